@@ -9,73 +9,6 @@
 #include "csua.h"
 #include "visitor.h"
 
-static void copy_declaration(CS_Compiler* compiler, CS_Executable* exec) {
-    DeclarationList* decl_list = compiler->decl_list;
-    int size;
-    for (size = 0; decl_list; decl_list = decl_list->next, ++size)
-        ;
-    CS_Variable* variables =
-        (CS_Variable*)MEM_malloc(sizeof(CS_Variable) * size);
-    decl_list = compiler->decl_list;
-    for (int i = 0; i < size; decl_list = decl_list->next, ++i) {
-        variables[i].name = MEM_strdup(decl_list->decl->name);
-        TypeSpecifier* type = MEM_malloc(sizeof(TypeSpecifier));
-        type->basic_type = decl_list->decl->type->basic_type;
-        variables[i].type = type;
-    }
-    exec->global_variable = variables;
-    exec->global_variable_count = size;
-}
-
-static CS_Executable* code_generate(CS_Compiler* compiler) {
-    CS_Executable* exec = (CS_Executable*)MEM_malloc(sizeof(CS_Executable));
-    memset(exec, 0x0, sizeof(CS_Executable));
-    exec->code = NULL;
-    exec->code_size = 0;
-    exec->constant_pool = NULL;
-    exec->constant_pool_count = 0;
-    exec->global_variable = NULL;
-    exec->global_variable_count = 0;
-
-    copy_declaration(compiler, exec);  // copy variables
-    CodegenVisitor* cgen_visitor = create_codegen_visitor(compiler, exec);
-
-    StatementList* stmt_list = compiler->stmt_list;
-    while (stmt_list) {
-        traverse_stmt(stmt_list->stmt, (Visitor*)cgen_visitor);
-        stmt_list = stmt_list->next;
-    }
-
-    exec->code_size = cgen_visitor->pos;
-    exec->code = (uint8_t*)MEM_malloc(exec->code_size);
-    memcpy(exec->code, cgen_visitor->code, exec->code_size);
-
-    if (cgen_visitor->code) {
-        MEM_free(cgen_visitor->code);
-    }
-    delete_visitor((Visitor*)cgen_visitor);
-
-    return exec;
-}
-
-static void delete_executable(CS_Executable* exec) {
-    for (int i = 0; i < exec->global_variable_count; ++i) {
-        MEM_free(exec->global_variable[i].name);
-        MEM_free(exec->global_variable[i].type);
-    }
-    MEM_free(exec->global_variable);
-
-    if (exec->constant_pool != NULL) {
-        MEM_free(exec->constant_pool);
-    }
-
-    if (exec->code != NULL) {
-        MEM_free(exec->code);
-    }
-
-    MEM_free(exec);
-}
-
 typedef struct {
     char buf[128];
     int index;
@@ -121,48 +54,6 @@ static void write_bytes(uint8_t* p, int len, FILE* fp) {
     fwrite(p, 1, len, fp);
 }
 
-static int count_stack_size(uint8_t* code, size_t len) {
-    int st_size = 0;
-    for (int i = 0; i < len; ++i) {
-        OpcodeInfo* oinfo = &svm_opcode_info[code[i]];
-        if (oinfo->s_size > 0) {
-            st_size += oinfo->s_size;
-        }
-        for (int j = 0; j < strlen(oinfo->parameter); ++j) {
-            switch (oinfo->parameter[j]) {
-                case 'i': {
-                    i += 2;
-                    break;
-                }
-                default: {
-                    fprintf(stderr, "unknown parameter [%c]in disassemble\n",
-                            oinfo->parameter[j]);
-                    exit(1);
-                }
-            }
-        }
-    }
-    return st_size;
-}
-
-static int count_pointer_stack_size(uint8_t* code, size_t len) {
-    int max_pst_size = 0;
-    int pst_size = 0;
-    for (int i = 0; i < len; ++i) {
-        OpcodeInfo* oinfo = &svm_opcode_info[code[i]];
-        if (strcmp(oinfo->opname, "push_stack_pointer") == 0) {
-            pst_size += 1;
-            if (pst_size > max_pst_size) {
-                max_pst_size = pst_size;
-            }
-        }
-        if (strcmp(oinfo->opname, "pop_stack_pointer") == 0) {
-            pst_size -= 1;
-        }
-    }
-    return max_pst_size;
-}
-
 static void serialize(CS_Executable* exec, char* filename) {
     FILE* fp;
 
@@ -207,7 +98,13 @@ static void serialize(CS_Executable* exec, char* filename) {
     for (int i = 0; i < exec->global_variable_count; ++i) {
         switch (exec->global_variable[i].type->basic_type) {
             case CS_BOOLEAN_TYPE:
-            case CS_INT_TYPE: {
+            case CS_INT_TYPE:
+            case CS_INT_ARRAY_TYPE:  // arrays, strings and maps are handles
+            case CS_DOUBLE_ARRAY_TYPE:
+            case CS_STRING_TYPE:
+            case CS_INT_MAP_TYPE:
+            case CS_DOUBLE_MAP_TYPE:
+            case CS_STRUCT_ARRAY_TYPE: {
                 write_char(SVM_INT, fp);
                 break;
             }
@@ -224,13 +121,25 @@ static void serialize(CS_Executable* exec, char* filename) {
 
     write_int(exec->code_size, fp);
     write_bytes(exec->code, exec->code_size, fp);
-    int stack_size = count_stack_size(exec->code, exec->code_size);
-    //    printf("s_size = %d\n", stack_size);
-    write_int(stack_size, fp);
+    write_int(exec->stack_size, fp);
+    write_int(exec->pt_stack_size, fp);
 
-    int pointer_stack_size =
-        count_pointer_stack_size(exec->code, exec->code_size);
-    write_int(pointer_stack_size, fp);
+    // optional trailing section: global names, for published layouts
+    for (int i = 0; i < exec->global_variable_count; ++i) {
+        int len = strlen(exec->global_variable[i].name);
+        write_int(len, fp);
+        write_bytes((uint8_t*)exec->global_variable[i].name, len, fp);
+    }
+
+    // then the string literals, when there are any
+    if (exec->string_count > 0) {
+        write_int(exec->string_count, fp);
+        for (int i = 0; i < exec->string_count; ++i) {
+            int len = strlen(exec->strings[i]);
+            write_int(len, fp);
+            write_bytes((uint8_t*)exec->strings[i], len, fp);
+        }
+    }
 
     fclose(fp);
 }
@@ -263,6 +172,10 @@ static void exec_disasm(CS_Executable* exec) {
             }
         }
     }
+    fprintf(stderr, "-- strings --\n");
+    for (int i = 0; i < exec->string_count; ++i) {
+        fprintf(stderr, "[%d]:\"%s\"\n", i, exec->strings[i]);
+    }
 
     fprintf(stderr, "-- code --\n");
     for (int i = 0; i < exec->code_size; ++i) {
@@ -324,6 +237,100 @@ static void exec_disasm(CS_Executable* exec) {
             case SVM_DECREMENT:
             case SVM_GOTO:
             case SVM_LABEL:
+            case SVM_PARALLEL_FOR:
+            case SVM_PARALLEL_END:
+            case SVM_FORK:
+            case SVM_JOIN:
+            case SVM_INVOKE_NATIVE:
+            case SVM_SQRT_DOUBLE:
+            case SVM_ABS_INT:
+            case SVM_ABS_DOUBLE:
+            case SVM_MIN_INT:
+            case SVM_MIN_DOUBLE:
+            case SVM_MAX_INT:
+            case SVM_MAX_DOUBLE:
+            case SVM_FLOOR_DOUBLE:
+            case SVM_FMA_INT:
+            case SVM_FMA_DOUBLE:
+            case SVM_SIN_DOUBLE:
+            case SVM_COS_DOUBLE:
+            case SVM_EXP_DOUBLE:
+            case SVM_LOG_DOUBLE:
+            case SVM_NEW_ARRAY_INT:
+            case SVM_NEW_ARRAY_DOUBLE:
+            case SVM_LOAD_ARRAY_INT:
+            case SVM_LOAD_ARRAY_DOUBLE:
+            case SVM_STORE_ARRAY_INT:
+            case SVM_STORE_ARRAY_DOUBLE:
+            case SVM_LOAD_ARRAY_INT_UNCHECKED:
+            case SVM_LOAD_ARRAY_DOUBLE_UNCHECKED:
+            case SVM_STORE_ARRAY_INT_UNCHECKED:
+            case SVM_STORE_ARRAY_DOUBLE_UNCHECKED:
+            case SVM_ARRAY_LENGTH:
+            case SVM_ARRAY_SUM:
+            case SVM_ARRAY_DOT:
+            case SVM_ARRAY_MIN:
+            case SVM_ARRAY_MAX:
+            case SVM_ARRAY_AXPY:
+            case SVM_ARRAY_FILL:
+            case SVM_ARRAY_COPY:
+            case SVM_PUSH_STRING:
+            case SVM_CONCAT_STRING:
+            case SVM_SUBSTR_STRING:
+            case SVM_STRING_LENGTH:
+            case SVM_EQ_STRING:
+            case SVM_NE_STRING:
+            case SVM_INT_TO_STRING:
+            case SVM_DOUBLE_TO_STRING:
+            case SVM_NEW_MAP_INT:
+            case SVM_NEW_MAP_DOUBLE:
+            case SVM_MAP_GET:
+            case SVM_MAP_PUT:
+            case SVM_MAP_INCREMENT:
+            case SVM_MAP_SIZE:
+            case SVM_NEW_RECORD_ARRAY:
+            case SVM_LOAD_FIELD_INT:
+            case SVM_LOAD_FIELD_DOUBLE:
+            case SVM_STORE_FIELD_INT:
+            case SVM_STORE_FIELD_DOUBLE:
+            case SVM_LOAD_FIELD_INT_UNCHECKED:
+            case SVM_LOAD_FIELD_DOUBLE_UNCHECKED:
+            case SVM_STORE_FIELD_INT_UNCHECKED:
+            case SVM_STORE_FIELD_DOUBLE_UNCHECKED:
+            case SVM_PUSH_STATIC_VECTOR:
+            case SVM_POP_STATIC_VECTOR:
+            case SVM_SPLAT_INT4:
+            case SVM_SPLAT_DOUBLE4:
+            case SVM_ADD_INT4:
+            case SVM_ADD_DOUBLE4:
+            case SVM_SUB_INT4:
+            case SVM_SUB_DOUBLE4:
+            case SVM_MUL_INT4:
+            case SVM_MUL_DOUBLE4:
+            case SVM_DIV_DOUBLE4:
+            case SVM_MINUS_INT4:
+            case SVM_MINUS_DOUBLE4:
+            case SVM_COMPARE_INT4:
+            case SVM_COMPARE_DOUBLE4:
+            case SVM_ALL_INT4:
+            case SVM_ANY_INT4:
+            case SVM_SUM_INT4:
+            case SVM_SUM_DOUBLE4:
+            case SVM_MIN_INT4:
+            case SVM_MIN_DOUBLE4:
+            case SVM_MAX_INT4:
+            case SVM_MAX_DOUBLE4:
+            case SVM_DOT_INT4:
+            case SVM_DOT_DOUBLE4:
+            case SVM_SHUFFLE_VECTOR:
+            case SVM_EXTRACT_VECTOR:
+            case SVM_INT4_TO_DOUBLE4:
+            case SVM_DOUBLE4_TO_INT4:
+            case SVM_JUMP:
+            case SVM_TABLE_SWITCH:
+            case SVM_LOOKUP_SWITCH:
+            case SVM_SELECT_INT:
+            case SVM_SELECT_DOUBLE:
             case SVM_INVOKE: {
                 add_string(&dinfo, oinfo->opname);
                 break;
@@ -370,10 +377,10 @@ int main(int argc, char* argv[]) {
 
     if (compile_result) {
         // Code Generate
-        CS_Executable* exec = code_generate(compiler);
+        CS_Executable* exec = CS_code_generate(compiler);
         exec_disasm(exec);
         serialize(exec, argv[2]);
-        delete_executable(exec);
+        CS_delete_executable(exec);
 
         fprintf(stderr, "\n--- Tree View ---\n");
         Visitor* visitor = create_treeview_visitor();
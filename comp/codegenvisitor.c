@@ -18,8 +18,8 @@ static void gen_byte_code(CodegenVisitor* visitor, SVM_Opcode op, ...) {
     va_start(ap, op);
 
     OpcodeInfo oInfo = svm_opcode_info[op];
-    printf("-->%s\n", oInfo.opname);
-    printf("-->%s\n", oInfo.parameter);
+    //    printf("-->%s\n", oInfo.opname);
+    //    printf("-->%s\n", oInfo.parameter);
 
     // pos + 1byte + operator (1byte) + operand_size
     if ((visitor->pos + 1 + 1 + (get_opsize(&oInfo))) >
@@ -56,6 +56,17 @@ static int add_constant(CS_Executable* exec, CS_ConstantPool* cpp) {
     return exec->constant_pool_count++;
 }
 
+/* Index of str among the string literals, added on first use. */
+static int add_string(CS_Executable* exec, const char* str) {
+    for (uint32_t i = 0; i < exec->string_count; ++i) {
+        if (!strcmp(exec->strings[i], str)) return i;
+    }
+    exec->strings = MEM_realloc(exec->strings,
+                                sizeof(char*) * (exec->string_count + 1));
+    exec->strings[exec->string_count] = MEM_strdup((char*)str);
+    return exec->string_count++;
+}
+
 static void enter_castexpr(Expression* expr, Visitor* visitor) {
     //    fprintf(stderr, "enter castexpr : %d\n",
     //    expr->u.cast_expression.ctype);
@@ -71,6 +82,22 @@ static void leave_castexpr(Expression* expr, Visitor* visitor) {
             gen_byte_code((CodegenVisitor*)visitor, SVM_CAST_DOUBLE_TO_INT);
             break;
         }
+        case CS_INT_TO_INT4: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_SPLAT_INT4);
+            break;
+        }
+        case CS_DOUBLE_TO_DOUBLE4: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_SPLAT_DOUBLE4);
+            break;
+        }
+        case CS_INT4_TO_DOUBLE4: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_INT4_TO_DOUBLE4);
+            break;
+        }
+        case CS_DOUBLE4_TO_INT4: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_DOUBLE4_TO_INT4);
+            break;
+        }
         default: {
             fprintf(stderr, "unknown cast type in codegenvisitor\n");
             exit(1);
@@ -123,6 +150,13 @@ static void leave_doubleexpr(Expression* expr, Visitor* visitor) {
     gen_byte_code((CodegenVisitor*)visitor, SVM_PUSH_DOUBLE, idx);
 }
 
+static void enter_stringexpr(Expression* expr, Visitor* visitor) {}
+static void leave_stringexpr(Expression* expr, Visitor* visitor) {
+    CS_Executable* exec = ((CodegenVisitor*)visitor)->exec;
+    gen_byte_code((CodegenVisitor*)visitor, SVM_PUSH_STRING,
+                  add_string(exec, expr->u.string_value));
+}
+
 static void enter_identexpr(Expression* expr, Visitor* visitor) {
     //    fprintf(stderr, "enter identifierexpr : %s\n",
     //    expr->u.identifier.name);
@@ -137,12 +171,21 @@ static void leave_identexpr(Expression* expr, Visitor* visitor) {
                 // printf("name=%s, index=%d\n",
                 //        expr->u.identifier.u.function->name,
                 //        expr->u.identifier.u.function->index);
-                gen_byte_code(c_visitor, SVM_PUSH_FUNCTION,
-                              expr->u.identifier.u.function->index);
+                // natives are called by SVM_INVOKE_NATIVE instead
+                if (find_native_index(expr->u.identifier.name) < 0) {
+                    gen_byte_code(c_visitor, SVM_PUSH_FUNCTION,
+                                  expr->u.identifier.u.function->index);
+                }
             } else {
                 switch (expr->type->basic_type) {
                     case CS_BOOLEAN_TYPE:
-                    case CS_INT_TYPE: {
+                    case CS_INT_TYPE:
+                    case CS_INT_ARRAY_TYPE:
+                    case CS_DOUBLE_ARRAY_TYPE:
+                    case CS_STRING_TYPE:
+                    case CS_INT_MAP_TYPE:
+                    case CS_DOUBLE_MAP_TYPE:
+                    case CS_STRUCT_ARRAY_TYPE: {
                         gen_byte_code(c_visitor, SVM_PUSH_STATIC_INT,
                                       expr->u.identifier.u.declaration->index);
                         break;
@@ -156,6 +199,12 @@ static void leave_identexpr(Expression* expr, Visitor* visitor) {
                                       expr->u.identifier.u.declaration->index);
                         break;
                     }
+                    case CS_INT4_TYPE:
+                    case CS_DOUBLE4_TYPE: {
+                        gen_byte_code(c_visitor, SVM_PUSH_STATIC_VECTOR,
+                                      expr->u.identifier.u.declaration->index);
+                        break;
+                    }
                     default: {
                         fprintf(stderr,
                                 "%d: unknown type in visit_normal in "
@@ -176,7 +225,13 @@ static void leave_identexpr(Expression* expr, Visitor* visitor) {
                 //                get_type_name(expr->type->basic_type));
                 switch (expr->type->basic_type) {
                     case CS_BOOLEAN_TYPE:
-                    case CS_INT_TYPE: {
+                    case CS_INT_TYPE:
+                    case CS_INT_ARRAY_TYPE:
+                    case CS_DOUBLE_ARRAY_TYPE:
+                    case CS_STRING_TYPE:
+                    case CS_INT_MAP_TYPE:
+                    case CS_DOUBLE_MAP_TYPE:
+                    case CS_STRUCT_ARRAY_TYPE: {
                         gen_byte_code(c_visitor, SVM_POP_STATIC_INT,
                                       expr->u.identifier.u.declaration->index);
                         break;
@@ -190,6 +245,12 @@ static void leave_identexpr(Expression* expr, Visitor* visitor) {
                                       expr->u.identifier.u.declaration->index);
                         break;
                     }
+                    case CS_INT4_TYPE:
+                    case CS_DOUBLE4_TYPE: {
+                        gen_byte_code(c_visitor, SVM_POP_STATIC_VECTOR,
+                                      expr->u.identifier.u.declaration->index);
+                        break;
+                    }
                     default: {
                         fprintf(
                             stderr,
@@ -212,7 +273,13 @@ static void leave_identexpr(Expression* expr, Visitor* visitor) {
                  VISIT_F_CALL)) {  // nested assign or inside function call
                 switch (expr->type->basic_type) {
                     case CS_BOOLEAN_TYPE:
-                    case CS_INT_TYPE: {
+                    case CS_INT_TYPE:
+                    case CS_INT_ARRAY_TYPE:
+                    case CS_DOUBLE_ARRAY_TYPE:
+                    case CS_STRING_TYPE:
+                    case CS_INT_MAP_TYPE:
+                    case CS_DOUBLE_MAP_TYPE:
+                    case CS_STRUCT_ARRAY_TYPE: {
                         gen_byte_code(c_visitor, SVM_PUSH_STATIC_INT,
                                       expr->u.identifier.u.declaration->index);
                         break;
@@ -226,6 +293,12 @@ static void leave_identexpr(Expression* expr, Visitor* visitor) {
                                       expr->u.identifier.u.declaration->index);
                         break;
                     }
+                    case CS_INT4_TYPE:
+                    case CS_DOUBLE4_TYPE: {
+                        gen_byte_code(c_visitor, SVM_PUSH_STATIC_VECTOR,
+                                      expr->u.identifier.u.declaration->index);
+                        break;
+                    }
                     default: {
                         fprintf(stderr,
                                 "%d: unknown type in leave_identexpr "
@@ -259,6 +332,18 @@ static void leave_addexpr(Expression* expr, Visitor* visitor) {
             gen_byte_code((CodegenVisitor*)visitor, SVM_ADD_DOUBLE);
             break;
         }
+        case CS_INT4_TYPE: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_ADD_INT4);
+            break;
+        }
+        case CS_DOUBLE4_TYPE: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_ADD_DOUBLE4);
+            break;
+        }
+        case CS_STRING_TYPE: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_CONCAT_STRING);
+            break;
+        }
         default: {
             fprintf(stderr,
                     "%d: unknown type in leave_addexpr codegenvisitor\n",
@@ -282,6 +367,14 @@ static void leave_subexpr(Expression* expr, Visitor* visitor) {
             gen_byte_code((CodegenVisitor*)visitor, SVM_SUB_DOUBLE);
             break;
         }
+        case CS_INT4_TYPE: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_SUB_INT4);
+            break;
+        }
+        case CS_DOUBLE4_TYPE: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_SUB_DOUBLE4);
+            break;
+        }
         default: {
             fprintf(stderr,
                     "%d: unknown type in leave_subexpr codegenvisitor\n",
@@ -304,6 +397,14 @@ static void leave_mulexpr(Expression* expr, Visitor* visitor) {
             gen_byte_code((CodegenVisitor*)visitor, SVM_MUL_DOUBLE);
             break;
         }
+        case CS_INT4_TYPE: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_MUL_INT4);
+            break;
+        }
+        case CS_DOUBLE4_TYPE: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_MUL_DOUBLE4);
+            break;
+        }
         default: {
             fprintf(stderr,
                     "%d: unknown type in leave_subexpr codegenvisitor\n",
@@ -327,6 +428,10 @@ static void leave_divexpr(Expression* expr, Visitor* visitor) {
             gen_byte_code((CodegenVisitor*)visitor, SVM_DIV_DOUBLE);
             break;
         }
+        case CS_DOUBLE4_TYPE: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_DIV_DOUBLE4);
+            break;
+        }
         default: {
             fprintf(stderr,
                     "%d: unknown type in leave_subexpr codegenvisitor\n",
@@ -373,6 +478,16 @@ static void leave_gtexpr(Expression* expr, Visitor* visitor) {
             gen_byte_code((CodegenVisitor*)visitor, SVM_GT_DOUBLE);
             break;
         }
+        case CS_INT4_TYPE: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_COMPARE_INT4,
+                          SVM_COMPARE_GT);
+            break;
+        }
+        case CS_DOUBLE4_TYPE: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_COMPARE_DOUBLE4,
+                          SVM_COMPARE_GT);
+            break;
+        }
         default: {
             fprintf(stderr, "%d: unknown type in leave_gtexpr codegenvisitor\n",
                     expr->line_number);
@@ -395,6 +510,16 @@ static void leave_geexpr(Expression* expr, Visitor* visitor) {
             gen_byte_code((CodegenVisitor*)visitor, SVM_GE_DOUBLE);
             break;
         }
+        case CS_INT4_TYPE: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_COMPARE_INT4,
+                          SVM_COMPARE_GE);
+            break;
+        }
+        case CS_DOUBLE4_TYPE: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_COMPARE_DOUBLE4,
+                          SVM_COMPARE_GE);
+            break;
+        }
         default: {
             fprintf(stderr, "%d: unknown type in leave_geexpr codegenvisitor\n",
                     expr->line_number);
@@ -418,6 +543,16 @@ static void leave_ltexpr(Expression* expr, Visitor* visitor) {
             gen_byte_code((CodegenVisitor*)visitor, SVM_LT_DOUBLE);
             break;
         }
+        case CS_INT4_TYPE: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_COMPARE_INT4,
+                          SVM_COMPARE_LT);
+            break;
+        }
+        case CS_DOUBLE4_TYPE: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_COMPARE_DOUBLE4,
+                          SVM_COMPARE_LT);
+            break;
+        }
         default: {
             fprintf(stderr, "%d: unknown type in leave_ltexpr codegenvisitor\n",
                     expr->line_number);
@@ -439,6 +574,16 @@ static void leave_leexpr(Expression* expr, Visitor* visitor) {
             gen_byte_code((CodegenVisitor*)visitor, SVM_LE_DOUBLE);
             break;
         }
+        case CS_INT4_TYPE: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_COMPARE_INT4,
+                          SVM_COMPARE_LE);
+            break;
+        }
+        case CS_DOUBLE4_TYPE: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_COMPARE_DOUBLE4,
+                          SVM_COMPARE_LE);
+            break;
+        }
         default: {
             fprintf(stderr, "%d: unknown type in leave_leexpr codegenvisitor\n",
                     expr->line_number);
@@ -454,7 +599,12 @@ static void leave_eqexpr(Expression* expr, Visitor* visitor) {
     //    fprintf(stderr, "leave eqexpr\n");
     switch (expr->u.binary_expression.left->type->basic_type) {
         case CS_BOOLEAN_TYPE:
-        case CS_INT_TYPE: {
+        case CS_INT_TYPE:
+        case CS_INT_ARRAY_TYPE:
+        case CS_DOUBLE_ARRAY_TYPE:
+        case CS_INT_MAP_TYPE:
+        case CS_DOUBLE_MAP_TYPE:
+        case CS_STRUCT_ARRAY_TYPE: {
             gen_byte_code((CodegenVisitor*)visitor, SVM_EQ_INT);
             break;
         }
@@ -462,6 +612,21 @@ static void leave_eqexpr(Expression* expr, Visitor* visitor) {
             gen_byte_code((CodegenVisitor*)visitor, SVM_EQ_DOUBLE);
             break;
         }
+        case CS_STRING_TYPE: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_EQ_STRING);
+            break;
+        }
+        case CS_INT4_TYPE:
+        case CS_DOUBLE4_TYPE: {  // true when every lane is
+            gen_byte_code((CodegenVisitor*)visitor,
+                          cs_lane_type(expr->u.binary_expression.left->type
+                                           ->basic_type) == CS_DOUBLE_TYPE
+                              ? SVM_COMPARE_DOUBLE4
+                              : SVM_COMPARE_INT4,
+                          SVM_COMPARE_EQ);
+            gen_byte_code((CodegenVisitor*)visitor, SVM_ALL_INT4);
+            break;
+        }
         default: {
             fprintf(stderr, "%d: unknown type in leave_eqexpr codegenvisitor\n",
                     expr->line_number);
@@ -477,7 +642,12 @@ static void leave_neexpr(Expression* expr, Visitor* visitor) {
     //    fprintf(stderr, "leave neexpr\n");
     switch (expr->u.binary_expression.left->type->basic_type) {
         case CS_BOOLEAN_TYPE:
-        case CS_INT_TYPE: {
+        case CS_INT_TYPE:
+        case CS_INT_ARRAY_TYPE:
+        case CS_DOUBLE_ARRAY_TYPE:
+        case CS_INT_MAP_TYPE:
+        case CS_DOUBLE_MAP_TYPE:
+        case CS_STRUCT_ARRAY_TYPE: {
             gen_byte_code((CodegenVisitor*)visitor, SVM_NE_INT);
             break;
         }
@@ -485,6 +655,21 @@ static void leave_neexpr(Expression* expr, Visitor* visitor) {
             gen_byte_code((CodegenVisitor*)visitor, SVM_NE_DOUBLE);
             break;
         }
+        case CS_STRING_TYPE: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_NE_STRING);
+            break;
+        }
+        case CS_INT4_TYPE:
+        case CS_DOUBLE4_TYPE: {  // true when any lane is
+            gen_byte_code((CodegenVisitor*)visitor,
+                          cs_lane_type(expr->u.binary_expression.left->type
+                                           ->basic_type) == CS_DOUBLE_TYPE
+                              ? SVM_COMPARE_DOUBLE4
+                              : SVM_COMPARE_INT4,
+                          SVM_COMPARE_NE);
+            gen_byte_code((CodegenVisitor*)visitor, SVM_ANY_INT4);
+            break;
+        }
         default: {
             fprintf(stderr, "%d: unknown type in leave_eqexpr codegenvisitor\n",
                     expr->line_number);
@@ -558,6 +743,14 @@ static void leave_minusexpr(Expression* expr, Visitor* visitor) {
             gen_byte_code((CodegenVisitor*)visitor, SVM_MINUS_DOUBLE);
             break;
         }
+        case CS_INT4_TYPE: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_MINUS_INT4);
+            break;
+        }
+        case CS_DOUBLE4_TYPE: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_MINUS_DOUBLE4);
+            break;
+        }
         default: {
             fprintf(stderr,
                     "%d: unknown type in leave_minusexpr codegenvisitor\n",
@@ -584,12 +777,23 @@ static void enter_assignexpr(Expression* expr, Visitor* visitor) {
         if (expr->u.assignment_expression.left->kind == IDENTIFIER_EXPRESSION &&
             expr->u.assignment_expression.left->u.identifier.is_function ==
                 CS_FALSE) {
-            gen_byte_code((CodegenVisitor*)visitor, SVM_PUSH_STATIC_INT,
+            TypeSpecifier* type = expr->u.assignment_expression.left->type;
+            SVM_Opcode op = SVM_PUSH_STATIC_INT;
+            if (cs_is_aggregate(type)) {
+                op = SVM_PUSH_STATIC_VECTOR;
+            } else if (type->basic_type == CS_DOUBLE_TYPE) {
+                op = SVM_PUSH_STATIC_DOUBLE;  // lanes keep doubles apart
+            }
+            gen_byte_code((CodegenVisitor*)visitor, op,
                           expr->u.assignment_expression.left->u.identifier.u
                               .declaration->index);
 
             // gen_byte_code((CodegenVisitor*)visitor, SVM_PUSH_STATIC_INT,
             //            expr->u.inc_dec->u.identifier.u.declaration->index);
+        } else if (expr->u.assignment_expression.left->kind ==
+                   INDEX_EXPRESSION) {
+            // loads the element, the mean check keeps the index pure
+            traverse_expr(expr->u.assignment_expression.left, visitor);
         }
     }
 
@@ -621,6 +825,18 @@ static void notify_assignexpr(Expression* expr, Visitor* visitor) {
                     gen_byte_code((CodegenVisitor*)visitor, SVM_ADD_DOUBLE);
                     break;
                 }
+                case CS_INT4_TYPE: {
+                    gen_byte_code((CodegenVisitor*)visitor, SVM_ADD_INT4);
+                    break;
+                }
+                case CS_DOUBLE4_TYPE: {
+                    gen_byte_code((CodegenVisitor*)visitor, SVM_ADD_DOUBLE4);
+                    break;
+                }
+                case CS_STRING_TYPE: {
+                    gen_byte_code((CodegenVisitor*)visitor, SVM_CONCAT_STRING);
+                    break;
+                }
                 default: {
                     exit(1);
                 }
@@ -637,6 +853,14 @@ static void notify_assignexpr(Expression* expr, Visitor* visitor) {
                     gen_byte_code((CodegenVisitor*)visitor, SVM_SUB_DOUBLE);
                     break;
                 }
+                case CS_INT4_TYPE: {
+                    gen_byte_code((CodegenVisitor*)visitor, SVM_SUB_INT4);
+                    break;
+                }
+                case CS_DOUBLE4_TYPE: {
+                    gen_byte_code((CodegenVisitor*)visitor, SVM_SUB_DOUBLE4);
+                    break;
+                }
                 default: {
                     exit(1);
                 }
@@ -653,6 +877,14 @@ static void notify_assignexpr(Expression* expr, Visitor* visitor) {
                     gen_byte_code((CodegenVisitor*)visitor, SVM_MUL_DOUBLE);
                     break;
                 }
+                case CS_INT4_TYPE: {
+                    gen_byte_code((CodegenVisitor*)visitor, SVM_MUL_INT4);
+                    break;
+                }
+                case CS_DOUBLE4_TYPE: {
+                    gen_byte_code((CodegenVisitor*)visitor, SVM_MUL_DOUBLE4);
+                    break;
+                }
                 default: {
                     exit(1);
                 }
@@ -669,6 +901,10 @@ static void notify_assignexpr(Expression* expr, Visitor* visitor) {
                     gen_byte_code((CodegenVisitor*)visitor, SVM_DIV_DOUBLE);
                     break;
                 }
+                case CS_DOUBLE4_TYPE: {
+                    gen_byte_code((CodegenVisitor*)visitor, SVM_DIV_DOUBLE4);
+                    break;
+                }
                 default: {
                     exit(1);
                 }
@@ -706,6 +942,153 @@ static void notify_assignexpr(Expression* expr, Visitor* visitor) {
     ((CodegenVisitor*)visitor)->vi_state = VISIT_NOMAL_ASSIGN;
 }
 
+/*
+ * As an assignment target a[i] is evaluated like a load, the array and the
+ * index go on the stack above the value and STORE takes all three.
+ */
+static void enter_indexexpr(Expression* expr, Visitor* visitor) {
+    CodegenVisitor* c_visitor = (CodegenVisitor*)visitor;
+    if (c_visitor->vi_state == VISIT_NOMAL_ASSIGN) {
+        c_visitor->index_target = expr;
+        c_visitor->vi_state = VISIT_NORMAL;
+    }
+}
+
+static void gen_array_load(CodegenVisitor* visitor, Expression* expr) {
+    int is_double = expr->type->basic_type == CS_DOUBLE_TYPE;
+    int field = expr->u.index_expression.field;
+    if (field >= 0) {  // a[i].name
+        if (expr->u.index_expression.checked) {
+            gen_byte_code(visitor,
+                          is_double ? SVM_LOAD_FIELD_DOUBLE
+                                    : SVM_LOAD_FIELD_INT,
+                          field);
+        } else {
+            gen_byte_code(visitor,
+                          is_double ? SVM_LOAD_FIELD_DOUBLE_UNCHECKED
+                                    : SVM_LOAD_FIELD_INT_UNCHECKED,
+                          field);
+        }
+    } else if (expr->u.index_expression.checked) {
+        gen_byte_code(visitor, is_double ? SVM_LOAD_ARRAY_DOUBLE
+                                         : SVM_LOAD_ARRAY_INT);
+    } else {
+        gen_byte_code(visitor, is_double ? SVM_LOAD_ARRAY_DOUBLE_UNCHECKED
+                                         : SVM_LOAD_ARRAY_INT_UNCHECKED);
+    }
+}
+
+static void leave_indexexpr(Expression* expr, Visitor* visitor) {
+    CodegenVisitor* c_visitor = (CodegenVisitor*)visitor;
+    if (c_visitor->index_target != expr) {
+        gen_array_load(c_visitor, expr);
+        return;
+    }
+    int is_double = expr->type->basic_type == CS_DOUBLE_TYPE;
+    int field = expr->u.index_expression.field;
+    if (field >= 0) {
+        if (expr->u.index_expression.checked) {
+            gen_byte_code(c_visitor,
+                          is_double ? SVM_STORE_FIELD_DOUBLE
+                                    : SVM_STORE_FIELD_INT,
+                          field);
+        } else {
+            gen_byte_code(c_visitor,
+                          is_double ? SVM_STORE_FIELD_DOUBLE_UNCHECKED
+                                    : SVM_STORE_FIELD_INT_UNCHECKED,
+                          field);
+        }
+    } else if (expr->u.index_expression.checked) {
+        gen_byte_code(c_visitor, is_double ? SVM_STORE_ARRAY_DOUBLE
+                                           : SVM_STORE_ARRAY_INT);
+    } else {
+        gen_byte_code(c_visitor, is_double ? SVM_STORE_ARRAY_DOUBLE_UNCHECKED
+                                           : SVM_STORE_ARRAY_INT_UNCHECKED);
+    }
+    c_visitor->index_target = NULL;
+    if ((c_visitor->assign_depth > 1) ||
+        (c_visitor->vf_state == VISIT_F_CALL)) {  // the value is used
+        traverse_expr(expr->u.index_expression.array, visitor);
+        traverse_expr(expr->u.index_expression.index, visitor);
+        gen_array_load(c_visitor, expr);
+    }
+    c_visitor->vi_state = VISIT_NOMAL_ASSIGN;
+}
+
+// lanes of a vector that is not a variable, v.x of a variable v is v.x
+static void enter_memberexpr(Expression* expr, Visitor* visitor) {}
+static void leave_memberexpr(Expression* expr, Visitor* visitor) {
+    CS_BasicType type = expr->type->basic_type;
+    gen_byte_code((CodegenVisitor*)visitor,
+                  type == CS_INT4_TYPE || type == CS_DOUBLE4_TYPE
+                      ? SVM_SHUFFLE_VECTOR
+                      : SVM_EXTRACT_VECTOR,
+                  expr->u.member_expression.swizzle);
+}
+
+static void enter_newarrayexpr(Expression* expr, Visitor* visitor) {}
+static void leave_newarrayexpr(Expression* expr, Visitor* visitor) {
+    gen_byte_code((CodegenVisitor*)visitor,
+                  expr->type->basic_type == CS_DOUBLE_ARRAY_TYPE
+                      ? SVM_NEW_ARRAY_DOUBLE
+                      : SVM_NEW_ARRAY_INT);
+}
+
+/* Opcode of each intrinsic as {int variant, double variant}. */
+static const SVM_Opcode intrinsic_opcodes[CS_INTRINSIC_PLUS_ONE][2] = {
+    [CS_INTRINSIC_SQRT] = {0, SVM_SQRT_DOUBLE},
+    [CS_INTRINSIC_ABS] = {SVM_ABS_INT, SVM_ABS_DOUBLE},
+    [CS_INTRINSIC_MIN] = {SVM_MIN_INT, SVM_MIN_DOUBLE},
+    [CS_INTRINSIC_MAX] = {SVM_MAX_INT, SVM_MAX_DOUBLE},
+    [CS_INTRINSIC_FLOOR] = {0, SVM_FLOOR_DOUBLE},
+    [CS_INTRINSIC_FMA] = {SVM_FMA_INT, SVM_FMA_DOUBLE},
+    [CS_INTRINSIC_SIN] = {0, SVM_SIN_DOUBLE},
+    [CS_INTRINSIC_COS] = {0, SVM_COS_DOUBLE},
+    [CS_INTRINSIC_EXP] = {0, SVM_EXP_DOUBLE},
+    [CS_INTRINSIC_LOG] = {0, SVM_LOG_DOUBLE},
+    // the array kernels read the element type from the array
+    [CS_INTRINSIC_LENGTH] = {SVM_ARRAY_LENGTH, SVM_ARRAY_LENGTH},
+    [CS_INTRINSIC_SUM] = {SVM_ARRAY_SUM, SVM_ARRAY_SUM},
+    [CS_INTRINSIC_DOT] = {SVM_ARRAY_DOT, SVM_ARRAY_DOT},
+    [CS_INTRINSIC_ARRAY_MIN] = {SVM_ARRAY_MIN, SVM_ARRAY_MIN},
+    [CS_INTRINSIC_ARRAY_MAX] = {SVM_ARRAY_MAX, SVM_ARRAY_MAX},
+    [CS_INTRINSIC_AXPY] = {SVM_ARRAY_AXPY, SVM_ARRAY_AXPY},
+    [CS_INTRINSIC_FILL] = {SVM_ARRAY_FILL, SVM_ARRAY_FILL},
+    [CS_INTRINSIC_COPY] = {SVM_ARRAY_COPY, SVM_ARRAY_COPY},
+    [CS_INTRINSIC_STRING_LENGTH] = {SVM_STRING_LENGTH, SVM_STRING_LENGTH},
+    [CS_INTRINSIC_SUBSTR] = {SVM_SUBSTR_STRING, SVM_SUBSTR_STRING},
+    [CS_INTRINSIC_STR] = {SVM_INT_TO_STRING, SVM_DOUBLE_TO_STRING},
+    [CS_INTRINSIC_GET] = {SVM_MAP_GET, SVM_MAP_GET},
+    [CS_INTRINSIC_PUT] = {SVM_MAP_PUT, SVM_MAP_PUT},
+    [CS_INTRINSIC_INCREMENT] = {SVM_MAP_INCREMENT, SVM_MAP_INCREMENT},
+    [CS_INTRINSIC_SIZE] = {SVM_MAP_SIZE, SVM_MAP_SIZE},
+    [CS_INTRINSIC_ALL] = {SVM_ALL_INT4, 0},
+    [CS_INTRINSIC_ANY] = {SVM_ANY_INT4, 0},
+    [CS_INTRINSIC_VECTOR_SUM] = {SVM_SUM_INT4, SVM_SUM_DOUBLE4},
+    [CS_INTRINSIC_VECTOR_DOT] = {SVM_DOT_INT4, SVM_DOT_DOUBLE4},
+    [CS_INTRINSIC_VECTOR_MIN] = {SVM_MIN_INT4, SVM_MIN_DOUBLE4},
+    [CS_INTRINSIC_VECTOR_MAX] = {SVM_MAX_INT4, SVM_MAX_DOUBLE4},
+};
+
+// the variant follows the type of the first argument, which the mean check
+// has already cast to the type of the result wherever they agree
+static void gen_intrinsic(CodegenVisitor* visitor, Expression* expr) {
+    CS_Intrinsic intrinsic = expr->u.function_call_expression.intrinsic;
+    Expression* first = expr->u.function_call_expression.argument->expr;
+    int is_double = first->type->basic_type == CS_DOUBLE_TYPE ||
+                    first->type->basic_type == CS_DOUBLE4_TYPE;
+    if (intrinsic == CS_INTRINSIC_INT4 || intrinsic == CS_INTRINSIC_DOUBLE4) {
+        return;  // the arguments already are the lanes
+    }
+    SVM_Opcode op = intrinsic_opcodes[intrinsic][is_double];
+    if (op == 0) {
+        fprintf(stderr, "%d: no int variant of intrinsic %d\n",
+                expr->line_number, intrinsic);
+        exit(1);
+    }
+    gen_byte_code(visitor, op);
+}
+
 static void enter_funccallexpr(Expression* expr, Visitor* visitor) {
     //    fprintf(stderr, "enter function call :\n");
     ((CodegenVisitor*)visitor)->vf_state = VISIT_F_CALL;
@@ -713,7 +1096,19 @@ static void enter_funccallexpr(Expression* expr, Visitor* visitor) {
 static void leave_funccallexpr(Expression* expr, Visitor* visitor) {
     //    fprintf(stderr, "leave function call\n");
     ((CodegenVisitor*)visitor)->vf_state = VISIT_F_NO;
-    gen_byte_code((CodegenVisitor*)visitor, SVM_INVOKE);
+    if (expr->u.function_call_expression.intrinsic != CS_INTRINSIC_NONE) {
+        gen_intrinsic((CodegenVisitor*)visitor, expr);
+        return;
+    }
+    Expression* function = expr->u.function_call_expression.function;
+    int native = function->kind == IDENTIFIER_EXPRESSION
+                     ? find_native_index(function->u.identifier.name)
+                     : -1;
+    if (native >= 0) {
+        gen_byte_code((CodegenVisitor*)visitor, SVM_INVOKE_NATIVE, native);
+    } else {
+        gen_byte_code((CodegenVisitor*)visitor, SVM_INVOKE);
+    }
 }
 
 /* For statement */
@@ -727,6 +1122,12 @@ static void leave_exprstmt(Statement* stmt, Visitor* visitor) {
     switch (c_visitor->vi_state) {
         case VISIT_NORMAL: {
             gen_byte_code(c_visitor, SVM_POP);
+            if (stmt->u.expression_s->type &&
+                cs_is_aggregate(stmt->u.expression_s->type)) {
+                for (int i = 1; i < SVM_VECTOR_LANES; ++i) {
+                    gen_byte_code(c_visitor, SVM_POP);
+                }
+            }
             break;
         }
         case VISIT_NOMAL_ASSIGN: {
@@ -756,6 +1157,35 @@ static void enter_declstmt(Statement* stmt, Visitor* visitor) {
 
 static void leave_declstmt(Statement* stmt, Visitor* visitor) {
     //    fprintf(stderr, "leave declstmt\n");
+    Declaration* array = stmt->u.declaration_s;
+    if (array->type->array_length > 0) {  // int[8] a; allocates here
+        CodegenVisitor* c_visitor = (CodegenVisitor*)visitor;
+        CS_ConstantPool cp;
+        cp.type = CS_CONSTANT_INT;
+        cp.u.c_int = array->type->array_length;
+        gen_byte_code(c_visitor, SVM_PUSH_INT,
+                      add_constant(c_visitor->exec, &cp));
+        if (array->type->basic_type == CS_STRUCT_ARRAY_TYPE) {
+            gen_byte_code(c_visitor, SVM_NEW_RECORD_ARRAY,
+                          array->type->struct_def->stride);
+        } else {
+            gen_byte_code(c_visitor,
+                          array->type->basic_type == CS_DOUBLE_ARRAY_TYPE
+                              ? SVM_NEW_ARRAY_DOUBLE
+                              : SVM_NEW_ARRAY_INT);
+        }
+        gen_byte_code(c_visitor, SVM_POP_STATIC_INT, array->index);
+    }
+    if (!array->initializer &&  // map<int,int> m; allocates here too
+        (array->type->basic_type == CS_INT_MAP_TYPE ||
+         array->type->basic_type == CS_DOUBLE_MAP_TYPE)) {
+        CodegenVisitor* c_visitor = (CodegenVisitor*)visitor;
+        gen_byte_code(c_visitor,
+                      array->type->basic_type == CS_DOUBLE_MAP_TYPE
+                          ? SVM_NEW_MAP_DOUBLE
+                          : SVM_NEW_MAP_INT);
+        gen_byte_code(c_visitor, SVM_POP_STATIC_INT, array->index);
+    }
     if (stmt->u.declaration_s->initializer) {
         Declaration* decl = NULL;
         //? cs_search_decl_in_blockを適用する必要あり？
@@ -768,7 +1198,13 @@ static void leave_declstmt(Statement* stmt, Visitor* visitor) {
 
             switch (decl->type->basic_type) {
                 case CS_BOOLEAN_TYPE:
-                case CS_INT_TYPE: {
+                case CS_INT_TYPE:
+                case CS_INT_ARRAY_TYPE:
+                case CS_DOUBLE_ARRAY_TYPE:
+                case CS_STRING_TYPE:
+                case CS_INT_MAP_TYPE:
+                case CS_DOUBLE_MAP_TYPE:
+                case CS_STRUCT_ARRAY_TYPE: {
                     gen_byte_code((CodegenVisitor*)visitor, SVM_POP_STATIC_INT,
                                   decl->index);
                     break;
@@ -778,6 +1214,12 @@ static void leave_declstmt(Statement* stmt, Visitor* visitor) {
                                   SVM_POP_STATIC_DOUBLE, decl->index);
                     break;
                 }
+                case CS_INT4_TYPE:
+                case CS_DOUBLE4_TYPE: {
+                    gen_byte_code((CodegenVisitor*)visitor,
+                                  SVM_POP_STATIC_VECTOR, decl->index);
+                    break;
+                }
                 default: {
                     fprintf(stderr, "unknown type in leave_declstmt\n");
                     exit(1);
@@ -863,6 +1305,194 @@ static void leave_if_stmt(Statement* stmt, Visitor* visitor) {
     }
 }
 
+static int add_int_constant(CS_Executable* exec, int value) {
+    CS_ConstantPool cp;
+    cp.type = CS_CONSTANT_INT;
+    cp.u.c_int = value;
+    return add_constant(exec, &cp);
+}
+
+static void enter_parallelstmt(Statement* stmt, Visitor* visitor) {}
+
+/*
+ * The bounds are on the stack when PARALLEL_FOR runs. Its operand points at
+ * a descriptor in the constant pool:
+ *   loop variable, reduction count, (global, SVM_Reduction) per reduction
+ */
+static void leave_parallelstmt(Statement* stmt, Visitor* visitor) {
+    CodegenVisitor* c_visitor = (CodegenVisitor*)visitor;
+    ParallelForOperation* parallel = stmt->u.parallel_s;
+    if (parallel->op_kind == PARALLEL_OP_LEAVE) {
+        gen_byte_code(c_visitor, SVM_PARALLEL_END);
+        return;
+    }
+
+    CS_Executable* exec = c_visitor->exec;
+    if (parallel->inclusive) {
+        gen_byte_code(c_visitor, SVM_PUSH_INT, add_int_constant(exec, 1));
+        gen_byte_code(c_visitor, SVM_ADD_INT);
+    }
+    int count = 0;
+    for (ReductionList* r = parallel->reduction; r; r = r->next) count++;
+    int desc = add_int_constant(exec, parallel->loop_variable->index);
+    add_int_constant(exec, count);
+    for (ReductionList* r = parallel->reduction; r; r = r->next) {
+        add_int_constant(exec, r->declaration->index);
+        add_int_constant(exec, r->kind);
+    }
+    gen_byte_code(c_visitor, SVM_PARALLEL_FOR, desc);
+}
+
+/*
+ * Both arms of a branchless ?: are on the stack above the condition when
+ * it is left. Otherwise the condition jumps to the false arm at label and
+ * the true arm jumps past it to label + 1.
+ */
+static void enter_condexpr(Expression* expr, Visitor* visitor) {}
+
+static void notify_condexpr(Expression* expr, Visitor* visitor) {
+    ConditionalExpression* c_expr = &expr->u.conditional_expression;
+    if (c_expr->branchless) return;
+    if (c_expr->label < 0) {  // after the condition
+        c_expr->label = id;
+        id += 2;
+        gen_byte_code((CodegenVisitor*)visitor, SVM_GOTO, c_expr->label);
+    } else {  // after the true arm
+        gen_byte_code((CodegenVisitor*)visitor, SVM_JUMP, c_expr->label + 1);
+        gen_byte_code((CodegenVisitor*)visitor, SVM_LABEL, c_expr->label);
+    }
+}
+
+static void leave_condexpr(Expression* expr, Visitor* visitor) {
+    ConditionalExpression* c_expr = &expr->u.conditional_expression;
+    if (!c_expr->branchless) {
+        gen_byte_code((CodegenVisitor*)visitor, SVM_LABEL, c_expr->label + 1);
+    } else if (expr->type->basic_type == CS_DOUBLE_TYPE) {
+        gen_byte_code((CodegenVisitor*)visitor, SVM_SELECT_DOUBLE);
+    } else {
+        gen_byte_code((CodegenVisitor*)visitor, SVM_SELECT_INT);
+    }
+}
+
+/* A switch with this many keys or fewer compares them one by one. */
+#define SWITCH_CHAIN_CASES (3)
+
+static void gen_switch_chain(CodegenVisitor* visitor, SwitchBlock* block,
+                             SwitchKey* keys, int count, int default_label) {
+    CS_Executable* exec = visitor->exec;
+    gen_byte_code(visitor, SVM_POP_STATIC_INT, block->value->index);
+    for (int i = 0; i < count; ++i) {
+        gen_byte_code(visitor, SVM_PUSH_STATIC_INT, block->value->index);
+        gen_byte_code(visitor, SVM_PUSH_INT,
+                      add_int_constant(exec, keys[i].value));
+        gen_byte_code(visitor, SVM_NE_INT);
+        gen_byte_code(visitor, SVM_GOTO, keys[i].case_s->label);
+    }
+    gen_byte_code(visitor, SVM_JUMP, default_label);
+}
+
+/* low, count, default, then a label for every key in [low, low + count) */
+static void gen_table_switch(CodegenVisitor* visitor, SwitchKey* keys,
+                             int count, int default_label) {
+    CS_Executable* exec = visitor->exec;
+    int low = keys[0].value;
+    int range = keys[count - 1].value - low + 1;
+    int table = add_int_constant(exec, low);
+    add_int_constant(exec, range);
+    add_int_constant(exec, default_label);
+    for (int i = 0, k = 0; i < range; ++i) {
+        if (keys[k].value == low + i) {
+            add_int_constant(exec, keys[k++].case_s->label);
+        } else {
+            add_int_constant(exec, default_label);
+        }
+    }
+    gen_byte_code(visitor, SVM_TABLE_SWITCH, table);
+}
+
+/* count, default, then (key, label) pairs sorted by key */
+static void gen_lookup_switch(CodegenVisitor* visitor, SwitchKey* keys,
+                              int count, int default_label) {
+    CS_Executable* exec = visitor->exec;
+    int table = add_int_constant(exec, count);
+    add_int_constant(exec, default_label);
+    for (int i = 0; i < count; ++i) {
+        add_int_constant(exec, keys[i].value);
+        add_int_constant(exec, keys[i].case_s->label);
+    }
+    gen_byte_code(visitor, SVM_LOOKUP_SWITCH, table);
+}
+
+/*
+ * The value is on the stack when the switch is entered. Few keys become an
+ * if-chain, keys filling at least half of their range a table and the rest
+ * a sorted lookup. Each case ends with a jump past the switch.
+ */
+static void enter_switchstmt(Statement* stmt, Visitor* visitor) {}
+
+static void leave_switchstmt(Statement* stmt, Visitor* visitor) {
+    CodegenVisitor* c_visitor = (CodegenVisitor*)visitor;
+    SwitchOperation* op = stmt->u.switch_s;
+    SwitchBlock* block = op->block;
+    switch (op->op_kind) {
+        case SWITCH_OP_ENTER: {
+            block->end_label = id++;
+            int default_label = block->end_label;
+            for (SwitchCase* c = block->cases; c; c = c->next) {
+                c->label = id++;
+                if (c->is_default) default_label = c->label;
+            }
+            SwitchKey* keys;
+            int count = cs_sort_switch_keys(block, &keys);
+            if (count <= SWITCH_CHAIN_CASES) {
+                gen_switch_chain(c_visitor, block, keys, count, default_label);
+            } else if ((int64_t)keys[count - 1].value - keys[0].value <
+                       2 * (int64_t)count) {
+                gen_table_switch(c_visitor, keys, count, default_label);
+            } else {
+                gen_lookup_switch(c_visitor, keys, count, default_label);
+            }
+            MEM_free(keys);
+            break;
+        }
+        case SWITCH_OP_CASE: {
+            if (op->case_s != block->cases) {
+                gen_byte_code(c_visitor, SVM_JUMP, block->end_label);
+            }
+            gen_byte_code(c_visitor, SVM_LABEL, op->case_s->label);
+            break;
+        }
+        case SWITCH_OP_LEAVE: {
+            gen_byte_code(c_visitor, SVM_LABEL, block->end_label);
+            break;
+        }
+        default: {
+            fprintf(stderr, "unknown type in leave_switchstmt\n");
+            exit(1);
+        }
+    }
+}
+
+static void enter_regionstmt(Statement* stmt, Visitor* visitor) {}
+
+static void leave_regionstmt(Statement* stmt, Visitor* visitor) {
+    switch (stmt->u.region_s->op_kind) {
+        case REGION_OP_FORK: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_FORK,
+                          stmt->u.region_s->segment_count);
+            break;
+        }
+        case REGION_OP_JOIN: {
+            gen_byte_code((CodegenVisitor*)visitor, SVM_JOIN);
+            break;
+        }
+        default: {
+            fprintf(stderr, "unknown type in leave_regionstmt\n");
+            exit(1);
+        }
+    }
+}
+
 CodegenVisitor* create_codegen_visitor(CS_Compiler* compiler,
                                        CS_Executable* exec) {
     visit_expr* enter_expr_list;
@@ -888,6 +1518,7 @@ CodegenVisitor* create_codegen_visitor(CS_Compiler* compiler,
     visitor->vi_state = VISIT_NORMAL;
     visitor->vf_state = VISIT_F_NO;
     visitor->assign_depth = 0;
+    visitor->index_target = NULL;
 
     enter_expr_list =
         (visit_expr*)MEM_malloc(sizeof(visit_expr) * EXPRESSION_KIND_PLUS_ONE);
@@ -933,13 +1564,22 @@ CodegenVisitor* create_codegen_visitor(CS_Compiler* compiler,
     enter_expr_list[ASSIGN_EXPRESSION] = enter_assignexpr;
     enter_expr_list[FUNCTION_CALL_EXPRESSION] = enter_funccallexpr;
     enter_expr_list[CAST_EXPRESSION] = enter_castexpr;
+    enter_expr_list[INDEX_EXPRESSION] = enter_indexexpr;
+    enter_expr_list[NEW_ARRAY_EXPRESSION] = enter_newarrayexpr;
+    enter_expr_list[MEMBER_EXPRESSION] = enter_memberexpr;
+    enter_expr_list[CONDITIONAL_EXPRESSION] = enter_condexpr;
+    enter_expr_list[STRING_EXPRESSION] = enter_stringexpr;
 
     enter_stmt_list[EXPRESSION_STATEMENT] = enter_exprstmt;
     enter_stmt_list[DECLARATION_STATEMENT] = enter_declstmt;
     enter_stmt_list[BLOCKOPERATION_STATEMENT] = enter_blkopstmt;
     enter_stmt_list[IF_STATEMENT] = enter_if_stmt;
+    enter_stmt_list[PARALLEL_FOR_STATEMENT] = enter_parallelstmt;
+    enter_stmt_list[REGION_STATEMENT] = enter_regionstmt;
+    enter_stmt_list[SWITCH_STATEMENT] = enter_switchstmt;
 
     notify_expr_list[ASSIGN_EXPRESSION] = notify_assignexpr;
+    notify_expr_list[CONDITIONAL_EXPRESSION] = notify_condexpr;
 
     leave_expr_list[BOOLEAN_EXPRESSION] = leave_boolexpr;
     leave_expr_list[INT_EXPRESSION] = leave_intexpr;
@@ -966,11 +1606,19 @@ CodegenVisitor* create_codegen_visitor(CS_Compiler* compiler,
     leave_expr_list[ASSIGN_EXPRESSION] = leave_assignexpr;
     leave_expr_list[FUNCTION_CALL_EXPRESSION] = leave_funccallexpr;
     leave_expr_list[CAST_EXPRESSION] = leave_castexpr;
+    leave_expr_list[INDEX_EXPRESSION] = leave_indexexpr;
+    leave_expr_list[NEW_ARRAY_EXPRESSION] = leave_newarrayexpr;
+    leave_expr_list[MEMBER_EXPRESSION] = leave_memberexpr;
+    leave_expr_list[CONDITIONAL_EXPRESSION] = leave_condexpr;
+    leave_expr_list[STRING_EXPRESSION] = leave_stringexpr;
 
     leave_stmt_list[EXPRESSION_STATEMENT] = leave_exprstmt;
     leave_stmt_list[DECLARATION_STATEMENT] = leave_declstmt;
     leave_stmt_list[BLOCKOPERATION_STATEMENT] = leave_blkopstmt;
     leave_stmt_list[IF_STATEMENT] = leave_if_stmt;
+    leave_stmt_list[PARALLEL_FOR_STATEMENT] = leave_parallelstmt;
+    leave_stmt_list[REGION_STATEMENT] = leave_regionstmt;
+    leave_stmt_list[SWITCH_STATEMENT] = leave_switchstmt;
 
     ((Visitor*)visitor)->enter_expr_list = enter_expr_list;
     ((Visitor*)visitor)->leave_expr_list = leave_expr_list;
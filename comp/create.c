@@ -80,6 +80,12 @@ Expression *cs_create_boolean_expression(CS_Boolean v) {
     return expr;
 }
 
+Expression *cs_create_string_expression(char *v) {
+    Expression *expr = cs_create_expression(STRING_EXPRESSION);
+    expr->u.string_value = v;
+    return expr;
+}
+
 Expression *cs_create_identifier_expression(char *identifier) {
     Expression *expr = cs_create_expression(IDENTIFIER_EXPRESSION);
     expr->u.identifier.name = identifier;
@@ -99,6 +105,7 @@ Expression *cs_create_function_call_expression(Expression *function,
     Expression *expr = cs_create_expression(FUNCTION_CALL_EXPRESSION);
     expr->u.function_call_expression.function = function;
     expr->u.function_call_expression.argument = args;
+    expr->u.function_call_expression.intrinsic = CS_INTRINSIC_NONE;
     return expr;
 }
 
@@ -140,6 +147,43 @@ Expression *cs_create_cast_expression(CS_CastType ctype, Expression *operand) {
     return expr;
 }
 
+Expression *cs_create_index_expression(Expression *array, Expression *index) {
+    Expression *expr = cs_create_expression(INDEX_EXPRESSION);
+    expr->u.index_expression.array = array;
+    expr->u.index_expression.index = index;
+    expr->u.index_expression.checked = CS_TRUE;
+    expr->u.index_expression.field = -1;
+    return expr;
+}
+
+Expression *cs_create_new_array_expression(CS_BasicType element,
+                                           Expression *length) {
+    Expression *expr = cs_create_expression(NEW_ARRAY_EXPRESSION);
+    expr->u.new_array_expression.type = cs_array_type(element);
+    expr->u.new_array_expression.length = length;
+    return expr;
+}
+
+Expression *cs_create_member_expression(Expression *record, char *member) {
+    Expression *expr = cs_create_expression(MEMBER_EXPRESSION);
+    expr->u.member_expression.expression = record;
+    expr->u.member_expression.member = member;
+    expr->u.member_expression.swizzle = 0;
+    return expr;
+}
+
+Expression *cs_create_conditional_expression(Expression *condition,
+                                             Expression *true_expr,
+                                             Expression *false_expr) {
+    Expression *expr = cs_create_expression(CONDITIONAL_EXPRESSION);
+    expr->u.conditional_expression.condition = condition;
+    expr->u.conditional_expression.true_expr = true_expr;
+    expr->u.conditional_expression.false_expr = false_expr;
+    expr->u.conditional_expression.branchless = CS_FALSE;
+    expr->u.conditional_expression.label = -1;
+    return expr;
+}
+
 char *cs_create_identifier(const char *str) {
     char *new_char;
     new_char = (char *)cs_malloc(strlen(str) + 1);
@@ -165,10 +209,55 @@ Statement *cs_create_expression_statement(Expression *expr) {
 TypeSpecifier *cs_create_type_specifier(CS_BasicType type) {
     TypeSpecifier *ts = (TypeSpecifier *)cs_malloc(sizeof(TypeSpecifier));
     ts->basic_type = type;
+    ts->array_length = 0;
+    ts->struct_def = NULL;
 
     return ts;
 }
 
+/* CS_BASIC_TYPE_PLUS_ONE for an element type arrays cannot hold */
+CS_BasicType cs_array_type(CS_BasicType element) {
+    switch (element) {
+        case CS_INT_TYPE: {
+            return CS_INT_ARRAY_TYPE;
+        }
+        case CS_DOUBLE_TYPE: {
+            return CS_DOUBLE_ARRAY_TYPE;
+        }
+        default: {
+            return CS_BASIC_TYPE_PLUS_ONE;
+        }
+    }
+}
+
+CS_BasicType cs_element_type(CS_BasicType array) {
+    return array == CS_DOUBLE_ARRAY_TYPE ? CS_DOUBLE_TYPE : CS_INT_TYPE;
+}
+
+CS_BasicType cs_lane_type(CS_BasicType vector) {
+    return vector == CS_DOUBLE4_TYPE ? CS_DOUBLE_TYPE : CS_INT_TYPE;
+}
+
+/* CS_BASIC_TYPE_PLUS_ONE unless key is int and value int or double */
+CS_BasicType cs_map_type(CS_BasicType key, CS_BasicType value) {
+    if (key != CS_INT_TYPE) return CS_BASIC_TYPE_PLUS_ONE;
+    switch (value) {
+        case CS_INT_TYPE: {
+            return CS_INT_MAP_TYPE;
+        }
+        case CS_DOUBLE_TYPE: {
+            return CS_DOUBLE_MAP_TYPE;
+        }
+        default: {
+            return CS_BASIC_TYPE_PLUS_ONE;
+        }
+    }
+}
+
+CS_BasicType cs_map_value_type(CS_BasicType map) {
+    return map == CS_DOUBLE_MAP_TYPE ? CS_DOUBLE_TYPE : CS_INT_TYPE;
+}
+
 ParameterList *cs_create_parameter(CS_BasicType type, char *name) {
     ParameterList *param = (ParameterList *)cs_malloc(sizeof(ParameterList));
     param->type = cs_create_type_specifier(type);
@@ -178,6 +267,28 @@ ParameterList *cs_create_parameter(CS_BasicType type, char *name) {
     return param;
 }
 
+FieldList *cs_create_field(CS_BasicType type, char *name) {
+    FieldList *field = (FieldList *)cs_malloc(sizeof(FieldList));
+    field->name = name;
+    field->type = cs_create_type_specifier(type);
+    field->offset = -1;
+    field->line_number = *linenum;
+    field->next = NULL;
+    return field;
+}
+
+StructDefinition *cs_create_struct_definition(char *name, FieldList *field) {
+    StructDefinition *def =
+        (StructDefinition *)cs_malloc(sizeof(StructDefinition));
+    def->name = name;
+    def->field = field;
+    def->field_count = 0;
+    def->stride = 0;
+    def->line_number = *linenum;
+    def->next = NULL;
+    return def;
+}
+
 static Declaration *cs_create_declaration(CS_BasicType type, char *name,
                                           Expression *initializer) {
     Declaration *decl = (Declaration *)cs_malloc(sizeof(Declaration));
@@ -195,6 +306,50 @@ Statement *cs_create_declaration_statement(CS_BasicType type, char *name,
     return stmt;
 }
 
+/* int[] name, or int[length] name when length > 0 */
+Statement *cs_create_array_declaration_statement(CS_BasicType element,
+                                                 int length, char *name,
+                                                 Expression *initializer) {
+    Statement *stmt = cs_create_statement(DECLARATION_STATEMENT);
+    stmt->u.declaration_s =
+        cs_create_declaration(cs_array_type(element), name, initializer);
+    stmt->u.declaration_s->type->array_length = length;
+    return stmt;
+}
+
+/*
+ * struct name var, or struct name[length] var when length > 0. The type
+ * has no struct_def when the struct is not defined yet.
+ */
+Statement *cs_create_struct_declaration_statement(char *struct_name,
+                                                  int length, char *name) {
+    Statement *stmt = cs_create_statement(DECLARATION_STATEMENT);
+    stmt->u.declaration_s = cs_create_declaration(
+        length > 0 ? CS_STRUCT_ARRAY_TYPE : CS_STRUCT_TYPE, name, NULL);
+    stmt->u.declaration_s->type->array_length = length;
+    stmt->u.declaration_s->type->struct_def = cs_search_struct(struct_name);
+    return stmt;
+}
+
+/* The variable record.field, which holds that field of a struct variable. */
+Declaration *cs_create_field_declaration(Declaration *record,
+                                         FieldList *field) {
+    char *name = cs_malloc(strlen(record->name) + strlen(field->name) + 2);
+    sprintf(name, "%s.%s", record->name, field->name);
+    return cs_create_declaration(field->type->basic_type, name, NULL);
+}
+
+/*
+ * Lane lane of a vector variable v, a variable v.x, v.y, v.z or v.w of
+ * the lane type. The lanes are declared right after v and hold its value.
+ */
+Declaration *cs_create_lane_declaration(Declaration *vector, int lane) {
+    char *name = cs_malloc(strlen(vector->name) + 3);
+    sprintf(name, "%s.%c", vector->name, "xyzw"[lane]);
+    return cs_create_declaration(cs_lane_type(vector->type->basic_type), name,
+                                 NULL);
+}
+
 StatementList *cs_create_statement_list(Statement *stmt) {
     StatementList *stmt_list =
         (StatementList *)cs_malloc(sizeof(StatementList));
@@ -271,3 +426,119 @@ Statement *cs_create_if_end_statement() {
     stmt->u.ifop_s->op_kind = IF_OP_LEAVE;
     return stmt;
 }
+
+Statement *cs_create_parallel_for_begin_statement(
+    Statement *loop_variable, Expression *lower, char *cond_name,
+    CS_Boolean inclusive, Expression *upper, char *step_name,
+    ReductionList *reduction) {
+    Statement *stmt = cs_create_statement(PARALLEL_FOR_STATEMENT);
+    stmt->u.parallel_s = cs_malloc(sizeof(ParallelForOperation));
+    stmt->u.parallel_s->op_kind = PARALLEL_OP_ENTER;
+    stmt->u.parallel_s->loop_variable = loop_variable->u.declaration_s;
+    stmt->u.parallel_s->lower = lower;
+    stmt->u.parallel_s->upper = upper;
+    stmt->u.parallel_s->inclusive = inclusive;
+    stmt->u.parallel_s->cond_name = cond_name;
+    stmt->u.parallel_s->step_name = step_name;
+    stmt->u.parallel_s->reduction = reduction;
+    return stmt;
+}
+
+Statement *cs_create_parallel_for_end_statement() {
+    Statement *stmt = cs_create_statement(PARALLEL_FOR_STATEMENT);
+    stmt->u.parallel_s = cs_malloc(sizeof(ParallelForOperation));
+    stmt->u.parallel_s->op_kind = PARALLEL_OP_LEAVE;
+    stmt->u.parallel_s->reduction = NULL;
+    return stmt;
+}
+
+Statement *cs_create_fork_statement(int segment_count) {
+    Statement *stmt = cs_create_statement(REGION_STATEMENT);
+    stmt->u.region_s = cs_malloc(sizeof(RegionOperation));
+    stmt->u.region_s->op_kind = REGION_OP_FORK;
+    stmt->u.region_s->segment_count = segment_count;
+    return stmt;
+}
+
+Statement *cs_create_join_statement() {
+    Statement *stmt = cs_create_statement(REGION_STATEMENT);
+    stmt->u.region_s = cs_malloc(sizeof(RegionOperation));
+    stmt->u.region_s->op_kind = REGION_OP_JOIN;
+    stmt->u.region_s->segment_count = 0;
+    return stmt;
+}
+
+/* int switch.N; that keeps the value of a switch, N counts switches */
+Statement *cs_create_switch_value_statement() {
+    static int switch_count = 0;
+    char *name = cs_malloc(24);
+    sprintf(name, "switch.%d", switch_count++);
+    return cs_create_declaration_statement(CS_INT_TYPE, name, NULL);
+}
+
+Statement *cs_create_switch_begin_statement(Statement *value,
+                                            Expression *expr) {
+    CS_Compiler *compiler = cs_get_current_compiler();
+    Statement *stmt = cs_create_statement(SWITCH_STATEMENT);
+    SwitchBlock *block = cs_malloc(sizeof(SwitchBlock));
+    block->expression = expr;
+    block->value = value->u.declaration_s;
+    block->cases = NULL;
+    block->end_label = 0;
+    block->enclosing = compiler->switch_block;
+    compiler->switch_block = block;
+    stmt->u.switch_s = cs_malloc(sizeof(SwitchOperation));
+    stmt->u.switch_s->op_kind = SWITCH_OP_ENTER;
+    stmt->u.switch_s->block = block;
+    stmt->u.switch_s->case_s = NULL;
+    return stmt;
+}
+
+/* case values:, or default: when values is NULL, of the innermost switch */
+Statement *cs_create_case_statement(CaseValueList *values) {
+    SwitchBlock *block = cs_get_current_compiler()->switch_block;
+    Statement *stmt = cs_create_statement(SWITCH_STATEMENT);
+    SwitchCase *case_s = cs_malloc(sizeof(SwitchCase));
+    case_s->values = values;
+    case_s->is_default = values == NULL;
+    case_s->line_number = stmt->line_number;
+    case_s->label = 0;
+    case_s->next = NULL;
+    SwitchCase **tail = &block->cases;
+    while (*tail) tail = &(*tail)->next;
+    *tail = case_s;
+    stmt->u.switch_s = cs_malloc(sizeof(SwitchOperation));
+    stmt->u.switch_s->op_kind = SWITCH_OP_CASE;
+    stmt->u.switch_s->block = block;
+    stmt->u.switch_s->case_s = case_s;
+    return stmt;
+}
+
+Statement *cs_create_switch_end_statement() {
+    CS_Compiler *compiler = cs_get_current_compiler();
+    Statement *stmt = cs_create_statement(SWITCH_STATEMENT);
+    stmt->u.switch_s = cs_malloc(sizeof(SwitchOperation));
+    stmt->u.switch_s->op_kind = SWITCH_OP_LEAVE;
+    stmt->u.switch_s->block = compiler->switch_block;
+    stmt->u.switch_s->case_s = NULL;
+    compiler->switch_block = compiler->switch_block->enclosing;
+    return stmt;
+}
+
+ReductionList *cs_create_reduction(char *kind_name, char *name) {
+    ReductionList *reduction = cs_malloc(sizeof(ReductionList));
+    reduction->kind_name = kind_name;
+    reduction->name = name;
+    reduction->line_number = *linenum;
+    reduction->kind = 0;
+    reduction->declaration = NULL;
+    reduction->next = NULL;
+    return reduction;
+}
+
+CaseValueList *cs_create_case_value(int value) {
+    CaseValueList *list = cs_malloc(sizeof(CaseValueList));
+    list->value = value;
+    list->next = NULL;
+    return list;
+}
@@ -11,15 +11,18 @@
 #include <stdio.h>
 
 #include "../memory/MEM.h"
+#include "../svm/svm.h"
 
 typedef struct Expression_tag Expression;
 typedef struct BlockOperation_tag BlockOperation;
 typedef struct Visitor_tag Visitor;
 typedef struct MeanVisitor_tag MeanVisitor;
 typedef struct CodegenVisitor_tag CodegenVisitor;
+typedef struct RegionVisitor_tag RegionVisitor;
 typedef struct CS_Compiler_tag CS_Compiler;
 
 typedef struct TypeSpecifier_tag TypeSpecifier;
+typedef struct StructDefinition_tag StructDefinition;
 typedef struct Statement_tag Statement;
 
 typedef enum { CS_FALSE = 0, CS_TRUE = 1 } CS_Boolean;
@@ -28,16 +31,54 @@ typedef enum {
     CS_BOOLEAN_TYPE,
     CS_INT_TYPE,
     CS_DOUBLE_TYPE,
+    CS_INT_ARRAY_TYPE,
+    CS_DOUBLE_ARRAY_TYPE,
+    CS_STRING_TYPE,
+    CS_INT_MAP_TYPE,  // map<int,int>
+    CS_DOUBLE_MAP_TYPE,
+    CS_STRUCT_TYPE,  // struct name, see TypeSpecifier.struct_def
+    CS_STRUCT_ARRAY_TYPE,
+    CS_INT4_TYPE,  // SVM_VECTOR_LANES lanes, see cs_create_lane_declaration
+    CS_DOUBLE4_TYPE,
     CS_BASIC_TYPE_PLUS_ONE,
 } CS_BasicType;
 
 typedef enum {
     CS_INT_TO_DOUBLE = 1,
     CS_DOUBLE_TO_INT,
+    CS_INT_TO_INT4,  // the scalar in every lane
+    CS_DOUBLE_TO_DOUBLE4,
+    CS_INT4_TO_DOUBLE4,
+    CS_DOUBLE4_TO_INT4,
 } CS_CastType;
 
 struct TypeSpecifier_tag {
     CS_BasicType basic_type;
+    int array_length;  // int[8] and double[8], 0 when sized by new
+    StructDefinition *struct_def;  // NULL unless a struct or array of them
+};
+
+/* A field of a struct, offset is its slot in the record. */
+typedef struct FieldList_tag {
+    char *name;
+    TypeSpecifier *type;
+    int offset;
+    int line_number;
+    struct FieldList_tag *next;
+} FieldList;
+
+/*
+ * struct name { fields }. The mean check lays the fields out one value
+ * each in declaration order; stride is the values per record of an array,
+ * padded so that no record crosses a cache line. 0 until laid out.
+ */
+struct StructDefinition_tag {
+    char *name;
+    FieldList *field;
+    int field_count;
+    int stride;
+    int line_number;
+    StructDefinition *next;
 };
 
 typedef struct {
@@ -93,12 +134,57 @@ typedef enum {
     LOGICAL_OR_EXPRESSION,
     ASSIGN_EXPRESSION,
     CAST_EXPRESSION,
+    INDEX_EXPRESSION,
+    NEW_ARRAY_EXPRESSION,
+    STRING_EXPRESSION,
+    MEMBER_EXPRESSION,
+    CONDITIONAL_EXPRESSION,
     EXPRESSION_KIND_PLUS_ONE
 } ExpressionKind;
 
+/* Math and array builtins compiled to a single opcode instead of a call. */
+typedef enum {
+    CS_INTRINSIC_NONE = 0,
+    CS_INTRINSIC_SQRT,
+    CS_INTRINSIC_ABS,
+    CS_INTRINSIC_MIN,
+    CS_INTRINSIC_MAX,
+    CS_INTRINSIC_FLOOR,
+    CS_INTRINSIC_FMA,
+    CS_INTRINSIC_SIN,
+    CS_INTRINSIC_COS,
+    CS_INTRINSIC_EXP,
+    CS_INTRINSIC_LOG,
+    CS_INTRINSIC_LENGTH,
+    CS_INTRINSIC_SUM,
+    CS_INTRINSIC_DOT,
+    CS_INTRINSIC_ARRAY_MIN,  // min and max of one array argument
+    CS_INTRINSIC_ARRAY_MAX,
+    CS_INTRINSIC_AXPY,
+    CS_INTRINSIC_FILL,
+    CS_INTRINSIC_COPY,
+    CS_INTRINSIC_STRING_LENGTH,  // length of a string argument
+    CS_INTRINSIC_SUBSTR,
+    CS_INTRINSIC_STR,
+    CS_INTRINSIC_GET,
+    CS_INTRINSIC_PUT,
+    CS_INTRINSIC_INCREMENT,
+    CS_INTRINSIC_SIZE,
+    CS_INTRINSIC_INT4,  // int4(x, y, z, w) and int4(s)
+    CS_INTRINSIC_DOUBLE4,
+    CS_INTRINSIC_ALL,  // of an int4, whether every lane / any lane is set
+    CS_INTRINSIC_ANY,
+    CS_INTRINSIC_VECTOR_SUM,  // sum, dot, min and max of vector arguments
+    CS_INTRINSIC_VECTOR_DOT,
+    CS_INTRINSIC_VECTOR_MIN,
+    CS_INTRINSIC_VECTOR_MAX,
+    CS_INTRINSIC_PLUS_ONE
+} CS_Intrinsic;
+
 typedef struct {
     Expression *function;
     ArgumentList *argument;
+    CS_Intrinsic intrinsic;  // set by the mean check
 } FunctionCallExpression;
 
 typedef struct {
@@ -136,6 +222,50 @@ typedef struct {
     Expression *right;
 } AssignmentExpression;
 
+/*
+ * array[index]; checked is cleared when the index is proven in range.
+ * array[index].name of an array of structs is an index expression too,
+ * field being the slot of name in the record and -1 otherwise.
+ */
+typedef struct {
+    Expression *array;
+    Expression *index;
+    CS_Boolean checked;
+    int field;
+} IndexExpression;
+
+/*
+ * record.name, replaced by the mean check with the identifier of the
+ * field or an IndexExpression. On a vector it picks lanes by x, y, z and
+ * w: v.y of a variable is the identifier of the lane, any other v.y or
+ * v.wzyx stays and swizzle holds the lane of each result lane, 2 bits
+ * apiece.
+ */
+typedef struct {
+    Expression *expression;
+    char *member;
+    int swizzle;
+} MemberExpression;
+
+/*
+ * condition ? true_expr : false_expr. The mean check sets branchless when
+ * both arms can be evaluated whatever the condition is, so a select picks
+ * the value. Otherwise codegen jumps to label or past label + 1.
+ */
+typedef struct {
+    Expression *condition;
+    Expression *true_expr;
+    Expression *false_expr;
+    CS_Boolean branchless;
+    int label;
+} ConditionalExpression;
+
+/* new int[length] or new double[length] */
+typedef struct {
+    CS_BasicType type;  // the array type
+    Expression *length;
+} NewArrayExpression;
+
 typedef enum {
     BLOCK_OPE_BEGIN = 1,
     BLOCK_OPE_END,
@@ -154,6 +284,7 @@ struct Expression_tag {
         double double_value;
         int int_value;
         CS_Boolean boolean_value;
+        char *string_value;
         IdentifierExpression identifier;
         Expression *inc_dec;
         FunctionCallExpression function_call_expression;
@@ -162,6 +293,10 @@ struct Expression_tag {
         BinaryExpression binary_expression;
         AssignmentExpression assignment_expression;
         CastExpression cast_expression;
+        IndexExpression index_expression;
+        NewArrayExpression new_array_expression;
+        MemberExpression member_expression;
+        ConditionalExpression conditional_expression;
     } u;
 };
 
@@ -172,6 +307,9 @@ typedef enum {
     DECLARATION_STATEMENT,
     BLOCKOPERATION_STATEMENT,
     IF_STATEMENT,
+    PARALLEL_FOR_STATEMENT,
+    REGION_STATEMENT,
+    SWITCH_STATEMENT,
     STATEMENT_TYPE_COUNT_PLUS_ONE,
 } StatementType;
 
@@ -182,6 +320,84 @@ typedef struct {
     IF_OP_KIND op_kind;
 } IfOperation;
 
+typedef enum { PARALLEL_OP_ENTER, PARALLEL_OP_LEAVE } PARALLEL_OP_KIND;
+
+/* reduce(kind: name), kind is resolved to SVM_Reduction by the mean check */
+typedef struct ReductionList_tag {
+    char *kind_name;
+    char *name;
+    int line_number;
+    SVM_Reduction kind;
+    Declaration *declaration;
+    struct ReductionList_tag *next;
+} ReductionList;
+
+/*
+ * parallel for (int i = lower; i < upper; i++) reduce(...) { ... }
+ * cond_name and step_name are the loop variable as written in the
+ * condition and the increment; the mean check requires them to match.
+ */
+typedef struct {
+    PARALLEL_OP_KIND op_kind;
+    Declaration *loop_variable;
+    Expression *lower;
+    Expression *upper;
+    CS_Boolean inclusive;  // i <= upper
+    char *cond_name;
+    char *step_name;
+    ReductionList *reduction;
+} ParallelForOperation;
+
+typedef enum { REGION_OP_FORK, REGION_OP_JOIN } REGION_OP_KIND;
+
+/* Put around top-level statements that may run concurrently, see
+ * cs_schedule_regions() */
+typedef struct {
+    REGION_OP_KIND op_kind;
+    int segment_count;  // REGION_OP_FORK only
+} RegionOperation;
+
+typedef enum { SWITCH_OP_ENTER, SWITCH_OP_CASE, SWITCH_OP_LEAVE } SWITCH_OP_KIND;
+
+typedef struct CaseValueList_tag {
+    int value;
+    struct CaseValueList_tag *next;
+} CaseValueList;
+
+/* case 1, 2: holds 1 and 2, default: holds no value */
+typedef struct SwitchCase_tag {
+    CaseValueList *values;
+    CS_Boolean is_default;
+    int line_number;
+    int label;  // set by codegen
+    struct SwitchCase_tag *next;
+} SwitchCase;
+
+/*
+ * switch (expression) { case 1: ... default: ... }. A case runs up to the
+ * next one, there is no fall through and no break. The enter, case and
+ * leave statements of one switch share it.
+ */
+typedef struct SwitchBlock_tag {
+    Expression *expression;
+    Declaration *value;  // the expression again, for an if-chain
+    SwitchCase *cases;
+    int end_label;                      // set by codegen
+    struct SwitchBlock_tag *enclosing;  // while parsing
+} SwitchBlock;
+
+typedef struct {
+    SWITCH_OP_KIND op_kind;
+    SwitchBlock *block;
+    SwitchCase *case_s;  // SWITCH_OP_CASE only
+} SwitchOperation;
+
+/* A case value and its case, see cs_sort_switch_keys() */
+typedef struct {
+    int value;
+    SwitchCase *case_s;
+} SwitchKey;
+
 struct Statement_tag {
     StatementType type;
     int line_number;
@@ -190,6 +406,9 @@ struct Statement_tag {
         Declaration *declaration_s;
         BlockOperation *blockop_s;
         IfOperation *ifop_s;
+        ParallelForOperation *parallel_s;
+        RegionOperation *region_s;
+        SwitchOperation *switch_s;
     } u;
 };
 
@@ -233,12 +452,14 @@ struct CS_Compiler_tag {
     StatementList *stmt_list;
     DeclarationList *decl_list;
     FunctionDeclarationList *func_list;
+    StructDefinition *struct_list;
     int current_line;
 
     DeclarationList *decl_list_tail;
     FunctionDeclarationList *func_list_tail;
     CheckpointList *cp_list;
     CheckpointList *cp_list_tail;
+    SwitchBlock *switch_block;  // innermost switch being parsed
 };
 
 /* For Code Generation */
@@ -265,6 +486,10 @@ typedef struct {
     CS_Variable *global_variable;
     uint32_t code_size;
     uint8_t *code;
+    uint32_t stack_size;
+    uint32_t pt_stack_size;
+    uint32_t string_count;
+    char **strings;  // string literals, each once
 } CS_Executable;
 
 /* create.c */
@@ -273,6 +498,7 @@ void *cs_malloc(size_t size);
 Expression *cs_create_int_expression(int v);
 Expression *cs_create_double_expression(double v);
 Expression *cs_create_boolean_expression(CS_Boolean v);
+Expression *cs_create_string_expression(char *v);
 Expression *cs_create_identifier_expression(char *identifier);
 Expression *cs_create_inc_dec_expression(Expression *id_expr,
                                          ExpressionKind inc_dec);
@@ -286,6 +512,13 @@ Expression *cs_create_assignment_expression(Expression *left,
                                             AssignmentOperator aope,
                                             Expression *operand);
 Expression *cs_create_cast_expression(CS_CastType ctype, Expression *operand);
+Expression *cs_create_index_expression(Expression *array, Expression *index);
+Expression *cs_create_new_array_expression(CS_BasicType element,
+                                           Expression *length);
+Expression *cs_create_member_expression(Expression *record, char *member);
+Expression *cs_create_conditional_expression(Expression *condition,
+                                             Expression *true_expr,
+                                             Expression *false_expr);
 void delete_storage();
 ExpressionList *cs_chain_expression_list(ExpressionList *list,
                                          Expression *expr);
@@ -294,10 +527,23 @@ char *cs_create_identifier(const char *str);
 Statement *cs_create_expression_statement(Expression *expr);
 Statement *cs_create_declaration_statement(CS_BasicType type, char *name,
                                            Expression *initializer);
+Statement *cs_create_array_declaration_statement(CS_BasicType element,
+                                                 int length, char *name,
+                                                 Expression *initializer);
+Statement *cs_create_struct_declaration_statement(char *struct_name,
+                                                  int length, char *name);
+Declaration *cs_create_field_declaration(Declaration *record,
+                                         FieldList *field);
+Declaration *cs_create_lane_declaration(Declaration *vector, int lane);
 StatementList *cs_create_statement_list(Statement *stmt);
 
 DeclarationList *cs_create_declaration_list(Declaration *decl);
 TypeSpecifier *cs_create_type_specifier(CS_BasicType type);
+CS_BasicType cs_array_type(CS_BasicType element);
+CS_BasicType cs_element_type(CS_BasicType array);
+CS_BasicType cs_lane_type(CS_BasicType vector);
+CS_BasicType cs_map_type(CS_BasicType key, CS_BasicType value);
+CS_BasicType cs_map_value_type(CS_BasicType map);
 
 FunctionDeclaration *cs_create_function_declaration(CS_BasicType type,
                                                     char *name,
@@ -306,6 +552,8 @@ FunctionDeclarationList *cs_create_function_declaration_list(
     FunctionDeclaration *func);
 
 ParameterList *cs_create_parameter(CS_BasicType type, char *name);
+FieldList *cs_create_field(CS_BasicType type, char *name);
+StructDefinition *cs_create_struct_definition(char *name, FieldList *field);
 ArgumentList *cs_create_argument(Expression *expr);
 
 /* interface.c */
@@ -313,6 +561,11 @@ CS_Compiler *CS_create_compiler();
 CS_Boolean CS_compile(CS_Compiler *compiler, FILE *fin);
 void CS_delete_compiler(CS_Compiler *compiler);
 
+/* executable.c */
+CS_Executable *CS_code_generate(CS_Compiler *compiler);
+void CS_delete_executable(CS_Executable *exec);
+SVM_Program *CS_create_program(CS_Executable *exec);
+
 /* util.c */
 void cs_set_current_compiler(CS_Compiler *compiler);
 CS_Compiler *cs_get_current_compiler();
@@ -330,14 +583,38 @@ FunctionDeclaration *cs_search_func_in_block(
     const char *name, FunctionDeclarationList *decl_list_border,
     CheckpointList *cp_list_boarder);  // Added
 FunctionDeclaration *cs_search_function(const char *name);
+CS_Intrinsic cs_search_intrinsic(const char *name, int *arg_count);
 ParameterList *cs_chain_parameter_list(ParameterList *list, CS_BasicType type,
                                        char *name);
 ArgumentList *cs_chain_argument_list(ArgumentList *list, Expression *expr);
+ReductionList *cs_chain_reduction_list(ReductionList *list, char *kind_name,
+                                       char *name);
+FieldList *cs_chain_field_list(FieldList *list, CS_BasicType type,
+                               char *name);
+CaseValueList *cs_chain_case_value_list(CaseValueList *list, int value);
+int cs_sort_switch_keys(SwitchBlock *block, SwitchKey **keys);
+void cs_define_struct(StructDefinition *def);
+StructDefinition *cs_search_struct(const char *name);
+CS_Boolean cs_is_aggregate(const TypeSpecifier *type);
 
 Statement *cs_create_block_begin_statement();
 Statement *cs_create_block_end_statement();
 Statement *cs_create_if_begin_statement(Expression *expr);
 Statement *cs_create_if_end_statement();
+Statement *cs_create_parallel_for_begin_statement(
+    Statement *loop_variable, Expression *lower, char *cond_name,
+    CS_Boolean inclusive, Expression *upper, char *step_name,
+    ReductionList *reduction);
+Statement *cs_create_parallel_for_end_statement();
+Statement *cs_create_fork_statement(int segment_count);
+Statement *cs_create_join_statement();
+Statement *cs_create_switch_value_statement();
+Statement *cs_create_switch_begin_statement(Statement *value,
+                                            Expression *expr);
+Statement *cs_create_case_statement(CaseValueList *values);
+Statement *cs_create_switch_end_statement();
+ReductionList *cs_create_reduction(char *kind_name, char *name);
+CaseValueList *cs_create_case_value(int value);
 
 void cs_record_checkpoint(BlockOperationType type);
 
@@ -17,12 +17,17 @@ int yylex();
     CS_BasicType         type_specifier;
     ParameterList       *parameter_list;
     ArgumentList        *argument_list;
+    ReductionList       *reduction_list;
+    FieldList           *field_list;
+    CaseValueList       *case_value_list;
 }
 
 %token LP
 %token RP
 %token LC
 %token RC
+%token LB
+%token RB
 %token COMMA
 %token LOGICAL_AND
 %token LOGICAL_OR
@@ -35,6 +40,7 @@ int yylex();
 %token LT
 %token SEMICOLON
 %token COLON
+%token QUESTION
 %token ADD
 %token SUB
 %token MUL
@@ -53,6 +59,7 @@ int yylex();
 %token <iv>   INT_LITERAL
 %token <dv>   DOUBLE_LITERAL
 %token <name> IDENTIFIER
+%token <name> STRING_LITERAL
 
 
 %token IF
@@ -69,8 +76,19 @@ int yylex();
 %token INT_T
 %token DOUBLE_T
 %token STRING_T
-
-%type <expression> expression assignment_expression logical_or_expression
+%token PARALLEL_T
+%token REDUCE_T
+%token NEW_T
+%token MAP_T
+%token STRUCT_T
+%token INT4_T
+%token DOUBLE4_T
+%token SWITCH_T
+%token CASE_T
+%token DEFAULT_T
+
+%type <expression> expression assignment_expression conditional_expression
+                 logical_or_expression
                  logical_and_expression equality_expression relational_expression
                  additive_expression multiplicative_expression unary_expression
                  postfix_expression primary_expression
@@ -81,6 +99,11 @@ int yylex();
 %type <function_declaration> function_definition
 %type <parameter_list> parameter_list
 %type <argument_list> argument_list
+%type <reduction_list> reduction_clause reduction_list
+%type <iv> loop_bound_operator
+%type <field_list> field_list
+%type <case_value_list> case_value_list
+%type <iv> case_value
 
 %%
 translation_unit
@@ -104,7 +127,25 @@ definition_or_statement
            }
         }
         | if_statement{ }
+        | switch_statement { }
+        | parallel_for_statement { }
         | block { }
+        | struct_definition { }
+        ;
+
+struct_definition
+        : STRUCT_T IDENTIFIER LC field_list RC SEMICOLON
+        {
+           CS_Compiler* compiler = cs_get_current_compiler();
+           if (compiler) {
+               cs_define_struct(cs_create_struct_definition($2, $4));
+           }
+        }
+        ;
+
+field_list
+        : type_specifier IDENTIFIER SEMICOLON { $$ = cs_create_field($1, $2); }
+        | field_list type_specifier IDENTIFIER SEMICOLON { $$ = cs_chain_field_list($1, $2, $3); }
         ;
 
 if_statement
@@ -136,6 +177,134 @@ if_end_statement
            }
         }
 
+switch_statement
+        : switch_begin_statement case_list switch_end_statement
+        | switch_begin_statement switch_end_statement
+        ;
+
+switch_begin_statement
+        : SWITCH_T LP expression RP LC
+        {
+           CS_Compiler* compiler = cs_get_current_compiler();
+           if (compiler) {
+                Statement* value = cs_create_switch_value_statement();
+                compiler->stmt_list = cs_chain_statement_list(compiler->stmt_list, cs_create_block_begin_statement());
+                compiler->stmt_list = cs_chain_statement_list(compiler->stmt_list, value);
+                compiler->stmt_list = cs_chain_statement_list(compiler->stmt_list,
+                        cs_create_switch_begin_statement(value, $3));
+           }
+        }
+        ;
+
+switch_end_statement
+        : RC
+        {
+           CS_Compiler* compiler = cs_get_current_compiler();
+           if (compiler) {
+              compiler->stmt_list = cs_chain_statement_list(compiler->stmt_list, cs_create_switch_end_statement());
+              compiler->stmt_list = cs_chain_statement_list(compiler->stmt_list, cs_create_block_end_statement());
+           }
+        }
+        ;
+
+case_list
+        : case_clause
+        | case_list case_clause
+        ;
+
+case_clause
+        : case_label translation_unit
+        {
+           CS_Compiler* compiler = cs_get_current_compiler();
+           if (compiler) {
+              compiler->stmt_list = cs_chain_statement_list(compiler->stmt_list, cs_create_block_end_statement());
+           }
+        }
+        | case_label
+        {
+           CS_Compiler* compiler = cs_get_current_compiler();
+           if (compiler) {
+              compiler->stmt_list = cs_chain_statement_list(compiler->stmt_list, cs_create_block_end_statement());
+           }
+        }
+        ;
+
+case_label
+        : CASE_T case_value_list COLON
+        {
+           CS_Compiler* compiler = cs_get_current_compiler();
+           if (compiler) {
+              compiler->stmt_list = cs_chain_statement_list(compiler->stmt_list, cs_create_case_statement($2));
+              compiler->stmt_list = cs_chain_statement_list(compiler->stmt_list, cs_create_block_begin_statement());
+           }
+        }
+        | DEFAULT_T COLON
+        {
+           CS_Compiler* compiler = cs_get_current_compiler();
+           if (compiler) {
+              compiler->stmt_list = cs_chain_statement_list(compiler->stmt_list, cs_create_case_statement(NULL));
+              compiler->stmt_list = cs_chain_statement_list(compiler->stmt_list, cs_create_block_begin_statement());
+           }
+        }
+        ;
+
+case_value_list
+        : case_value { $$ = cs_create_case_value($1); }
+        | case_value_list COMMA case_value { $$ = cs_chain_case_value_list($1, $3); }
+        ;
+
+case_value
+        : INT_LITERAL
+        | SUB INT_LITERAL { $$ = -$2; }
+        ;
+
+parallel_for_statement
+        : parallel_for_begin_statement translation_unit parallel_for_end_statement
+        | parallel_for_begin_statement parallel_for_end_statement
+        ;
+
+parallel_for_begin_statement
+        : PARALLEL_T FOR LP INT_T IDENTIFIER ASSIGN_T expression SEMICOLON
+          IDENTIFIER loop_bound_operator expression SEMICOLON
+          IDENTIFIER INCREMENT RP reduction_clause LC
+        {
+           CS_Compiler* compiler = cs_get_current_compiler();
+           if (compiler) {
+                Statement* loop_variable = cs_create_declaration_statement(CS_INT_TYPE, $5, NULL);
+                compiler->stmt_list = cs_chain_statement_list(compiler->stmt_list,
+                        cs_create_parallel_for_begin_statement(loop_variable, $7, $9, $10, $11, $13, $16));
+                compiler->stmt_list = cs_chain_statement_list(compiler->stmt_list, cs_create_block_begin_statement());
+                compiler->stmt_list = cs_chain_statement_list(compiler->stmt_list, loop_variable);
+           }
+        }
+        ;
+
+parallel_for_end_statement
+        : RC
+        {
+           CS_Compiler* compiler = cs_get_current_compiler();
+           if (compiler) {
+              compiler->stmt_list = cs_chain_statement_list(compiler->stmt_list, cs_create_block_end_statement());
+              compiler->stmt_list = cs_chain_statement_list(compiler->stmt_list, cs_create_parallel_for_end_statement());
+           }
+        }
+        ;
+
+loop_bound_operator
+        : LT { $$ = CS_FALSE; }
+        | LE { $$ = CS_TRUE;  }
+        ;
+
+reduction_clause
+        : /* empty */                 { $$ = NULL; }
+        | REDUCE_T LP reduction_list RP { $$ = $3; }
+        ;
+
+reduction_list
+        : IDENTIFIER COLON IDENTIFIER { $$ = cs_create_reduction($1, $3); }
+        | reduction_list COMMA IDENTIFIER COLON IDENTIFIER { $$ = cs_chain_reduction_list($1, $3, $5); }
+        ;
+
 block
         : block_begin_statement translation_unit block_end_statement { }
         | LC RC
@@ -205,6 +374,34 @@ declaration_statement
         {
             $$ = cs_create_declaration_statement($1, $2, $4);
         }
+        | type_specifier LB RB IDENTIFIER SEMICOLON
+        {
+            $$ = cs_create_array_declaration_statement($1, 0, $4, NULL);
+        }
+        | type_specifier LB RB IDENTIFIER ASSIGN_T expression SEMICOLON
+        {
+            $$ = cs_create_array_declaration_statement($1, 0, $4, $6);
+        }
+        | type_specifier LB INT_LITERAL RB IDENTIFIER SEMICOLON
+        {
+            if ($3 <= 0) {
+                yyerror("array length must be positive");
+                YYERROR;
+            }
+            $$ = cs_create_array_declaration_statement($1, $3, $5, NULL);
+        }
+        | STRUCT_T IDENTIFIER IDENTIFIER SEMICOLON
+        {
+            $$ = cs_create_struct_declaration_statement($2, 0, $3);
+        }
+        | STRUCT_T IDENTIFIER LB INT_LITERAL RB IDENTIFIER SEMICOLON
+        {
+            if ($4 <= 0) {
+                yyerror("array length must be positive");
+                YYERROR;
+            }
+            $$ = cs_create_struct_declaration_statement($2, $4, $6);
+        }
         ;
 
 
@@ -212,6 +409,13 @@ type_specifier
         : BOOLEAN_T { $$ = CS_BOOLEAN_TYPE; }
         | INT_T     { $$ = CS_INT_TYPE;     }
         | DOUBLE_T  { $$ = CS_DOUBLE_TYPE;  }
+        | STRING_T  { $$ = CS_STRING_TYPE;  }
+        | INT4_T    { $$ = CS_INT4_TYPE;    }
+        | DOUBLE4_T { $$ = CS_DOUBLE4_TYPE; }
+        | MAP_T LT type_specifier COMMA type_specifier GT
+        {
+            $$ = cs_map_type($3, $5);
+        }
         ;
 
 expression
@@ -222,7 +426,7 @@ expression
     ;
 
 assignment_expression
-        : logical_or_expression
+        : conditional_expression
         | postfix_expression assignment_operator assignment_expression
         {
           $$ = cs_create_assignment_expression($1, $2, $3);
@@ -238,6 +442,14 @@ assignment_operator
         | MOD_ASSIGN_T    { $$ = MOD_ASSIGN; }
         ;
 
+conditional_expression
+        : logical_or_expression
+        | logical_or_expression QUESTION expression COLON conditional_expression
+        {
+          $$ = cs_create_conditional_expression($1, $3, $5);
+        }
+        ;
+
 logical_or_expression
         : logical_and_expression
         | logical_or_expression LOGICAL_OR logical_and_expression { $$ = cs_create_binary_expression(LOGICAL_OR_EXPRESSION, $1, $3);  }
@@ -286,6 +498,8 @@ postfix_expression
         | postfix_expression LP RP     { $$ = cs_create_function_call_expression($1, NULL); }
         | postfix_expression INCREMENT { $$ = cs_create_inc_dec_expression($1, INCREMENT_EXPRESSION);}
         | postfix_expression DECREMENT { $$ = cs_create_inc_dec_expression($1, DECREMENT_EXPRESSION);}
+        | postfix_expression LB expression RB { $$ = cs_create_index_expression($1, $3); }
+        | postfix_expression DOT IDENTIFIER { $$ = cs_create_member_expression($1, $3); }
         ;
 
 primary_expression
@@ -293,8 +507,18 @@ primary_expression
         | IDENTIFIER       { $$ = cs_create_identifier_expression($1); }
         | INT_LITERAL      { $$ = cs_create_int_expression($1); }
         | DOUBLE_LITERAL   { $$ = cs_create_double_expression($1); }
+        | STRING_LITERAL   { $$ = cs_create_string_expression($1); }
         | TRUE_T           { $$ = cs_create_boolean_expression(CS_TRUE); }
         | FALSE_T          { $$ = cs_create_boolean_expression(CS_FALSE); }
+        | NEW_T type_specifier LB expression RB { $$ = cs_create_new_array_expression($2, $4); }
+        | INT4_T LP argument_list RP
+        {
+            $$ = cs_create_function_call_expression(cs_create_identifier_expression(cs_create_identifier("int4")), $3);
+        }
+        | DOUBLE4_T LP argument_list RP
+        {
+            $$ = cs_create_function_call_expression(cs_create_identifier_expression(cs_create_identifier("double4")), $3);
+        }
         ;
 %%
 int
@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../memory/MEM.h"
+#include "../svm/svm.h"
+#include "csua.h"
+#include "visitor.h"
+
+static void copy_declaration(CS_Compiler* compiler, CS_Executable* exec) {
+    DeclarationList* decl_list = compiler->decl_list;
+    int size = 0;
+    for (; decl_list; decl_list = decl_list->next) {
+        if (!cs_is_aggregate(decl_list->decl->type)) ++size;
+    }
+    CS_Variable* variables =
+        (CS_Variable*)MEM_malloc(sizeof(CS_Variable) * size);
+    decl_list = compiler->decl_list;
+    for (int i = 0; i < size; decl_list = decl_list->next) {
+        if (cs_is_aggregate(decl_list->decl->type)) {
+            continue;  // held by its fields or lanes
+        }
+        variables[i].name = MEM_strdup(decl_list->decl->name);
+        TypeSpecifier* type = MEM_malloc(sizeof(TypeSpecifier));
+        *type = *decl_list->decl->type;
+        variables[i].type = type;
+        ++i;
+    }
+    exec->global_variable = variables;
+    exec->global_variable_count = size;
+}
+
+static int count_stack_size(uint8_t* code, size_t len) {
+    int st_size = 0;
+    for (int i = 0; i < len; ++i) {
+        OpcodeInfo* oinfo = &svm_opcode_info[code[i]];
+        if (oinfo->s_size > 0) {
+            st_size += oinfo->s_size;
+        }
+        for (int j = 0; j < strlen(oinfo->parameter); ++j) {
+            switch (oinfo->parameter[j]) {
+                case 'i': {
+                    i += 2;
+                    break;
+                }
+                default: {
+                    fprintf(stderr, "unknown parameter [%c]in disassemble\n",
+                            oinfo->parameter[j]);
+                    exit(1);
+                }
+            }
+        }
+    }
+    return st_size;
+}
+
+static int count_pointer_stack_size(uint8_t* code, size_t len) {
+    int max_pst_size = 0;
+    int pst_size = 0;
+    for (int i = 0; i < len; ++i) {
+        OpcodeInfo* oinfo = &svm_opcode_info[code[i]];
+        if (strcmp(oinfo->opname, "push_stack_pointer") == 0) {
+            pst_size += 1;
+            if (pst_size > max_pst_size) {
+                max_pst_size = pst_size;
+            }
+        }
+        if (strcmp(oinfo->opname, "pop_stack_pointer") == 0) {
+            pst_size -= 1;
+        }
+    }
+    return max_pst_size;
+}
+
+CS_Executable* CS_code_generate(CS_Compiler* compiler) {
+    CS_Executable* exec = (CS_Executable*)MEM_malloc(sizeof(CS_Executable));
+    memset(exec, 0x0, sizeof(CS_Executable));
+    exec->code = NULL;
+    exec->code_size = 0;
+    exec->constant_pool = NULL;
+    exec->constant_pool_count = 0;
+    exec->global_variable = NULL;
+    exec->global_variable_count = 0;
+
+    copy_declaration(compiler, exec);  // copy variables
+    cs_schedule_regions(compiler);
+    CodegenVisitor* cgen_visitor = create_codegen_visitor(compiler, exec);
+
+    StatementList* stmt_list = compiler->stmt_list;
+    while (stmt_list) {
+        traverse_stmt(stmt_list->stmt, (Visitor*)cgen_visitor);
+        stmt_list = stmt_list->next;
+    }
+
+    exec->code_size = cgen_visitor->pos;
+    exec->code = (uint8_t*)MEM_malloc(exec->code_size);
+    memcpy(exec->code, cgen_visitor->code, exec->code_size);
+    exec->stack_size = count_stack_size(exec->code, exec->code_size);
+    exec->pt_stack_size =
+        count_pointer_stack_size(exec->code, exec->code_size);
+
+    if (cgen_visitor->code) {
+        MEM_free(cgen_visitor->code);
+    }
+    delete_visitor((Visitor*)cgen_visitor);
+
+    return exec;
+}
+
+void CS_delete_executable(CS_Executable* exec) {
+    for (int i = 0; i < exec->global_variable_count; ++i) {
+        MEM_free(exec->global_variable[i].name);
+        MEM_free(exec->global_variable[i].type);
+    }
+    MEM_free(exec->global_variable);
+
+    if (exec->constant_pool != NULL) {
+        MEM_free(exec->constant_pool);
+    }
+
+    if (exec->code != NULL) {
+        MEM_free(exec->code);
+    }
+
+    for (int i = 0; i < exec->string_count; ++i) {
+        MEM_free(exec->strings[i]);
+    }
+    if (exec->strings != NULL) {
+        MEM_free(exec->strings);
+    }
+
+    MEM_free(exec);
+}
+
+// Build a virtual machine straight from the executable, skipping the .csb
+// serialize/parse round-trip.
+SVM_Program* CS_create_program(CS_Executable* exec) {
+    SVM_Program* program = svm_create_program();
+    MEM_Controller controller = program->controller;
+
+    program->constant_pool_count = exec->constant_pool_count;
+    program->constant_pool = (SVM_Constant*)MEM_controller_malloc(
+        controller, sizeof(SVM_Constant) * program->constant_pool_count);
+    for (int i = 0; i < exec->constant_pool_count; ++i) {
+        switch (exec->constant_pool[i].type) {
+            case CS_CONSTANT_INT: {
+                program->constant_pool[i].type = SVM_INT;
+                program->constant_pool[i].u.c_int =
+                    exec->constant_pool[i].u.c_int;
+                break;
+            }
+            case CS_CONSTANT_DOUBLE: {
+                program->constant_pool[i].type = SVM_DOUBLE;
+                program->constant_pool[i].u.c_double =
+                    exec->constant_pool[i].u.c_double;
+                break;
+            }
+            default: {
+                fprintf(stderr, "undefined constant type in load\n");
+                exit(1);
+            }
+        }
+    }
+
+    program->global_variable_count = exec->global_variable_count;
+    program->global_variable_types = (uint8_t*)MEM_controller_malloc(
+        controller, sizeof(uint8_t) * program->global_variable_count);
+    for (int i = 0; i < exec->global_variable_count; ++i) {
+        switch (exec->global_variable[i].type->basic_type) {
+            case CS_BOOLEAN_TYPE:
+            case CS_INT_TYPE:
+            case CS_INT_ARRAY_TYPE:  // arrays, strings and maps are handles
+            case CS_DOUBLE_ARRAY_TYPE:
+            case CS_STRING_TYPE:
+            case CS_INT_MAP_TYPE:
+            case CS_DOUBLE_MAP_TYPE:
+            case CS_STRUCT_ARRAY_TYPE: {
+                program->global_variable_types[i] = SVM_INT;
+                break;
+            }
+            case CS_DOUBLE_TYPE: {
+                program->global_variable_types[i] = SVM_DOUBLE;
+                break;
+            }
+            default: {
+                fprintf(stderr, "No such type\n");
+                exit(1);
+            }
+        }
+    }
+    program->global_variable_names = (char**)MEM_controller_malloc(
+        controller, sizeof(char*) * program->global_variable_count);
+    for (int i = 0; i < exec->global_variable_count; ++i) {
+        int len = strlen(exec->global_variable[i].name);
+        program->global_variable_names[i] =
+            (char*)MEM_controller_malloc(controller, len + 1);
+        memcpy(program->global_variable_names[i],
+               exec->global_variable[i].name, len + 1);
+    }
+
+    program->code_size = exec->code_size;
+    program->code =
+        (uint8_t*)MEM_controller_malloc(controller, program->code_size);
+    memcpy(program->code, exec->code, program->code_size);
+    program->stack_size = exec->stack_size;
+    program->pt_stack_size = exec->pt_stack_size;
+
+    if (exec->string_count > 0) {
+        program->string_count = exec->string_count;
+        program->strings = (SVM_String*)MEM_controller_malloc(
+            controller, sizeof(SVM_String) * program->string_count);
+        for (int i = 0; i < exec->string_count; ++i) {
+            int len = strlen(exec->strings[i]);
+            char* data = (char*)MEM_controller_malloc(controller, len + 1);
+            memcpy(data, exec->strings[i], len + 1);
+            program->strings[i].length = len;
+            program->strings[i].data = data;
+        }
+    }
+
+    if (svm_prepare_program(program) != SVM_FINISHED) {
+        fprintf(stderr, "broken code in executable\n");
+        exit(1);
+    }
+
+    return program;
+}
@@ -15,12 +15,14 @@ CS_Compiler* CS_create_compiler() {
     compiler->stmt_list = NULL;
     compiler->decl_list = NULL;
     compiler->func_list = NULL;
+    compiler->struct_list = NULL;
     compiler->current_line = 1;
 
     compiler->decl_list_tail = NULL;
     compiler->func_list_tail = NULL;
     compiler->cp_list = NULL;
     compiler->cp_list_tail = NULL;
+    compiler->switch_block = NULL;
 
     cs_set_current_compiler(compiler);
 
@@ -42,9 +44,11 @@ static CS_Boolean do_mean_check(CS_Compiler* compiler) {
     }
 
     DeclarationList* dp = NULL;
+    // a struct or vector variable takes no slot, its fields or lanes follow
     dp = compiler->decl_list;
-    for (int i = 0; dp; dp = dp->next, ++i) {
+    for (int i = 0; dp; dp = dp->next) {
         dp->decl->index = i;
+        if (!cs_is_aggregate(dp->decl->type)) ++i;
     }
 
     FunctionDeclarationList* func_list = compiler->func_list;
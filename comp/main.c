@@ -0,0 +1,48 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../memory/MEM.h"
+#include "../svm/svm.h"
+#include "csua.h"
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage ./csua input.cs\n");
+        return 1;
+    }
+    FILE* fin = fopen(argv[1], "r");
+    if (fin == NULL) {
+        fprintf(stderr, "Cannot find file %s\n", argv[1]);
+        return 1;
+    }
+    CS_Compiler* compiler = CS_create_compiler();
+    CS_Boolean compile_result = CS_compile(compiler, fin);
+    fclose(fin);
+
+    if (!compile_result) {
+        CS_delete_compiler(compiler);
+        return 1;
+    }
+
+    CS_Executable* exec = CS_code_generate(compiler);
+    CS_delete_compiler(compiler);
+
+    SVM_Program* program = CS_create_program(exec);
+    CS_delete_executable(exec);
+
+    add_native_functions(program);
+    SVM_Context* ctx = svm_create_context(program);
+    SVM_Status status = svm_init(ctx);
+    if (status == SVM_FINISHED) {
+        status = svm_run(ctx);
+    }
+    if (status != SVM_FINISHED) {
+        fprintf(stderr, "%s: %s at pc %u\n", argv[1],
+                svm_status_message(status), ctx->pc);
+    }
+    svm_show_status(ctx);
+    svm_delete_context(ctx);
+    svm_delete_program(program);
+
+    return status == SVM_FINISHED ? 0 : 1;
+}
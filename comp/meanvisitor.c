@@ -1,4 +1,5 @@
 
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,6 +12,16 @@
 #define cs_is_int(type) (cs_is_type(type, CS_INT_TYPE))
 #define cs_is_double(type) (cs_is_type(type, CS_DOUBLE_TYPE))
 #define cs_is_boolean(type) (cs_is_type(type, CS_BOOLEAN_TYPE))
+#define cs_is_array(type)                    \
+    (cs_is_type(type, CS_INT_ARRAY_TYPE) || \
+     cs_is_type(type, CS_DOUBLE_ARRAY_TYPE))
+#define cs_is_string(type) (cs_is_type(type, CS_STRING_TYPE))
+#define cs_is_map(type) \
+    (cs_is_type(type, CS_INT_MAP_TYPE) || cs_is_type(type, CS_DOUBLE_MAP_TYPE))
+#define cs_is_struct(type) (cs_is_type(type, CS_STRUCT_TYPE))
+#define cs_is_struct_array(type) (cs_is_type(type, CS_STRUCT_ARRAY_TYPE))
+#define cs_is_vector(type) \
+    (cs_is_type(type, CS_INT4_TYPE) || cs_is_type(type, CS_DOUBLE4_TYPE))
 
 #define cs_same_type(type1, type2) ((type1)->basic_type == (type2)->basic_type)
 
@@ -25,6 +36,33 @@ char* get_type_name(CS_BasicType type) {
         case CS_DOUBLE_TYPE: {
             return "double";
         }
+        case CS_INT_ARRAY_TYPE: {
+            return "int[]";
+        }
+        case CS_DOUBLE_ARRAY_TYPE: {
+            return "double[]";
+        }
+        case CS_STRING_TYPE: {
+            return "string";
+        }
+        case CS_INT_MAP_TYPE: {
+            return "map<int,int>";
+        }
+        case CS_DOUBLE_MAP_TYPE: {
+            return "map<int,double>";
+        }
+        case CS_STRUCT_TYPE: {
+            return "struct";
+        }
+        case CS_STRUCT_ARRAY_TYPE: {
+            return "struct[]";
+        }
+        case CS_INT4_TYPE: {
+            return "int4";
+        }
+        case CS_DOUBLE4_TYPE: {
+            return "double4";
+        }
         default: {
             return "untyped";
         }
@@ -72,6 +110,11 @@ static void leave_doubleexpr(Expression* expr, Visitor* visitor) {
     expr->type = cs_create_type_specifier(CS_DOUBLE_TYPE);
 }
 
+static void enter_stringexpr(Expression* expr, Visitor* visitor) {}
+static void leave_stringexpr(Expression* expr, Visitor* visitor) {
+    expr->type = cs_create_type_specifier(CS_STRING_TYPE);
+}
+
 static void enter_identexpr(Expression* expr, Visitor* visitor) {}
 static void leave_identexpr(Expression* expr, Visitor* visitor) {
     CS_Compiler* compiler = cs_get_current_compiler();
@@ -139,6 +182,79 @@ static void unacceptable_type_binary_expr(Expression* expr, Visitor* visitor) {
     add_check_log(message, visitor);
 }
 
+/*
+ * expr as an operand of the vector type vector: itself, or a scalar of
+ * the lane type copied into every lane, an int widened first for double4.
+ * NULL when it is neither.
+ */
+static Expression* vector_operand(Expression* expr, CS_BasicType vector) {
+    CS_BasicType lane = cs_lane_type(vector);
+    if (cs_is_type(expr->type, vector)) return expr;
+    if (lane == CS_DOUBLE_TYPE && cs_is_int(expr->type)) {
+        Expression* cast = cs_create_cast_expression(CS_INT_TO_DOUBLE, expr);
+        cast->type = cs_create_type_specifier(CS_DOUBLE_TYPE);
+        expr = cast;
+    }
+    if (!cs_is_type(expr->type, lane)) return NULL;
+    Expression* splat = cs_create_cast_expression(
+        vector == CS_DOUBLE4_TYPE ? CS_DOUBLE_TO_DOUBLE4 : CS_INT_TO_INT4,
+        expr);
+    splat->type = cs_create_type_specifier(vector);
+    return splat;
+}
+
+/*
+ * A vector taking any number: itself, the same lanes converted from the
+ * other vector type, or a scalar cast to the lane type in every lane.
+ */
+static Expression* vector_conversion(Expression* expr, CS_BasicType vector) {
+    if (cs_is_vector(expr->type) && !cs_is_type(expr->type, vector)) {
+        Expression* cast = cs_create_cast_expression(
+            vector == CS_DOUBLE4_TYPE ? CS_INT4_TO_DOUBLE4
+                                      : CS_DOUBLE4_TO_INT4,
+            expr);
+        cast->type = cs_create_type_specifier(vector);
+        return cast;
+    }
+    if (vector == CS_INT4_TYPE && cs_is_double(expr->type)) {
+        Expression* cast = cs_create_cast_expression(CS_DOUBLE_TO_INT, expr);
+        cast->type = cs_create_type_specifier(CS_INT_TYPE);
+        expr = cast;
+    }
+    return vector_operand(expr, vector);
+}
+
+/*
+ * Arithmetic and comparisons of int4 and double4 work lane by lane, a
+ * scalar operand taking every lane. Like int and double, an int4 meeting
+ * a double goes double4. There is no % of vectors and no / of int4. TRUE
+ * when expr has a vector operand; its type is the vector type unless
+ * reported.
+ */
+static CS_Boolean vector_binary_check(Expression* expr, Visitor* visitor) {
+    Expression* left = expr->u.binary_expression.left;
+    Expression* right = expr->u.binary_expression.right;
+    if (!cs_is_vector(left->type) && !cs_is_vector(right->type)) {
+        return CS_FALSE;
+    }
+    CS_BasicType vector = CS_INT4_TYPE;
+    if (cs_is_type(left->type, CS_DOUBLE4_TYPE) || cs_is_double(left->type) ||
+        cs_is_type(right->type, CS_DOUBLE4_TYPE) || cs_is_double(right->type)) {
+        vector = CS_DOUBLE4_TYPE;
+    }
+    left = vector_conversion(left, vector);
+    right = vector_conversion(right, vector);
+    if (left == NULL || right == NULL || expr->kind == MOD_EXPRESSION ||
+        (expr->kind == DIV_EXPRESSION && vector == CS_INT4_TYPE)) {
+        unacceptable_type_binary_expr(expr, visitor);
+        return CS_TRUE;
+    }
+    expr->u.binary_expression.left = left;
+    expr->u.binary_expression.right = right;
+    expr->type = cs_create_type_specifier(vector);
+    return CS_TRUE;
+}
+
 static void cast_arithmetic_binary_expr(Expression* expr, Visitor* visitor) {
     Expression* left = expr->u.binary_expression.left;
     Expression* right = expr->u.binary_expression.right;
@@ -146,6 +262,9 @@ static void cast_arithmetic_binary_expr(Expression* expr, Visitor* visitor) {
     if (check_nulltype_binary_expr(expr, visitor)) {
         return;
     }
+    if (vector_binary_check(expr, visitor)) {
+        return;
+    }
 
     if (cs_is_int(left->type) && cs_is_int(right->type)) {
         expr->type = cs_create_type_specifier(CS_INT_TYPE);
@@ -170,9 +289,28 @@ static void cast_arithmetic_binary_expr(Expression* expr, Visitor* visitor) {
     }
 }
 
+// what is "an array" or "a string"
+static void check_parallel_alloc(int line_number, const char* what,
+                                 Visitor* visitor) {
+    if (((MeanVisitor*)visitor)->parallel) {
+        char message[100];
+        sprintf(message, "%d: Cannot allocate %s in parallel for",
+                line_number, what);
+        add_check_log(message, visitor);
+    }
+}
+
 /* arithmetic calculation*/
 static void enter_addexpr(Expression* expr, Visitor* visitor) {}
 static void leave_addexpr(Expression* expr, Visitor* visitor) {
+    Expression* left = expr->u.binary_expression.left;
+    Expression* right = expr->u.binary_expression.right;
+    if (left->type && right->type && cs_is_string(left->type) &&
+        cs_is_string(right->type)) {  // concatenation
+        check_parallel_alloc(expr->line_number, "a string", visitor);
+        expr->type = cs_create_type_specifier(CS_STRING_TYPE);
+        return;
+    }
     cast_arithmetic_binary_expr(expr, visitor);
 }
 static void enter_subexpr(Expression* expr, Visitor* visitor) {}
@@ -193,6 +331,19 @@ static void leave_modexpr(Expression* expr, Visitor* visitor) {
     cast_arithmetic_binary_expr(expr, visitor);
 }
 
+/*
+ * A struct is only ever read or written a field at a time, there is no
+ * value that holds a whole record. TRUE when expr is such a record.
+ */
+static CS_Boolean whole_struct_check(Expression* expr, Visitor* visitor) {
+    if (expr->type == NULL || !cs_is_struct(expr->type)) return CS_FALSE;
+    char message[100];
+    sprintf(message, "%d: A struct is used a field at a time",
+            expr->line_number);
+    add_check_log(message, visitor);
+    return CS_TRUE;
+}
+
 static void compare_type_check(Expression* expr, Visitor* visitor) {
     Expression* left = expr->u.binary_expression.left;
     Expression* right = expr->u.binary_expression.right;
@@ -219,27 +370,63 @@ static void compare_type_check(Expression* expr, Visitor* visitor) {
     //    expr->type = cs_create_type_specifier(CS_BOOLEAN_TYPE);
 }
 
+static CS_Boolean is_unordered(TypeSpecifier* type) {
+    return type && (cs_is_array(type) || cs_is_string(type) ||
+                    cs_is_map(type) || cs_is_struct(type) ||
+                    cs_is_struct_array(type));
+}
+
+// arrays, strings and maps only compare for equality
+static void relational_type_check(Expression* expr, Visitor* visitor) {
+    Expression* left = expr->u.binary_expression.left;
+    Expression* right = expr->u.binary_expression.right;
+    if (is_unordered(left->type) || is_unordered(right->type)) {
+        unacceptable_type_binary_expr(expr, visitor);
+        return;
+    }
+    compare_type_check(expr, visitor);
+}
+
+/*
+ * <, <=, > and >= of vectors give the int4 of the lanes where they hold,
+ * TRUE when expr is one of them.
+ */
+static CS_Boolean vector_relational_check(Expression* expr,
+                                          Visitor* visitor) {
+    if (expr->u.binary_expression.left->type == NULL ||
+        expr->u.binary_expression.right->type == NULL ||
+        !vector_binary_check(expr, visitor)) {
+        return CS_FALSE;
+    }
+    if (expr->type) expr->type = cs_create_type_specifier(CS_INT4_TYPE);
+    return CS_TRUE;
+}
+
 static void enter_gtexpr(Expression* expr, Visitor* visitor) {}
 static void leave_gtexpr(Expression* expr, Visitor* visitor) {
-    compare_type_check(expr, visitor);
+    if (vector_relational_check(expr, visitor)) return;
+    relational_type_check(expr, visitor);
     expr->type = cs_create_type_specifier(CS_BOOLEAN_TYPE);
 }
 
 static void enter_geexpr(Expression* expr, Visitor* visitor) {}
 static void leave_geexpr(Expression* expr, Visitor* visitor) {
-    compare_type_check(expr, visitor);
+    if (vector_relational_check(expr, visitor)) return;
+    relational_type_check(expr, visitor);
     expr->type = cs_create_type_specifier(CS_BOOLEAN_TYPE);
 }
 
 static void enter_ltexpr(Expression* expr, Visitor* visitor) {}
 static void leave_ltexpr(Expression* expr, Visitor* visitor) {
-    compare_type_check(expr, visitor);
+    if (vector_relational_check(expr, visitor)) return;
+    relational_type_check(expr, visitor);
     expr->type = cs_create_type_specifier(CS_BOOLEAN_TYPE);
 }
 
 static void enter_leexpr(Expression* expr, Visitor* visitor) {}
 static void leave_leexpr(Expression* expr, Visitor* visitor) {
-    compare_type_check(expr, visitor);
+    if (vector_relational_check(expr, visitor)) return;
+    relational_type_check(expr, visitor);
     expr->type = cs_create_type_specifier(CS_BOOLEAN_TYPE);
 }
 
@@ -250,6 +437,13 @@ static void compare_equality_type_check(Expression* expr, Visitor* visitor) {
     Expression* left = expr->u.binary_expression.left;
     Expression* right = expr->u.binary_expression.right;
     char message[100];
+    if (whole_struct_check(left, visitor) ||
+        whole_struct_check(right, visitor)) {
+        return;
+    }
+    if (vector_binary_check(expr, visitor)) {  // every lane, or any lane
+        return;
+    }
     if (cs_is_boolean(left->type) && !cs_is_boolean(right->type)) {
         sprintf(
             message,
@@ -334,6 +528,12 @@ static void incdec_typecheck(Expression* expr, Visitor* visitor) {
                     expr->line_number);
         }
     }
+    if (eKind == INDEX_EXPRESSION) {
+        sprintf(message, "%d: Cannot ++ or -- an array element, use +=",
+                expr->line_number);
+        add_check_log(message, visitor);
+        return;
+    }
 
     if (idexpr->type->basic_type != CS_INT_TYPE) {
         sprintf(message, "%d: Operand is not INT type (%s)", expr->line_number,
@@ -344,14 +544,72 @@ static void incdec_typecheck(Expression* expr, Visitor* visitor) {
         expr->type = idexpr->type;
     }
 }
+/*
+ * Iterations of a parallel for run concurrently, so a body may only write
+ * variables declared inside it and its reduction variables. Arrays cannot
+ * be allocated there, so every array it sees is shared: an element may
+ * only be stored at the loop variable, which no other iteration holds.
+ */
+static CS_Boolean is_parallel_private(MeanVisitor* visitor, Declaration* decl) {
+    DeclarationList* list = visitor->parallel_border
+                                ? visitor->parallel_border->next
+                                : visitor->compiler->decl_list;
+    for (; list; list = list->next) {
+        if (list->decl == decl) return CS_TRUE;
+    }
+    return CS_FALSE;
+}
+
+static void check_parallel_write(Expression* target, Visitor* visitor) {
+    MeanVisitor* m_visitor = (MeanVisitor*)visitor;
+    ParallelForOperation* parallel = m_visitor->parallel;
+    char message[100];
+    if (parallel && target->kind == INDEX_EXPRESSION) {
+        Expression* i = target->u.index_expression.index;
+        if (i->kind != IDENTIFIER_EXPRESSION || i->u.identifier.is_function ||
+            i->u.identifier.u.declaration != parallel->loop_variable) {
+            sprintf(message,
+                    "%d: parallel for stores a shared array element "
+                    "not at %s",
+                    target->line_number, parallel->loop_variable->name);
+            add_check_log(message, visitor);
+        }
+        return;
+    }
+    if (parallel == NULL || target->kind != IDENTIFIER_EXPRESSION ||
+        target->u.identifier.is_function) {
+        return;
+    }
+    Declaration* decl = target->u.identifier.u.declaration;
+    if (decl == NULL) return;
+
+    if (decl == parallel->loop_variable) {
+        sprintf(message, "%d: Cannot assign loop variable %s in parallel for",
+                target->line_number, decl->name);
+        add_check_log(message, visitor);
+        return;
+    }
+    for (ReductionList* r = parallel->reduction; r; r = r->next) {
+        if (r->declaration == decl) return;
+    }
+    if (!is_parallel_private(m_visitor, decl)) {
+        sprintf(message,
+                "%d: parallel for writes shared variable %s without reduce",
+                target->line_number, decl->name);
+        add_check_log(message, visitor);
+    }
+}
+
 static void enter_incexpr(Expression* expr, Visitor* visitor) {}
 static void leave_incexpr(Expression* expr, Visitor* visitor) {
     incdec_typecheck(expr, visitor);
+    check_parallel_write(expr->u.inc_dec, visitor);
 }
 
 static void enter_decexpr(Expression* expr, Visitor* visitor) {}
 static void leave_decexpr(Expression* expr, Visitor* visitor) {
     incdec_typecheck(expr, visitor);
+    check_parallel_write(expr->u.inc_dec, visitor);
 }
 
 static void enter_minusexpr(Expression* expr, Visitor* visitor) {}
@@ -365,7 +623,7 @@ static void leave_minusexpr(Expression* expr, Visitor* visitor) {
     }
 
     if ((type->basic_type != CS_INT_TYPE) &&
-        (type->basic_type != CS_DOUBLE_TYPE)) {
+        (type->basic_type != CS_DOUBLE_TYPE) && !cs_is_vector(type)) {
         sprintf(message, "%d: Operand is not INT or DOUBLE type (%s)",
                 expr->line_number, get_type_name(type->basic_type));
         add_check_log(message, visitor);
@@ -411,6 +669,10 @@ static Expression* assignment_type_check(TypeSpecifier* ltype, Expression* expr,
         return expr;
     }
 
+    if (cs_is_vector(ltype)) {
+        Expression* operand = vector_conversion(expr, ltype->basic_type);
+        if (operand) return operand;
+    }
     if (ltype->basic_type == expr->type->basic_type) {
         return expr;
     } else if ((ltype->basic_type == CS_INT_TYPE) &&
@@ -432,138 +694,1375 @@ static Expression* assignment_type_check(TypeSpecifier* ltype, Expression* expr,
     }
     return expr;
 }
-static void enter_assignexpr(Expression* expr, Visitor* visitor) {}
-static void leave_assignexpr(Expression* expr, Visitor* visitor) {
-    Expression* left = expr->u.assignment_expression.left;
-    Expression* right = expr->u.assignment_expression.right;
-    expr->u.assignment_expression.right =
-        assignment_type_check(left->type, right, visitor);
-    expr->type = left->type;
-}
-
-static void enter_funccallexpr(Expression* expr, Visitor* visitor) {}
-static void leave_funccallexpr(Expression* expr, Visitor* visitor) {
-    FunctionCallExpression* f_expr = &expr->u.function_call_expression;
-    FunctionDeclaration* func_dec = NULL;
-    printf("type = %d\n", f_expr->function->kind);
-    switch (f_expr->function->kind) {
+/* Whether evaluating expr twice could differ from evaluating it once. */
+static CS_Boolean has_side_effect(Expression* expr) {
+    switch (expr->kind) {
+        case BOOLEAN_EXPRESSION:
+        case DOUBLE_EXPRESSION:
+        case INT_EXPRESSION:
+        case STRING_EXPRESSION:
         case IDENTIFIER_EXPRESSION: {
-            //            printf("identifier!!!\n");
-            //            printf("%s\n", f_expr->function->u.identifier.name);
-            func_dec = cs_search_function(f_expr->function->u.identifier.name);
-            break;
+            return CS_FALSE;
+        }
+        case MINUS_EXPRESSION: {
+            return has_side_effect(expr->u.minus_expression);
+        }
+        case LOGICAL_NOT_EXPRESSION: {
+            return has_side_effect(expr->u.logical_not_expression);
+        }
+        case CAST_EXPRESSION: {
+            return has_side_effect(expr->u.cast_expression.expr);
+        }
+        case MEMBER_EXPRESSION: {
+            return has_side_effect(expr->u.member_expression.expression);
+        }
+        case CONDITIONAL_EXPRESSION: {
+            ConditionalExpression* c_expr = &expr->u.conditional_expression;
+            return has_side_effect(c_expr->condition) ||
+                   has_side_effect(c_expr->true_expr) ||
+                   has_side_effect(c_expr->false_expr);
+        }
+        case INDEX_EXPRESSION: {
+            return has_side_effect(expr->u.index_expression.array) ||
+                   has_side_effect(expr->u.index_expression.index);
+        }
+        case FUNCTION_CALL_EXPRESSION: {
+            FunctionCallExpression* f_expr = &expr->u.function_call_expression;
+            switch (f_expr->intrinsic) {
+                case CS_INTRINSIC_NONE:
+                case CS_INTRINSIC_AXPY:
+                case CS_INTRINSIC_FILL:
+                case CS_INTRINSIC_COPY:
+                case CS_INTRINSIC_PUT:
+                case CS_INTRINSIC_INCREMENT: {
+                    return CS_TRUE;
+                }
+                default: {
+                    break;
+                }
+            }
+            for (ArgumentList* args = f_expr->argument; args;
+                 args = args->next) {
+                if (has_side_effect(args->expr)) return CS_TRUE;
+            }
+            return CS_FALSE;
+        }
+        case MUL_EXPRESSION:
+        case DIV_EXPRESSION:
+        case MOD_EXPRESSION:
+        case ADD_EXPRESSION:
+        case SUB_EXPRESSION:
+        case GT_EXPRESSION:
+        case GE_EXPRESSION:
+        case LT_EXPRESSION:
+        case LE_EXPRESSION:
+        case EQ_EXPRESSION:
+        case NE_EXPRESSION:
+        case LOGICAL_AND_EXPRESSION:
+        case LOGICAL_OR_EXPRESSION: {
+            return has_side_effect(expr->u.binary_expression.left) ||
+                   has_side_effect(expr->u.binary_expression.right);
         }
         default: {
-            fprintf(stderr, "this type cannot be the function %d\n",
-                    f_expr->function->kind);
-            exit(1);
+            return CS_TRUE;
         }
     }
+}
 
-    if (func_dec) {
-        ParameterList* params = func_dec->param;
-        ArgumentList* args = f_expr->argument;
-        int params_count, args_count;
-        for (params_count = 0; params; params = params->next, ++params_count)
-            ;
-        for (args_count = 0; args; args = args->next, ++args_count)
-            ;
-        //        printf("params_count = %d\n", params_count);
-        //        printf("args_count   = %d\n", args_count);
-
-        if (params_count != args_count) {
-            fprintf(stderr, "argument count is not the same\n");
-            char message[100];
-            sprintf(message,
-                    "%d: argument count mismatch in function call require:%d, "
-                    "pass:%d",
-                    expr->line_number, params_count, args_count);
-            add_check_log(message, visitor);
-        } else {
-            for (params = func_dec->param, args = f_expr->argument; params;
-                 params = params->next, args = args->next) {
-                if (cs_same_type(params->type, args->expr->type)) {
-                    // OK
-                } else if (cs_is_int(params->type) &&
-                           cs_is_double(args->expr->type)) {
-                    Expression* cast =
-                        cs_create_cast_expression(CS_DOUBLE_TO_INT, args->expr);
-                    cast->type = cs_create_type_specifier(CS_INT_TYPE);
-                    args->expr = cast;
-                } else if (cs_is_double(params->type) &&
-                           cs_is_int(args->expr->type)) {
-                    Expression* cast =
-                        cs_create_cast_expression(CS_INT_TO_DOUBLE, args->expr);
-                    cast->type = cs_create_type_specifier(CS_DOUBLE_TYPE);
-                    args->expr = cast;
-                } else {
-                    char message[100];
-                    sprintf(message,
-                            "%d: type mismatch in function call require:%s, "
-                            "pass:%s",
-                            expr->line_number,
-                            get_type_name(params->type->basic_type),
-                            get_type_name(args->expr->type->basic_type));
-                    add_check_log(message, visitor);
-                }
+/*
+ * Whether expr can be evaluated when its value is not wanted: no side
+ * effect and nothing that can fault, like an array index or an int
+ * division, or allocate, like a string concatenation.
+ */
+static CS_Boolean can_speculate(Expression* expr) {
+    switch (expr->kind) {
+        case BOOLEAN_EXPRESSION:
+        case DOUBLE_EXPRESSION:
+        case INT_EXPRESSION:
+        case IDENTIFIER_EXPRESSION: {
+            return CS_TRUE;
+        }
+        case MINUS_EXPRESSION: {
+            return can_speculate(expr->u.minus_expression);
+        }
+        case LOGICAL_NOT_EXPRESSION: {
+            return can_speculate(expr->u.logical_not_expression);
+        }
+        case CAST_EXPRESSION: {
+            return can_speculate(expr->u.cast_expression.expr);
+        }
+        case MEMBER_EXPRESSION: {
+            return can_speculate(expr->u.member_expression.expression);
+        }
+        case CONDITIONAL_EXPRESSION: {
+            ConditionalExpression* c_expr = &expr->u.conditional_expression;
+            return can_speculate(c_expr->condition) &&
+                   can_speculate(c_expr->true_expr) &&
+                   can_speculate(c_expr->false_expr);
+        }
+        case FUNCTION_CALL_EXPRESSION: {
+            FunctionCallExpression* f_expr = &expr->u.function_call_expression;
+            if (f_expr->intrinsic < CS_INTRINSIC_SQRT ||
+                f_expr->intrinsic > CS_INTRINSIC_LOG) {
+                return CS_FALSE;  // only the math intrinsics
+            }
+            for (ArgumentList* args = f_expr->argument; args;
+                 args = args->next) {
+                if (!can_speculate(args->expr)) return CS_FALSE;
+            }
+            return CS_TRUE;
+        }
+        case DIV_EXPRESSION:
+        case MOD_EXPRESSION: {
+            if (expr->type == NULL || cs_is_int(expr->type)) return CS_FALSE;
+            break;
+        }
+        case ADD_EXPRESSION: {
+            if (expr->type == NULL || cs_is_string(expr->type)) {
+                return CS_FALSE;
             }
+            break;
+        }
+        case MUL_EXPRESSION:
+        case SUB_EXPRESSION:
+        case GT_EXPRESSION:
+        case GE_EXPRESSION:
+        case LT_EXPRESSION:
+        case LE_EXPRESSION:
+        case EQ_EXPRESSION:
+        case NE_EXPRESSION:
+        case LOGICAL_AND_EXPRESSION:
+        case LOGICAL_OR_EXPRESSION: {
+            break;
+        }
+        default: {
+            return CS_FALSE;
         }
     }
-    expr->type = expr->u.function_call_expression.function->type;
+    return can_speculate(expr->u.binary_expression.left) &&
+           can_speculate(expr->u.binary_expression.right);
 }
 
-/* For statement */
-static void enter_exprstmt(Statement* stmt, Visitor* visitor) {
-    //    fprintf(stderr, "enter exprstmt :\n");
-}
-static void leave_exprstmt(Statement* stmt, Visitor* visitor) {
-    //    fprintf(stderr, "leave exprstmt\n");
+static CS_Boolean is_number(TypeSpecifier* type) {
+    return cs_is_int(type) || cs_is_double(type) || cs_is_vector(type);
 }
 
-static void enter_declstmt(Statement* stmt, Visitor* visitor) {
-    CS_Compiler* compiler = ((MeanVisitor*)visitor)->compiler;
-    Declaration* decl = cs_search_decl_in_block(stmt->u.declaration_s->name,
-                                                compiler->decl_list_tail,
-                                                compiler->cp_list_tail);
-    // if (!decl) {
-    //     decl = cs_search_decl_global(stmt->u.declaration_s->name);
-    // }
-
-    if (decl) {
-        char message[50];
-        sprintf(message, "%d: Already defind identifier %s", stmt->line_number,
-                stmt->u.declaration_s->name);
+/*
+ * The arms meet at one type like the operands of arithmetic: int and
+ * double go double, a vector and a number the vector of the wider lane.
+ * Structs and fixed size arrays take several slots and cannot be picked.
+ */
+static void enter_condexpr(Expression* expr, Visitor* visitor) {}
+static void leave_condexpr(Expression* expr, Visitor* visitor) {
+    ConditionalExpression* c_expr = &expr->u.conditional_expression;
+    TypeSpecifier* cond = c_expr->condition->type;
+    TypeSpecifier* t_type = c_expr->true_expr->type;
+    TypeSpecifier* f_type = c_expr->false_expr->type;
+    char message[100];
+    if (cond == NULL || t_type == NULL || f_type == NULL) {
+        sprintf(message, "%d: Cannot find ?: type", expr->line_number);
+        add_check_log(message, visitor);
+        return;
+    }
+    if (!cs_is_boolean(cond)) {
+        sprintf(message, "%d: Condition of ?: is not BOOLEAN type (%s)",
+                expr->line_number, get_type_name(cond->basic_type));
         add_check_log(message, visitor);
         return;
     }
 
-    compiler->decl_list =
-        cs_chain_declaration(compiler->decl_list, stmt->u.declaration_s);
-    //    fprintf(stderr, "enter declstmt\n");
+    TypeSpecifier* type = t_type;
+    if (!cs_same_type(t_type, f_type)) {
+        if (!is_number(t_type) || !is_number(f_type)) {
+            sprintf(message, "%d: type mismatch in ?: true:%s, false:%s",
+                    expr->line_number, get_type_name(t_type->basic_type),
+                    get_type_name(f_type->basic_type));
+            add_check_log(message, visitor);
+            return;
+        }
+        CS_Boolean wide = cs_is_double(t_type) || cs_is_double(f_type) ||
+                          cs_is_type(t_type, CS_DOUBLE4_TYPE) ||
+                          cs_is_type(f_type, CS_DOUBLE4_TYPE);
+        if (cs_is_vector(t_type) || cs_is_vector(f_type)) {
+            type = cs_create_type_specifier(wide ? CS_DOUBLE4_TYPE
+                                                 : CS_INT4_TYPE);
+        } else {
+            type = cs_create_type_specifier(CS_DOUBLE_TYPE);
+        }
+    }
+    if (cs_is_struct(type) || cs_is_struct_array(type) ||
+        t_type->array_length > 0 || f_type->array_length > 0) {
+        sprintf(message, "%d: ?: cannot pick a %s", expr->line_number,
+                get_type_name(type->basic_type));
+        add_check_log(message, visitor);
+        return;
+    }
+    c_expr->true_expr = assignment_type_check(type, c_expr->true_expr, visitor);
+    c_expr->false_expr =
+        assignment_type_check(type, c_expr->false_expr, visitor);
+    expr->type = type;
+    c_expr->branchless =
+        (cs_is_boolean(type) || cs_is_int(type) || cs_is_double(type)) &&
+        can_speculate(c_expr->true_expr) && can_speculate(c_expr->false_expr);
 }
 
-static void leave_declstmt(Statement* stmt, Visitor* visitor) {
-    //    fprintf(stderr, "leave declstmt\n");
-    Declaration* decl = stmt->u.declaration_s;
-    if (decl->initializer != NULL) {
-        decl->initializer =
-            assignment_type_check(decl->type, decl->initializer, visitor);
+static void array_assignment_check(Expression* expr, Visitor* visitor) {
+    Expression* left = expr->u.assignment_expression.left;
+    char message[100];
+    if (left->kind == INDEX_EXPRESSION) {
+        // the index is evaluated again to load or reload the element
+        if (has_side_effect(left->u.index_expression.index)) {
+            sprintf(message,
+                    "%d: Array index of an assignment has a side effect",
+                    expr->line_number);
+            add_check_log(message, visitor);
+        }
+        return;
+    }
+    if (left->type == NULL ||
+        !(cs_is_array(left->type) || cs_is_struct_array(left->type))) {
+        return;
+    }
+    if (expr->u.assignment_expression.aope != ASSIGN) {
+        sprintf(message, "%d: Cannot apply compound assignment to %s",
+                expr->line_number, get_type_name(left->type->basic_type));
+        add_check_log(message, visitor);
+    } else if (left->type->array_length > 0) {
+        sprintf(message, "%d: Cannot assign fixed size array %s",
+                expr->line_number, left->u.identifier.name);
+        add_check_log(message, visitor);
     }
 }
 
-static void enter_ifopstmt(Statement* stmt, Visitor* visitor) {
-    if (stmt->u.ifop_s->op_kind == IF_OP_LEAVE) return;
-    switch (stmt->u.ifop_s->expression_s->type->basic_type) {
-        case CS_BOOLEAN_TYPE:
-        case CS_INT_TYPE:
+// += concatenates, no other compound assignment applies to a string
+static void string_assignment_check(Expression* expr, Visitor* visitor) {
+    Expression* left = expr->u.assignment_expression.left;
+    char message[100];
+    if (left->type == NULL || !cs_is_string(left->type)) return;
+    switch (expr->u.assignment_expression.aope) {
+        case ASSIGN: {
             break;
-
-        default:
-            fprintf(stderr, "unknown type in enter_ifstmt\n");
-            exit(1);
-    }
-
-    /*
+        }
+        case ADD_ASSIGN: {
+            check_parallel_alloc(expr->line_number, "a string", visitor);
+            break;
+        }
+        default: {
+            sprintf(message, "%d: Cannot apply compound assignment to %s",
+                    expr->line_number, get_type_name(left->type->basic_type));
+            add_check_log(message, visitor);
+        }
+    }
+}
+
+// lanes are assigned one at a time, a swizzle is no variable
+static void vector_assignment_check(Expression* expr, Visitor* visitor) {
+    Expression* left = expr->u.assignment_expression.left;
+    AssignmentOperator aope = expr->u.assignment_expression.aope;
+    char message[100];
+    if (left->kind == MEMBER_EXPRESSION) {
+        sprintf(message, "%d: Cannot assign lanes %s, assign them one by one",
+                expr->line_number, left->u.member_expression.member);
+        add_check_log(message, visitor);
+    } else if (left->type && cs_is_vector(left->type) &&
+               (aope == MOD_ASSIGN ||
+                (aope == DIV_ASSIGN && cs_is_type(left->type, CS_INT4_TYPE)))) {
+        sprintf(message, "%d: Cannot apply compound assignment to %s",
+                expr->line_number, get_type_name(left->type->basic_type));
+        add_check_log(message, visitor);
+    }
+}
+
+static void enter_assignexpr(Expression* expr, Visitor* visitor) {}
+static void leave_assignexpr(Expression* expr, Visitor* visitor) {
+    Expression* left = expr->u.assignment_expression.left;
+    Expression* right = expr->u.assignment_expression.right;
+    if (whole_struct_check(left, visitor)) return;
+    expr->u.assignment_expression.right =
+        assignment_type_check(left->type, right, visitor);
+    expr->type = left->type;
+    array_assignment_check(expr, visitor);
+    string_assignment_check(expr, visitor);
+    vector_assignment_check(expr, visitor);
+    check_parallel_write(left, visitor);
+}
+
+/*
+ * An index needs no bounds check when it is a constant inside a fixed size
+ * array, or the loop variable of a parallel for whose range lies inside
+ * the array: constant bounds within a fixed size, or 0 .. length(array).
+ * Neither the loop variable nor a shared array can be assigned in the
+ * body, so the range still holds at the access.
+ */
+static CS_Boolean index_in_range(MeanVisitor* visitor, IndexExpression* index) {
+    Declaration* array = index->array->u.identifier.u.declaration;
+    long length = array->type->array_length;
+    Expression* i = index->index;
+    if (i->kind == INT_EXPRESSION) {
+        return i->u.int_value >= 0 && i->u.int_value < length;
+    }
+
+    ParallelForOperation* parallel = visitor->parallel;
+    if (parallel == NULL || i->kind != IDENTIFIER_EXPRESSION ||
+        i->u.identifier.is_function ||
+        i->u.identifier.u.declaration != parallel->loop_variable) {
+        return CS_FALSE;
+    }
+    Expression* lower = parallel->lower;
+    Expression* upper = parallel->upper;
+    if (lower->kind != INT_EXPRESSION || lower->u.int_value < 0) {
+        return CS_FALSE;
+    }
+    if (upper->kind == INT_EXPRESSION) {
+        return (long)upper->u.int_value + parallel->inclusive <= length;
+    }
+    if (parallel->inclusive || upper->kind != FUNCTION_CALL_EXPRESSION ||
+        upper->u.function_call_expression.intrinsic != CS_INTRINSIC_LENGTH) {
+        return CS_FALSE;
+    }
+    Expression* bound = upper->u.function_call_expression.argument->expr;
+    return bound->kind == IDENTIFIER_EXPRESSION &&
+           !bound->u.identifier.is_function &&
+           bound->u.identifier.u.declaration == array;
+}
+
+static void enter_indexexpr(Expression* expr, Visitor* visitor) {}
+static void leave_indexexpr(Expression* expr, Visitor* visitor) {
+    IndexExpression* index = &expr->u.index_expression;
+    char message[100];
+    if (index->array->type == NULL || index->index->type == NULL) {
+        return;  // already reported
+    }
+    if (index->array->kind != IDENTIFIER_EXPRESSION ||
+        index->array->u.identifier.is_function ||
+        !(cs_is_array(index->array->type) ||
+          cs_is_struct_array(index->array->type))) {
+        sprintf(message, "%d: Only an array variable can be indexed (%s)",
+                expr->line_number,
+                get_type_name(index->array->type->basic_type));
+        add_check_log(message, visitor);
+        return;
+    }
+    if (!cs_is_int(index->index->type)) {
+        sprintf(message, "%d: Array index is not INT type (%s)",
+                expr->line_number,
+                get_type_name(index->index->type->basic_type));
+        add_check_log(message, visitor);
+        return;
+    }
+    if (cs_is_struct_array(index->array->type)) {
+        expr->type = cs_create_type_specifier(CS_STRUCT_TYPE);
+        expr->type->struct_def = index->array->type->struct_def;
+    } else {
+        expr->type = cs_create_type_specifier(
+            cs_element_type(index->array->type->basic_type));
+    }
+    index->checked = !index_in_range((MeanVisitor*)visitor, index);
+}
+
+// expr becomes the identifier of the variable record.member
+static void member_variable(Expression* expr, Visitor* visitor) {
+    CS_Compiler* compiler = ((MeanVisitor*)visitor)->compiler;
+    char* name = expr->u.member_expression.expression->u.identifier.name;
+    char* member = expr->u.member_expression.member;
+    char* field_name = cs_malloc(strlen(name) + strlen(member) + 2);
+    sprintf(field_name, "%s.%s", name, member);
+    Declaration* decl = cs_search_decl_in_block(
+        field_name, compiler->decl_list_tail, compiler->cp_list_tail);
+    expr->kind = IDENTIFIER_EXPRESSION;
+    expr->u.identifier.name = field_name;
+    expr->u.identifier.is_function = CS_FALSE;
+    expr->u.identifier.u.declaration = decl;
+}
+
+/*
+ * v.x, v.y, v.z and v.w read one lane of a vector, four of the letters in
+ * any order build a vector of those lanes. A lane of a variable is the
+ * variable holding it, anything else stays a member expression for
+ * SVM_EXTRACT_VECTOR or SVM_SHUFFLE_VECTOR.
+ */
+static void vector_member(Expression* expr, Visitor* visitor) {
+    Expression* vector = expr->u.member_expression.expression;
+    char* member = expr->u.member_expression.member;
+    const char* lanes = "xyzw";
+    int count = strlen(member);
+    int swizzle = 0;
+    for (int i = 0; i < count; ++i) {
+        char* lane = strchr(lanes, member[i]);
+        if (lane == NULL || (count != 1 && count != SVM_VECTOR_LANES)) {
+            char message[100];
+            sprintf(message, "%d: Cannot take lanes %s of %s",
+                    expr->line_number, member,
+                    get_type_name(vector->type->basic_type));
+            add_check_log(message, visitor);
+            return;
+        }
+        swizzle |= (int)(lane - lanes) << (2 * i);
+    }
+    if (count > 1) {
+        expr->u.member_expression.swizzle = swizzle;
+        expr->type = vector->type;
+        return;
+    }
+    CS_BasicType lane = cs_lane_type(vector->type->basic_type);
+    if (vector->kind == IDENTIFIER_EXPRESSION) {
+        member_variable(expr, visitor);
+    } else {
+        expr->u.member_expression.swizzle = swizzle;
+    }
+    expr->type = cs_create_type_specifier(lane);
+}
+
+/*
+ * p.name turns into the identifier of the variable p.name that holds the
+ * field, a[i].name into an index expression reading slot field of the
+ * record a[i]. Either way later passes never see a member expression of a
+ * struct.
+ */
+static void enter_memberexpr(Expression* expr, Visitor* visitor) {}
+static void leave_memberexpr(Expression* expr, Visitor* visitor) {
+    Expression* record = expr->u.member_expression.expression;
+    char* member = expr->u.member_expression.member;
+    char message[100];
+    if (record->type == NULL || (cs_is_struct(record->type) &&
+                                 record->type->struct_def == NULL)) {
+        return;  // already reported
+    }
+    if (cs_is_vector(record->type)) {
+        vector_member(expr, visitor);
+        return;
+    }
+    if (!cs_is_struct(record->type)) {
+        sprintf(message, "%d: Cannot take field %s of %s", expr->line_number,
+                member, get_type_name(record->type->basic_type));
+        add_check_log(message, visitor);
+        return;
+    }
+    FieldList* field = record->type->struct_def->field;
+    for (; field; field = field->next) {
+        if (!strcmp(field->name, member)) break;
+    }
+    if (field == NULL) {
+        sprintf(message, "%d: struct %s has no field %s", expr->line_number,
+                record->type->struct_def->name, member);
+        add_check_log(message, visitor);
+        return;
+    }
+
+    if (record->kind == INDEX_EXPRESSION) {
+        IndexExpression index = record->u.index_expression;
+        index.field = field->offset;
+        expr->kind = INDEX_EXPRESSION;
+        expr->u.index_expression = index;
+    } else {
+        member_variable(expr, visitor);
+    }
+    expr->type = field->type;
+}
+
+static void enter_newarrayexpr(Expression* expr, Visitor* visitor) {}
+static void leave_newarrayexpr(Expression* expr, Visitor* visitor) {
+    NewArrayExpression* new_array = &expr->u.new_array_expression;
+    char message[100];
+    if (new_array->type == CS_BASIC_TYPE_PLUS_ONE) {
+        sprintf(message, "%d: Arrays hold only INT or DOUBLE",
+                expr->line_number);
+        add_check_log(message, visitor);
+        return;
+    }
+    if (new_array->length->type && !cs_is_int(new_array->length->type)) {
+        sprintf(message, "%d: Array length is not INT type (%s)",
+                expr->line_number,
+                get_type_name(new_array->length->type->basic_type));
+        add_check_log(message, visitor);
+    }
+    check_parallel_alloc(expr->line_number, "an array", visitor);
+    expr->type = cs_create_type_specifier(new_array->type);
+}
+
+/*
+ * A pure call whose arguments are all literals is replaced by its value.
+ * A cast or minus sign of a literal counts as a literal, so does a call
+ * folded before. The math builtins are worked out here the way the VM
+ * does them and a pure typed native is called.
+ */
+#define FOLD_ARGUMENTS (3)
+
+static CS_Boolean constant_value(Expression* expr, SVM_Value* value) {
+    if (expr->type == NULL ||
+        !(cs_is_int(expr->type) || cs_is_double(expr->type))) {
+        return CS_FALSE;
+    }
+    switch (expr->kind) {
+        case INT_EXPRESSION: {
+            value->ival = expr->u.int_value;
+            return CS_TRUE;
+        }
+        case DOUBLE_EXPRESSION: {
+            value->dval = expr->u.double_value;
+            return CS_TRUE;
+        }
+        case MINUS_EXPRESSION: {
+            if (!constant_value(expr->u.minus_expression, value)) {
+                return CS_FALSE;
+            }
+            if (cs_is_double(expr->type)) {
+                value->dval = -value->dval;
+            } else {
+                value->ival = -value->ival;
+            }
+            return CS_TRUE;
+        }
+        case CAST_EXPRESSION: {
+            if (!constant_value(expr->u.cast_expression.expr, value)) {
+                return CS_FALSE;
+            }
+            switch (expr->u.cast_expression.ctype) {
+                case CS_INT_TO_DOUBLE: {
+                    value->dval = value->ival;
+                    return CS_TRUE;
+                }
+                case CS_DOUBLE_TO_INT: {
+                    value->ival = (int)value->dval;
+                    return CS_TRUE;
+                }
+                default: {
+                    return CS_FALSE;
+                }
+            }
+        }
+        default: {
+            return CS_FALSE;
+        }
+    }
+}
+
+/* The number of arguments, -1 unless every one is a literal. */
+static int constant_arguments(ArgumentList* args, SVM_Value* values) {
+    int count = 0;
+    for (; args; args = args->next) {
+        if (count == FOLD_ARGUMENTS ||
+            !constant_value(args->expr, &values[count++])) {
+            return -1;
+        }
+    }
+    return count;
+}
+
+static void fold_to_literal(Expression* expr, SVM_Value value) {
+    if (cs_is_double(expr->type)) {
+        expr->kind = DOUBLE_EXPRESSION;
+        expr->u.double_value = value.dval;
+    } else {
+        expr->kind = INT_EXPRESSION;
+        expr->u.int_value = value.ival;
+    }
+}
+
+static void fold_intrinsic(Expression* expr) {
+    SVM_Value a[FOLD_ARGUMENTS];
+    SVM_Value v;
+    CS_Boolean is_int = cs_is_int(expr->type);
+    if (constant_arguments(expr->u.function_call_expression.argument, a) <
+        0) {
+        return;
+    }
+    switch (expr->u.function_call_expression.intrinsic) {
+        case CS_INTRINSIC_SQRT: {
+            v.dval = sqrt(a[0].dval);
+            break;
+        }
+        case CS_INTRINSIC_ABS: {
+            if (is_int) {
+                v.ival = a[0].ival < 0 ? -a[0].ival : a[0].ival;
+            } else {
+                v.dval = fabs(a[0].dval);
+            }
+            break;
+        }
+        case CS_INTRINSIC_MIN: {
+            if (is_int) {
+                v.ival = a[0].ival < a[1].ival ? a[0].ival : a[1].ival;
+            } else {
+                v.dval = a[0].dval < a[1].dval ? a[0].dval : a[1].dval;
+            }
+            break;
+        }
+        case CS_INTRINSIC_MAX: {
+            if (is_int) {
+                v.ival = a[0].ival > a[1].ival ? a[0].ival : a[1].ival;
+            } else {
+                v.dval = a[0].dval > a[1].dval ? a[0].dval : a[1].dval;
+            }
+            break;
+        }
+        case CS_INTRINSIC_FLOOR: {
+            v.dval = floor(a[0].dval);
+            break;
+        }
+        case CS_INTRINSIC_FMA: {
+            if (is_int) {
+                v.ival = a[0].ival * a[1].ival + a[2].ival;
+            } else {
+                v.dval = fma(a[0].dval, a[1].dval, a[2].dval);
+            }
+            break;
+        }
+        case CS_INTRINSIC_SIN: {
+            v.dval = sin(a[0].dval);
+            break;
+        }
+        case CS_INTRINSIC_COS: {
+            v.dval = cos(a[0].dval);
+            break;
+        }
+        case CS_INTRINSIC_EXP: {
+            v.dval = exp(a[0].dval);
+            break;
+        }
+        case CS_INTRINSIC_LOG: {
+            v.dval = log(a[0].dval);
+            break;
+        }
+        default: {
+            return;
+        }
+    }
+    fold_to_literal(expr, v);
+}
+
+/* Only a pure typed native can be called without a context. */
+static void fold_native_call(Expression* expr) {
+    FunctionCallExpression* f_expr = &expr->u.function_call_expression;
+    const SVM_Function* native =
+        find_native_function(f_expr->function->u.identifier.name);
+    SVM_Value a[FOLD_ARGUMENTS];
+    if (native == NULL || !native->pure || expr->type == NULL ||
+        native->f_type != TYPED_NATIVE_FUNCTION ||
+        constant_arguments(f_expr->argument, a) != native->arg_count) {
+        return;
+    }
+    fold_to_literal(expr, svm_call_typed(native, a));
+}
+
+// a declared function of the same name takes precedence over a builtin
+static void enter_funccallexpr(Expression* expr, Visitor* visitor) {
+    FunctionCallExpression* f_expr = &expr->u.function_call_expression;
+    int arg_count;
+    if (f_expr->function->kind == IDENTIFIER_EXPRESSION &&
+        !cs_search_function(f_expr->function->u.identifier.name)) {
+        f_expr->intrinsic =
+            cs_search_intrinsic(f_expr->function->u.identifier.name,
+                                &arg_count);
+    }
+}
+
+static void cast_argument(ArgumentList* arg, CS_CastType ctype) {
+    Expression* cast = cs_create_cast_expression(ctype, arg->expr);
+    cast->type = cs_create_type_specifier(
+        ctype == CS_INT_TO_DOUBLE ? CS_DOUBLE_TYPE : CS_INT_TYPE);
+    arg->expr = cast;
+}
+
+/*
+ * abs, min, max and fma stay int when every argument is int; everything
+ * else is computed in double, with int arguments widened.
+ */
+static void leave_intrinsic(Expression* expr, Visitor* visitor) {
+    FunctionCallExpression* f_expr = &expr->u.function_call_expression;
+    char message[100];
+    int arg_count, count = 0;
+    CS_Boolean all_int = CS_TRUE;
+    cs_search_intrinsic(f_expr->function->u.identifier.name, &arg_count);
+
+    for (ArgumentList* args = f_expr->argument; args; args = args->next) {
+        count++;
+        if (args->expr->type == NULL) return;  // already reported
+        if (cs_is_double(args->expr->type)) {
+            all_int = CS_FALSE;
+        } else if (!cs_is_int(args->expr->type)) {
+            sprintf(message, "%d: %s needs numeric arguments, pass:%s",
+                    expr->line_number, f_expr->function->u.identifier.name,
+                    get_type_name(args->expr->type->basic_type));
+            add_check_log(message, visitor);
+            return;
+        }
+    }
+    if (count != arg_count) {
+        sprintf(message,
+                "%d: argument count mismatch in function call require:%d, "
+                "pass:%d",
+                expr->line_number, arg_count, count);
+        add_check_log(message, visitor);
+        return;
+    }
+
+    switch (f_expr->intrinsic) {
+        case CS_INTRINSIC_ABS:
+        case CS_INTRINSIC_MIN:
+        case CS_INTRINSIC_MAX:
+        case CS_INTRINSIC_FMA: {
+            break;
+        }
+        default: {
+            all_int = CS_FALSE;
+            break;
+        }
+    }
+    if (!all_int) {
+        for (ArgumentList* args = f_expr->argument; args; args = args->next) {
+            if (cs_is_int(args->expr->type)) {
+                cast_argument(args, CS_INT_TO_DOUBLE);
+            }
+        }
+    }
+    expr->type = cs_create_type_specifier(all_int ? CS_INT_TYPE
+                                                  : CS_DOUBLE_TYPE);
+    fold_intrinsic(expr);
+}
+
+/* Arguments of the array builtins: 'a' an array, 's' one of its elements. */
+static const char* array_signatures[CS_INTRINSIC_PLUS_ONE] = {
+    [CS_INTRINSIC_LENGTH] = "a",    [CS_INTRINSIC_SUM] = "a",
+    [CS_INTRINSIC_DOT] = "aa",      [CS_INTRINSIC_ARRAY_MIN] = "a",
+    [CS_INTRINSIC_ARRAY_MAX] = "a", [CS_INTRINSIC_AXPY] = "saa",
+    [CS_INTRINSIC_FILL] = "as",     [CS_INTRINSIC_COPY] = "aa",
+};
+
+/*
+ * Every array argument has the type of the first one, scalars are cast to
+ * its element type. length is int, sum, dot, min and max are an element,
+ * axpy, fill and copy give back the array they wrote.
+ */
+static void leave_array_intrinsic(Expression* expr, Visitor* visitor) {
+    FunctionCallExpression* f_expr = &expr->u.function_call_expression;
+    const char* name = f_expr->function->u.identifier.name;
+    const char* signature = array_signatures[f_expr->intrinsic];
+    TypeSpecifier* array_type = NULL;
+    char message[100];
+    int count = 0, arg_count = strlen(signature);
+
+    for (ArgumentList* args = f_expr->argument; args; args = args->next) {
+        if (args->expr->type == NULL) return;  // already reported
+        if (count < arg_count && signature[count] == 'a' &&
+            array_type == NULL) {
+            array_type = args->expr->type;
+        }
+        count++;
+    }
+    if (count != arg_count) {
+        sprintf(message,
+                "%d: argument count mismatch in function call require:%d, "
+                "pass:%d",
+                expr->line_number, arg_count, count);
+        add_check_log(message, visitor);
+        return;
+    }
+
+    CS_BasicType element = cs_element_type(array_type->basic_type);
+    count = 0;
+    for (ArgumentList* args = f_expr->argument; args; args = args->next) {
+        TypeSpecifier* type = args->expr->type;
+        if (signature[count++] == 'a') {
+            if (cs_is_array(type) && cs_same_type(type, array_type)) continue;
+        } else if (cs_is_type(type, element)) {
+            continue;
+        } else if (cs_is_int(type) || cs_is_double(type)) {
+            cast_argument(args, element == CS_DOUBLE_TYPE ? CS_INT_TO_DOUBLE
+                                                          : CS_DOUBLE_TO_INT);
+            continue;
+        }
+        sprintf(message, "%d: type mismatch in %s argument %d, pass:%s",
+                expr->line_number, name, count,
+                get_type_name(type->basic_type));
+        add_check_log(message, visitor);
+        return;
+    }
+
+    // every array in a parallel for body is shared, see check_parallel_write
+    if (((MeanVisitor*)visitor)->parallel &&
+        (f_expr->intrinsic == CS_INTRINSIC_AXPY ||
+         f_expr->intrinsic == CS_INTRINSIC_FILL ||
+         f_expr->intrinsic == CS_INTRINSIC_COPY)) {
+        sprintf(message, "%d: Cannot %s a shared array in parallel for",
+                expr->line_number, name);
+        add_check_log(message, visitor);
+        return;
+    }
+
+    switch (f_expr->intrinsic) {
+        case CS_INTRINSIC_LENGTH: {
+            expr->type = cs_create_type_specifier(CS_INT_TYPE);
+            break;
+        }
+        case CS_INTRINSIC_AXPY:
+        case CS_INTRINSIC_FILL:
+        case CS_INTRINSIC_COPY: {
+            expr->type = cs_create_type_specifier(array_type->basic_type);
+            break;
+        }
+        default: {
+            expr->type = cs_create_type_specifier(element);
+            break;
+        }
+    }
+}
+
+/* Arguments of the string builtins: 's' a string, 'i' an int, 'n' a number. */
+static const char* string_signatures[CS_INTRINSIC_PLUS_ONE] = {
+    [CS_INTRINSIC_STRING_LENGTH] = "s",
+    [CS_INTRINSIC_SUBSTR] = "sii",
+    [CS_INTRINSIC_STR] = "n",
+};
+
+/* length is int; substr and str build a new string. */
+static void leave_string_intrinsic(Expression* expr, Visitor* visitor) {
+    FunctionCallExpression* f_expr = &expr->u.function_call_expression;
+    const char* name = f_expr->function->u.identifier.name;
+    const char* signature = string_signatures[f_expr->intrinsic];
+    char message[100];
+    int count = 0, arg_count = strlen(signature);
+
+    for (ArgumentList* args = f_expr->argument; args; args = args->next) {
+        if (args->expr->type == NULL) return;  // already reported
+        count++;
+    }
+    if (count != arg_count) {
+        sprintf(message,
+                "%d: argument count mismatch in function call require:%d, "
+                "pass:%d",
+                expr->line_number, arg_count, count);
+        add_check_log(message, visitor);
+        return;
+    }
+
+    count = 0;
+    for (ArgumentList* args = f_expr->argument; args; args = args->next) {
+        TypeSpecifier* type = args->expr->type;
+        switch (signature[count++]) {
+            case 's': {
+                if (cs_is_string(type)) continue;
+                break;
+            }
+            case 'i': {
+                if (cs_is_int(type)) continue;
+                if (cs_is_double(type)) {
+                    cast_argument(args, CS_DOUBLE_TO_INT);
+                    continue;
+                }
+                break;
+            }
+            default: {
+                if (cs_is_int(type) || cs_is_double(type)) continue;
+                break;
+            }
+        }
+        sprintf(message, "%d: type mismatch in %s argument %d, pass:%s",
+                expr->line_number, name, count,
+                get_type_name(type->basic_type));
+        add_check_log(message, visitor);
+        return;
+    }
+
+    if (f_expr->intrinsic == CS_INTRINSIC_STRING_LENGTH) {
+        expr->type = cs_create_type_specifier(CS_INT_TYPE);
+    } else {
+        check_parallel_alloc(expr->line_number, "a string", visitor);
+        expr->type = cs_create_type_specifier(CS_STRING_TYPE);
+    }
+}
+
+/* Arguments of the map builtins: 'm' a map, 'k' a key, 'v' a value. */
+static const char* map_signatures[CS_INTRINSIC_PLUS_ONE] = {
+    [CS_INTRINSIC_GET] = "mk",
+    [CS_INTRINSIC_PUT] = "mkv",
+    [CS_INTRINSIC_INCREMENT] = "mkv",
+    [CS_INTRINSIC_SIZE] = "m",
+};
+
+/*
+ * Keys are cast to int and values to the value type of the map. size is
+ * int, get, put and increment give the value now held for the key.
+ */
+static void leave_map_intrinsic(Expression* expr, Visitor* visitor) {
+    FunctionCallExpression* f_expr = &expr->u.function_call_expression;
+    const char* name = f_expr->function->u.identifier.name;
+    const char* signature = map_signatures[f_expr->intrinsic];
+    TypeSpecifier* map_type = NULL;
+    char message[100];
+    int count = 0, arg_count = strlen(signature);
+
+    for (ArgumentList* args = f_expr->argument; args; args = args->next) {
+        if (args->expr->type == NULL) return;  // already reported
+        if (count == 0) map_type = args->expr->type;
+        count++;
+    }
+    if (count != arg_count) {
+        sprintf(message,
+                "%d: argument count mismatch in function call require:%d, "
+                "pass:%d",
+                expr->line_number, arg_count, count);
+        add_check_log(message, visitor);
+        return;
+    }
+
+    CS_BasicType value = cs_map_value_type(map_type->basic_type);
+    count = 0;
+    for (ArgumentList* args = f_expr->argument; args; args = args->next) {
+        TypeSpecifier* type = args->expr->type;
+        CS_BasicType want = signature[count] == 'k' ? CS_INT_TYPE : value;
+        if (signature[count++] == 'm') {
+            if (cs_is_map(type)) continue;
+        } else if (cs_is_type(type, want)) {
+            continue;
+        } else if (cs_is_int(type) || cs_is_double(type)) {
+            cast_argument(args, want == CS_DOUBLE_TYPE ? CS_INT_TO_DOUBLE
+                                                       : CS_DOUBLE_TO_INT);
+            continue;
+        }
+        sprintf(message, "%d: type mismatch in %s argument %d, pass:%s",
+                expr->line_number, name, count,
+                get_type_name(type->basic_type));
+        add_check_log(message, visitor);
+        return;
+    }
+
+    switch (f_expr->intrinsic) {
+        case CS_INTRINSIC_SIZE: {
+            expr->type = cs_create_type_specifier(CS_INT_TYPE);
+            break;
+        }
+        case CS_INTRINSIC_PUT:
+        case CS_INTRINSIC_INCREMENT: {
+            if (((MeanVisitor*)visitor)->parallel) {
+                sprintf(message, "%d: Cannot write a map in parallel for",
+                        expr->line_number);
+                add_check_log(message, visitor);
+            }
+            expr->type = cs_create_type_specifier(value);
+            break;
+        }
+        default: {
+            expr->type = cs_create_type_specifier(value);
+            break;
+        }
+    }
+}
+
+static const int vector_arg_counts[CS_INTRINSIC_PLUS_ONE] = {
+    [CS_INTRINSIC_ALL] = 1,        [CS_INTRINSIC_ANY] = 1,
+    [CS_INTRINSIC_VECTOR_SUM] = 1, [CS_INTRINSIC_VECTOR_DOT] = 2,
+    [CS_INTRINSIC_VECTOR_MIN] = 1, [CS_INTRINSIC_VECTOR_MAX] = 1,
+};
+
+/*
+ * int4 and double4 build a vector of four numbers, or convert one number
+ * or vector, all cast to the lane type. all and any fold an int4, sum,
+ * min, max and dot fold vectors of one type into a lane.
+ */
+static void leave_vector_intrinsic(Expression* expr, Visitor* visitor) {
+    FunctionCallExpression* f_expr = &expr->u.function_call_expression;
+    const char* name = f_expr->function->u.identifier.name;
+    CS_Intrinsic intrinsic = f_expr->intrinsic;
+    char message[100];
+    int count = 0;
+
+    for (ArgumentList* args = f_expr->argument; args; args = args->next) {
+        if (args->expr->type == NULL) return;  // already reported
+        count++;
+    }
+    if (intrinsic == CS_INTRINSIC_INT4 || intrinsic == CS_INTRINSIC_DOUBLE4) {
+        CS_BasicType vector =
+            intrinsic == CS_INTRINSIC_INT4 ? CS_INT4_TYPE : CS_DOUBLE4_TYPE;
+        CS_BasicType lane = cs_lane_type(vector);
+        count = 0;
+        for (ArgumentList* args = f_expr->argument; args; args = args->next) {
+            TypeSpecifier* type = args->expr->type;
+            count++;
+            if (f_expr->argument->next == NULL) {
+                Expression* converted = vector_conversion(args->expr, vector);
+                if (converted) {
+                    args->expr = converted;
+                    continue;
+                }
+            } else if (cs_is_type(type, lane)) {
+                continue;
+            } else if (cs_is_int(type) || cs_is_double(type)) {
+                cast_argument(args, lane == CS_DOUBLE_TYPE ? CS_INT_TO_DOUBLE
+                                                           : CS_DOUBLE_TO_INT);
+                continue;
+            }
+            sprintf(message, "%d: type mismatch in %s argument %d, pass:%s",
+                    expr->line_number, name, count,
+                    get_type_name(type->basic_type));
+            add_check_log(message, visitor);
+            return;
+        }
+        if (count != 1 && count != SVM_VECTOR_LANES) {
+            sprintf(message,
+                    "%d: argument count mismatch in function call require:%d, "
+                    "pass:%d",
+                    expr->line_number, SVM_VECTOR_LANES, count);
+            add_check_log(message, visitor);
+            return;
+        }
+        expr->type = cs_create_type_specifier(vector);
+        return;
+    }
+
+    if (count != vector_arg_counts[intrinsic]) {
+        sprintf(message,
+                "%d: argument count mismatch in function call require:%d, "
+                "pass:%d",
+                expr->line_number, vector_arg_counts[intrinsic], count);
+        add_check_log(message, visitor);
+        return;
+    }
+    TypeSpecifier* first = f_expr->argument->expr->type;
+    count = 0;
+    for (ArgumentList* args = f_expr->argument; args; args = args->next) {
+        TypeSpecifier* type = args->expr->type;
+        count++;
+        if (intrinsic == CS_INTRINSIC_ALL || intrinsic == CS_INTRINSIC_ANY
+                ? cs_is_type(type, CS_INT4_TYPE)
+                : cs_is_vector(type) && cs_same_type(type, first)) {
+            continue;
+        }
+        sprintf(message, "%d: type mismatch in %s argument %d, pass:%s",
+                expr->line_number, name, count,
+                get_type_name(type->basic_type));
+        add_check_log(message, visitor);
+        return;
+    }
+    if (intrinsic == CS_INTRINSIC_ALL || intrinsic == CS_INTRINSIC_ANY) {
+        expr->type = cs_create_type_specifier(CS_BOOLEAN_TYPE);
+    } else {
+        expr->type = cs_create_type_specifier(cs_lane_type(first->basic_type));
+    }
+}
+
+// sum, dot, min and max of a vector are the vector builtins
+static void find_vector_intrinsic(FunctionCallExpression* f_expr) {
+    Expression* first = f_expr->argument ? f_expr->argument->expr : NULL;
+    if (first == NULL || first->type == NULL || !cs_is_vector(first->type)) {
+        return;
+    }
+    switch (f_expr->intrinsic) {
+        case CS_INTRINSIC_SUM: {
+            f_expr->intrinsic = CS_INTRINSIC_VECTOR_SUM;
+            break;
+        }
+        case CS_INTRINSIC_DOT: {
+            f_expr->intrinsic = CS_INTRINSIC_VECTOR_DOT;
+            break;
+        }
+        case CS_INTRINSIC_MIN: {
+            f_expr->intrinsic = CS_INTRINSIC_VECTOR_MIN;
+            break;
+        }
+        case CS_INTRINSIC_MAX: {
+            f_expr->intrinsic = CS_INTRINSIC_VECTOR_MAX;
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+}
+
+/*
+ * A declaration that binds to a native needs the native's arity and, for
+ * a typed native, its exact return and parameter types: the VM hands the
+ * values over as they are.
+ */
+static CS_Boolean check_native_prototype(FunctionDeclaration* func_dec,
+                                         const SVM_Function* native,
+                                         int line_number, Visitor* visitor) {
+    const char* args = native->f_type == TYPED_NATIVE_FUNCTION
+                           ? svm_signature_args[native->signature]
+                           : NULL;
+    CS_Boolean match =
+        native->f_type != TYPED_NATIVE_FUNCTION ||
+        (svm_signature_type[native->signature] == SVM_DOUBLE
+             ? cs_is_double(func_dec->type)
+             : cs_is_int(func_dec->type));
+    int count = 0;
+    for (ParameterList* params = func_dec->param; params;
+         params = params->next, ++count) {
+        if (args && count < native->arg_count &&
+            !(args[count] == 'd' ? cs_is_double(params->type)
+                                 : cs_is_int(params->type))) {
+            match = CS_FALSE;
+        }
+    }
+    if (count != native->arg_count) match = CS_FALSE;
+    if (!match) {
+        char message[100];
+        sprintf(message, "%d: %.40s does not match its native prototype",
+                line_number, func_dec->name);
+        add_check_log(message, visitor);
+    }
+    return match;
+}
+
+static void leave_funccallexpr(Expression* expr, Visitor* visitor) {
+    FunctionCallExpression* f_expr = &expr->u.function_call_expression;
+    FunctionDeclaration* func_dec = NULL;
+    find_vector_intrinsic(f_expr);
+    if (f_expr->intrinsic >= CS_INTRINSIC_INT4) {
+        leave_vector_intrinsic(expr, visitor);
+        return;
+    }
+    if (f_expr->intrinsic >= CS_INTRINSIC_GET) {
+        leave_map_intrinsic(expr, visitor);
+        return;
+    }
+    if (f_expr->intrinsic == CS_INTRINSIC_LENGTH && f_expr->argument &&
+        f_expr->argument->expr->type &&
+        cs_is_string(f_expr->argument->expr->type)) {
+        f_expr->intrinsic = CS_INTRINSIC_STRING_LENGTH;
+    }
+    if (f_expr->intrinsic >= CS_INTRINSIC_STRING_LENGTH) {
+        leave_string_intrinsic(expr, visitor);
+        return;
+    }
+    if ((f_expr->intrinsic == CS_INTRINSIC_MIN ||
+         f_expr->intrinsic == CS_INTRINSIC_MAX) &&
+        f_expr->argument && f_expr->argument->next == NULL) {
+        f_expr->intrinsic = f_expr->intrinsic == CS_INTRINSIC_MIN
+                                ? CS_INTRINSIC_ARRAY_MIN
+                                : CS_INTRINSIC_ARRAY_MAX;
+    }
+    if (f_expr->intrinsic >= CS_INTRINSIC_LENGTH) {
+        leave_array_intrinsic(expr, visitor);
+        return;
+    }
+    if (f_expr->intrinsic != CS_INTRINSIC_NONE) {
+        leave_intrinsic(expr, visitor);
+        return;
+    }
+    //    printf("type = %d\n", f_expr->function->kind);
+    switch (f_expr->function->kind) {
+        case IDENTIFIER_EXPRESSION: {
+            //            printf("identifier!!!\n");
+            //            printf("%s\n", f_expr->function->u.identifier.name);
+            func_dec = cs_search_function(f_expr->function->u.identifier.name);
+            break;
+        }
+        default: {
+            fprintf(stderr, "this type cannot be the function %d\n",
+                    f_expr->function->kind);
+            exit(1);
+        }
+    }
+
+    const SVM_Function* native =
+        func_dec ? find_native_function(func_dec->name) : NULL;
+    if (native && !check_native_prototype(func_dec, native,
+                                          expr->line_number, visitor)) {
+        expr->type = func_dec->type;
+        return;
+    }
+
+    if (func_dec) {
+        ParameterList* params = func_dec->param;
+        ArgumentList* args = f_expr->argument;
+        int params_count, args_count;
+        for (params_count = 0; params; params = params->next, ++params_count)
+            ;
+        for (args_count = 0; args; args = args->next, ++args_count)
+            ;
+        //        printf("params_count = %d\n", params_count);
+        //        printf("args_count   = %d\n", args_count);
+
+        if (params_count != args_count) {
+            fprintf(stderr, "argument count is not the same\n");
+            char message[100];
+            sprintf(message,
+                    "%d: argument count mismatch in function call require:%d, "
+                    "pass:%d",
+                    expr->line_number, params_count, args_count);
+            add_check_log(message, visitor);
+        } else {
+            for (params = func_dec->param, args = f_expr->argument; params;
+                 params = params->next, args = args->next) {
+                if (cs_same_type(params->type, args->expr->type)) {
+                    // OK
+                } else if (cs_is_int(params->type) &&
+                           cs_is_double(args->expr->type)) {
+                    Expression* cast =
+                        cs_create_cast_expression(CS_DOUBLE_TO_INT, args->expr);
+                    cast->type = cs_create_type_specifier(CS_INT_TYPE);
+                    args->expr = cast;
+                } else if (cs_is_double(params->type) &&
+                           cs_is_int(args->expr->type)) {
+                    Expression* cast =
+                        cs_create_cast_expression(CS_INT_TO_DOUBLE, args->expr);
+                    cast->type = cs_create_type_specifier(CS_DOUBLE_TYPE);
+                    args->expr = cast;
+                } else {
+                    char message[100];
+                    sprintf(message,
+                            "%d: type mismatch in function call require:%s, "
+                            "pass:%s",
+                            expr->line_number,
+                            get_type_name(params->type->basic_type),
+                            get_type_name(args->expr->type->basic_type));
+                    add_check_log(message, visitor);
+                }
+            }
+        }
+    }
+    expr->type = expr->u.function_call_expression.function->type;
+    fold_native_call(expr);
+}
+
+/* For statement */
+static void enter_exprstmt(Statement* stmt, Visitor* visitor) {
+    //    fprintf(stderr, "enter exprstmt :\n");
+}
+static void leave_exprstmt(Statement* stmt, Visitor* visitor) {
+    //    fprintf(stderr, "leave exprstmt\n");
+    whole_struct_check(stmt->u.expression_s, visitor);
+}
+
+static CS_Boolean is_field_type(TypeSpecifier* type) {
+    return cs_is_boolean(type) || cs_is_int(type) || cs_is_double(type) ||
+           cs_is_string(type);
+}
+
+/*
+ * Give each field of def one value slot in declaration order. An array
+ * pads its records to a power of two slots up to a cache line, so a
+ * record never straddles two lines.
+ */
+static CS_Boolean layout_struct(StructDefinition* def, Visitor* visitor) {
+    char message[100];
+    if (def->stride > 0) return CS_TRUE;
+    int offset = 0;
+    for (FieldList* field = def->field; field; field = field->next) {
+        if (!is_field_type(field->type)) {
+            sprintf(message, "%d: Field %s of struct %s is not %s",
+                    field->line_number, field->name, def->name,
+                    "BOOLEAN, INT, DOUBLE or STRING");
+            add_check_log(message, visitor);
+            return CS_FALSE;
+        }
+        for (FieldList* f = def->field; f != field; f = f->next) {
+            if (!strcmp(f->name, field->name)) {
+                sprintf(message, "%d: Already defined field %s of struct %s",
+                        field->line_number, field->name, def->name);
+                add_check_log(message, visitor);
+                return CS_FALSE;
+            }
+        }
+        field->offset = offset++;
+    }
+    def->field_count = offset;
+    int line = SVM_ARRAY_ALIGN / sizeof(SVM_Value);
+    int stride = 1;
+    while (stride < offset && stride < line) stride *= 2;
+    def->stride = offset > line ? offset : stride;
+    return CS_TRUE;
+}
+
+/*
+ * struct name p; declares p.name for every field right after p, so the
+ * fields take consecutive slots. p itself takes none.
+ */
+static void declare_struct(Statement* stmt, Visitor* visitor) {
+    CS_Compiler* compiler = ((MeanVisitor*)visitor)->compiler;
+    Declaration* decl = stmt->u.declaration_s;
+    StructDefinition* def = decl->type->struct_def;
+    if (!cs_is_struct(decl->type) && !cs_is_struct_array(decl->type)) {
+        return;
+    }
+    if (def == NULL) {
+        char message[100];
+        sprintf(message, "%d: Unknown struct type of %s", stmt->line_number,
+                decl->name);
+        add_check_log(message, visitor);
+        return;
+    }
+    if (!layout_struct(def, visitor) || cs_is_struct_array(decl->type)) {
+        return;
+    }
+    for (FieldList* field = def->field; field; field = field->next) {
+        compiler->decl_list = cs_chain_declaration(
+            compiler->decl_list, cs_create_field_declaration(decl, field));
+    }
+}
+
+// int4 v; declares v.x, v.y, v.z and v.w right after v, see declare_struct
+static void declare_vector(Statement* stmt, Visitor* visitor) {
+    CS_Compiler* compiler = ((MeanVisitor*)visitor)->compiler;
+    Declaration* decl = stmt->u.declaration_s;
+    if (!cs_is_vector(decl->type)) return;
+    for (int lane = 0; lane < SVM_VECTOR_LANES; ++lane) {
+        compiler->decl_list = cs_chain_declaration(
+            compiler->decl_list, cs_create_lane_declaration(decl, lane));
+    }
+}
+
+static void enter_declstmt(Statement* stmt, Visitor* visitor) {
+    CS_Compiler* compiler = ((MeanVisitor*)visitor)->compiler;
+    Declaration* decl = cs_search_decl_in_block(stmt->u.declaration_s->name,
+                                                compiler->decl_list_tail,
+                                                compiler->cp_list_tail);
+    // if (!decl) {
+    //     decl = cs_search_decl_global(stmt->u.declaration_s->name);
+    // }
+
+    if (decl) {
+        char message[50];
+        sprintf(message, "%d: Already defind identifier %s", stmt->line_number,
+                stmt->u.declaration_s->name);
+        add_check_log(message, visitor);
+        return;
+    }
+
+    compiler->decl_list =
+        cs_chain_declaration(compiler->decl_list, stmt->u.declaration_s);
+    //    fprintf(stderr, "enter declstmt\n");
+    declare_struct(stmt, visitor);
+    declare_vector(stmt, visitor);
+}
+
+static void leave_declstmt(Statement* stmt, Visitor* visitor) {
+    //    fprintf(stderr, "leave declstmt\n");
+    Declaration* decl = stmt->u.declaration_s;
+    if (decl->type->basic_type == CS_BASIC_TYPE_PLUS_ONE) {
+        char message[100];
+        sprintf(message, "%d: %s can hold only INT or DOUBLE (keyed by INT)",
+                stmt->line_number, decl->name);
+        add_check_log(message, visitor);
+        return;
+    }
+    if (decl->type->array_length > 0) {
+        check_parallel_alloc(stmt->line_number, "an array", visitor);
+    }
+    if (cs_is_map(decl->type) && decl->initializer == NULL) {
+        check_parallel_alloc(stmt->line_number, "a map", visitor);
+    }
+    if (decl->initializer != NULL) {
+        decl->initializer =
+            assignment_type_check(decl->type, decl->initializer, visitor);
+    }
+}
+
+static void enter_ifopstmt(Statement* stmt, Visitor* visitor) {
+    if (stmt->u.ifop_s->op_kind == IF_OP_LEAVE) return;
+    switch (stmt->u.ifop_s->expression_s->type->basic_type) {
+        case CS_BOOLEAN_TYPE:
+        case CS_INT_TYPE:
+            break;
+
+        default:
+            fprintf(stderr, "unknown type in enter_ifstmt\n");
+            exit(1);
+    }
+
+    /*
         switch (stmt->u.ifop_s->expression_s->kind) {
             case BOOLEAN_EXPRESSION:
             case INT_EXPRESSION:
@@ -597,6 +2096,126 @@ static void enter_ifopstmt(Statement* stmt, Visitor* visitor) {
 
 static void leave_ifopstmt(Statement* stmt, Visitor* visitor) {}
 
+static void enter_parallelstmt(Statement* stmt, Visitor* visitor) {
+    MeanVisitor* m_visitor = (MeanVisitor*)visitor;
+    if (stmt->u.parallel_s->op_kind == PARALLEL_OP_LEAVE) {
+        m_visitor->parallel = NULL;
+        m_visitor->parallel_border = NULL;
+    } else if (m_visitor->parallel) {
+        char message[100];
+        sprintf(message, "%d: parallel for cannot be nested",
+                stmt->line_number);
+        add_check_log(message, visitor);
+    }
+}
+
+static void check_loop_bound(Expression* bound, Visitor* visitor) {
+    if (bound->type && !cs_is_int(bound->type)) {
+        char message[100];
+        sprintf(message, "%d: parallel for bound is not INT type (%s)",
+                bound->line_number, get_type_name(bound->type->basic_type));
+        add_check_log(message, visitor);
+    }
+}
+
+static void resolve_reduction(ReductionList* r, Visitor* visitor) {
+    CS_Compiler* compiler = ((MeanVisitor*)visitor)->compiler;
+    char message[100];
+    if (!strcmp(r->kind_name, "sum")) {
+        r->kind = SVM_REDUCE_SUM;
+    } else if (!strcmp(r->kind_name, "min")) {
+        r->kind = SVM_REDUCE_MIN;
+    } else if (!strcmp(r->kind_name, "max")) {
+        r->kind = SVM_REDUCE_MAX;
+    } else {
+        sprintf(message, "%d: Unknown reduction %s (sum, min or max)",
+                r->line_number, r->kind_name);
+        add_check_log(message, visitor);
+    }
+
+    r->declaration = cs_search_decl_in_block(
+        r->name, compiler->decl_list_tail, compiler->cp_list_tail);
+    if (r->declaration == NULL) {
+        sprintf(message, "%d: Cannot find identifier %s", r->line_number,
+                r->name);
+        add_check_log(message, visitor);
+    } else if (!cs_is_int(r->declaration->type) &&
+               !cs_is_double(r->declaration->type)) {
+        sprintf(message, "%d: Reduction variable %s is not INT or DOUBLE",
+                r->line_number, r->name);
+        add_check_log(message, visitor);
+    }
+}
+
+static void leave_parallelstmt(Statement* stmt, Visitor* visitor) {
+    MeanVisitor* m_visitor = (MeanVisitor*)visitor;
+    ParallelForOperation* parallel = stmt->u.parallel_s;
+    if (parallel->op_kind == PARALLEL_OP_LEAVE || m_visitor->parallel) return;
+
+    check_loop_bound(parallel->lower, visitor);
+    check_loop_bound(parallel->upper, visitor);
+    const char* name = parallel->loop_variable->name;
+    if (strcmp(parallel->cond_name, name) ||
+        strcmp(parallel->step_name, name)) {
+        char message[100];
+        sprintf(message, "%d: parallel for must test and increment %s",
+                stmt->line_number, name);
+        add_check_log(message, visitor);
+    }
+    for (ReductionList* r = parallel->reduction; r; r = r->next) {
+        resolve_reduction(r, visitor);
+        for (ReductionList* prev = parallel->reduction; prev != r;
+             prev = prev->next) {
+            if (r->declaration && prev->declaration == r->declaration) {
+                char message[100];
+                sprintf(message, "%d: %s is reduced twice", r->line_number,
+                        r->name);
+                add_check_log(message, visitor);
+            }
+        }
+    }
+
+    // the loop variable and the body's declarations come after this border
+    m_visitor->parallel = parallel;
+    m_visitor->parallel_border = m_visitor->compiler->decl_list_tail;
+}
+
+// regions are scheduled after the mean check
+static void enter_regionstmt(Statement* stmt, Visitor* visitor) {}
+static void leave_regionstmt(Statement* stmt, Visitor* visitor) {}
+
+/* A switch takes an int, every case value once and at most one default. */
+static void enter_switchstmt(Statement* stmt, Visitor* visitor) {}
+static void leave_switchstmt(Statement* stmt, Visitor* visitor) {
+    SwitchBlock* block = stmt->u.switch_s->block;
+    char message[100];
+    if (stmt->u.switch_s->op_kind != SWITCH_OP_ENTER) return;
+    if (block->expression->type && !cs_is_int(block->expression->type)) {
+        sprintf(message, "%d: switch needs an int, pass:%s",
+                stmt->line_number,
+                get_type_name(block->expression->type->basic_type));
+        add_check_log(message, visitor);
+    }
+    int defaults = 0;
+    for (SwitchCase* c = block->cases; c; c = c->next) {
+        if (c->is_default && ++defaults == 2) {
+            sprintf(message, "%d: Duplicate default in switch",
+                    c->line_number);
+            add_check_log(message, visitor);
+        }
+    }
+    SwitchKey* keys;
+    int count = cs_sort_switch_keys(block, &keys);
+    for (int i = 1; i < count; ++i) {
+        if (keys[i].value == keys[i - 1].value) {
+            sprintf(message, "%d: Duplicate case %d in switch",
+                    keys[i].case_s->line_number, keys[i].value);
+            add_check_log(message, visitor);
+        }
+    }
+    MEM_free(keys);
+}
+
 static void enter_blkopstmt(Statement* stmt, Visitor* visitor) {
     switch (stmt->u.blockop_s->type) {
         case BLOCK_OPE_BEGIN: {
@@ -623,6 +2242,8 @@ MeanVisitor* create_mean_visitor() {
 
     MeanVisitor* visitor = MEM_malloc(sizeof(MeanVisitor));
     visitor->check_log = NULL;
+    visitor->parallel = NULL;
+    visitor->parallel_border = NULL;
     visitor->compiler = cs_get_current_compiler();
     if (visitor->compiler == NULL) {
         fprintf(stderr, "Compile is NULL\n");
@@ -662,11 +2283,19 @@ MeanVisitor* create_mean_visitor() {
     enter_expr_list[ASSIGN_EXPRESSION] = enter_assignexpr;
     enter_expr_list[FUNCTION_CALL_EXPRESSION] = enter_funccallexpr;
     enter_expr_list[CAST_EXPRESSION] = enter_castexpr;
+    enter_expr_list[INDEX_EXPRESSION] = enter_indexexpr;
+    enter_expr_list[NEW_ARRAY_EXPRESSION] = enter_newarrayexpr;
+    enter_expr_list[STRING_EXPRESSION] = enter_stringexpr;
+    enter_expr_list[MEMBER_EXPRESSION] = enter_memberexpr;
+    enter_expr_list[CONDITIONAL_EXPRESSION] = enter_condexpr;
 
     enter_stmt_list[EXPRESSION_STATEMENT] = enter_exprstmt;
     enter_stmt_list[DECLARATION_STATEMENT] = enter_declstmt;
     enter_stmt_list[BLOCKOPERATION_STATEMENT] = enter_blkopstmt;
     enter_stmt_list[IF_STATEMENT] = enter_ifopstmt;
+    enter_stmt_list[PARALLEL_FOR_STATEMENT] = enter_parallelstmt;
+    enter_stmt_list[REGION_STATEMENT] = enter_regionstmt;
+    enter_stmt_list[SWITCH_STATEMENT] = enter_switchstmt;
 
     leave_expr_list[BOOLEAN_EXPRESSION] = leave_boolexpr;
     leave_expr_list[INT_EXPRESSION] = leave_intexpr;
@@ -693,11 +2322,19 @@ MeanVisitor* create_mean_visitor() {
     leave_expr_list[ASSIGN_EXPRESSION] = leave_assignexpr;
     leave_expr_list[FUNCTION_CALL_EXPRESSION] = leave_funccallexpr;
     leave_expr_list[CAST_EXPRESSION] = leave_castexpr;
+    leave_expr_list[INDEX_EXPRESSION] = leave_indexexpr;
+    leave_expr_list[NEW_ARRAY_EXPRESSION] = leave_newarrayexpr;
+    leave_expr_list[STRING_EXPRESSION] = leave_stringexpr;
+    leave_expr_list[MEMBER_EXPRESSION] = leave_memberexpr;
+    leave_expr_list[CONDITIONAL_EXPRESSION] = leave_condexpr;
 
     leave_stmt_list[EXPRESSION_STATEMENT] = leave_exprstmt;
     leave_stmt_list[DECLARATION_STATEMENT] = leave_declstmt;
     leave_stmt_list[BLOCKOPERATION_STATEMENT] = leave_blkopstmt;
     leave_stmt_list[IF_STATEMENT] = leave_ifopstmt;
+    leave_stmt_list[PARALLEL_FOR_STATEMENT] = leave_parallelstmt;
+    leave_stmt_list[REGION_STATEMENT] = leave_regionstmt;
+    leave_stmt_list[SWITCH_STATEMENT] = leave_switchstmt;
 
     ((Visitor*)visitor)->enter_expr_list = enter_expr_list;
     ((Visitor*)visitor)->leave_expr_list = leave_expr_list;
@@ -0,0 +1,436 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../memory/MEM.h"
+#include "../svm/svm.h"
+#include "visitor.h"
+
+/*
+ * Region scheduling. The top-level statement list is cut into groups, one
+ * per top-level statement, if, block or parallel for. A group's level is
+ * one more than the level of every earlier group it depends on:
+ *
+ *   - it reads or writes a variable an earlier group writes
+ *   - it writes a variable an earlier group reads
+ *   - both call a function that is not a pure native (print, ...)
+ *
+ * Array elements and the string arena are tracked as one more variable,
+ * "heap", after the declared ones: indexing, the reading kernels and any
+ * use of a string read it; element stores, allocation, axpy/fill/copy and
+ * anything that builds a string write it.
+ *
+ * Groups of the same level are independent, so when a level holds two or
+ * more heavy groups they are put between SVM_FORK / SVM_JOIN and run
+ * concurrently. Levels are emitted in order, which is a valid order of
+ * the program since a group only ever moves past groups it does not
+ * depend on.
+ */
+#define REGION_CALL_COST (64)
+#define REGION_LOOP_COST (4096)
+#define REGION_MIN_COST (256)
+
+typedef struct {
+    StatementList* first;
+    StatementList* last;
+    int level;
+    int cost;
+} RegionGroup;
+
+static void add_access(RegionVisitor* visitor, uint8_t* set, int index) {
+    if (index < 0 || index >= visitor->var_count) {
+        visitor->impure = CS_TRUE;
+        return;
+    }
+    set[index] = 1;
+}
+
+// a vector variable is its lanes, which follow it
+static void add_variable(RegionVisitor* visitor, uint8_t* set,
+                         Declaration* decl) {
+    int slots = decl->type->basic_type == CS_INT4_TYPE ||
+                        decl->type->basic_type == CS_DOUBLE4_TYPE
+                    ? SVM_VECTOR_LANES
+                    : 1;
+    for (int i = 0; i < slots; ++i) {
+        add_access(visitor, set, decl->index + i);
+    }
+}
+
+static void add_write(RegionVisitor* visitor, Expression* target) {
+    if (target->kind == IDENTIFIER_EXPRESSION &&
+        !target->u.identifier.is_function) {
+        add_variable(visitor, visitor->writes,
+                     target->u.identifier.u.declaration);
+    } else if (target->kind == INDEX_EXPRESSION) {
+        add_access(visitor, visitor->writes, visitor->heap);
+    } else {
+        visitor->impure = CS_TRUE;
+    }
+}
+
+static void enter_expr(Expression* expr, Visitor* visitor) {
+    ((RegionVisitor*)visitor)->cost++;
+}
+
+static void leave_expr(Expression* expr, Visitor* visitor) {}
+
+static void leave_identexpr(Expression* expr, Visitor* visitor) {
+    RegionVisitor* r_visitor = (RegionVisitor*)visitor;
+    if (!expr->u.identifier.is_function) {
+        add_variable(r_visitor, r_visitor->reads,
+                     expr->u.identifier.u.declaration);
+        if (expr->type->basic_type == CS_STRING_TYPE) {
+            add_access(r_visitor, r_visitor->reads, r_visitor->heap);
+        }
+    }
+}
+
+static void leave_addexpr(Expression* expr, Visitor* visitor) {
+    RegionVisitor* r_visitor = (RegionVisitor*)visitor;
+    if (expr->type->basic_type == CS_STRING_TYPE) {  // concatenation
+        add_access(r_visitor, r_visitor->writes, r_visitor->heap);
+    }
+}
+
+static void leave_indexexpr(Expression* expr, Visitor* visitor) {
+    RegionVisitor* r_visitor = (RegionVisitor*)visitor;
+    add_access(r_visitor, r_visitor->reads, r_visitor->heap);
+}
+
+static void leave_newarrayexpr(Expression* expr, Visitor* visitor) {
+    RegionVisitor* r_visitor = (RegionVisitor*)visitor;
+    add_access(r_visitor, r_visitor->writes, r_visitor->heap);
+}
+
+static void leave_incdecexpr(Expression* expr, Visitor* visitor) {
+    add_write((RegionVisitor*)visitor, expr->u.inc_dec);
+}
+
+static void leave_assignexpr(Expression* expr, Visitor* visitor) {
+    RegionVisitor* r_visitor = (RegionVisitor*)visitor;
+    add_write(r_visitor, expr->u.assignment_expression.left);
+    if (expr->type->basic_type == CS_STRING_TYPE &&
+        expr->u.assignment_expression.aope == ADD_ASSIGN) {
+        add_access(r_visitor, r_visitor->writes, r_visitor->heap);
+    }
+}
+
+static void leave_funccallexpr(Expression* expr, Visitor* visitor) {
+    RegionVisitor* r_visitor = (RegionVisitor*)visitor;
+    Expression* function = expr->u.function_call_expression.function;
+    const SVM_Function* native = NULL;
+    switch (expr->u.function_call_expression.intrinsic) {
+        case CS_INTRINSIC_NONE: {
+            break;
+        }
+        case CS_INTRINSIC_LENGTH:
+        case CS_INTRINSIC_STRING_LENGTH:
+        case CS_INTRINSIC_GET:
+        case CS_INTRINSIC_SIZE: {
+            add_access(r_visitor, r_visitor->reads, r_visitor->heap);
+            r_visitor->cost++;
+            return;
+        }
+        case CS_INTRINSIC_SUM:
+        case CS_INTRINSIC_DOT:
+        case CS_INTRINSIC_ARRAY_MIN:
+        case CS_INTRINSIC_ARRAY_MAX: {
+            add_access(r_visitor, r_visitor->reads, r_visitor->heap);
+            r_visitor->cost += REGION_LOOP_COST;
+            return;
+        }
+        case CS_INTRINSIC_AXPY:
+        case CS_INTRINSIC_FILL:
+        case CS_INTRINSIC_COPY: {
+            add_access(r_visitor, r_visitor->writes, r_visitor->heap);
+            r_visitor->cost += REGION_LOOP_COST;
+            return;
+        }
+        case CS_INTRINSIC_SUBSTR:
+        case CS_INTRINSIC_STR:
+        case CS_INTRINSIC_PUT:
+        case CS_INTRINSIC_INCREMENT: {
+            add_access(r_visitor, r_visitor->writes, r_visitor->heap);
+            r_visitor->cost++;
+            return;
+        }
+        default: {
+            r_visitor->cost++;  // a single opcode
+            return;
+        }
+    }
+    if (function->kind == IDENTIFIER_EXPRESSION) {
+        native = find_native_function(function->u.identifier.name);
+    }
+    if (native == NULL || !native->pure) {
+        r_visitor->impure = CS_TRUE;
+    }
+    r_visitor->cost += REGION_CALL_COST;
+}
+
+static void enter_stmt(Statement* stmt, Visitor* visitor) {}
+
+static void leave_declstmt(Statement* stmt, Visitor* visitor) {
+    RegionVisitor* r_visitor = (RegionVisitor*)visitor;
+    Declaration* decl = stmt->u.declaration_s;
+    if (decl->initializer) {
+        // codegen stores initializers by name, see leave_declstmt there
+        Declaration* target = cs_search_decl_global(decl->name);
+        add_variable(r_visitor, r_visitor->writes, decl);
+        if (target) {
+            add_variable(r_visitor, r_visitor->writes, target);
+        } else {
+            add_access(r_visitor, r_visitor->writes, -1);
+        }
+    }
+    if (decl->type->array_length > 0 ||  // allocated by the declaration
+        (!decl->initializer && (decl->type->basic_type == CS_INT_MAP_TYPE ||
+                                decl->type->basic_type == CS_DOUBLE_MAP_TYPE))) {
+        add_access(r_visitor, r_visitor->writes, decl->index);
+        add_access(r_visitor, r_visitor->writes, r_visitor->heap);
+    }
+}
+
+static void leave_parallelstmt(Statement* stmt, Visitor* visitor) {
+    RegionVisitor* r_visitor = (RegionVisitor*)visitor;
+    ParallelForOperation* parallel = stmt->u.parallel_s;
+    if (parallel->op_kind != PARALLEL_OP_ENTER) {
+        return;
+    }
+    r_visitor->cost += REGION_LOOP_COST;
+    add_access(r_visitor, r_visitor->writes, parallel->loop_variable->index);
+    for (ReductionList* r = parallel->reduction; r; r = r->next) {
+        add_access(r_visitor, r_visitor->writes,
+                   r->declaration ? r->declaration->index : -1);
+    }
+}
+
+// an if-chain keeps the value of the switch in block->value
+static void leave_switchstmt(Statement* stmt, Visitor* visitor) {
+    RegionVisitor* r_visitor = (RegionVisitor*)visitor;
+    if (stmt->u.switch_s->op_kind == SWITCH_OP_ENTER) {
+        add_access(r_visitor, r_visitor->writes,
+                   stmt->u.switch_s->block->value->index);
+    }
+}
+
+static void leave_stmt(Statement* stmt, Visitor* visitor) {}
+
+/* var_count counts the heap, the last slot. */
+static RegionVisitor* create_region_visitor(int var_count) {
+    RegionVisitor* visitor = MEM_malloc(sizeof(RegionVisitor));
+    visitor->var_count = var_count;
+    visitor->heap = var_count - 1;
+    visitor->reads = MEM_malloc(var_count ? var_count : 1);
+    visitor->writes = MEM_malloc(var_count ? var_count : 1);
+
+    visit_expr* enter_expr_list =
+        (visit_expr*)MEM_malloc(sizeof(visit_expr) * EXPRESSION_KIND_PLUS_ONE);
+    visit_expr* leave_expr_list =
+        (visit_expr*)MEM_malloc(sizeof(visit_expr) * EXPRESSION_KIND_PLUS_ONE);
+    visit_stmt* enter_stmt_list = (visit_stmt*)MEM_malloc(
+        sizeof(visit_stmt) * STATEMENT_TYPE_COUNT_PLUS_ONE);
+    visit_stmt* leave_stmt_list = (visit_stmt*)MEM_malloc(
+        sizeof(visit_stmt) * STATEMENT_TYPE_COUNT_PLUS_ONE);
+
+    for (int i = 0; i < EXPRESSION_KIND_PLUS_ONE; ++i) {
+        enter_expr_list[i] = enter_expr;
+        leave_expr_list[i] = leave_expr;
+    }
+    leave_expr_list[IDENTIFIER_EXPRESSION] = leave_identexpr;
+    leave_expr_list[INCREMENT_EXPRESSION] = leave_incdecexpr;
+    leave_expr_list[DECREMENT_EXPRESSION] = leave_incdecexpr;
+    leave_expr_list[ASSIGN_EXPRESSION] = leave_assignexpr;
+    leave_expr_list[FUNCTION_CALL_EXPRESSION] = leave_funccallexpr;
+    leave_expr_list[INDEX_EXPRESSION] = leave_indexexpr;
+    leave_expr_list[NEW_ARRAY_EXPRESSION] = leave_newarrayexpr;
+    leave_expr_list[ADD_EXPRESSION] = leave_addexpr;
+
+    for (int i = 0; i < STATEMENT_TYPE_COUNT_PLUS_ONE; ++i) {
+        enter_stmt_list[i] = enter_stmt;
+        leave_stmt_list[i] = leave_stmt;
+    }
+    leave_stmt_list[DECLARATION_STATEMENT] = leave_declstmt;
+    leave_stmt_list[PARALLEL_FOR_STATEMENT] = leave_parallelstmt;
+    leave_stmt_list[SWITCH_STATEMENT] = leave_switchstmt;
+
+    ((Visitor*)visitor)->enter_expr_list = enter_expr_list;
+    ((Visitor*)visitor)->leave_expr_list = leave_expr_list;
+    ((Visitor*)visitor)->notify_expr_list = NULL;
+    ((Visitor*)visitor)->enter_stmt_list = enter_stmt_list;
+    ((Visitor*)visitor)->leave_stmt_list = leave_stmt_list;
+    return visitor;
+}
+
+static int depth_change(Statement* stmt) {
+    switch (stmt->type) {
+        case BLOCKOPERATION_STATEMENT: {
+            return stmt->u.blockop_s->type == BLOCK_OPE_BEGIN ? 1 : -1;
+        }
+        case IF_STATEMENT: {
+            return stmt->u.ifop_s->op_kind == IF_OP_ENTER ? 1 : -1;
+        }
+        case PARALLEL_FOR_STATEMENT: {
+            return stmt->u.parallel_s->op_kind == PARALLEL_OP_ENTER ? 1 : -1;
+        }
+        case SWITCH_STATEMENT: {
+            switch (stmt->u.switch_s->op_kind) {
+                case SWITCH_OP_ENTER: {
+                    return 1;
+                }
+                case SWITCH_OP_LEAVE: {
+                    return -1;
+                }
+                default: {
+                    return 0;
+                }
+            }
+        }
+        default: {
+            return 0;
+        }
+    }
+}
+
+static int split_groups(StatementList* list, RegionGroup** groups) {
+    int count = 0;
+    int depth = 0;
+    for (StatementList* p = list; p; p = p->next) {
+        if (depth == 0) count++;
+        depth += depth_change(p->stmt);
+    }
+    *groups = MEM_malloc(sizeof(RegionGroup) * (count ? count : 1));
+
+    int i = -1;
+    depth = 0;
+    for (StatementList* p = list; p; p = p->next) {
+        if (depth == 0) {
+            (*groups)[++i].first = p;
+        }
+        (*groups)[i].last = p;
+        depth += depth_change(p->stmt);
+    }
+    return count;
+}
+
+static void max_level(int* level, int value) {
+    if (value > *level) *level = value;
+}
+
+/* Give every group its level and cost, returns the highest level. */
+static int assign_levels(RegionGroup* groups, int count, int var_count) {
+    RegionVisitor* visitor = create_region_visitor(var_count);
+    int* read_level = MEM_malloc(sizeof(int) * (var_count ? var_count : 1));
+    int* write_level = MEM_malloc(sizeof(int) * (var_count ? var_count : 1));
+    memset(read_level, 0, sizeof(int) * var_count);
+    memset(write_level, 0, sizeof(int) * var_count);
+    int impure_level = 0;
+    int top = 0;
+
+    for (int g = 0; g < count; ++g) {
+        memset(visitor->reads, 0, var_count);
+        memset(visitor->writes, 0, var_count);
+        visitor->impure = CS_FALSE;
+        visitor->cost = 0;
+        for (StatementList* p = groups[g].first;; p = p->next) {
+            traverse_stmt(p->stmt, (Visitor*)visitor);
+            if (p == groups[g].last) break;
+        }
+
+        int level = 0;
+        if (visitor->impure) max_level(&level, impure_level);
+        for (int v = 0; v < var_count; ++v) {
+            if (visitor->reads[v] || visitor->writes[v]) {
+                max_level(&level, write_level[v]);
+            }
+            if (visitor->writes[v]) {
+                max_level(&level, read_level[v]);
+            }
+        }
+        level++;
+
+        if (visitor->impure) impure_level = level;
+        for (int v = 0; v < var_count; ++v) {
+            if (visitor->reads[v]) max_level(&read_level[v], level);
+            if (visitor->writes[v]) write_level[v] = level;
+        }
+        groups[g].level = level;
+        groups[g].cost = visitor->cost;
+        max_level(&top, level);
+    }
+
+    MEM_free(read_level);
+    MEM_free(write_level);
+    MEM_free(visitor->reads);
+    MEM_free(visitor->writes);
+    delete_visitor((Visitor*)visitor);
+    return top;
+}
+
+static StatementList* append_group(StatementList* tail, RegionGroup* group) {
+    tail->next = group->first;
+    return group->last;
+}
+
+static StatementList* append_stmt(StatementList* tail, Statement* stmt) {
+    tail->next = cs_create_statement_list(stmt);
+    return tail->next;
+}
+
+/*
+ * Reorder compiler->stmt_list level by level and fork the heavy groups of
+ * each level. The list is left alone when nothing would run concurrently.
+ */
+void cs_schedule_regions(CS_Compiler* compiler) {
+    int var_count = 1;  // the heap
+    for (DeclarationList* d = compiler->decl_list; d; d = d->next) {
+        if (!cs_is_aggregate(d->decl->type)) var_count++;
+    }
+
+    RegionGroup* groups;
+    int count = split_groups(compiler->stmt_list, &groups);
+    int top = assign_levels(groups, count, var_count);
+
+    int* heavy = MEM_malloc(sizeof(int) * (top + 1));
+    memset(heavy, 0, sizeof(int) * (top + 1));
+    CS_Boolean any_fork = CS_FALSE;
+    for (int g = 0; g < count; ++g) {
+        if (groups[g].cost >= REGION_MIN_COST &&
+            ++heavy[groups[g].level] >= 2) {
+            any_fork = CS_TRUE;
+        }
+    }
+    if (!any_fork) {
+        MEM_free(heavy);
+        MEM_free(groups);
+        return;
+    }
+
+    StatementList head;
+    StatementList* tail = &head;
+    for (int level = 1; level <= top; ++level) {
+        CS_Boolean fork = heavy[level] >= 2;
+        for (int g = 0; g < count; ++g) {
+            if (groups[g].level != level ||
+                (fork && groups[g].cost >= REGION_MIN_COST)) {
+                continue;
+            }
+            tail = append_group(tail, &groups[g]);
+        }
+        if (!fork) continue;
+        tail = append_stmt(tail, cs_create_fork_statement(heavy[level]));
+        for (int g = 0; g < count; ++g) {
+            if (groups[g].level != level || groups[g].cost < REGION_MIN_COST) {
+                continue;
+            }
+            tail = append_group(tail, &groups[g]);
+            tail = append_stmt(tail, cs_create_join_statement());
+        }
+    }
+    tail->next = NULL;
+    compiler->stmt_list = head.next;
+
+    MEM_free(heavy);
+    MEM_free(groups);
+}
@@ -170,6 +170,12 @@ retry:
         case ';': {
             return SEMICOLON;
         }
+        case ':': {
+            return COLON;
+        }
+        case '?': {
+            return QUESTION;
+        }
         case '(': {
             return LP;
         }
@@ -182,9 +188,43 @@ retry:
         case '}': {
             return RC;
         }
+        case '[': {
+            return LB;
+        }
+        case ']': {
+            return RB;
+        }
         case ',': {
             return COMMA;
         }
+        case '"': {  // string literal, with \n \t \\ and \" escapes
+            while ((c = read()) != '"') {
+                if (c == EOF || c == '\n') error();
+                if (c == '\\') {
+                    switch (c = read()) {
+                        case 'n': {
+                            c = '\n';
+                            break;
+                        }
+                        case 't': {
+                            c = '\t';
+                            break;
+                        }
+                        case '\\':
+                        case '"': {
+                            break;
+                        }
+                        default: {
+                            addText(c);
+                            error();
+                        }
+                    }
+                }
+                addText(c);
+            }
+            yylval.name = cs_create_identifier(ytp ? yytext : "");
+            return STRING_LITERAL;
+        }
         case '&': {
             addText(c);
             if ((c = read()) == '&') {
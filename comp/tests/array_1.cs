@@ -0,0 +1,23 @@
+int print(int i, double j);
+int n = 100;
+double[] x = new double[n];
+double[] y = new double[n];
+int[8] counts;
+parallel for (int i = 0; i < length(x); i++) {
+    x[i] = i;
+    y[i] = 2 * i;
+}
+parallel for (int i = 0; i < 8; i++) {
+    counts[i] = i * i;
+}
+counts[7] += 1;
+print(counts[7], dot(x, y));
+print(sum(counts), sum(x));
+print(min(counts), max(y));
+axpy(0.5, y, x);
+print(length(x), x[99]);
+fill(y, 1);
+copy(x, y);
+double last;
+last = x[n - 1] = 3.5;
+print(length(counts), last + sum(x));
@@ -0,0 +1,9 @@
+int print(int i, double j);
+int printb(boolean b);
+int sleep(int ms);
+int total = 0;
+total = total + 1;
+sleep(200);
+total = total + 2;
+sleep(100);
+print(total, 0.5);
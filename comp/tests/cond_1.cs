@@ -0,0 +1,36 @@
+int print(int i, double j);
+int a = 3;
+int b = 8;
+int m = a > b ? a : b;
+print(1, m);
+double d = a < b ? a * 0.5 : b;
+print(2, d);
+int sign = a - b < 0 ? -1 : a == b ? 0 : 1;
+print(3, sign);
+boolean small = a < 5 ? true : false;
+if (small) {
+    print(4, 1);
+}
+int[] xs = new int[4];
+xs[1] = 42;
+int i = 7;
+int safe = i < length(xs) ? xs[i] : -1;
+print(5, safe);
+i = 1;
+safe = i < length(xs) ? xs[i] : -1;
+print(6, safe);
+int zero = 0;
+int q = zero != 0 ? 10 / zero : 0;
+print(7, q);
+int calls = 0;
+int picked = a > 0 ? calls++ : calls--;
+print(8, picked * 10 + calls);
+string s = a > b ? "big" : "small";
+print(9, length(s));
+int4 v = a < b ? int4(1, 2, 3, 4) : 0;
+print(10, sum(v));
+double total = 0.0;
+parallel for (int k = 0; k < 10; k++) reduce(sum: total) {
+    total += k % 2 == 0 ? sqrt(k) : -1.0;
+}
+print(11, total);
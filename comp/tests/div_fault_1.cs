@@ -0,0 +1,7 @@
+int print(int i, double j);
+int a = 7;
+int zero = 0;
+print(1, a / 2);
+print(2, a % 2);
+int q = a / zero;
+print(3, q);
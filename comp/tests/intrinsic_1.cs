@@ -0,0 +1,13 @@
+int print(int i, double j);
+double x = 2.0;
+int n = 0 - 7;
+print(abs(n), sqrt(x));
+print(min(3, n), max(x, 1.5));
+print(fma(2, 3, 4), fma(x, 3, 0.5));
+print(max(abs(n), 5), floor(0.0 - 2.5));
+print(0, sin(0.5) * sin(0.5) + cos(0.5) * cos(0.5));
+print(0, log(exp(3.0)));
+parallel for (int i = 0; i < 1000; i++) reduce(max: n) {
+    n = max(n, abs(500 - i));
+}
+print(n, sqrt(16));
@@ -0,0 +1,30 @@
+int print(int i, double j);
+map<int,int> counts;
+map<int,double> totals;
+int[8] keys;
+parallel for (int i = 0; i < 8; i++) {
+    keys[i] = (i * 7) % 3;
+}
+increment(counts, keys[0], 1);
+increment(counts, keys[1], 1);
+increment(counts, keys[2], 1);
+increment(counts, keys[3], 1);
+increment(counts, keys[4], 1);
+increment(counts, keys[5], 1);
+increment(counts, keys[6], 1);
+increment(counts, keys[7], 1);
+print(get(counts, 0), get(totals, 0));
+print(get(counts, 1), 0.0);
+print(get(counts, 2), 0.0);
+print(size(counts), 0.0);
+put(totals, 1000000, 1.5);
+increment(totals, 1000000, 2);
+increment(totals, -2147483647 - 1, 0.25);
+print(size(totals), get(totals, 1000000));
+print(get(counts, 99), get(totals, -2147483647 - 1));
+map<int,int> same = counts;
+put(same, 5, 50);
+print(get(counts, 5), 0.0);
+if (same == counts) {
+    print(size(counts), 0.0);
+}
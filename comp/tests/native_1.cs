@@ -0,0 +1,9 @@
+int print(int i, double j);
+double sqrt(double x);
+double pow(double x, double y);
+int abs(int i);
+double r = sqrt(2.0);
+double p = pow(r, 4.0);
+int a = abs(3 - 10);
+print(a, r);
+print(abs(0 - a) + 1, p + sqrt(16.0));
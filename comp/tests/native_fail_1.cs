@@ -0,0 +1,3 @@
+int print(int i, double j);
+double pow(int x, int y);
+print(1, pow(2, 10));
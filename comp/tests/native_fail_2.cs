@@ -0,0 +1,5 @@
+int print(int i, double j);
+double sqrt(double x, double y);
+int abs(double d);
+print(1, sqrt(2.0, 3.0));
+print(2, abs(-1.5));
@@ -0,0 +1,25 @@
+int print(int i, double j);
+int n = 100000;
+int total = 0;
+double area = 0.0;
+int lo = 1000;
+int hi = 0 - 1000;
+parallel for (int i = 0; i < n; i++) reduce(sum: total, sum: area, min: lo, max: hi) {
+    int sq = (i % 100) * (i % 100);
+    total = total + i % 7;
+    area = area + 1.0 / (i + 1);
+    if (sq < lo) {
+        lo = sq;
+    }
+    if (sq > hi) {
+        hi = sq;
+    }
+}
+print(total, area);
+print(lo, 0.0);
+print(hi, 0.0);
+int count = 0;
+parallel for (int k = 1; k <= 10; k++) reduce(sum: count) {
+    count = count + k;
+}
+print(count, 0.0);
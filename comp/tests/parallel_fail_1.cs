@@ -0,0 +1,15 @@
+struct Cell {
+    int hits;
+};
+int[] a = new int[1];
+double[] d = new double[8];
+double[] e = new double[8];
+struct Cell[4] cells;
+parallel for (int i = 0; i < 2000000; i++) {
+    a[0] = a[0] + 1;
+    a[i / 2] += 1;
+    cells[i % 4].hits += 1;
+    fill(d, 1.0);
+    copy(d, e);
+    axpy(2.0, e, d);
+}
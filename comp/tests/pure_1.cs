@@ -0,0 +1,16 @@
+int print(int i, double j);
+double pow(double x, double y);
+double kilo = pow(2, 10);
+print(1, kilo);
+double root = sqrt(2.0) * 2.0;
+print(2, root);
+int m = max(abs(-7), 5) + min(3, fma(2, 3, 1));
+print(m, floor(-2.5));
+double e = pow(exp(1.0), -0.5) + log(1.0);
+print(3, e);
+double base = 1.5;
+double total = 0.0;
+parallel for (int i = 0; i < 1000; i++) reduce(sum: total) {
+    total += pow(base, i % 4);
+}
+print(4, total);
@@ -0,0 +1,19 @@
+int print(int i, double j);
+int n = 200000;
+int evens = 0;
+double harmonic = 0.0;
+int squares = 0;
+parallel for (int i = 0; i < n; i++) reduce(sum: evens) {
+    if (i % 2 == 0) {
+        evens = evens + 1;
+    }
+}
+parallel for (int j = 1; j <= n; j++) reduce(sum: harmonic) {
+    harmonic = harmonic + 1.0 / j;
+}
+int m = n / 1000;
+parallel for (int k = 0; k < m; k++) reduce(sum: squares) {
+    squares = squares + k * k;
+}
+print(evens, harmonic);
+print(squares, 0.0);
@@ -0,0 +1,24 @@
+int print(int i, double j);
+int puts(string s);
+string greeting = "hello";
+string name = "world";
+string line = greeting + ", " + name + "!";
+puts(line);
+print(length(line), 0.5);
+string part = substr(line, 7, 5);
+puts(part);
+if (part == name) {
+    puts("substr equals");
+}
+if (greeting == "hello" && part != "World") {
+    puts("interned equals");
+}
+string n = str(42) + " / " + str(2.5);
+puts(n);
+string acc = "";
+acc += str(0);
+acc += str(1) + str(2);
+if (acc == "012") {
+    puts(acc);
+}
+puts("tab\there \"quoted\"");
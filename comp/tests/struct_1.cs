@@ -0,0 +1,32 @@
+int print(int i, double j);
+struct Particle {
+    double x;
+    double v;
+    int id;
+};
+struct Particle p;
+p.x = 1.5;
+p.v = 2;
+p.id = 7;
+p.x += p.v * 0.5;
+p.id++;
+print(p.id, p.x);
+struct Particle[16] ps;
+parallel for (int i = 0; i < 16; i++) {
+    ps[i].id = i;
+    ps[i].x = i * 0.5;
+    ps[i].v = 1.0;
+}
+double sum = 0.0;
+parallel for (int i = 0; i < 16; i++) reduce(sum: sum) {
+    sum = sum + ps[i].x * ps[i].v;
+}
+print(ps[15].id, sum);
+int k = 3;
+ps[k].v *= 4;
+print(ps[k].id, ps[k].v);
+{
+    struct Particle q;
+    q.id = ps[k].id + p.id;
+    print(q.id, q.x);
+}
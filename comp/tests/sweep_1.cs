@@ -0,0 +1,9 @@
+int x;
+double y;
+int z;
+double w;
+z = x * 2 + 1;
+w = y * 1.5;
+if (x > 10) {
+    z = z + 100;
+}
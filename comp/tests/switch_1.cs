@@ -0,0 +1,57 @@
+int print(int i, double j);
+int small = 2;
+switch (small) {
+    case 1:
+        print(1, 10.0);
+    case 2:
+        print(1, 20.0);
+    default:
+        print(1, 0.0);
+}
+int day = 5;
+switch (day + 1) {
+    case 0:
+        print(2, 0.0);
+    case 1:
+        print(2, 1.0);
+    case 2, 3:
+        print(2, 2.5);
+    case 4:
+        print(2, 4.0);
+    case 5:
+        print(2, 5.0);
+    case 6:
+        int hours = 6 * 24;
+        print(2, hours);
+    default:
+        print(2, -1.0);
+}
+switch (day * 200) {
+    case -5:
+        print(3, -5.0);
+    case 1:
+        print(3, 1.0);
+    case 100:
+        print(3, 100.0);
+    case 1000:
+        print(3, 1000.0);
+        switch (day) {
+            case 4:
+                print(4, 4.0);
+            case 5:
+                print(4, 5.0);
+        }
+    case 99999:
+        print(3, 99999.0);
+}
+switch (-5) {
+    case 1, 2, 3, 4, 5, 6:
+        print(5, 1.0);
+    case -5:
+        print(5, -5.0);
+}
+switch (7) {
+    case 1, 2, 3, 4, 5, 6:
+        print(6, 1.0);
+}
+print(6, 0.0);
@@ -0,0 +1,32 @@
+int print(int i, double j);
+double4 a = double4(1.0, 2.0, 3.0, 4.0);
+double4 b = 2;
+double4 c = a * b + 0.5;
+print(1, c.w);
+print(2, sum(c));
+print(3, dot(a, b));
+int4 m = int4(5, 1, 7, 3);
+print(4, min(m) * 10 + max(m));
+int4 gt = m > int4(2);
+print(5, sum(gt));
+if (any(m > 6) && all(m > 0)) {
+    print(6, 1);
+}
+if (m == int4(5, 1, 7, 3)) {
+    print(7, 1);
+}
+if (m != 5) {
+    print(8, 1);
+}
+m.y = 9;
+m += 1;
+print(9, m.y);
+double4 r = a.wzyx;
+print(10, r.x);
+print(11, (a - b).z);
+double4 h = m / 2.0;
+print(12, h.w);
+int4 t = double4(1.9, -1.9, 2.5, 0.5);
+print(13, t.x + t.y);
+c = -a;
+print(14, c.y);
@@ -58,6 +58,22 @@ static void traverse_stmt_children(Statement* stmt, Visitor* visitor) {
             }
             break;
         }
+        case PARALLEL_FOR_STATEMENT: {
+            if (stmt->u.parallel_s->op_kind == PARALLEL_OP_ENTER) {
+                traverse_expr(stmt->u.parallel_s->lower, visitor);
+                traverse_expr(stmt->u.parallel_s->upper, visitor);
+            }
+            break;
+        }
+        case REGION_STATEMENT: {
+            break;
+        }
+        case SWITCH_STATEMENT: {
+            if (stmt->u.switch_s->op_kind == SWITCH_OP_ENTER) {
+                traverse_expr(stmt->u.switch_s->block->expression, visitor);
+            }
+            break;
+        }
         default: {
             fprintf(stderr, "No such stmt->type %d in traverse_stmt_children\n",
                     stmt->type);
@@ -70,7 +86,8 @@ static void traverse_expr_children(Expression* expr, Visitor* visitor) {
         case BOOLEAN_EXPRESSION:
         case IDENTIFIER_EXPRESSION:
         case DOUBLE_EXPRESSION:
-        case INT_EXPRESSION: {
+        case INT_EXPRESSION:
+        case STRING_EXPRESSION: {
             break;
         }
 
@@ -102,6 +119,33 @@ static void traverse_expr_children(Expression* expr, Visitor* visitor) {
             traverse_expr(expr->u.cast_expression.expr, visitor);
             break;
         }
+        case INDEX_EXPRESSION: {
+            traverse_expr(expr->u.index_expression.array, visitor);
+            traverse_expr(expr->u.index_expression.index, visitor);
+            break;
+        }
+        case NEW_ARRAY_EXPRESSION: {
+            traverse_expr(expr->u.new_array_expression.length, visitor);
+            break;
+        }
+        case MEMBER_EXPRESSION: {
+            traverse_expr(expr->u.member_expression.expression, visitor);
+            break;
+        }
+        case CONDITIONAL_EXPRESSION: {
+            // notified after the condition and after the true arm
+            ConditionalExpression* c_expr = &expr->u.conditional_expression;
+            visit_expr notify =
+                visitor->notify_expr_list
+                    ? visitor->notify_expr_list[CONDITIONAL_EXPRESSION]
+                    : NULL;
+            traverse_expr(c_expr->condition, visitor);
+            if (notify) notify(expr, visitor);
+            traverse_expr(c_expr->true_expr, visitor);
+            if (notify) notify(expr, visitor);
+            traverse_expr(c_expr->false_expr, visitor);
+            break;
+        }
         case FUNCTION_CALL_EXPRESSION: {
             //            printf("function call!\n");
             ArgumentList* args = expr->u.function_call_expression.argument;
@@ -110,7 +154,12 @@ static void traverse_expr_children(Expression* expr, Visitor* visitor) {
                     traverse_expr(args->expr, visitor);
                 }
             }
-            traverse_expr(expr->u.function_call_expression.function, visitor);
+            // an intrinsic has no function value to evaluate
+            if (expr->u.function_call_expression.intrinsic ==
+                CS_INTRINSIC_NONE) {
+                traverse_expr(expr->u.function_call_expression.function,
+                              visitor);
+            }
             break;
         }
         case LOGICAL_AND_EXPRESSION:
@@ -1,5 +1,6 @@
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "csua.h"
@@ -101,6 +102,94 @@ ArgumentList* cs_chain_argument_list(ArgumentList* list, Expression* expr) {
     return list;
 }
 
+ReductionList* cs_chain_reduction_list(ReductionList* list, char* kind_name,
+                                       char* name) {
+    ReductionList* p = NULL;
+    ReductionList* current = cs_create_reduction(kind_name, name);
+    for (p = list; p->next; p = p->next)
+        ;
+    p->next = current;
+    return list;
+}
+
+FieldList* cs_chain_field_list(FieldList* list, CS_BasicType type,
+                               char* name) {
+    FieldList* p = NULL;
+    FieldList* current = cs_create_field(type, name);
+    for (p = list; p->next; p = p->next)
+        ;
+    p->next = current;
+    return list;
+}
+
+CaseValueList* cs_chain_case_value_list(CaseValueList* list, int value) {
+    CaseValueList* p = NULL;
+    for (p = list; p->next; p = p->next)
+        ;
+    p->next = cs_create_case_value(value);
+    return list;
+}
+
+static int compare_switch_key(const void* a, const void* b) {
+    int left = ((const SwitchKey*)a)->value;
+    int right = ((const SwitchKey*)b)->value;
+    return (left > right) - (left < right);
+}
+
+/*
+ * Every case value of block with its case, sorted by value; returns how
+ * many. The caller frees *keys with MEM_free.
+ */
+int cs_sort_switch_keys(SwitchBlock* block, SwitchKey** keys) {
+    int count = 0;
+    for (SwitchCase* c = block->cases; c; c = c->next) {
+        for (CaseValueList* v = c->values; v; v = v->next) count++;
+    }
+    *keys = MEM_malloc(sizeof(SwitchKey) * (count ? count : 1));
+    int i = 0;
+    for (SwitchCase* c = block->cases; c; c = c->next) {
+        for (CaseValueList* v = c->values; v; v = v->next) {
+            (*keys)[i].value = v->value;
+            (*keys)[i++].case_s = c;
+        }
+    }
+    qsort(*keys, count, sizeof(SwitchKey), compare_switch_key);
+    return count;
+}
+
+// structs are global wherever they are defined
+void cs_define_struct(StructDefinition* def) {
+    CS_Compiler* compiler = cs_get_current_compiler();
+    StructDefinition** p = &compiler->struct_list;
+    while (*p) p = &(*p)->next;
+    *p = def;
+}
+
+StructDefinition* cs_search_struct(const char* name) {
+    CS_Compiler* compiler = cs_get_current_compiler();
+    for (StructDefinition* def = compiler->struct_list; def; def = def->next) {
+        if (!strcmp(def->name, name)) return def;
+    }
+    return NULL;
+}
+
+/*
+ * A struct or vector variable takes no slot of its own, its fields or
+ * lanes are declared after it and take one each.
+ */
+CS_Boolean cs_is_aggregate(const TypeSpecifier* type) {
+    switch (type->basic_type) {
+        case CS_STRUCT_TYPE:
+        case CS_INT4_TYPE:
+        case CS_DOUBLE4_TYPE: {
+            return CS_TRUE;
+        }
+        default: {
+            return CS_FALSE;
+        }
+    }
+}
+
 static Declaration* search_decls_from_list(DeclarationList* list,
                                            const char* name) {
     for (; list; list = list->next) {
@@ -110,32 +199,50 @@ static Declaration* search_decls_from_list(DeclarationList* list,
     }
     return NULL;
 }
+/* The nearest checkpoint at or before cp closing a block. */
+static CheckpointList* closed_block_end(CheckpointList* cp) {
+    while (cp != NULL && cp->checkpoint->type == BLOCK_OPE_BEGIN) {
+        cp = cp->prev;
+    }
+    return cp;
+}
+
+/* The '{' matching the '}' at end, blocks in between are nested in it. */
+static CheckpointList* closed_block_begin(CheckpointList* end) {
+    int depth = 0;
+    for (CheckpointList* cp = end; cp != NULL; cp = cp->prev) {
+        if (cp->checkpoint->type == BLOCK_OPE_END) {
+            depth++;
+        } else if (--depth == 0) {
+            return cp;
+        }
+    }
+    return NULL;
+}
+
 // search from a block temporary
 /// @brief 有効なスコープ内で変数を探索する
 /// @return 変数が見つからない場合はNULLを返す
 Declaration* cs_search_decl_in_block(const char* name,
                                      DeclarationList* decl_list_border,
                                      CheckpointList* cp_list_boarder) {
-    CheckpointList* cp_list = cp_list_boarder;
-
-    // スキップすべき最初のCheckpoint(BLOCK_OPE_END:'}')を見つけるまでCheckpointStackを逆順にたどる
-    for (; cp_list != NULL && cp_list->checkpoint->type == BLOCK_OPE_BEGIN;
-         cp_list = cp_list->prev)
-        ;
+    // スキップすべき最初のCheckpoint(BLOCK_OPE_END:'}')を見つける
+    CheckpointList* cp_list = closed_block_end(cp_list_boarder);
 
     DeclarationList* list = decl_list_border;
 
     while (list != NULL) {
-        if (cp_list != NULL && list == cp_list->checkpoint->decl_list_ptr &&
-            cp_list->prev != NULL) {
+        CheckpointList* begin = closed_block_begin(cp_list);
+        if (begin != NULL && list == cp_list->checkpoint->decl_list_ptr) {
             fprintf(stderr, "Skip block: [decl=%p->%p]\n",
                     cp_list->checkpoint->decl_list_ptr,
-                    cp_list->prev->checkpoint->decl_list_ptr);
+                    begin->checkpoint->decl_list_ptr);
             // Checkpoint( BLOCK_OPE_END:'}' )に到達
-            // 次のチェックポイント( BLOCK_OPE_BEGIN:'{' )までlistをスキップする
-            list = cp_list->prev->checkpoint->decl_list_ptr;
+            // 対応するチェックポイント( BLOCK_OPE_BEGIN:'{' )まで
+            // listをスキップする
+            list = begin->checkpoint->decl_list_ptr;
             // Checkpointを更新
-            cp_list = cp_list->prev->prev;
+            cp_list = closed_block_end(begin->prev);
             continue;
         }
 
@@ -167,25 +274,23 @@ static FunctionDeclaration* search_function_from_list(
 FunctionDeclaration* cs_search_func_in_block(
     const char* name, FunctionDeclarationList* func_decl_list_border,
     CheckpointList* cp_list_boarder) {
-    CheckpointList* cp_list = cp_list_boarder;
-
-    // スキップすべき最初のCheckpoint(BLOCK_OPE_END:'}')を見つけるまでCheckpointStackを逆順にたどる
-    for (; cp_list != NULL && cp_list->checkpoint->type == BLOCK_OPE_BEGIN;
-         cp_list = cp_list->prev)
-        ;
+    // スキップすべき最初のCheckpoint(BLOCK_OPE_END:'}')を見つける
+    CheckpointList* cp_list = closed_block_end(cp_list_boarder);
 
     FunctionDeclarationList* list = func_decl_list_border;
 
     while (list != NULL) {
-        if (cp_list != NULL && list == cp_list->checkpoint->fun_list_ptr) {
+        CheckpointList* begin = closed_block_begin(cp_list);
+        if (begin != NULL && list == cp_list->checkpoint->fun_list_ptr) {
             fprintf(stderr, "Skip block: [decl=%p->%p]\n",
                     cp_list->checkpoint->fun_list_ptr,
-                    cp_list->prev->checkpoint->fun_list_ptr);
+                    begin->checkpoint->fun_list_ptr);
             // Checkpoint( BLOCK_OPE_END:'}' )に到達
-            // 次のチェックポイント( BLOCK_OPE_BEGIN:'{' )までlistをスキップする
-            list = cp_list->prev->checkpoint->fun_list_ptr;
+            // 対応するチェックポイント( BLOCK_OPE_BEGIN:'{' )まで
+            // listをスキップする
+            list = begin->checkpoint->fun_list_ptr;
             // Checkpointを更新
-            cp_list = cp_list->prev->prev;
+            cp_list = closed_block_end(begin->prev);
             continue;
         }
 
@@ -203,6 +308,56 @@ FunctionDeclaration* cs_search_function(const char* name) {
     return search_function_from_list(compiler->func_list, name);
 }
 
+static struct {
+    char* name;
+    int arg_count;
+} intrinsics[CS_INTRINSIC_PLUS_ONE] = {
+    [CS_INTRINSIC_SQRT] = {"sqrt", 1},
+    [CS_INTRINSIC_ABS] = {"abs", 1},
+    [CS_INTRINSIC_MIN] = {"min", 2},
+    [CS_INTRINSIC_MAX] = {"max", 2},
+    [CS_INTRINSIC_FLOOR] = {"floor", 1},
+    [CS_INTRINSIC_FMA] = {"fma", 3},
+    [CS_INTRINSIC_SIN] = {"sin", 1},
+    [CS_INTRINSIC_COS] = {"cos", 1},
+    [CS_INTRINSIC_EXP] = {"exp", 1},
+    [CS_INTRINSIC_LOG] = {"log", 1},
+    [CS_INTRINSIC_LENGTH] = {"length", 1},
+    [CS_INTRINSIC_SUM] = {"sum", 1},
+    [CS_INTRINSIC_DOT] = {"dot", 2},
+    [CS_INTRINSIC_ARRAY_MIN] = {"min", 1},  // found as MIN, see mean check
+    [CS_INTRINSIC_ARRAY_MAX] = {"max", 1},
+    [CS_INTRINSIC_AXPY] = {"axpy", 3},
+    [CS_INTRINSIC_FILL] = {"fill", 2},
+    [CS_INTRINSIC_COPY] = {"copy", 2},
+    [CS_INTRINSIC_STRING_LENGTH] = {"length", 1},  // found as LENGTH
+    [CS_INTRINSIC_SUBSTR] = {"substr", 3},
+    [CS_INTRINSIC_STR] = {"str", 1},
+    [CS_INTRINSIC_GET] = {"get", 2},
+    [CS_INTRINSIC_PUT] = {"put", 3},
+    [CS_INTRINSIC_INCREMENT] = {"increment", 3},
+    [CS_INTRINSIC_SIZE] = {"size", 1},
+    [CS_INTRINSIC_INT4] = {"int4", 4},
+    [CS_INTRINSIC_DOUBLE4] = {"double4", 4},
+    [CS_INTRINSIC_ALL] = {"all", 1},
+    [CS_INTRINSIC_ANY] = {"any", 1},
+    [CS_INTRINSIC_VECTOR_SUM] = {"sum", 1},  // found as SUM, see mean check
+    [CS_INTRINSIC_VECTOR_DOT] = {"dot", 2},
+    [CS_INTRINSIC_VECTOR_MIN] = {"min", 1},
+    [CS_INTRINSIC_VECTOR_MAX] = {"max", 1},
+};
+
+/* Builtin function called name, CS_INTRINSIC_NONE if there is none. */
+CS_Intrinsic cs_search_intrinsic(const char* name, int* arg_count) {
+    for (int i = CS_INTRINSIC_NONE + 1; i < CS_INTRINSIC_PLUS_ONE; ++i) {
+        if (!strcmp(intrinsics[i].name, name)) {
+            *arg_count = intrinsics[i].arg_count;
+            return i;
+        }
+    }
+    return CS_INTRINSIC_NONE;
+}
+
 static Checkpoint* create_checkpoint(BlockOperationType type) {
     Checkpoint* cp = (Checkpoint*)cs_malloc(sizeof(Checkpoint));
     cp->type = type;
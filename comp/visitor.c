@@ -43,6 +43,18 @@ static const char* get_cast_type_name(CS_CastType type) {
         case CS_DOUBLE_TO_INT: {
             return "double_to_int";
         }
+        case CS_INT_TO_INT4: {
+            return "int_to_int4";
+        }
+        case CS_DOUBLE_TO_DOUBLE4: {
+            return "double_to_double4";
+        }
+        case CS_INT4_TO_DOUBLE4: {
+            return "int4_to_double4";
+        }
+        case CS_DOUBLE4_TO_INT4: {
+            return "double4_to_int4";
+        }
         default: {
             return "unknown cast";
         }
@@ -102,6 +114,18 @@ static void leave_doubleexpr(Expression* expr, Visitor* visitor) {
             get_type_name(get_type(expr)));
 }
 
+static void enter_stringexpr(Expression* expr, Visitor* visitor) {
+    print_depth();
+    fprintf(stderr, "enter stringexpr : \"%s\"\n", expr->u.string_value);
+    increment();
+}
+static void leave_stringexpr(Expression* expr, Visitor* visitor) {
+    decrement();
+    print_depth();
+    fprintf(stderr, "leave stringexpr(type:%s)\n",
+            get_type_name(get_type(expr)));
+}
+
 static void enter_identexpr(Expression* expr, Visitor* visitor) {
     print_depth();
     fprintf(stderr, "enter identifierexpr : %s\n", expr->u.identifier.name);
@@ -316,6 +340,57 @@ static void leave_assignexpr(Expression* expr, Visitor* visitor) {
             get_type_name(get_type(expr)));
 }
 
+static void enter_indexexpr(Expression* expr, Visitor* visitor) {
+    print_depth();
+    fprintf(stderr, "enter indexexpr%s:\n",
+            expr->u.index_expression.checked ? "" : " (unchecked)");
+    increment();
+}
+static void leave_indexexpr(Expression* expr, Visitor* visitor) {
+    decrement();
+    print_depth();
+    fprintf(stderr, "leave indexexpr(type:%s)\n",
+            get_type_name(get_type(expr)));
+}
+
+static void enter_memberexpr(Expression* expr, Visitor* visitor) {
+    print_depth();
+    fprintf(stderr, "enter memberexpr : %s\n",
+            expr->u.member_expression.member);
+    increment();
+}
+static void leave_memberexpr(Expression* expr, Visitor* visitor) {
+    decrement();
+    print_depth();
+    fprintf(stderr, "leave memberexpr(type:%s)\n",
+            get_type_name(get_type(expr)));
+}
+
+static void enter_condexpr(Expression* expr, Visitor* visitor) {
+    print_depth();
+    fprintf(stderr, "enter condexpr\n");
+    increment();
+}
+static void leave_condexpr(Expression* expr, Visitor* visitor) {
+    decrement();
+    print_depth();
+    fprintf(stderr, "leave condexpr(type:%s)\n",
+            get_type_name(get_type(expr)));
+}
+
+static void enter_newarrayexpr(Expression* expr, Visitor* visitor) {
+    print_depth();
+    fprintf(stderr, "enter newarrayexpr : %s\n",
+            get_type_name(expr->u.new_array_expression.type));
+    increment();
+}
+static void leave_newarrayexpr(Expression* expr, Visitor* visitor) {
+    decrement();
+    print_depth();
+    fprintf(stderr, "leave newarrayexpr(type:%s)\n",
+            get_type_name(get_type(expr)));
+}
+
 static void enter_funccallexpr(Expression* expr, Visitor* visitor) {
     print_depth();
     fprintf(stderr, "enter function call :\n");
@@ -374,6 +449,36 @@ static void leave_ifopstmt(Statement* stmt, Visitor* visitor) {
     fprintf(stderr, "leave ifopstmt\n");
 }
 
+static void enter_switchstmt(Statement* stmt, Visitor* visitor) {
+    print_depth();
+    fprintf(stderr, "enter switchstmt : %d\n", stmt->u.switch_s->op_kind);
+}
+
+static void leave_switchstmt(Statement* stmt, Visitor* visitor) {
+    print_depth();
+    fprintf(stderr, "leave switchstmt\n");
+}
+
+static void enter_parallelstmt(Statement* stmt, Visitor* visitor) {
+    print_depth();
+    fprintf(stderr, "enter parallelstmt\n");
+}
+
+static void leave_parallelstmt(Statement* stmt, Visitor* visitor) {
+    print_depth();
+    fprintf(stderr, "leave parallelstmt\n");
+}
+
+static void enter_regionstmt(Statement* stmt, Visitor* visitor) {
+    print_depth();
+    fprintf(stderr, "enter regionstmt\n");
+}
+
+static void leave_regionstmt(Statement* stmt, Visitor* visitor) {
+    print_depth();
+    fprintf(stderr, "leave regionstmt\n");
+}
+
 Visitor* create_treeview_visitor() {
     visit_expr* enter_expr_list;
     visit_expr* leave_expr_list;
@@ -414,11 +519,19 @@ Visitor* create_treeview_visitor() {
     enter_expr_list[ASSIGN_EXPRESSION] = enter_assignexpr;
     enter_expr_list[FUNCTION_CALL_EXPRESSION] = enter_funccallexpr;
     enter_expr_list[CAST_EXPRESSION] = enter_castexpr;
+    enter_expr_list[INDEX_EXPRESSION] = enter_indexexpr;
+    enter_expr_list[NEW_ARRAY_EXPRESSION] = enter_newarrayexpr;
+    enter_expr_list[MEMBER_EXPRESSION] = enter_memberexpr;
+    enter_expr_list[CONDITIONAL_EXPRESSION] = enter_condexpr;
+    enter_expr_list[STRING_EXPRESSION] = enter_stringexpr;
 
     enter_stmt_list[EXPRESSION_STATEMENT] = enter_exprstmt;
     enter_stmt_list[DECLARATION_STATEMENT] = enter_declstmt;
     enter_stmt_list[BLOCKOPERATION_STATEMENT] = enter_blkopstmt;
     enter_stmt_list[IF_STATEMENT] = enter_ifopstmt;
+    enter_stmt_list[PARALLEL_FOR_STATEMENT] = enter_parallelstmt;
+    enter_stmt_list[REGION_STATEMENT] = enter_regionstmt;
+    enter_stmt_list[SWITCH_STATEMENT] = enter_switchstmt;
 
     leave_expr_list[BOOLEAN_EXPRESSION] = leave_boolexpr;
     leave_expr_list[INT_EXPRESSION] = leave_intexpr;
@@ -445,11 +558,19 @@ Visitor* create_treeview_visitor() {
     leave_expr_list[ASSIGN_EXPRESSION] = leave_assignexpr;
     leave_expr_list[FUNCTION_CALL_EXPRESSION] = leave_funccallexpr;
     leave_expr_list[CAST_EXPRESSION] = leave_castexpr;
+    leave_expr_list[INDEX_EXPRESSION] = leave_indexexpr;
+    leave_expr_list[NEW_ARRAY_EXPRESSION] = leave_newarrayexpr;
+    leave_expr_list[MEMBER_EXPRESSION] = leave_memberexpr;
+    leave_expr_list[CONDITIONAL_EXPRESSION] = leave_condexpr;
+    leave_expr_list[STRING_EXPRESSION] = leave_stringexpr;
 
     leave_stmt_list[EXPRESSION_STATEMENT] = leave_exprstmt;
     leave_stmt_list[DECLARATION_STATEMENT] = leave_declstmt;
     leave_stmt_list[BLOCKOPERATION_STATEMENT] = leave_blkopstmt;
     leave_stmt_list[IF_STATEMENT] = leave_ifopstmt;
+    leave_stmt_list[PARALLEL_FOR_STATEMENT] = leave_parallelstmt;
+    leave_stmt_list[REGION_STATEMENT] = leave_regionstmt;
+    leave_stmt_list[SWITCH_STATEMENT] = leave_switchstmt;
 
     visitor->enter_expr_list = enter_expr_list;
     visitor->leave_expr_list = leave_expr_list;
@@ -31,6 +31,9 @@ struct MeanVisitor_tag {
     int i;
     int j;
     MeanCheckLogger* check_log;
+
+    ParallelForOperation* parallel;    // innermost parallel for body, or NULL
+    DeclarationList* parallel_border;  // last declaration outside of it
 };
 
 typedef enum {
@@ -51,6 +54,7 @@ struct CodegenVisitor_tag {
     VisitIdentState vi_state;
     VisitFunCallState vf_state;
     uint16_t assign_depth;
+    Expression* index_target;  // a[i] being assigned, see enter_indexexpr
 
     uint32_t CODE_ALLOC_SIZE;
     uint32_t current_code_size;
@@ -58,6 +62,17 @@ struct CodegenVisitor_tag {
     uint8_t* code;
 };
 
+/* reads and writes of one statement group, by variable index */
+struct RegionVisitor_tag {
+    Visitor visitor;
+    int var_count;
+    int heap;  // pseudo variable for array elements and the string arena
+    uint8_t* reads;
+    uint8_t* writes;
+    CS_Boolean impure;  // calls something other than a pure native
+    int cost;
+};
+
 /* visitor.c */
 void print_depth();
 Visitor* create_treeview_visitor();
@@ -74,4 +89,7 @@ char* get_type_name(CS_BasicType type);
 CodegenVisitor* create_codegen_visitor(CS_Compiler* compiler,
                                        CS_Executable* exec);
 
+/* region_visitor */
+void cs_schedule_regions(CS_Compiler* compiler);
+
 #endif
\ No newline at end of file
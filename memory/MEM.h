@@ -19,6 +19,15 @@ extern MEM_Controller mem_default_controller;
 #define MEM_realloc(ptr, size) \
     MEM_realloc_func(mem_default_controller, __FILE__, __LINE__, ptr, size)
 
+/* Malloc on a given controller */
+#define MEM_controller_malloc(controller, size) \
+    MEM_malloc_func(controller, __FILE__, __LINE__, size)
+#define MEM_controller_realloc(controller, ptr, size) \
+    MEM_realloc_func(controller, __FILE__, __LINE__, ptr, size)
+#define MEM_controller_free(controller, ptr) MEM_free_func(controller, ptr)
+#define MEM_controller_malloc_aligned(controller, size, alignment) \
+    MEM_malloc_aligned_func(controller, __FILE__, __LINE__, size, alignment)
+
 /* Storage */
 #define MEM_open_storage(page_size) \
     MEM_open_storage_func(mem_default_controller, __FILE__, __LINE__, page_size)
@@ -29,10 +38,16 @@ extern MEM_Controller mem_default_controller;
 
 void test();
 
+/* Controller */
+MEM_Controller MEM_create_controller();
+void MEM_dispose_controller(MEM_Controller controller);
+
 /* For Inner functions */
 /* Malloc */
 void* MEM_malloc_func(MEM_Controller controller, char* filename, int line,
                       size_t size);
+void* MEM_malloc_aligned_func(MEM_Controller controller, char* filename,
+                              int line, size_t size, size_t alignment);
 void* MEM_realloc_func(MEM_Controller controller, char* filename, int line,
                        void* ptr, size_t size);
 void MEM_dump_memory_func(MEM_Controller controller);
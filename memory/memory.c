@@ -17,6 +17,22 @@ static struct MEM_Controller_tag st_default_controller = {
 
 MEM_Controller mem_default_controller = &st_default_controller;
 
+/*
+ * The default controller is a single global block list without locking.
+ * Code that allocates from several threads gives each thread (or each
+ * virtual machine) its own controller instead.
+ */
+MEM_Controller MEM_create_controller() {
+    MEM_Controller controller =
+        (MEM_Controller)malloc(sizeof(struct MEM_Controller_tag));
+    if (controller == NULL) {
+        fprintf(stderr, "error");
+        exit(1);
+    }
+    controller->block_header = NULL;
+    return controller;
+}
+
 typedef union {
     long l_dummy;
     double d_dummy;
@@ -31,6 +47,7 @@ typedef struct {
     int line;
     Header* prev;
     Header* next;
+    void* base;  // what malloc returned, before any alignment
     uint8_t mark[MARK_SIZE];
 } HeaderStruct;
 
@@ -49,6 +66,7 @@ static void set_header(Header* header, size_t size, char* filename, int line) {
     header->s.filename = filename;
     header->s.line = line;
     header->s.next = header->s.prev = NULL;
+    header->s.base = header;
     memset(header->s.mark, MARK, (char*)&header[1] - (char*)header->s.mark);
 }
 
@@ -132,9 +150,24 @@ void MEM_free_func(MEM_Controller controller, void* bptr) {
     //    fprintf(stderr, "free ptr = %p\n", ptr);
     Header* current_header = (Header*)ptr;
     unchain_header(controller, current_header);  // remove from chain
+    void* base = current_header->s.base;
     memset(current_header, 0xcc,
            sizeof(Header) + current_header->s.size + MARK_SIZE);
-    free((void*)current_header);
+    free(base);
+}
+
+void MEM_dispose_controller(MEM_Controller controller) {
+    Header* header = controller->block_header;
+    while (header) {
+        Header* next = header->s.next;
+        free(header->s.base);
+        header = next;
+    }
+    if (controller != mem_default_controller) {
+        free(controller);
+    } else {
+        controller->block_header = NULL;
+    }
 }
 
 void* MEM_malloc_func(MEM_Controller controller, char* filename, int line,
@@ -155,6 +188,37 @@ void* MEM_malloc_func(MEM_Controller controller, char* filename, int line,
     return (void*)&header[1];
 }
 
+/*
+ * Like MEM_malloc_func, but the block starts on a multiple of alignment,
+ * a power of two. The header sits just before the block as usual, so
+ * MEM_free and MEM_dispose_controller take it; MEM_realloc does not.
+ */
+void* MEM_malloc_aligned_func(MEM_Controller controller, char* filename,
+                              int line, size_t size, size_t alignment) {
+    if (alignment < ALIGN_SIZE || (alignment & (alignment - 1))) {
+        fprintf(stderr, "bad alignment %zu\n", alignment);
+        exit(1);
+    }
+    size_t alloc_size = sizeof(Header) + size + MARK_SIZE + alignment;
+
+    uint8_t* base = (uint8_t*)malloc(alloc_size);
+    if (base == NULL) {
+        fprintf(stderr, "error");
+        exit(1);
+    }
+
+    uintptr_t block = (uintptr_t)(base + sizeof(Header));
+    block = (block + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    Header* header = (Header*)block - 1;
+    memset((void*)header, 0xcc, sizeof(Header) + size + MARK_SIZE);
+
+    set_header(header, size, filename, line);
+    header->s.base = base;
+    chain_header(controller, header);
+    set_footer(header, size);
+    return (void*)&header[1];
+}
+
 char* MEM_strdup_func(MEM_Controller controller, char* filename, int line,
                       char* src) {
     char* dst = MEM_malloc_func(controller, filename, line, strlen(src) + 1);
@@ -174,6 +238,11 @@ void* MEM_realloc_func(MEM_Controller controller, char* filename, int line,
     if (ptr) {
         real_ptr = ptr - sizeof(Header);
         //        fprintf(stderr, "ptr:real_ptr = %p:%p\n", ptr, real_ptr);
+        if (((Header*)real_ptr)->s.base != real_ptr) {
+            fprintf(stderr, "realloc of an aligned block (%s:%d)\n", filename,
+                    line);
+            exit(1);
+        }
         unchain_header(controller, real_ptr);
         old_header = *((Header*)real_ptr);
         old_size = old_header.s.size;
@@ -198,6 +267,7 @@ void* MEM_realloc_func(MEM_Controller controller, char* filename, int line,
         ((Header*)new_ptr)->s.size = size;
         ((Header*)new_ptr)->s.line = line;
         ((Header*)new_ptr)->s.filename = filename;
+        ((Header*)new_ptr)->s.base = new_ptr;
         rechain_header(controller, new_ptr);
         set_footer(new_ptr, size);
     } else {
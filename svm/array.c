@@ -0,0 +1,238 @@
+#include <string.h>
+
+#include "../memory/MEM.h"
+#include "svm.h"
+
+/*
+ * Array storage and the whole-array kernels behind SVM_ARRAY_SUM and
+ * friends. Elements are SVM_ARRAY_ALIGN aligned, so the kernels walk an
+ * array one 64-byte vector at a time with GCC vector extensions (SSE, AVX2
+ * or AVX-512 depending on the target flags) and finish the tail in scalar
+ * code.
+ */
+typedef int32_t ArrayInt __attribute__((vector_size(SVM_ARRAY_ALIGN)));
+typedef uint32_t ArrayUInt __attribute__((vector_size(SVM_ARRAY_ALIGN)));
+typedef double ArrayDouble __attribute__((vector_size(SVM_ARRAY_ALIGN)));
+typedef int64_t ArrayMask __attribute__((vector_size(SVM_ARRAY_ALIGN)));
+
+#define INT_STEP (SVM_ARRAY_ALIGN / sizeof(int32_t))
+#define DOUBLE_STEP (SVM_ARRAY_ALIGN / sizeof(double))
+
+void svm_init_arrays(SVM_Context *ctx) {
+    ctx->heap.controller = ctx->controller;
+    ctx->heap.count = 0;
+    ctx->heap.capacity = 0;
+    ctx->heap.arrays = NULL;
+    ctx->arrays = &ctx->heap;
+}
+
+/* Free every array; the handles handed out so far become invalid. */
+void svm_free_arrays(SVM_ArrayHeap *heap) {
+    for (uint32_t i = 0; i < heap->count; ++i) {
+        MEM_controller_free(heap->controller, heap->arrays[i].data);
+    }
+    if (heap->arrays) MEM_controller_free(heap->controller, heap->arrays);
+    heap->count = 0;
+    heap->capacity = 0;
+    heap->arrays = NULL;
+}
+
+/* Bytes of the elements of a. */
+size_t svm_array_size(const SVM_Array *a) {
+    if (a->stride) return (size_t)a->length * a->stride * sizeof(SVM_Value);
+    return (size_t)a->length *
+           (a->type == SVM_DOUBLE ? sizeof(double) : sizeof(int32_t));
+}
+
+static int alloc_array(SVM_ArrayHeap *heap, uint8_t type, uint32_t stride,
+                       int length) {
+    if (length < 0 || heap->count == INT32_MAX) return 0;
+    if (heap->count == heap->capacity) {
+        uint32_t capacity = heap->capacity ? heap->capacity * 2 : 16;
+        heap->arrays = (SVM_Array *)MEM_controller_realloc(
+            heap->controller, heap->arrays, sizeof(SVM_Array) * capacity);
+        heap->capacity = capacity;
+    }
+    SVM_Array *a = &heap->arrays[heap->count];
+    a->type = type;
+    a->length = length;
+    a->stride = stride;
+    size_t size = svm_array_size(a);
+    a->data = MEM_controller_malloc_aligned(heap->controller, size,
+                                            SVM_ARRAY_ALIGN);
+    memset(a->data, 0, size);
+    return ++heap->count;
+}
+
+/* Allocate a zero filled array, returns its handle or 0 on a bad length. */
+int svm_new_array(SVM_ArrayHeap *heap, uint8_t type, int length) {
+    return alloc_array(heap, type, 0, length);
+}
+
+/* Allocate length zero filled records of stride values each. */
+int svm_new_record_array(SVM_ArrayHeap *heap, int stride, int length) {
+    if (stride <= 0 || (uint64_t)length * stride > INT32_MAX) return 0;
+    return alloc_array(heap, SVM_INT, stride, length);
+}
+
+SVM_Value svm_array_sum(const SVM_Array *a) {
+    SVM_Value v;
+    uint32_t i = 0;
+    if (a->type == SVM_DOUBLE) {
+        const double *x = (const double *)a->data;
+        ArrayDouble acc = {0};
+        for (; i + DOUBLE_STEP <= a->length; i += DOUBLE_STEP) {
+            acc += *(const ArrayDouble *)&x[i];
+        }
+        double s = 0.0;
+        for (int l = 0; l < DOUBLE_STEP; ++l) s += acc[l];
+        for (; i < a->length; ++i) s += x[i];
+        v.dval = s;
+    } else {
+        // unsigned so that overflow wraps like the scalar SVM_ADD_INT
+        const uint32_t *x = (const uint32_t *)a->data;
+        ArrayUInt acc = {0};
+        for (; i + INT_STEP <= a->length; i += INT_STEP) {
+            acc += *(const ArrayUInt *)&x[i];
+        }
+        uint32_t s = 0;
+        for (int l = 0; l < INT_STEP; ++l) s += acc[l];
+        for (; i < a->length; ++i) s += x[i];
+        v.ival = (int32_t)s;
+    }
+    return v;
+}
+
+/* a and b have the same type and length. */
+SVM_Value svm_array_dot(const SVM_Array *a, const SVM_Array *b) {
+    SVM_Value v;
+    uint32_t i = 0;
+    if (a->type == SVM_DOUBLE) {
+        const double *x = (const double *)a->data;
+        const double *y = (const double *)b->data;
+        ArrayDouble acc = {0};
+        for (; i + DOUBLE_STEP <= a->length; i += DOUBLE_STEP) {
+            acc += *(const ArrayDouble *)&x[i] * *(const ArrayDouble *)&y[i];
+        }
+        double s = 0.0;
+        for (int l = 0; l < DOUBLE_STEP; ++l) s += acc[l];
+        for (; i < a->length; ++i) s += x[i] * y[i];
+        v.dval = s;
+    } else {
+        const uint32_t *x = (const uint32_t *)a->data;
+        const uint32_t *y = (const uint32_t *)b->data;
+        ArrayUInt acc = {0};
+        for (; i + INT_STEP <= a->length; i += INT_STEP) {
+            acc += *(const ArrayUInt *)&x[i] * *(const ArrayUInt *)&y[i];
+        }
+        uint32_t s = 0;
+        for (int l = 0; l < INT_STEP; ++l) s += acc[l];
+        for (; i < a->length; ++i) s += x[i] * y[i];
+        v.ival = (int32_t)s;
+    }
+    return v;
+}
+
+/* Smallest (sign 1) or largest (sign -1) element, 0 for an empty array. */
+static SVM_Value array_extreme(const SVM_Array *a, int sign) {
+    SVM_Value v;
+    uint32_t i = 0;
+    if (a->type == SVM_DOUBLE) {
+        const double *x = (const double *)a->data;
+        double m = a->length ? x[0] : 0.0;
+        if (a->length >= DOUBLE_STEP) {
+            ArrayDouble acc = *(const ArrayDouble *)x;
+            for (i = DOUBLE_STEP; i + DOUBLE_STEP <= a->length;
+                 i += DOUBLE_STEP) {
+                ArrayDouble e = *(const ArrayDouble *)&x[i];
+                ArrayMask take = sign > 0 ? e < acc : e > acc;
+                acc = (ArrayDouble)(((ArrayMask)e & take) |
+                                    ((ArrayMask)acc & ~take));
+            }
+            m = acc[0];
+            for (int l = 1; l < DOUBLE_STEP; ++l) {
+                if (sign > 0 ? acc[l] < m : acc[l] > m) m = acc[l];
+            }
+        }
+        for (; i < a->length; ++i) {
+            if (sign > 0 ? x[i] < m : x[i] > m) m = x[i];
+        }
+        v.dval = m;
+    } else {
+        const int32_t *x = (const int32_t *)a->data;
+        int32_t m = a->length ? x[0] : 0;
+        if (a->length >= INT_STEP) {
+            ArrayInt acc = *(const ArrayInt *)x;
+            for (i = INT_STEP; i + INT_STEP <= a->length; i += INT_STEP) {
+                ArrayInt e = *(const ArrayInt *)&x[i];
+                ArrayInt take = sign > 0 ? e < acc : e > acc;
+                acc = (e & take) | (acc & ~take);
+            }
+            m = acc[0];
+            for (int l = 1; l < INT_STEP; ++l) {
+                if (sign > 0 ? acc[l] < m : acc[l] > m) m = acc[l];
+            }
+        }
+        for (; i < a->length; ++i) {
+            if (sign > 0 ? x[i] < m : x[i] > m) m = x[i];
+        }
+        v.ival = m;
+    }
+    return v;
+}
+
+SVM_Value svm_array_min(const SVM_Array *a) { return array_extreme(a, 1); }
+
+SVM_Value svm_array_max(const SVM_Array *a) { return array_extreme(a, -1); }
+
+/* y += alpha * x; alpha has the element type, x and y the same length. */
+void svm_array_axpy(SVM_Value alpha, const SVM_Array *x, SVM_Array *y) {
+    uint32_t i = 0;
+    if (y->type == SVM_DOUBLE) {
+        const double *xs = (const double *)x->data;
+        double *ys = (double *)y->data;
+        ArrayDouble va = {0};
+        va += alpha.dval;
+        for (; i + DOUBLE_STEP <= y->length; i += DOUBLE_STEP) {
+            *(ArrayDouble *)&ys[i] += va * *(const ArrayDouble *)&xs[i];
+        }
+        for (; i < y->length; ++i) ys[i] += alpha.dval * xs[i];
+    } else {
+        const uint32_t *xs = (const uint32_t *)x->data;
+        uint32_t *ys = (uint32_t *)y->data;
+        ArrayUInt va = {0};
+        va += (uint32_t)alpha.ival;
+        for (; i + INT_STEP <= y->length; i += INT_STEP) {
+            *(ArrayUInt *)&ys[i] += va * *(const ArrayUInt *)&xs[i];
+        }
+        for (; i < y->length; ++i) ys[i] += (uint32_t)alpha.ival * xs[i];
+    }
+}
+
+void svm_array_fill(SVM_Array *a, SVM_Value v) {
+    uint32_t i = 0;
+    if (a->type == SVM_DOUBLE) {
+        double *xs = (double *)a->data;
+        ArrayDouble vv = {0};
+        vv += v.dval;
+        for (; i + DOUBLE_STEP <= a->length; i += DOUBLE_STEP) {
+            *(ArrayDouble *)&xs[i] = vv;
+        }
+        for (; i < a->length; ++i) xs[i] = v.dval;
+    } else {
+        int32_t *xs = (int32_t *)a->data;
+        ArrayInt vv = {0};
+        vv += v.ival;
+        for (; i + INT_STEP <= a->length; i += INT_STEP) {
+            *(ArrayInt *)&xs[i] = vv;
+        }
+        for (; i < a->length; ++i) xs[i] = v.ival;
+    }
+}
+
+/* dst and src have the same type and length, and may be the same array. */
+void svm_array_copy(SVM_Array *dst, const SVM_Array *src) {
+    size_t size = (size_t)dst->length *
+                  (dst->type == SVM_DOUBLE ? sizeof(double) : sizeof(int32_t));
+    memmove(dst->data, src->data, size);
+}
@@ -0,0 +1,164 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "svm.h"
+
+/*
+ * Multi-threaded throughput benchmark: the program is loaded once and
+ * shared, and every thread repeatedly creates, runs and deletes its own
+ * context on it. With no shared mutable state the runs/sec should scale
+ * with the number of threads. With -p the contexts come from a shared
+ * SVM_ContextPool instead, which only resets them between runs.
+ */
+
+typedef struct {
+    const SVM_Program *program;
+    SVM_ContextPool *pool;
+    int runs;
+    int failures;
+} BenchWorker;
+
+static double now_sec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *bench_worker(void *arg) {
+    BenchWorker *worker = (BenchWorker *)arg;
+    FILE *out = fopen("/dev/null", "w");
+    for (int i = 0; i < worker->runs; ++i) {
+        SVM_Context *ctx;
+        SVM_Status status = SVM_FINISHED;
+        if (worker->pool) {
+            ctx = svm_acquire_context(worker->pool);
+        } else {
+            ctx = svm_create_context(worker->program);
+            status = svm_init(ctx);
+        }
+        ctx->out = out;
+        if (status == SVM_FINISHED) {
+            status = svm_run(ctx);
+        }
+        if (status != SVM_FINISHED) {
+            worker->failures++;
+        }
+        if (worker->pool) {
+            svm_release_context(worker->pool, ctx);
+        } else {
+            svm_delete_context(ctx);
+        }
+    }
+    fclose(out);
+    return NULL;
+}
+
+static double run_bench(int threads, int runs, const SVM_Program *program,
+                        SVM_ContextPool *pool, int *failures) {
+    pthread_t *tids = (pthread_t *)malloc(sizeof(pthread_t) * threads);
+    BenchWorker *workers = (BenchWorker *)malloc(sizeof(BenchWorker) * threads);
+    double start = now_sec();
+    for (int i = 0; i < threads; ++i) {
+        workers[i].program = program;
+        workers[i].pool = pool;
+        workers[i].runs = runs;
+        workers[i].failures = 0;
+        pthread_create(&tids[i], NULL, bench_worker, &workers[i]);
+    }
+    *failures = 0;
+    for (int i = 0; i < threads; ++i) {
+        pthread_join(tids[i], NULL);
+        *failures += workers[i].failures;
+    }
+    double elapsed = now_sec() - start;
+    free(workers);
+    free(tids);
+    return elapsed;
+}
+
+int main(int argc, char *argv[]) {
+    int max_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int runs = 10000;
+    bool use_pool = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:n:p")) != -1) {
+        switch (opt) {
+            case 't': {
+                max_threads = atoi(optarg);
+                break;
+            }
+            case 'n': {
+                runs = atoi(optarg);
+                break;
+            }
+            case 'p': {
+                use_pool = true;
+                break;
+            }
+            default: {
+                fprintf(stderr, "Usage ./svmbench [-t threads] [-n runs] [-p] "
+                                "file.csb\n");
+                return 1;
+            }
+        }
+    }
+    if (optind >= argc || max_threads < 1 || runs < 1) {
+        fprintf(stderr,
+                "Usage ./svmbench [-t threads] [-n runs] [-p] file.csb\n");
+        return 1;
+    }
+
+    struct stat st;
+    if (stat(argv[optind], &st) != 0) {
+        fprintf(stderr, "Cannot find file %s\n", argv[optind]);
+        return 1;
+    }
+    uint8_t *image = (uint8_t *)malloc(st.st_size);
+    int fd = open(argv[optind], O_RDONLY);
+    ssize_t len = read(fd, image, st.st_size);
+    close(fd);
+    if (len != st.st_size) {
+        fprintf(stderr, "Cannot read file %s\n", argv[optind]);
+        return 1;
+    }
+    SVM_Program *program = svm_create_program();
+    SVM_Status status = svm_load(program, image, len);
+    free(image);
+    if (status != SVM_FINISHED) {
+        fprintf(stderr, "%s: %s\n", argv[optind], svm_status_message(status));
+        return 1;
+    }
+    add_native_functions(program);
+    SVM_ContextPool *pool =
+        use_pool ? svm_create_context_pool(program, max_threads) : NULL;
+
+    printf("threads  runs/thread     seconds        runs/sec  speedup\n");
+    double base = 0.0;
+    for (int threads = 1; threads <= max_threads;
+         threads = (threads * 2 > max_threads && threads != max_threads)
+                       ? max_threads
+                       : threads * 2) {
+        int failures;
+        double elapsed = run_bench(threads, runs, program, pool, &failures);
+        double rate = (double)threads * runs / elapsed;
+        if (threads == 1) base = rate;
+        printf("%7d  %11d  %10.4f  %14.0f  %7.2f\n", threads, runs, elapsed,
+               rate, rate / base);
+        if (failures) {
+            fprintf(stderr, "%d runs failed\n", failures);
+            return 1;
+        }
+        if (threads == max_threads) break;
+    }
+
+    svm_delete_context_pool(pool);
+    svm_delete_program(program);
+    return 0;
+}
@@ -0,0 +1,292 @@
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../memory/MEM.h"
+#include "svm.h"
+
+/*
+ * Multi-process sweep. The coordinator forks worker processes that keep
+ * the loaded program and talk to it over a Unix domain socket pair each.
+ * Rows travel in batches:
+ *
+ *   request  u32 batch, u32 row_count, row_count * input columns SVM_Value
+ *   reply    u32 batch, u32 row_count, row_count * result columns
+ *            SVM_Value, row_count status bytes
+ *
+ * A request with row_count 0 tells the worker to exit. When a worker dies
+ * its batch goes back on the queue and a new worker takes its place; a
+ * batch that kills max_attempts workers is marked SVM_ERROR_IO.
+ */
+typedef struct {
+    uint32_t batch;
+    uint32_t row_count;
+} BatchHeader;
+
+typedef struct {
+    pid_t pid;
+    int fd;
+    int64_t batch;  // batch in flight, -1 when idle
+} ClusterWorker;
+
+/* Read exactly size bytes; end of input is a failure. */
+static bool read_exact(int fd, void *buf, size_t size) {
+    return svm_read_full(fd, buf, size) == (ssize_t)size;
+}
+
+/* Body of a worker process: serve batches until told to stop. */
+static void worker_main(const SVM_Program *program,
+                        const SVM_SweepTable *input,
+                        const SVM_SweepResult *result, int fd,
+                        uint32_t batch_rows, FILE *out) {
+    SVM_Context *ctx = svm_create_context(program);
+    ctx->out = out;
+    uint32_t in_cols = input->column_count;
+    uint32_t out_cols = result->column_count;
+    SVM_Value *rows =
+        (SVM_Value *)malloc(sizeof(SVM_Value) * in_cols * batch_rows);
+    size_t reply_size = (sizeof(SVM_Value) * out_cols + 1) * batch_rows;
+    uint8_t *reply = (uint8_t *)malloc(reply_size);
+
+    BatchHeader header;
+    while (read_exact(fd, &header, sizeof(header)) && header.row_count &&
+           header.row_count <= batch_rows &&
+           read_exact(fd, rows, sizeof(SVM_Value) * in_cols *
+                                   header.row_count)) {
+        SVM_Value *values = (SVM_Value *)reply;
+        uint8_t *status = reply + sizeof(SVM_Value) * out_cols *
+                                      header.row_count;
+        for (uint32_t r = 0; r < header.row_count; ++r) {
+            svm_init(ctx);
+            for (uint32_t i = 0; i < in_cols; ++i) {
+                ctx->global_variables[input->globals[i]] =
+                    rows[(size_t)r * in_cols + i];
+            }
+            status[r] = svm_run(ctx);
+            for (uint32_t i = 0; i < out_cols; ++i) {
+                values[(size_t)r * out_cols + i] =
+                    ctx->global_variables[result->globals[i]];
+            }
+        }
+        fflush(out);
+        if (!svm_write_full(fd, &header, sizeof(header)) ||
+            !svm_write_full(fd, reply,
+                        (sizeof(SVM_Value) * out_cols + 1) *
+                            header.row_count)) {
+            break;
+        }
+    }
+    free(rows);
+    free(reply);
+    svm_delete_context(ctx);
+}
+
+static bool spawn_worker(ClusterWorker *workers, uint32_t count,
+                         uint32_t slot, const SVM_Program *program,
+                         const SVM_SweepTable *input,
+                         const SVM_SweepResult *result, uint32_t batch_rows,
+                         FILE *out) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return false;
+    fflush(out);
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        for (uint32_t i = 0; i < count; ++i) {
+            if (i != slot && workers[i].fd >= 0) close(workers[i].fd);
+        }
+        worker_main(program, input, result, fds[1], batch_rows, out);
+        _exit(0);
+    }
+    close(fds[1]);
+    workers[slot].pid = pid;
+    workers[slot].fd = fds[0];
+    workers[slot].batch = -1;
+    return true;
+}
+
+static bool send_batch(ClusterWorker *worker, const SVM_SweepTable *input,
+                       uint32_t batch, uint32_t batch_rows) {
+    uint32_t first = batch * batch_rows;
+    BatchHeader header;
+    header.batch = batch;
+    header.row_count = input->row_count - first < batch_rows
+                           ? input->row_count - first
+                           : batch_rows;
+    worker->batch = batch;
+    return svm_write_full(worker->fd, &header, sizeof(header)) &&
+           svm_write_full(worker->fd,
+                      &input->rows[(size_t)first * input->column_count],
+                      sizeof(SVM_Value) * input->column_count *
+                          header.row_count);
+}
+
+static bool receive_batch(ClusterWorker *worker, SVM_SweepResult *result,
+                          uint32_t batch_rows, SVM_Value *values,
+                          uint8_t *status) {
+    BatchHeader header;
+    uint32_t out_cols = result->column_count;
+    if (!read_exact(worker->fd, &header, sizeof(header)) ||
+        header.batch != worker->batch || header.row_count > batch_rows ||
+        !read_exact(worker->fd, values,
+                   sizeof(SVM_Value) * out_cols * header.row_count) ||
+        !read_exact(worker->fd, status, header.row_count)) {
+        return false;
+    }
+    uint32_t first = header.batch * batch_rows;
+    for (uint32_t r = 0; r < header.row_count; ++r) {
+        result->status[first + r] = status[r];
+        for (uint32_t i = 0; i < out_cols; ++i) {
+            result->columns[i][first + r] = values[(size_t)r * out_cols + i];
+        }
+    }
+    worker->batch = -1;
+    return true;
+}
+
+static void reap_worker(ClusterWorker *worker) {
+    close(worker->fd);
+    worker->fd = -1;
+    waitpid(worker->pid, NULL, 0);
+}
+
+/*
+ * Run every input row on options->process_count worker processes, filling
+ * result in place. Returns the number of rows that did not finish.
+ */
+uint32_t svm_sweep_processes(const SVM_Program *program,
+                             const SVM_SweepTable *input,
+                             SVM_SweepResult *result,
+                             const SVM_ClusterOptions *options, FILE *out) {
+    uint32_t batch_rows = options->batch_rows ? options->batch_rows : 1;
+    uint32_t batch_count = (input->row_count + batch_rows - 1) / batch_rows;
+    uint32_t count = options->process_count ? options->process_count : 1;
+    int64_t kill_batch = options->kill_batch;
+
+    // a write to a dead worker must fail with EPIPE, not kill us
+    struct sigaction ignore, old_action;
+    memset(&ignore, 0, sizeof(ignore));
+    ignore.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &ignore, &old_action);
+
+    uint32_t *queue = (uint32_t *)MEM_malloc(sizeof(uint32_t) *
+                                             (batch_count ? batch_count : 1));
+    uint32_t *attempts = (uint32_t *)MEM_malloc(
+        sizeof(uint32_t) * (batch_count ? batch_count : 1));
+    for (uint32_t b = 0; b < batch_count; ++b) {
+        queue[b] = b;
+        attempts[b] = 0;
+    }
+    uint32_t head = 0, tail = 0;  // queue is a full ring of pending batches
+    uint32_t pending = batch_count;
+    uint32_t done = 0;
+    memset(result->status, SVM_ERROR_IO, input->row_count);
+
+    ClusterWorker *workers =
+        (ClusterWorker *)MEM_malloc(sizeof(ClusterWorker) * count);
+    struct pollfd *fds =
+        (struct pollfd *)MEM_malloc(sizeof(struct pollfd) * count);
+    SVM_Value *values = (SVM_Value *)MEM_malloc(
+        sizeof(SVM_Value) * result->column_count * batch_rows + 1);
+    uint8_t *status = (uint8_t *)MEM_malloc(batch_rows);
+    for (uint32_t i = 0; i < count; ++i) workers[i].fd = -1;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (!spawn_worker(workers, count, i, program, input, result,
+                          batch_rows, out)) {
+            perror("svm_sweep_processes");
+        }
+    }
+
+    while (done < batch_count) {
+        // hand a pending batch to every idle worker
+        for (uint32_t i = 0; i < count && pending; ++i) {
+            ClusterWorker *worker = &workers[i];
+            if (worker->fd < 0 || worker->batch >= 0) continue;
+            uint32_t batch = queue[head];
+            head = (head + 1) % batch_count;
+            pending--;
+            attempts[batch]++;
+            if (kill_batch == batch) {
+                kill(worker->pid, SIGKILL);
+                kill_batch = -1;
+            }
+            // a failed send shows up as a hangup below
+            send_batch(worker, input, batch, batch_rows);
+        }
+
+        uint32_t busy = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            fds[i].fd = workers[i].batch >= 0 ? workers[i].fd : -1;
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+            if (fds[i].fd >= 0) busy++;
+        }
+        if (busy == 0) {
+            fprintf(stderr, "svm_sweep_processes: no live worker\n");
+            break;
+        }
+        if (poll(fds, count, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("svm_sweep_processes");
+            break;
+        }
+
+        for (uint32_t i = 0; i < count; ++i) {
+            ClusterWorker *worker = &workers[i];
+            if (fds[i].fd < 0 || fds[i].revents == 0) continue;
+            if (receive_batch(worker, result, batch_rows, values, status)) {
+                done++;
+                continue;
+            }
+            // the worker died: retry its batch on a fresh process
+            uint32_t batch = (uint32_t)worker->batch;
+            fprintf(stderr, "worker %d lost batch %u, attempt %u\n",
+                    (int)worker->pid, batch, attempts[batch]);
+            reap_worker(worker);
+            if (attempts[batch] < options->max_attempts) {
+                queue[tail] = batch;
+                tail = (tail + 1) % batch_count;
+                pending++;
+            } else {
+                done++;  // its rows keep SVM_ERROR_IO
+            }
+            if (!spawn_worker(workers, count, i, program, input, result,
+                              batch_rows, out)) {
+                perror("svm_sweep_processes");
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        if (workers[i].fd < 0) continue;
+        BatchHeader stop = {0, 0};
+        svm_write_full(workers[i].fd, &stop, sizeof(stop));
+        reap_worker(&workers[i]);
+    }
+    sigaction(SIGPIPE, &old_action, NULL);
+
+    MEM_free(status);
+    MEM_free(values);
+    MEM_free(fds);
+    MEM_free(workers);
+    MEM_free(attempts);
+    MEM_free(queue);
+
+    uint32_t failures = 0;
+    for (uint32_t row = 0; row < input->row_count; ++row) {
+        if (result->status[row] != SVM_FINISHED) failures++;
+    }
+    return failures;
+}
@@ -0,0 +1,157 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "../memory/MEM.h"
+#include "svm.h"
+
+/*
+ * Single-threaded event loop for I/O-bound scripts. Runnable contexts take
+ * turns for one slice each. A context that stops in an async native is
+ * parked on epoll with its completion fd and costs nothing until the fd
+ * is ready, so one thread keeps any number of them in flight. When the
+ * fd cannot be watched (a regular file, or one already watched for
+ * another context) the loop waits for it in place instead.
+ */
+#define EVENT_BATCH (64)
+
+struct SVM_EventLoop_tag {
+    MEM_Controller controller;
+    int epoll_fd;
+    uint64_t slice;
+    SVM_Context **ready;  // ring buffer of runnable contexts
+    uint32_t capacity;
+    uint32_t head;
+    uint32_t count;
+    uint32_t parked;  // contexts waiting on epoll
+    uint32_t failures;
+};
+
+static void push_ready(SVM_EventLoop *loop, SVM_Context *ctx) {
+    if (loop->count == loop->capacity) {
+        uint32_t capacity = loop->capacity ? loop->capacity * 2 : 64;
+        SVM_Context **ready = (SVM_Context **)MEM_controller_malloc(
+            loop->controller, sizeof(SVM_Context *) * capacity);
+        for (uint32_t i = 0; i < loop->count; ++i) {
+            ready[i] = loop->ready[(loop->head + i) % loop->capacity];
+        }
+        if (loop->ready) MEM_controller_free(loop->controller, loop->ready);
+        loop->ready = ready;
+        loop->capacity = capacity;
+        loop->head = 0;
+    }
+    loop->ready[(loop->head + loop->count) % loop->capacity] = ctx;
+    loop->count++;
+}
+
+static SVM_Context *pop_ready(SVM_EventLoop *loop) {
+    SVM_Context *ctx = loop->ready[loop->head];
+    loop->head = (loop->head + 1) % loop->capacity;
+    loop->count--;
+    return ctx;
+}
+
+static bool watch(SVM_EventLoop *loop, SVM_Context *ctx) {
+    struct epoll_event event;
+    event.events = ctx->completion.events | EPOLLONESHOT;
+    event.data.ptr = ctx;
+    return epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, ctx->completion.fd,
+                     &event) == 0;
+}
+
+static void park(SVM_EventLoop *loop, SVM_Context *ctx) {
+    if (watch(loop, ctx)) {
+        loop->parked++;
+        return;
+    }
+    if (svm_wait_completion(ctx) == SVM_SUSPENDED) {
+        push_ready(loop, ctx);
+    } else {
+        loop->failures++;
+    }
+}
+
+/* Hand every context whose fd became ready back to the run queue. */
+static void wait_events(SVM_EventLoop *loop) {
+    struct epoll_event events[EVENT_BATCH];
+    int n = epoll_wait(loop->epoll_fd, events, EVENT_BATCH, -1);
+    if (n < 0) {
+        if (errno == EINTR) return;
+        perror("svm_event_loop_run");
+        exit(1);
+    }
+    for (int i = 0; i < n; ++i) {
+        SVM_Context *ctx = (SVM_Context *)events[i].data.ptr;
+        SVM_Completion *completion = &ctx->completion;
+        // the handler may close the fd, so stop watching it first
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, completion->fd, NULL);
+        loop->parked--;
+        SVM_Value result;
+        if (completion->ready(ctx, completion, &result)) {
+            svm_complete(ctx, result);
+            push_ready(loop, ctx);
+        } else {
+            park(loop, ctx);
+        }
+    }
+}
+
+SVM_EventLoop *svm_create_event_loop(uint64_t slice) {
+    MEM_Controller controller = MEM_create_controller();
+    SVM_EventLoop *loop = (SVM_EventLoop *)MEM_controller_malloc(
+        controller, sizeof(SVM_EventLoop));
+    memset(loop, 0, sizeof(SVM_EventLoop));
+    loop->controller = controller;
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epoll_fd < 0) {
+        perror("svm_create_event_loop");
+        exit(1);
+    }
+    loop->slice = slice ? slice : SVM_DEFAULT_SLICE;
+    return loop;
+}
+
+void svm_delete_event_loop(SVM_EventLoop *loop) {
+    if (!loop) return;
+    close(loop->epoll_fd);
+    MEM_Controller controller = loop->controller;
+    if (loop->ready) MEM_controller_free(controller, loop->ready);
+    MEM_controller_free(controller, loop);
+    MEM_dispose_controller(controller);
+}
+
+/* Queue a context; it runs from wherever it stands on the next run. */
+void svm_event_loop_submit(SVM_EventLoop *loop, SVM_Context *ctx) {
+    if (ctx->status == SVM_PENDING) {
+        park(loop, ctx);
+    } else {
+        push_ready(loop, ctx);
+    }
+}
+
+/*
+ * Run every submitted context to the end. Returns how many did not finish;
+ * each context keeps its final status.
+ */
+uint32_t svm_event_loop_run(SVM_EventLoop *loop) {
+    while (loop->count || loop->parked) {
+        while (loop->count) {
+            SVM_Context *ctx = pop_ready(loop);
+            SVM_Status status = svm_run_slice(ctx, loop->slice, 0);
+            if (status == SVM_SUSPENDED) {
+                push_ready(loop, ctx);
+            } else if (status == SVM_PENDING) {
+                park(loop, ctx);
+            } else if (status != SVM_FINISHED) {
+                loop->failures++;
+            }
+        }
+        if (loop->parked) wait_events(loop);
+    }
+    uint32_t failures = loop->failures;
+    loop->failures = 0;
+    return failures;
+}
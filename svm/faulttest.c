@@ -0,0 +1,77 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../memory/MEM.h"
+#include "svm.h"
+
+/*
+ * Embedding test for runtime faults: the image is run through svm_run()
+ * and svm_run_lanes() and must stop on an integer division by zero, at
+ * the dividing instruction, instead of taking the host down with SIGFPE.
+ */
+
+static int check(const char *mode, SVM_Context *ctx) {
+    const SVM_Program *program = ctx->program;
+    uint8_t op = ctx->pc < program->code_size ? program->code[ctx->pc] : 0;
+    if (ctx->status != SVM_ERROR_DIVISION_BY_ZERO ||
+        (op != SVM_DIV_INT && op != SVM_MOD_INT)) {
+        fprintf(stderr, "%s: %s at pc %u\n", mode,
+                svm_status_message(ctx->status), ctx->pc);
+        return 1;
+    }
+    printf("%s: %s at pc %u\n", mode, svm_status_message(ctx->status),
+           ctx->pc);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage ./svmfault file\n");
+        exit(1);
+    }
+    struct stat st;
+    if (stat(argv[1], &st) != 0) {
+        fprintf(stderr, "Cannot find file %s\n", argv[1]);
+        exit(1);
+    }
+    uint8_t *buf = (uint8_t *)malloc(st.st_size);
+    int fp = open(argv[1], O_RDONLY);
+    ssize_t len = read(fp, buf, st.st_size);
+    close(fp);
+
+    SVM_Program *program = svm_create_program();
+    SVM_Status status = svm_load(program, buf, len < 0 ? 0 : len);
+    free(buf);
+    if (status != SVM_FINISHED) {
+        fprintf(stderr, "%s: %s\n", argv[1], svm_status_message(status));
+        exit(1);
+    }
+    add_native_functions(program);
+
+    int failures = 0;
+    FILE *out = fopen("/dev/null", "w");
+    SVM_Context *ctx = svm_create_context(program);
+    ctx->out = out;
+    if (svm_init(ctx) == SVM_FINISHED) svm_run(ctx);
+    failures += check("svm_run", ctx);
+    svm_delete_context(ctx);
+
+    SVM_Context *ctxs[SVM_LANES];
+    for (int l = 0; l < SVM_LANES; ++l) {
+        ctxs[l] = svm_create_context(program);
+        ctxs[l]->out = out;
+        svm_init(ctxs[l]);
+    }
+    svm_run_lanes(ctxs, SVM_LANES);
+    for (int l = 0; l < SVM_LANES; ++l) {
+        failures += check("svm_run_lanes", ctxs[l]);
+        svm_delete_context(ctxs[l]);
+    }
+    fclose(out);
+
+    svm_delete_program(program);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,701 @@
+#include <limits.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "svm.h"
+
+/*
+ * Lane-parallel interpreter. Up to SVM_LANES contexts of one program run
+ * through a single dispatch loop: every stack slot and global holds one
+ * value per lane, and arithmetic is done with GCC vector extensions, which
+ * become SSE or AVX2 instructions depending on the target flags.
+ *
+ * Control flow is shared, so a SVM_GOTO whose condition differs between
+ * lanes spills every lane back into its own context and finishes them with
+ * the scalar interpreter.
+ */
+typedef int32_t LaneInt __attribute__((vector_size(SVM_LANES * 4)));
+typedef double LaneDouble __attribute__((vector_size(SVM_LANES * 8)));
+typedef int64_t LaneMask __attribute__((vector_size(SVM_LANES * 8)));
+
+typedef union {
+    LaneInt i;
+    LaneDouble d;
+} LaneValue;
+
+typedef struct {
+    const SVM_Program *program;
+    SVM_Context **ctxs;
+    uint32_t lane_count;
+    LaneValue *globals;
+    LaneValue *stack;
+    uint8_t *stack_value_type;
+    size_t *pt_stack;
+    size_t pt_stack_count;
+    uint32_t pc;
+    uint32_t sp;
+} LaneState;
+
+static LaneValue *alloc_lanes(uint32_t count) {
+    void *p = NULL;
+    // vector loads need the natural alignment, which MEM does not give
+    if (posix_memalign(&p, sizeof(LaneValue),
+                       sizeof(LaneValue) * (count ? count : 1)) != 0) {
+        return NULL;
+    }
+    return (LaneValue *)p;
+}
+
+static uint8_t fetch(LaneState *ls) { return ls->program->code[ls->pc++]; }
+
+static uint16_t fetch2(LaneState *ls) {
+    uint8_t v1 = fetch(ls);
+    return (v1 << 8) | fetch(ls);
+}
+
+static LaneValue *push(LaneState *ls, uint8_t type) {
+    ls->stack_value_type[ls->sp] = type;
+    return &ls->stack[ls->sp++];
+}
+
+/* Top of stack, retyped to the result of a unary op. */
+static LaneValue *unary(LaneState *ls, uint8_t type) {
+    ls->stack_value_type[ls->sp - 1] = type;
+    return &ls->stack[ls->sp - 1];
+}
+
+/* Pop the right operand; the left one is overwritten with the result. */
+static LaneValue *binary(LaneState *ls, uint8_t type, LaneValue **right) {
+    *right = &ls->stack[--ls->sp];
+    return unary(ls, type);
+}
+
+/* Whether int / or % would trap in any lane; svm_run reports the fault. */
+static bool division_faults(const LaneState *ls) {
+    const LaneValue *v = &ls->stack[ls->sp - 2], *r = &ls->stack[ls->sp - 1];
+    for (int l = 0; l < SVM_LANES; ++l) {
+        if (r->i[l] == 0 || (r->i[l] == -1 && v->i[l] == INT_MIN)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Comparison masks are -1 or 0; the VM's booleans are 1 or 0. */
+#define TRUTH(mask) ((mask)&1)
+#define TRUTH_D(mask) (__builtin_convertvector((mask), LaneInt) & 1)
+
+static void load_lanes(LaneState *ls) {
+    const SVM_Program *program = ls->program;
+    for (uint32_t g = 0; g < program->global_variable_count; ++g) {
+        for (int l = 0; l < SVM_LANES; ++l) {
+            // idle lanes mirror lane 0 so they cannot fault
+            SVM_Context *ctx = ls->ctxs[l < ls->lane_count ? l : 0];
+            if (program->global_variable_types[g] == SVM_DOUBLE) {
+                ls->globals[g].d[l] = ctx->global_variables[g].dval;
+            } else {
+                ls->globals[g].i[l] = ctx->global_variables[g].ival;
+            }
+        }
+    }
+}
+
+/* Write every lane back into its own context, positioned at pc. */
+static void spill_lanes(LaneState *ls, SVM_Status status) {
+    const SVM_Program *program = ls->program;
+    for (uint32_t l = 0; l < ls->lane_count; ++l) {
+        SVM_Context *ctx = ls->ctxs[l];
+        for (uint32_t g = 0; g < program->global_variable_count; ++g) {
+            if (program->global_variable_types[g] == SVM_DOUBLE) {
+                ctx->global_variables[g].dval = ls->globals[g].d[l];
+            } else {
+                ctx->global_variables[g].ival = ls->globals[g].i[l];
+            }
+        }
+        for (uint32_t s = 0; s < ls->sp; ++s) {
+            if (ls->stack_value_type[s] == SVM_DOUBLE) {
+                ctx->stack[s].dval = ls->stack[s].d[l];
+            } else {
+                ctx->stack[s].ival = ls->stack[s].i[l];
+            }
+            ctx->stack_value_type[s] = ls->stack_value_type[s];
+        }
+        memcpy(ctx->pt_stack, ls->pt_stack,
+               sizeof(size_t) * ls->pt_stack_count);
+        ctx->pt_stack_count = ls->pt_stack_count;
+        ctx->sp = ls->sp;
+        ctx->pc = ls->pc;
+        ctx->status = status;
+    }
+}
+
+static void invoke_lanes(LaneState *ls, const SVM_Function *func) {
+    int arg_count = func->arg_count;
+    uint32_t base = ls->sp - arg_count;
+    bool typed = func->f_type == TYPED_NATIVE_FUNCTION;
+    bool is_double =
+        typed && svm_signature_type[func->signature] == SVM_DOUBLE;
+    LaneValue result;
+    for (int l = 0; l < SVM_LANES; ++l) {
+        if (l >= ls->lane_count) {
+            if (is_double) {
+                result.d[l] = result.d[0];
+            } else {
+                result.i[l] = result.i[0];
+            }
+            continue;
+        }
+        SVM_Value args[arg_count ? arg_count : 1];
+        for (int a = 0; a < arg_count; ++a) {
+            if (ls->stack_value_type[base + a] == SVM_DOUBLE) {
+                args[a].dval = ls->stack[base + a].d[l];
+            } else {
+                args[a].ival = ls->stack[base + a].i[l];
+            }
+        }
+        SVM_Value val =
+            typed ? svm_call_typed(func, args)
+                  : func->u.n_func(ls->ctxs[l], args, arg_count);
+        if (is_double) {
+            result.d[l] = val.dval;
+        } else {
+            result.i[l] = val.ival;
+        }
+    }
+    ls->sp = base;
+    // an untyped native returns an int, as in invoke()
+    ls->stack_value_type[ls->sp] =
+        typed ? svm_signature_type[func->signature] : SVM_INT;
+    ls->stack[ls->sp++] = result;
+}
+
+/* Continue at the label with id goto_id, see svm_prepare_program. */
+static bool skip_to_label(LaneState *ls, uint16_t goto_id) {
+    if (goto_id >= ls->program->label_count ||
+        ls->program->label_pc[goto_id] == SVM_NO_LABEL) {
+        return false;
+    }
+    ls->pc = ls->program->label_pc[goto_id];
+    return true;
+}
+
+static SVM_Status run_lanes(LaneState *ls) {
+    const SVM_Program *program = ls->program;
+    uint8_t op;
+
+    while (ls->pc < program->code_size) {
+        switch (op = fetch(ls)) {
+            case SVM_PUSH_INT: {
+                int v = program->constant_pool[fetch2(ls)].u.c_int;
+                push(ls, SVM_INT)->i = (LaneInt){} + v;
+                break;
+            }
+            case SVM_PUSH_DOUBLE: {
+                double dv = program->constant_pool[fetch2(ls)].u.c_double;
+                push(ls, SVM_DOUBLE)->d = (LaneDouble){} + dv;
+                break;
+            }
+            case SVM_POP_STATIC_INT:
+            case SVM_POP_STATIC_DOUBLE: {
+                uint16_t s_idx = fetch2(ls);
+                ls->globals[s_idx] = ls->stack[--ls->sp];
+                break;
+            }
+            case SVM_PUSH_STATIC_INT: {
+                uint16_t s_idx = fetch2(ls);
+                *push(ls, SVM_INT) = ls->globals[s_idx];
+                break;
+            }
+            case SVM_PUSH_STATIC_DOUBLE: {
+                uint16_t s_idx = fetch2(ls);
+                *push(ls, SVM_DOUBLE) = ls->globals[s_idx];
+                break;
+            }
+            case SVM_PUSH_STACK_PT: {
+                if (ls->pt_stack_count >= program->pt_stack_size) {
+                    ls->pc--;
+                    return SVM_ERROR_PT_STACK_OVERFLOW;
+                }
+                ls->pt_stack[ls->pt_stack_count++] = ls->sp++;
+                break;
+            }
+            case SVM_POP_STACK_PT: {
+                if (ls->pt_stack_count == 0) {
+                    ls->pc--;
+                    return SVM_ERROR_PT_STACK_UNDERFLOW;
+                }
+                ls->sp = ls->pt_stack[--ls->pt_stack_count];
+                break;
+            }
+            case SVM_ADD_INT: {
+                LaneValue *r, *v = binary(ls, SVM_INT, &r);
+                v->i = v->i + r->i;
+                break;
+            }
+            case SVM_ADD_DOUBLE: {
+                LaneValue *r, *v = binary(ls, SVM_DOUBLE, &r);
+                v->d = v->d + r->d;
+                break;
+            }
+            case SVM_SUB_INT: {
+                LaneValue *r, *v = binary(ls, SVM_INT, &r);
+                v->i = v->i - r->i;
+                break;
+            }
+            case SVM_SUB_DOUBLE: {
+                LaneValue *r, *v = binary(ls, SVM_DOUBLE, &r);
+                v->d = v->d - r->d;
+                break;
+            }
+            case SVM_MUL_INT: {
+                LaneValue *r, *v = binary(ls, SVM_INT, &r);
+                v->i = v->i * r->i;
+                break;
+            }
+            case SVM_MUL_DOUBLE: {
+                LaneValue *r, *v = binary(ls, SVM_DOUBLE, &r);
+                v->d = v->d * r->d;
+                break;
+            }
+            case SVM_DIV_INT: {
+                if (division_faults(ls)) {
+                    ls->pc--;
+                    return SVM_SUSPENDED;
+                }
+                LaneValue *r, *v = binary(ls, SVM_INT, &r);
+                v->i = v->i / r->i;
+                break;
+            }
+            case SVM_DIV_DOUBLE: {
+                LaneValue *r, *v = binary(ls, SVM_DOUBLE, &r);
+                v->d = v->d / r->d;
+                break;
+            }
+            case SVM_MOD_INT: {
+                if (division_faults(ls)) {
+                    ls->pc--;
+                    return SVM_SUSPENDED;
+                }
+                LaneValue *r, *v = binary(ls, SVM_INT, &r);
+                v->i = v->i % r->i;
+                break;
+            }
+            case SVM_MOD_DOUBLE: {
+                LaneValue *r, *v = binary(ls, SVM_DOUBLE, &r);
+                for (int l = 0; l < SVM_LANES; ++l) {
+                    v->d[l] = fmod(v->d[l], r->d[l]);
+                }
+                break;
+            }
+            case SVM_LT_INT: {
+                LaneValue *r, *v = binary(ls, SVM_INT, &r);
+                v->i = TRUTH(v->i < r->i);
+                break;
+            }
+            case SVM_LT_DOUBLE: {
+                LaneValue *r, *v = binary(ls, SVM_INT, &r);
+                v->i = TRUTH_D(v->d < r->d);
+                break;
+            }
+            case SVM_LE_INT: {
+                LaneValue *r, *v = binary(ls, SVM_INT, &r);
+                v->i = TRUTH(v->i <= r->i);
+                break;
+            }
+            case SVM_LE_DOUBLE: {
+                LaneValue *r, *v = binary(ls, SVM_INT, &r);
+                v->i = TRUTH_D(v->d <= r->d);
+                break;
+            }
+            case SVM_GT_INT: {
+                LaneValue *r, *v = binary(ls, SVM_INT, &r);
+                v->i = TRUTH(v->i > r->i);
+                break;
+            }
+            case SVM_GT_DOUBLE: {
+                LaneValue *r, *v = binary(ls, SVM_INT, &r);
+                v->i = TRUTH_D(v->d > r->d);
+                break;
+            }
+            case SVM_GE_INT: {
+                LaneValue *r, *v = binary(ls, SVM_INT, &r);
+                v->i = TRUTH(v->i >= r->i);
+                break;
+            }
+            case SVM_GE_DOUBLE: {
+                LaneValue *r, *v = binary(ls, SVM_INT, &r);
+                v->i = TRUTH_D(v->d >= r->d);
+                break;
+            }
+            case SVM_EQ_INT: {
+                LaneValue *r, *v = binary(ls, SVM_INT, &r);
+                v->i = TRUTH(v->i == r->i);
+                break;
+            }
+            case SVM_EQ_DOUBLE: {
+                LaneValue *r, *v = binary(ls, SVM_INT, &r);
+                v->i = TRUTH_D(v->d == r->d);
+                break;
+            }
+            case SVM_NE_INT: {
+                LaneValue *r, *v = binary(ls, SVM_INT, &r);
+                v->i = TRUTH(v->i != r->i);
+                break;
+            }
+            case SVM_NE_DOUBLE: {
+                LaneValue *r, *v = binary(ls, SVM_INT, &r);
+                v->i = TRUTH_D(v->d != r->d);
+                break;
+            }
+            case SVM_CAST_DOUBLE_TO_INT: {
+                LaneValue *v = unary(ls, SVM_INT);
+                v->i = __builtin_convertvector(v->d, LaneInt);
+                break;
+            }
+            case SVM_CAST_INT_TO_DOUBLE: {
+                LaneValue *v = unary(ls, SVM_DOUBLE);
+                v->d = __builtin_convertvector(v->i, LaneDouble);
+                break;
+            }
+            case SVM_SQRT_DOUBLE: {
+                LaneValue *v = unary(ls, SVM_DOUBLE);
+                for (int l = 0; l < SVM_LANES; ++l) v->d[l] = sqrt(v->d[l]);
+                break;
+            }
+            case SVM_ABS_INT: {
+                LaneValue *v = unary(ls, SVM_INT);
+                for (int l = 0; l < SVM_LANES; ++l) {
+                    if (v->i[l] < 0) v->i[l] = -v->i[l];
+                }
+                break;
+            }
+            case SVM_ABS_DOUBLE: {
+                LaneValue *v = unary(ls, SVM_DOUBLE);
+                for (int l = 0; l < SVM_LANES; ++l) v->d[l] = fabs(v->d[l]);
+                break;
+            }
+            case SVM_MIN_INT: {
+                LaneValue *r, *v = binary(ls, SVM_INT, &r);
+                LaneInt take = v->i < r->i;  // -1 where the left is smaller
+                v->i = (v->i & take) | (r->i & ~take);
+                break;
+            }
+            case SVM_MIN_DOUBLE: {
+                LaneValue *r, *v = binary(ls, SVM_DOUBLE, &r);
+                for (int l = 0; l < SVM_LANES; ++l) {
+                    if (!(v->d[l] < r->d[l])) v->d[l] = r->d[l];
+                }
+                break;
+            }
+            case SVM_MAX_INT: {
+                LaneValue *r, *v = binary(ls, SVM_INT, &r);
+                LaneInt take = v->i > r->i;
+                v->i = (v->i & take) | (r->i & ~take);
+                break;
+            }
+            case SVM_MAX_DOUBLE: {
+                LaneValue *r, *v = binary(ls, SVM_DOUBLE, &r);
+                for (int l = 0; l < SVM_LANES; ++l) {
+                    if (!(v->d[l] > r->d[l])) v->d[l] = r->d[l];
+                }
+                break;
+            }
+            case SVM_SELECT_INT: {
+                LaneValue *f = &ls->stack[--ls->sp];
+                LaneValue *t = &ls->stack[--ls->sp];
+                LaneValue *v = unary(ls, SVM_INT);
+                LaneInt take = v->i != 0;
+                v->i = (t->i & take) | (f->i & ~take);
+                break;
+            }
+            case SVM_SELECT_DOUBLE: {
+                LaneValue *f = &ls->stack[--ls->sp];
+                LaneValue *t = &ls->stack[--ls->sp];
+                LaneInt cond = ls->stack[ls->sp - 1].i;
+                LaneValue *v = unary(ls, SVM_DOUBLE);
+                for (int l = 0; l < SVM_LANES; ++l) {
+                    v->d[l] = cond[l] ? t->d[l] : f->d[l];
+                }
+                break;
+            }
+            case SVM_FLOOR_DOUBLE: {
+                LaneValue *v = unary(ls, SVM_DOUBLE);
+                for (int l = 0; l < SVM_LANES; ++l) v->d[l] = floor(v->d[l]);
+                break;
+            }
+            case SVM_FMA_INT: {
+                LaneValue *c = &ls->stack[--ls->sp];
+                LaneValue *b, *a = binary(ls, SVM_INT, &b);
+                a->i = a->i * b->i + c->i;
+                break;
+            }
+            case SVM_FMA_DOUBLE: {
+                LaneValue *c = &ls->stack[--ls->sp];
+                LaneValue *b, *a = binary(ls, SVM_DOUBLE, &b);
+                for (int l = 0; l < SVM_LANES; ++l) {
+                    a->d[l] = fma(a->d[l], b->d[l], c->d[l]);
+                }
+                break;
+            }
+            case SVM_SIN_DOUBLE: {
+                LaneValue *v = unary(ls, SVM_DOUBLE);
+                for (int l = 0; l < SVM_LANES; ++l) v->d[l] = sin(v->d[l]);
+                break;
+            }
+            case SVM_COS_DOUBLE: {
+                LaneValue *v = unary(ls, SVM_DOUBLE);
+                for (int l = 0; l < SVM_LANES; ++l) v->d[l] = cos(v->d[l]);
+                break;
+            }
+            case SVM_EXP_DOUBLE: {
+                LaneValue *v = unary(ls, SVM_DOUBLE);
+                for (int l = 0; l < SVM_LANES; ++l) v->d[l] = exp(v->d[l]);
+                break;
+            }
+            case SVM_LOG_DOUBLE: {
+                LaneValue *v = unary(ls, SVM_DOUBLE);
+                for (int l = 0; l < SVM_LANES; ++l) v->d[l] = log(v->d[l]);
+                break;
+            }
+            case SVM_INCREMENT: {
+                LaneValue *v = unary(ls, SVM_INT);
+                v->i = v->i + 1;
+                break;
+            }
+            case SVM_DECREMENT: {
+                LaneValue *v = unary(ls, SVM_INT);
+                v->i = v->i - 1;
+                break;
+            }
+            case SVM_LOGICAL_AND: {
+                LaneValue *r, *v = binary(ls, SVM_INT, &r);
+                v->i = TRUTH((v->i == 1) & (r->i == 1));
+                break;
+            }
+            case SVM_LOGICAL_OR: {
+                LaneValue *r, *v = binary(ls, SVM_INT, &r);
+                v->i = TRUTH((v->i == 1) | (r->i == 1));
+                break;
+            }
+            case SVM_LOGICAL_NOT: {
+                LaneValue *v = unary(ls, SVM_INT);
+                v->i = TRUTH(v->i != 1);
+                break;
+            }
+            case SVM_MINUS_INT: {
+                LaneValue *v = unary(ls, SVM_INT);
+                v->i = -v->i;
+                break;
+            }
+            case SVM_MINUS_DOUBLE: {
+                LaneValue *v = unary(ls, SVM_DOUBLE);
+                v->d = -v->d;
+                break;
+            }
+            case SVM_POP: {
+                ls->sp--;
+                break;
+            }
+            case SVM_PUSH_FUNCTION: {
+                uint16_t idx = fetch2(ls);
+                push(ls, SVM_INT)->i = (LaneInt){} + idx;
+                break;
+            }
+            case SVM_INVOKE:
+            case SVM_INVOKE_NATIVE: {
+                uint32_t start = ls->pc - 1;
+                uint16_t f_idx = op == SVM_INVOKE ? ls->stack[--ls->sp].i[0]
+                                                  : fetch2(ls);
+                FunctionType f_type =
+                    f_idx < program->function_count
+                        ? program->functions[f_idx].f_type
+                        : CSUA_FUNCTION;
+                if (f_type == ASYNC_NATIVE_FUNCTION) {
+                    if (op == SVM_INVOKE) ls->sp++;
+                    ls->pc = start;
+                    return SVM_SUSPENDED;  // each lane waits on its own
+                }
+                if (f_type != NATIVE_FUNCTION &&
+                    f_type != TYPED_NATIVE_FUNCTION) {
+                    ls->pc = start;
+                    return SVM_ERROR_BAD_FUNCTION;
+                }
+                invoke_lanes(ls, &program->functions[f_idx]);
+                break;
+            }
+            case SVM_GOTO: {
+                // same truncation as the scalar interpreter
+                LaneInt cond = ls->stack[ls->sp - 1].i & 0xffff;
+                int taken = 0;
+                for (uint32_t l = 0; l < ls->lane_count; ++l) {
+                    if (cond[l]) taken++;
+                }
+                if (taken != 0 && taken != ls->lane_count) {
+                    ls->pc--;
+                    return SVM_SUSPENDED;  // lanes diverge here
+                }
+                ls->sp--;
+                uint16_t goto_id = fetch2(ls);
+                if (taken == 0 && !skip_to_label(ls, goto_id)) {
+                    return SVM_ERROR_LABEL_NOT_FOUND;
+                }
+                break;
+            }
+            case SVM_LABEL: {
+                fetch2(ls);
+                break;
+            }
+            case SVM_JUMP: {
+                if (!skip_to_label(ls, fetch2(ls))) {
+                    ls->pc -= 3;
+                    return SVM_ERROR_LABEL_NOT_FOUND;
+                }
+                break;
+            }
+            case SVM_TABLE_SWITCH:
+            case SVM_LOOKUP_SWITCH: {
+                ls->pc--;
+                return SVM_SUSPENDED;  // lanes may take different cases
+            }
+            case SVM_PARALLEL_FOR:
+            case SVM_FORK: {
+                ls->pc--;
+                return SVM_SUSPENDED;  // each lane forks on its own
+            }
+            case SVM_NEW_ARRAY_INT:
+            case SVM_NEW_ARRAY_DOUBLE:
+            case SVM_LOAD_ARRAY_INT:
+            case SVM_LOAD_ARRAY_DOUBLE:
+            case SVM_STORE_ARRAY_INT:
+            case SVM_STORE_ARRAY_DOUBLE:
+            case SVM_LOAD_ARRAY_INT_UNCHECKED:
+            case SVM_LOAD_ARRAY_DOUBLE_UNCHECKED:
+            case SVM_STORE_ARRAY_INT_UNCHECKED:
+            case SVM_STORE_ARRAY_DOUBLE_UNCHECKED:
+            case SVM_ARRAY_LENGTH:
+            case SVM_ARRAY_SUM:
+            case SVM_ARRAY_DOT:
+            case SVM_ARRAY_MIN:
+            case SVM_ARRAY_MAX:
+            case SVM_ARRAY_AXPY:
+            case SVM_ARRAY_FILL:
+            case SVM_ARRAY_COPY:
+            case SVM_PUSH_STRING:
+            case SVM_CONCAT_STRING:
+            case SVM_SUBSTR_STRING:
+            case SVM_STRING_LENGTH:
+            case SVM_EQ_STRING:
+            case SVM_NE_STRING:
+            case SVM_INT_TO_STRING:
+            case SVM_DOUBLE_TO_STRING:
+            case SVM_NEW_MAP_INT:
+            case SVM_NEW_MAP_DOUBLE:
+            case SVM_MAP_GET:
+            case SVM_MAP_PUT:
+            case SVM_MAP_INCREMENT:
+            case SVM_MAP_SIZE:
+            case SVM_NEW_RECORD_ARRAY:
+            case SVM_LOAD_FIELD_INT:
+            case SVM_LOAD_FIELD_DOUBLE:
+            case SVM_STORE_FIELD_INT:
+            case SVM_STORE_FIELD_DOUBLE:
+            case SVM_LOAD_FIELD_INT_UNCHECKED:
+            case SVM_LOAD_FIELD_DOUBLE_UNCHECKED:
+            case SVM_STORE_FIELD_INT_UNCHECKED:
+            case SVM_STORE_FIELD_DOUBLE_UNCHECKED: {
+                ls->pc--;
+                return SVM_SUSPENDED;  // the heaps are left to svm_run
+            }
+            case SVM_PUSH_STATIC_VECTOR:
+            case SVM_POP_STATIC_VECTOR:
+            case SVM_SPLAT_INT4:
+            case SVM_SPLAT_DOUBLE4:
+            case SVM_ADD_INT4:
+            case SVM_ADD_DOUBLE4:
+            case SVM_SUB_INT4:
+            case SVM_SUB_DOUBLE4:
+            case SVM_MUL_INT4:
+            case SVM_MUL_DOUBLE4:
+            case SVM_DIV_DOUBLE4:
+            case SVM_MINUS_INT4:
+            case SVM_MINUS_DOUBLE4:
+            case SVM_COMPARE_INT4:
+            case SVM_COMPARE_DOUBLE4:
+            case SVM_ALL_INT4:
+            case SVM_ANY_INT4:
+            case SVM_SUM_INT4:
+            case SVM_SUM_DOUBLE4:
+            case SVM_MIN_INT4:
+            case SVM_MIN_DOUBLE4:
+            case SVM_MAX_INT4:
+            case SVM_MAX_DOUBLE4:
+            case SVM_DOT_INT4:
+            case SVM_DOT_DOUBLE4:
+            case SVM_SHUFFLE_VECTOR:
+            case SVM_EXTRACT_VECTOR:
+            case SVM_INT4_TO_DOUBLE4:
+            case SVM_DOUBLE4_TO_INT4: {
+                ls->pc--;
+                return SVM_SUSPENDED;  // vectors are left to svm_run too
+            }
+            default: {
+                ls->pc--;
+                return SVM_ERROR_UNKNOWN_OPCODE;
+            }
+        }
+    }
+    return SVM_FINISHED;
+}
+
+/*
+ * Run lane_count (at most SVM_LANES) freshly initialised contexts of one
+ * program to completion, as svm_run() would run each of them. Contexts
+ * that are not at the start of the program are run one by one instead.
+ * Returns how many contexts did not finish.
+ */
+uint32_t svm_run_lanes(SVM_Context **ctxs, uint32_t lane_count) {
+    uint32_t failures = 0;
+    if (lane_count == 0) return 0;
+
+    const SVM_Program *program = ctxs[0]->program;
+    bool uniform = lane_count <= SVM_LANES;
+    for (uint32_t l = 0; l < lane_count && uniform; ++l) {
+        uniform = ctxs[l]->program == program && ctxs[l]->pc == 0 &&
+                  ctxs[l]->sp == 0 && ctxs[l]->pt_stack_count == 0 &&
+                  ctxs[l]->status == SVM_FINISHED;
+    }
+
+    LaneState ls;
+    ls.globals = uniform ? alloc_lanes(program->global_variable_count) : NULL;
+    ls.stack = uniform ? alloc_lanes(program->stack_size) : NULL;
+    bool vectorized = ls.globals && ls.stack;
+    if (vectorized) {
+        ls.program = program;
+        ls.ctxs = ctxs;
+        ls.lane_count = lane_count;
+        ls.stack_value_type = (uint8_t *)malloc(program->stack_size + 1);
+        ls.pt_stack = (size_t *)malloc(sizeof(size_t) *
+                                       (program->pt_stack_size + 1));
+        ls.pt_stack_count = 0;
+        ls.pc = 0;
+        ls.sp = 0;
+
+        load_lanes(&ls);
+        spill_lanes(&ls, run_lanes(&ls));
+        free(ls.pt_stack);
+        free(ls.stack_value_type);
+    }
+    free(ls.globals);
+    free(ls.stack);
+
+    for (uint32_t l = 0; l < lane_count; ++l) {
+        // diverged or fallback lanes continue on the scalar interpreter
+        if (ctxs[l]->status == SVM_SUSPENDED || !vectorized) {
+            svm_run(ctxs[l]);
+        }
+        if (ctxs[l]->status != SVM_FINISHED) failures++;
+    }
+    return failures;
+}
@@ -0,0 +1,108 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "svm.h"
+
+/*
+ * Runs many contexts of one program on a single-threaded event loop,
+ * checks that each ends exactly as a plain svm_run() does, and prints how
+ * long it took. With a program that sleeps the total stays close to one
+ * sleep however many contexts there are.
+ */
+
+static void usage() {
+    fprintf(stderr, "Usage ./svmloop [-n contexts] [-q slice] file.csb\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    int contexts = 1000;
+    uint64_t slice = SVM_DEFAULT_SLICE;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:q:")) != -1) {
+        switch (opt) {
+            case 'n': {
+                contexts = atoi(optarg);
+                break;
+            }
+            case 'q': {
+                slice = strtoull(optarg, NULL, 10);
+                break;
+            }
+            default: {
+                usage();
+            }
+        }
+    }
+    if (optind >= argc || contexts < 1) usage();
+
+    struct stat st;
+    if (stat(argv[optind], &st) != 0) {
+        fprintf(stderr, "Cannot find file %s\n", argv[optind]);
+        return 1;
+    }
+    uint8_t *image = (uint8_t *)malloc(st.st_size);
+    int fd = open(argv[optind], O_RDONLY);
+    ssize_t len = read(fd, image, st.st_size);
+    close(fd);
+    SVM_Program *program = svm_create_program();
+    SVM_Status status = svm_load(program, image, len < 0 ? 0 : len);
+    free(image);
+    if (status != SVM_FINISHED) {
+        fprintf(stderr, "%s: %s\n", argv[optind], svm_status_message(status));
+        return 1;
+    }
+    add_native_functions(program);
+    FILE *out = fopen("/dev/null", "w");
+
+    SVM_Context *reference = svm_create_context(program);
+    reference->out = out;
+    svm_init(reference);
+    SVM_Status expected = svm_run(reference);
+
+    SVM_Context **ctxs =
+        (SVM_Context **)malloc(sizeof(SVM_Context *) * contexts);
+    SVM_EventLoop *loop = svm_create_event_loop(slice);
+    for (int i = 0; i < contexts; ++i) {
+        ctxs[i] = svm_create_context(program);
+        ctxs[i]->out = out;
+        svm_init(ctxs[i]);
+        svm_event_loop_submit(loop, ctxs[i]);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint32_t failures = svm_event_loop_run(loop);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds =
+        (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    int mismatches = 0;
+    for (int i = 0; i < contexts; ++i) {
+        if (ctxs[i]->status != expected ||
+            !svm_same_globals(ctxs[i], reference)) {
+            mismatches++;
+        }
+    }
+    printf("contexts     %d\n", contexts);
+    printf("failures     %u\n", failures);
+    printf("seconds      %.4f\n", seconds);
+    printf("contexts/sec %.0f\n", contexts / (seconds > 0 ? seconds : 1e-9));
+    if (mismatches) {
+        fprintf(stderr, "%d contexts differ from svm_run\n", mismatches);
+    }
+
+    svm_delete_event_loop(loop);
+    for (int i = 0; i < contexts; ++i) {
+        svm_delete_context(ctxs[i]);
+    }
+    svm_delete_context(reference);
+    free(ctxs);
+    fclose(out);
+    svm_delete_program(program);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,118 @@
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../memory/MEM.h"
+#include "svm.h"
+
+/* Slice length while a snapshot file is given, so SIGUSR1 is noticed. */
+#define SNAPSHOT_POLL_INSTRUCTIONS (1 << 20)
+
+static volatile sig_atomic_t snapshot_requested = 0;
+
+static void request_snapshot(int sig) { snapshot_requested = 1; }
+
+int main(int argc, char *argv[]) {
+    // for test
+    bool disasm_mode = false;
+    uint64_t slice = SVM_UNLIMITED;
+    char *snapshot_path = NULL;
+    char *segment_path = NULL;
+    bool checkpoint = false;
+    int file_idx = 1;
+    if (argc < 2) {
+        fprintf(stderr,
+                "Usage ./svm [-d | -b budget] [-s snapshot [-c interval]] "
+                "[-m segment] [-j threads] file\n");
+        exit(1);
+    }
+
+    for (; file_idx < argc - 1; ++file_idx) {
+        if (!strcmp("-d", argv[file_idx])) {
+            printf("disasm\n");
+            disasm_mode = true;
+        } else if (!strcmp("-b", argv[file_idx]) && file_idx + 2 < argc) {
+            slice = strtoull(argv[++file_idx], NULL, 10);
+        } else if (!strcmp("-s", argv[file_idx]) && file_idx + 2 < argc) {
+            snapshot_path = argv[++file_idx];
+        } else if (!strcmp("-c", argv[file_idx]) && file_idx + 2 < argc) {
+            slice = strtoull(argv[++file_idx], NULL, 10);
+            checkpoint = true;
+        } else if (!strcmp("-m", argv[file_idx]) && file_idx + 2 < argc) {
+            segment_path = argv[++file_idx];
+        } else if (!strcmp("-j", argv[file_idx]) && file_idx + 2 < argc) {
+            svm_set_parallel_workers(atoi(argv[++file_idx]));
+        } else {
+            fprintf(stderr, "No such option %s\n", argv[file_idx]);
+        }
+    }
+
+    struct stat st;
+    if (stat(argv[file_idx], &st) != 0) {
+        fprintf(stderr, "Cannot find file %s\n", argv[file_idx]);
+        exit(1);
+    }
+    uint8_t *buf = (uint8_t *)malloc(st.st_size);
+    int fp = open(argv[file_idx], O_RDONLY);
+    ssize_t len = read(fp, buf, st.st_size);
+    close(fp);
+
+    SVM_Program *program = svm_create_program();
+    SVM_Status status = svm_load(program, buf, len < 0 ? 0 : len);
+    free(buf);
+
+    if (status != SVM_FINISHED) {
+        fprintf(stderr, "%s: %s\n", argv[file_idx],
+                svm_status_message(status));
+    } else if (disasm_mode) {
+        svm_disasm(program);
+    } else {
+        add_native_functions(program);
+        SVM_Context *ctx = svm_create_context(program);
+        status = svm_init(ctx);
+        if (status == SVM_FINISHED && segment_path) {
+            status = svm_map_globals(ctx, segment_path);
+        }
+        if (status == SVM_FINISHED && snapshot_path) {
+            // warm start from the last snapshot, if there is one
+            if (access(snapshot_path, F_OK) == 0) {
+                status = svm_restore_snapshot(ctx, snapshot_path);
+            }
+            if (slice == SVM_UNLIMITED) slice = SNAPSHOT_POLL_INSTRUCTIONS;
+            signal(SIGUSR1, request_snapshot);
+        }
+        if (status == SVM_FINISHED) {
+            do {
+                status = svm_run_slice(ctx, slice, 0);
+                if (status == SVM_PENDING) {
+                    status = svm_wait_completion(ctx);
+                }
+                if (status == SVM_SUSPENDED && snapshot_path &&
+                    (checkpoint || snapshot_requested)) {
+                    snapshot_requested = 0;
+                    SVM_Status saved = svm_save_snapshot(ctx, snapshot_path);
+                    if (saved != SVM_FINISHED) status = saved;
+                }
+            } while (status == SVM_SUSPENDED);
+        }
+        if (status == SVM_FINISHED && segment_path) {
+            status = svm_sync_globals(ctx);
+        }
+        if (status != SVM_FINISHED) {
+            fprintf(stderr, "svm: %s at pc %u\n", svm_status_message(status),
+                    ctx->pc);
+        }
+        svm_show_status(ctx);
+        svm_delete_context(ctx);
+    }
+
+    svm_delete_program(program);
+    MEM_dump_memory();
+
+    return status == SVM_FINISHED ? 0 : 1;
+}
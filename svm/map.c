@@ -0,0 +1,163 @@
+#include <string.h>
+
+#include "../memory/MEM.h"
+#include "svm.h"
+
+/*
+ * Maps behind SVM_MAP_GET and friends. Slots are found by Fibonacci
+ * hashing, which spreads the sequential and strided keys scripts tend to
+ * use, and the table doubles before it is half full, so a lookup probes
+ * one or two keys on average. Nothing is ever removed, so there are no
+ * tombstones to skip.
+ */
+#define MAP_MIN_CAPACITY (16)
+
+static size_t value_size(const SVM_Map *map) {
+    return map->type == SVM_DOUBLE ? sizeof(double) : sizeof(int32_t);
+}
+
+static uint32_t map_hash(const SVM_Map *map, int key) {
+    return ((uint32_t)key * 0x9e3779b9u) >> map->shift;
+}
+
+void svm_init_maps(SVM_Context *ctx) {
+    ctx->map_heap.controller = ctx->controller;
+    ctx->map_heap.count = 0;
+    ctx->map_heap.capacity = 0;
+    ctx->map_heap.maps = NULL;
+    ctx->maps = &ctx->map_heap;
+}
+
+static void free_table(MEM_Controller controller, SVM_Map *map) {
+    if (map->capacity) {
+        MEM_controller_free(controller, map->keys);
+        MEM_controller_free(controller, map->values);
+    }
+}
+
+/* Free every map; the handles handed out so far become invalid. */
+void svm_free_maps(SVM_MapHeap *heap) {
+    for (uint32_t i = 0; i < heap->count; ++i) {
+        free_table(heap->controller, &heap->maps[i]);
+    }
+    if (heap->maps) MEM_controller_free(heap->controller, heap->maps);
+    heap->count = 0;
+    heap->capacity = 0;
+    heap->maps = NULL;
+}
+
+/* Allocate an empty map, returns its handle or 0 when there are too many. */
+int svm_new_map(SVM_MapHeap *heap, uint8_t type) {
+    if (heap->count == INT32_MAX) return 0;
+    if (heap->count == heap->capacity) {
+        uint32_t capacity = heap->capacity ? heap->capacity * 2 : 16;
+        heap->maps = (SVM_Map *)MEM_controller_realloc(
+            heap->controller, heap->maps, sizeof(SVM_Map) * capacity);
+        heap->capacity = capacity;
+    }
+    SVM_Map *map = &heap->maps[heap->count];
+    memset(map, 0, sizeof(SVM_Map));
+    map->type = type;
+    return ++heap->count;
+}
+
+/* Give map an empty table of capacity slots, a power of two. */
+void svm_map_alloc(SVM_MapHeap *heap, SVM_Map *map, uint32_t capacity) {
+    map->capacity = capacity;
+    map->shift = 32 - __builtin_ctz(capacity);
+    map->keys = MEM_controller_malloc_aligned(
+        heap->controller, sizeof(int32_t) * capacity, SVM_ARRAY_ALIGN);
+    map->values = MEM_controller_malloc_aligned(
+        heap->controller, value_size(map) * capacity, SVM_ARRAY_ALIGN);
+    for (uint32_t i = 0; i < capacity; ++i) map->keys[i] = SVM_MAP_EMPTY;
+}
+
+/* Slot holding key, or the free slot where it would go. */
+static uint32_t find_slot(const SVM_Map *map, int key) {
+    uint32_t mask = map->capacity - 1;
+    uint32_t i = map_hash(map, key);
+    while (map->keys[i] != key && map->keys[i] != SVM_MAP_EMPTY) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static void grow(SVM_MapHeap *heap, SVM_Map *map) {
+    SVM_Map old = *map;
+    svm_map_alloc(heap, map,
+                  old.capacity ? old.capacity * 2 : MAP_MIN_CAPACITY);
+    size_t size = value_size(map);
+    for (uint32_t i = 0; i < old.capacity; ++i) {
+        if (old.keys[i] == SVM_MAP_EMPTY) continue;
+        uint32_t slot = find_slot(map, old.keys[i]);
+        map->keys[slot] = old.keys[i];
+        memcpy((uint8_t *)map->values + slot * size,
+               (uint8_t *)old.values + i * size, size);
+    }
+    free_table(heap->controller, &old);
+}
+
+/* Value slot of key, inserted as 0 when missing. */
+static void *value_slot(SVM_MapHeap *heap, SVM_Map *map, int key) {
+    if (key == SVM_MAP_EMPTY) {
+        if (!map->has_empty_key) {
+            map->has_empty_key = true;
+            memset(&map->empty_value, 0, sizeof(SVM_Value));
+            map->count++;
+        }
+        return &map->empty_value;
+    }
+    if (2 * ((uint64_t)map->count + 1) > map->capacity) grow(heap, map);
+    uint32_t slot = find_slot(map, key);
+    size_t size = value_size(map);
+    void *value = (uint8_t *)map->values + slot * size;
+    if (map->keys[slot] == SVM_MAP_EMPTY) {
+        map->keys[slot] = key;
+        memset(value, 0, size);
+        map->count++;
+    }
+    return value;
+}
+
+/* The value of key, 0 when it is missing. */
+SVM_Value svm_map_get(const SVM_Map *map, int key) {
+    SVM_Value v;
+    memset(&v, 0, sizeof(v));
+    if (key == SVM_MAP_EMPTY) {
+        if (map->has_empty_key) v = map->empty_value;
+        return v;
+    }
+    if (map->capacity == 0) return v;
+    uint32_t slot = find_slot(map, key);
+    if (map->keys[slot] == SVM_MAP_EMPTY) return v;
+    if (map->type == SVM_DOUBLE) {
+        v.dval = ((const double *)map->values)[slot];
+    } else {
+        v.ival = ((const int32_t *)map->values)[slot];
+    }
+    return v;
+}
+
+SVM_Value svm_map_put(SVM_MapHeap *heap, SVM_Map *map, int key, SVM_Value v) {
+    void *value = value_slot(heap, map, key);
+    if (map->type == SVM_DOUBLE) {
+        *(double *)value = v.dval;
+    } else {
+        *(int32_t *)value = v.ival;
+    }
+    return v;
+}
+
+/* Add delta to the value of key, a missing key counting as 0. */
+SVM_Value svm_map_increment(SVM_MapHeap *heap, SVM_Map *map, int key,
+                            SVM_Value delta) {
+    void *value = value_slot(heap, map, key);
+    SVM_Value v;
+    if (map->type == SVM_DOUBLE) {
+        v.dval = *(double *)value += delta.dval;
+    } else {
+        // unsigned so that overflow wraps like SVM_ADD_INT
+        v.ival = (int32_t)(*(uint32_t *)value += (uint32_t)delta.ival);
+    }
+    return v;
+}
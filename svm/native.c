@@ -1,27 +1,124 @@
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
 
 #include "../memory/MEM.h"
 #include "svm.h"
 
-static SVM_Value native_print(SVM_VirtualMachine* svm, SVM_Value* values,
+static SVM_Value native_print(SVM_Context* ctx, SVM_Value* values,
                               int arg_count) {
     SVM_Value v;
     v.ival = 0;
-    printf("%d\n", values[0].ival);
-    printf("%f\n", values[1].dval);
+    flockfile(ctx->out);
+    fprintf(ctx->out, "%d\n", values[0].ival);
+    fprintf(ctx->out, "%f\n", values[1].dval);
+    funlockfile(ctx->out);
     return v;
 }
 
-static SVM_Value native_printb(SVM_VirtualMachine* svm, SVM_Value* values,
+static SVM_Value native_printb(SVM_Context* ctx, SVM_Value* values,
                                int arg_count) {
     SVM_Value v;
     v.ival = 1;
-    printf("printb\n");
-    printf("%d\n", values[0].ival);
+    flockfile(ctx->out);
+    fprintf(ctx->out, "printb\n");
+    fprintf(ctx->out, "%d\n", values[0].ival);
+    funlockfile(ctx->out);
     return v;
 }
 
-void add_native_functions(SVM_VirtualMachine* svm) {
-    svm_add_native_function(svm, native_print, "print", 2);
-    svm_add_native_function(svm, native_printb, "printb", 1);
+/* puts(s): the string and a newline. */
+static SVM_Value native_puts(SVM_Context* ctx, SVM_Value* values,
+                             int arg_count) {
+    SVM_Value v;
+    SVM_String s;
+    if (!svm_string(ctx, values[0].ival, &s)) {
+        v.ival = -1;
+        return v;
+    }
+    flockfile(ctx->out);
+    fwrite(s.data, 1, s.length, ctx->out);
+    fputc('\n', ctx->out);
+    funlockfile(ctx->out);
+    v.ival = 0;
+    return v;
+}
+
+static bool sleep_done(SVM_Context* ctx, SVM_Completion* completion,
+                       SVM_Value* result) {
+    uint64_t expirations;
+    if (read(completion->fd, &expirations, sizeof(expirations)) < 0 &&
+        (errno == EAGAIN || errno == EINTR)) {
+        return false;
+    }
+    close(completion->fd);
+    result->ival = 0;
+    return true;
+}
+
+/* sleep(ms): parks the context on a timerfd instead of the thread. */
+static SVM_Status native_sleep(SVM_Context* ctx, SVM_Value* values,
+                               int arg_count, SVM_Value* result) {
+    result->ival = 0;
+    int ms = values[0].ival;
+    if (ms <= 0) return SVM_FINISHED;
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) return SVM_ERROR_IO;
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = ms / 1000;
+    spec.it_value.tv_nsec = (long)(ms % 1000) * 1000000;
+    if (timerfd_settime(fd, 0, &spec, NULL) != 0) {
+        close(fd);
+        return SVM_ERROR_IO;
+    }
+    ctx->completion.fd = fd;
+    ctx->completion.events = POLLIN;
+    ctx->completion.ready = sleep_done;
+    ctx->completion.data = NULL;
+    return SVM_PENDING;
+}
+
+/* Shared by every program; never written after startup. */
+static const SVM_Function native_functions[] = {
+    {NATIVE_FUNCTION, "print", 2, false, false, SVM_SIG_NONE, {native_print}},
+    {NATIVE_FUNCTION, "printb", 1, false, false, SVM_SIG_NONE,
+     {native_printb}},
+    {ASYNC_NATIVE_FUNCTION, "sleep", 1, false, false, SVM_SIG_NONE,
+     {.a_func = native_sleep}},
+    {TYPED_NATIVE_FUNCTION, "sqrt", 1, true, false, SVM_SIG_D_D,
+     {.t_func = (SVM_TypedNative)sqrt}},
+    {TYPED_NATIVE_FUNCTION, "pow", 2, true, true, SVM_SIG_D_DD,
+     {.t_func = (SVM_TypedNative)pow}},
+    {TYPED_NATIVE_FUNCTION, "abs", 1, true, false, SVM_SIG_I_I,
+     {.t_func = (SVM_TypedNative)abs}},
+    {NATIVE_FUNCTION, "puts", 1, false, false, SVM_SIG_NONE, {native_puts}},
+};
+
+void add_native_functions(SVM_Program* program) {
+    svm_set_native_functions(
+        program, native_functions,
+        sizeof(native_functions) / sizeof(native_functions[0]));
+}
+
+/* Index of a native for SVM_INVOKE_NATIVE, -1 when there is none. */
+int find_native_index(const char* name) {
+    for (int i = 0;
+         i < sizeof(native_functions) / sizeof(native_functions[0]); ++i) {
+        if (!strcmp(native_functions[i].name, name)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Look a native up by name, for the compiler. NULL when there is none. */
+const SVM_Function* find_native_function(const char* name) {
+    int index = find_native_index(name);
+    return index < 0 ? NULL : &native_functions[index];
 }
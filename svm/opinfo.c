@@ -56,5 +56,99 @@ OpcodeInfo svm_opcode_info[] = {
     {"return", "", -1},
     {"goto", "i", 1},
     {"label", "i", 1},
+    {"parallel_for", "i", -2},
+    {"parallel_end", "", 0},
+    {"fork", "i", 0},
+    {"join", "", 0},
+    {"invoke_native", "i", 1},
+    {"sqrt_double", "", 0},
+    {"abs_int", "", 0},
+    {"abs_double", "", 0},
+    {"min_int", "", -1},
+    {"min_double", "", -1},
+    {"max_int", "", -1},
+    {"max_double", "", -1},
+    {"floor_double", "", 0},
+    {"fma_int", "", -2},
+    {"fma_double", "", -2},
+    {"sin_double", "", 0},
+    {"cos_double", "", 0},
+    {"exp_double", "", 0},
+    {"log_double", "", 0},
+    {"new_array_int", "", 0},
+    {"new_array_double", "", 0},
+    {"load_array_int", "", -1},
+    {"load_array_double", "", -1},
+    {"store_array_int", "", -3},
+    {"store_array_double", "", -3},
+    {"load_array_int_unchecked", "", -1},
+    {"load_array_double_unchecked", "", -1},
+    {"store_array_int_unchecked", "", -3},
+    {"store_array_double_unchecked", "", -3},
+    {"array_length", "", 0},
+    {"array_sum", "", 0},
+    {"array_dot", "", -1},
+    {"array_min", "", 0},
+    {"array_max", "", 0},
+    {"array_axpy", "", -2},
+    {"array_fill", "", -1},
+    {"array_copy", "", -1},
+    {"push_string", "i", 1},
+    {"concat_string", "", -1},
+    {"substr_string", "", -2},
+    {"string_length", "", 0},
+    {"eq_string", "", -1},
+    {"ne_string", "", -1},
+    {"int_to_string", "", 0},
+    {"double_to_string", "", 0},
+    {"new_map_int", "", 1},
+    {"new_map_double", "", 1},
+    {"map_get", "", -1},
+    {"map_put", "", -2},
+    {"map_increment", "", -2},
+    {"map_size", "", 0},
+    {"new_record_array", "i", 0},
+    {"load_field_int", "i", -1},
+    {"load_field_double", "i", -1},
+    {"store_field_int", "i", -3},
+    {"store_field_double", "i", -3},
+    {"load_field_int_unchecked", "i", -1},
+    {"load_field_double_unchecked", "i", -1},
+    {"store_field_int_unchecked", "i", -3},
+    {"store_field_double_unchecked", "i", -3},
+    {"push_static_vector", "i", 4},
+    {"pop_static_vector", "i", -4},
+    {"splat_int4", "", 3},
+    {"splat_double4", "", 3},
+    {"add_int4", "", -4},
+    {"add_double4", "", -4},
+    {"sub_int4", "", -4},
+    {"sub_double4", "", -4},
+    {"mul_int4", "", -4},
+    {"mul_double4", "", -4},
+    {"div_double4", "", -4},
+    {"minus_int4", "", 0},
+    {"minus_double4", "", 0},
+    {"compare_int4", "i", -4},
+    {"compare_double4", "i", -4},
+    {"all_int4", "", -3},
+    {"any_int4", "", -3},
+    {"sum_int4", "", -3},
+    {"sum_double4", "", -3},
+    {"min_int4", "", -3},
+    {"min_double4", "", -3},
+    {"max_int4", "", -3},
+    {"max_double4", "", -3},
+    {"dot_int4", "", -7},
+    {"dot_double4", "", -7},
+    {"shuffle_vector", "i", 0},
+    {"extract_vector", "i", -3},
+    {"int4_to_double4", "", 0},
+    {"double4_to_int4", "", 0},
+    {"jump", "i", 0},
+    {"table_switch", "i", -1},
+    {"lookup_switch", "i", -1},
+    {"select_int", "", -2},
+    {"select_double", "", -2},
 
 };
@@ -0,0 +1,417 @@
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../memory/MEM.h"
+#include "svm.h"
+
+/*
+ * parallel for. SVM_PARALLEL_FOR pops [lower, upper) and runs the code up
+ * to the matching SVM_PARALLEL_END once per index; its operand points at a
+ * descriptor in the constant pool:
+ *
+ *   loop variable, reduction count, (global, SVM_Reduction) per reduction
+ *
+ * The range is cut into at most PARALLEL_CHUNKS chunks whatever the number
+ * of threads. Each chunk runs on a private context holding a copy of the
+ * caller's globals, so the stacks and the body's own variables never leave
+ * the thread. Reduction variables start every chunk at their identity and
+ * are folded into the caller's value in chunk order, which keeps results
+ * (double sums included) the same for any number of threads.
+ *
+ * fork. SVM_FORK n is followed by n segments, each ending with SVM_JOIN.
+ * The compiler only puts segments side by side when none of them writes
+ * a global another one reads or writes, so they run concurrently on the
+ * caller's own globals and the result is that of running them in order.
+ *
+ * Both run as jobs on a pool of helper threads, started on first use and
+ * shared by the process, with the calling thread taking part. A job that
+ * starts while the pool is busy, e.g. a loop inside a forked segment or
+ * from a sweep worker, runs on the calling thread alone.
+ */
+#define PARALLEL_CHUNKS (64)
+
+typedef struct ParallelJob_tag ParallelJob;
+
+struct ParallelJob_tag {
+    SVM_Context *parent;
+    uint32_t chunk_count;
+    uint32_t next_chunk;
+    bool share_globals;  // run on the parent's globals instead of a copy
+    void (*run_chunk)(ParallelJob *job, SVM_Context *ctx, uint32_t chunk);
+    SVM_Status *status;  // of each chunk
+};
+
+typedef struct {
+    ParallelJob job;
+    uint32_t body_start;
+    uint32_t body_end;  // pc of SVM_PARALLEL_END
+    uint32_t loop_variable;
+    uint32_t reduction_count;
+    const SVM_Constant *reductions;  // (global, kind) pairs
+    int64_t lower;
+    int64_t upper;
+    int64_t chunk_size;
+    SVM_Value *partials;  // chunk_count * reduction_count
+} ParallelLoop;
+
+typedef struct {
+    ParallelJob job;
+    uint32_t *starts;  // first pc of each segment
+    uint32_t *ends;    // pc of its SVM_JOIN
+} ForkJob;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_idle = PTHREAD_COND_INITIALIZER;
+static uint32_t pool_workers = 0;  // requested, 0 = one per CPU
+static uint32_t pool_size = 0;     // helper threads running
+static pid_t pool_pid = 0;         // helpers do not survive fork()
+static ParallelJob *pool_job = NULL;
+static uint64_t pool_round = 0;
+static uint32_t pool_running = 0;  // helpers still on pool_job
+
+/*
+ * Threads taking part in a parallel for, the caller included. Takes effect
+ * when called before the first parallel for of the process.
+ */
+void svm_set_parallel_workers(uint32_t worker_count) {
+    pthread_mutex_lock(&pool_lock);
+    pool_workers = worker_count;
+    pthread_mutex_unlock(&pool_lock);
+}
+
+static SVM_Value reduction_identity(uint8_t type, SVM_Reduction kind) {
+    SVM_Value v;
+    memset(&v, 0, sizeof(v));  // an int global keeps clean upper bytes
+    if (type == SVM_DOUBLE) {
+        v.dval = (kind == SVM_REDUCE_SUM)   ? 0.0
+                 : (kind == SVM_REDUCE_MIN) ? INFINITY
+                                            : -INFINITY;
+    } else {
+        v.ival = (kind == SVM_REDUCE_SUM)   ? 0
+                 : (kind == SVM_REDUCE_MIN) ? INT_MAX
+                                            : INT_MIN;
+    }
+    return v;
+}
+
+static void reduce(uint8_t type, SVM_Reduction kind, SVM_Value *acc,
+                   SVM_Value v) {
+    if (type == SVM_DOUBLE) {
+        switch (kind) {
+            case SVM_REDUCE_SUM: {
+                acc->dval += v.dval;
+                break;
+            }
+            case SVM_REDUCE_MIN: {
+                if (v.dval < acc->dval) acc->dval = v.dval;
+                break;
+            }
+            default: {
+                if (v.dval > acc->dval) acc->dval = v.dval;
+                break;
+            }
+        }
+    } else {
+        switch (kind) {
+            case SVM_REDUCE_SUM: {
+                acc->ival = (int)((unsigned)acc->ival + (unsigned)v.ival);
+                break;
+            }
+            case SVM_REDUCE_MIN: {
+                if (v.ival < acc->ival) acc->ival = v.ival;
+                break;
+            }
+            default: {
+                if (v.ival > acc->ival) acc->ival = v.ival;
+                break;
+            }
+        }
+    }
+}
+
+static SVM_Status prepare_loop(SVM_Context *ctx, uint16_t desc,
+                               ParallelLoop *loop) {
+    const SVM_Program *program = ctx->program;
+    const SVM_Constant *c = &program->constant_pool[desc];
+    if ((uint32_t)desc + 2 > program->constant_pool_count ||
+        c[0].type != SVM_INT || c[1].type != SVM_INT || c[1].u.c_int < 0 ||
+        (uint32_t)desc + 2 + (uint32_t)c[1].u.c_int * 2 >
+            program->constant_pool_count) {
+        return SVM_ERROR_BAD_IMAGE;
+    }
+    loop->loop_variable = (uint32_t)c[0].u.c_int;
+    loop->reduction_count = (uint32_t)c[1].u.c_int;
+    loop->reductions = &c[2];
+    if (loop->loop_variable >= program->global_variable_count ||
+        program->global_variable_types[loop->loop_variable] != SVM_INT) {
+        return SVM_ERROR_BAD_IMAGE;
+    }
+    for (uint32_t r = 0; r < loop->reduction_count; ++r) {
+        const SVM_Constant *g = &loop->reductions[r * 2];
+        if (g[0].type != SVM_INT || g[1].type != SVM_INT ||
+            (uint32_t)g[0].u.c_int >= program->global_variable_count ||
+            g[1].u.c_int < SVM_REDUCE_SUM ||
+            g[1].u.c_int >= SVM_REDUCE_PLUS_ONE) {
+            return SVM_ERROR_BAD_IMAGE;
+        }
+    }
+
+    // the body ends at the next PARALLEL_END; loops do not nest
+    loop->body_start = ctx->pc;
+    for (uint32_t pc = ctx->pc; pc < program->code_size;) {
+        uint8_t op = program->code[pc];
+        if (op == SVM_PARALLEL_END) {
+            loop->body_end = pc;
+            return SVM_FINISHED;
+        }
+        if (op == SVM_PARALLEL_FOR) break;
+        pc += 1 + strlen(svm_opcode_info[op].parameter) * 2;
+    }
+    return SVM_ERROR_BAD_IMAGE;
+}
+
+static void run_loop_chunk(ParallelJob *job, SVM_Context *ctx,
+                           uint32_t chunk) {
+    ParallelLoop *loop = (ParallelLoop *)job;
+    const uint8_t *types = ctx->program->global_variable_types;
+    for (uint32_t r = 0; r < loop->reduction_count; ++r) {
+        uint32_t g = loop->reductions[r * 2].u.c_int;
+        ctx->global_variables[g] = reduction_identity(
+            types[g], (SVM_Reduction)loop->reductions[r * 2 + 1].u.c_int);
+    }
+
+    int64_t first = loop->lower + chunk * loop->chunk_size;
+    int64_t last = first + loop->chunk_size;
+    if (last > loop->upper) last = loop->upper;
+    SVM_Status status = SVM_FINISHED;
+    for (int64_t i = first; i < last && status == SVM_FINISHED; ++i) {
+        ctx->global_variables[loop->loop_variable].ival = (int)i;
+        ctx->pc = loop->body_start;
+        ctx->stop_pc = loop->body_end;
+        ctx->sp = 0;
+        ctx->pt_stack_count = 0;
+        ctx->status = SVM_FINISHED;
+        status = svm_run(ctx);
+    }
+
+    SVM_Value *partial = &loop->partials[chunk * loop->reduction_count];
+    for (uint32_t r = 0; r < loop->reduction_count; ++r) {
+        partial[r] = ctx->global_variables[loop->reductions[r * 2].u.c_int];
+    }
+    job->status[chunk] = status;
+}
+
+static void run_fork_chunk(ParallelJob *job, SVM_Context *ctx,
+                           uint32_t chunk) {
+    ForkJob *fork = (ForkJob *)job;
+    ctx->pc = fork->starts[chunk];
+    ctx->stop_pc = fork->ends[chunk];
+    ctx->sp = 0;
+    ctx->pt_stack_count = 0;
+    ctx->status = SVM_FINISHED;
+    job->status[chunk] = svm_run(ctx);
+}
+
+/* Take chunks until none is left. */
+static void run_participant(ParallelJob *job) {
+    SVM_Context *ctx = NULL;
+    SVM_Value *own_globals = NULL;
+    for (;;) {
+        uint32_t chunk =
+            __atomic_fetch_add(&job->next_chunk, 1, __ATOMIC_RELAXED);
+        if (chunk >= job->chunk_count) break;
+        if (ctx == NULL) {
+            const SVM_Context *parent = job->parent;
+            ctx = svm_create_context(parent->program);
+            ctx->out = parent->out;
+            ctx->arrays = parent->arrays;  // handles name the parent's arrays
+            ctx->strings = parent->strings;
+            ctx->maps = parent->maps;
+            if (job->share_globals) {
+                own_globals = ctx->global_variables;
+                ctx->global_variables = parent->global_variables;
+            } else {
+                memcpy(ctx->global_variables, parent->global_variables,
+                       sizeof(SVM_Value) *
+                           parent->program->global_variable_count);
+            }
+        }
+        job->run_chunk(job, ctx, chunk);
+    }
+    if (own_globals) ctx->global_variables = own_globals;
+    svm_delete_context(ctx);
+}
+
+static void *pool_thread(void *arg) {
+    uint64_t seen = 0;  // helpers start before the first round is posted
+    pthread_mutex_lock(&pool_lock);
+    for (;;) {
+        while (pool_round == seen) {
+            pthread_cond_wait(&pool_wake, &pool_lock);
+        }
+        seen = pool_round;
+        ParallelJob *job = pool_job;
+        pthread_mutex_unlock(&pool_lock);
+        run_participant(job);
+        pthread_mutex_lock(&pool_lock);
+        if (--pool_running == 0) pthread_cond_signal(&pool_idle);
+    }
+    return NULL;
+}
+
+/* Called with pool_lock held. */
+static void start_pool() {
+    uint32_t workers = pool_workers
+                           ? pool_workers
+                           : (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
+    pool_size = 0;
+    pool_job = NULL;
+    pool_round = 0;
+    pool_running = 0;
+    pool_pid = getpid();
+    for (uint32_t i = 1; i < workers; ++i) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, pool_thread, NULL) != 0) break;
+        pthread_detach(thread);
+        pool_size++;
+    }
+}
+
+/*
+ * Run every chunk of job, on the pool when it is free, and return the
+ * status of the first chunk that did not finish.
+ */
+static SVM_Status run_job(ParallelJob *job) {
+    pthread_mutex_lock(&pool_lock);
+    if (pool_pid != getpid()) start_pool();
+    bool shared = pool_job == NULL && pool_size > 0 && job->chunk_count > 1;
+    if (shared) {
+        pool_job = job;
+        pool_round++;
+        pool_running = pool_size;
+        pthread_cond_broadcast(&pool_wake);
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    run_participant(job);
+
+    if (shared) {
+        pthread_mutex_lock(&pool_lock);
+        while (pool_running > 0) {
+            pthread_cond_wait(&pool_idle, &pool_lock);
+        }
+        pool_job = NULL;
+        pthread_mutex_unlock(&pool_lock);
+    }
+
+    for (uint32_t chunk = 0; chunk < job->chunk_count; ++chunk) {
+        if (job->status[chunk] != SVM_FINISHED) return job->status[chunk];
+    }
+    return SVM_FINISHED;
+}
+
+/*
+ * Run the body that follows ctx->pc for every index in [lower, upper) and
+ * merge the reductions into ctx. On success ctx->pc is left on the
+ * matching SVM_PARALLEL_END; on failure the status of the first failing
+ * chunk is returned and the reductions are not merged.
+ */
+SVM_Status svm_parallel_for(SVM_Context *ctx, uint16_t desc, int lower,
+                            int upper) {
+    ParallelLoop loop;
+    SVM_Status status = prepare_loop(ctx, desc, &loop);
+    if (status != SVM_FINISHED) return status;
+    if (lower >= upper) {
+        ctx->pc = loop.body_end;
+        return SVM_FINISHED;
+    }
+
+    int64_t iterations = (int64_t)upper - lower;
+    ParallelJob *job = &loop.job;
+    job->parent = ctx;
+    job->next_chunk = 0;
+    job->share_globals = false;
+    job->run_chunk = run_loop_chunk;
+    loop.lower = lower;
+    loop.upper = upper;
+    job->chunk_count =
+        iterations < PARALLEL_CHUNKS ? (uint32_t)iterations : PARALLEL_CHUNKS;
+    loop.chunk_size = (iterations + job->chunk_count - 1) / job->chunk_count;
+    job->chunk_count =
+        (uint32_t)((iterations + loop.chunk_size - 1) / loop.chunk_size);
+    loop.partials = (SVM_Value *)malloc(
+        sizeof(SVM_Value) * (job->chunk_count * loop.reduction_count + 1));
+    job->status = (SVM_Status *)malloc(sizeof(SVM_Status) * job->chunk_count);
+
+    status = run_job(job);
+    if (status == SVM_FINISHED) {
+        const uint8_t *types = ctx->program->global_variable_types;
+        for (uint32_t r = 0; r < loop.reduction_count; ++r) {
+            uint32_t g = loop.reductions[r * 2].u.c_int;
+            SVM_Reduction kind =
+                (SVM_Reduction)loop.reductions[r * 2 + 1].u.c_int;
+            for (uint32_t chunk = 0; chunk < job->chunk_count; ++chunk) {
+                reduce(types[g], kind, &ctx->global_variables[g],
+                       loop.partials[chunk * loop.reduction_count + r]);
+            }
+        }
+        ctx->pc = loop.body_end;
+    }
+    free(loop.partials);
+    free(job->status);
+    return status;
+}
+
+/*
+ * Run the segment_count segments that follow ctx->pc concurrently. On
+ * success ctx->pc is left on the last segment's SVM_JOIN; on failure the
+ * status of the first failing segment is returned.
+ */
+SVM_Status svm_fork(SVM_Context *ctx, uint16_t segment_count) {
+    const SVM_Program *program = ctx->program;
+    ForkJob fork;
+    ParallelJob *job = &fork.job;
+    job->parent = ctx;
+    job->chunk_count = segment_count;
+    job->next_chunk = 0;
+    job->share_globals = true;
+    job->run_chunk = run_fork_chunk;
+    job->status = (SVM_Status *)malloc(sizeof(SVM_Status) *
+                                       (segment_count ? segment_count : 1));
+    fork.starts = (uint32_t *)malloc(sizeof(uint32_t) *
+                                     (segment_count ? segment_count : 1));
+    fork.ends = (uint32_t *)malloc(sizeof(uint32_t) *
+                                   (segment_count ? segment_count : 1));
+
+    // segments hold whole statements, so forks do not nest
+    SVM_Status status = SVM_FINISHED;
+    uint32_t pc = ctx->pc;
+    for (uint32_t k = 0; k < segment_count && status == SVM_FINISHED; ++k) {
+        fork.starts[k] = pc;
+        for (;;) {
+            if (pc >= program->code_size || program->code[pc] == SVM_FORK) {
+                status = SVM_ERROR_BAD_IMAGE;
+                break;
+            }
+            if (program->code[pc] == SVM_JOIN) {
+                fork.ends[k] = pc++;
+                break;
+            }
+            pc += 1 + strlen(svm_opcode_info[program->code[pc]].parameter) * 2;
+        }
+    }
+    if (status == SVM_FINISHED && segment_count > 0) {
+        status = run_job(job);
+        if (status == SVM_FINISHED) ctx->pc = fork.ends[segment_count - 1];
+    }
+    free(fork.ends);
+    free(fork.starts);
+    free(job->status);
+    return status;
+}
@@ -0,0 +1,70 @@
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "../memory/MEM.h"
+#include "svm.h"
+
+SVM_ContextPool *svm_create_context_pool(const SVM_Program *program,
+                                         uint32_t size) {
+    MEM_Controller controller = MEM_create_controller();
+    SVM_ContextPool *pool = (SVM_ContextPool *)MEM_controller_malloc(
+        controller, sizeof(SVM_ContextPool));
+    pool->controller = controller;
+    pool->program = program;
+    pthread_mutex_init(&pool->lock, NULL);
+    pool->capacity = size ? size : 1;
+    pool->free_list = (SVM_Context **)MEM_controller_malloc(
+        controller, sizeof(SVM_Context *) * pool->capacity);
+    for (pool->count = 0; pool->count < size; pool->count++) {
+        SVM_Context *ctx = svm_create_context(program);
+        svm_init(ctx);
+        pool->free_list[pool->count] = ctx;
+    }
+    return pool;
+}
+
+void svm_delete_context_pool(SVM_ContextPool *pool) {
+    if (!pool) return;
+    for (uint32_t i = 0; i < pool->count; ++i) {
+        svm_delete_context(pool->free_list[i]);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    MEM_Controller controller = pool->controller;
+    MEM_controller_free(controller, pool->free_list);
+    MEM_controller_free(controller, pool);
+    MEM_dispose_controller(controller);
+}
+
+/*
+ * Hand out an idle context, ready to run. Only when the pool is empty is a
+ * new context allocated; the pool then keeps it after release.
+ */
+SVM_Context *svm_acquire_context(SVM_ContextPool *pool) {
+    SVM_Context *ctx = NULL;
+    pthread_mutex_lock(&pool->lock);
+    if (pool->count > 0) {
+        ctx = pool->free_list[--pool->count];
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    if (ctx == NULL) {
+        ctx = svm_create_context(pool->program);
+        svm_init(ctx);
+    }
+    return ctx;
+}
+
+void svm_release_context(SVM_ContextPool *pool, SVM_Context *ctx) {
+    svm_init(ctx);
+    ctx->out = stdout;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->count == pool->capacity) {
+        pool->capacity *= 2;
+        pool->free_list = (SVM_Context **)MEM_controller_realloc(
+            pool->controller, pool->free_list,
+            sizeof(SVM_Context *) * pool->capacity);
+    }
+    pool->free_list[pool->count++] = ctx;
+    pthread_mutex_unlock(&pool->lock);
+}
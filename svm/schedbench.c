@@ -0,0 +1,127 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "svm.h"
+
+/*
+ * Runs many contexts of one program on the green-thread scheduler, checks
+ * that each ends exactly as a plain svm_run() does, and prints the
+ * scheduler metrics.
+ */
+
+int main(int argc, char *argv[]) {
+    int workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int contexts = 10000;
+    uint64_t slice = SVM_DEFAULT_SLICE;
+    int opt;
+    while ((opt = getopt(argc, argv, "w:n:q:")) != -1) {
+        switch (opt) {
+            case 'w': {
+                workers = atoi(optarg);
+                break;
+            }
+            case 'n': {
+                contexts = atoi(optarg);
+                break;
+            }
+            case 'q': {
+                slice = strtoull(optarg, NULL, 10);
+                break;
+            }
+            default: {
+                fprintf(stderr, "Usage ./svmsched [-w workers] [-n contexts] "
+                                "[-q slice] file.csb\n");
+                return 1;
+            }
+        }
+    }
+    if (optind >= argc || workers < 1 || contexts < 1) {
+        fprintf(stderr, "Usage ./svmsched [-w workers] [-n contexts] "
+                        "[-q slice] file.csb\n");
+        return 1;
+    }
+
+    struct stat st;
+    if (stat(argv[optind], &st) != 0) {
+        fprintf(stderr, "Cannot find file %s\n", argv[optind]);
+        return 1;
+    }
+    uint8_t *image = (uint8_t *)malloc(st.st_size);
+    int fd = open(argv[optind], O_RDONLY);
+    ssize_t len = read(fd, image, st.st_size);
+    close(fd);
+    SVM_Program *program = svm_create_program();
+    SVM_Status status = svm_load(program, image, len < 0 ? 0 : len);
+    free(image);
+    if (status != SVM_FINISHED) {
+        fprintf(stderr, "%s: %s\n", argv[optind], svm_status_message(status));
+        return 1;
+    }
+    add_native_functions(program);
+    FILE *out = fopen("/dev/null", "w");
+
+    SVM_Context *reference = svm_create_context(program);
+    reference->out = out;
+    svm_init(reference);
+    SVM_Status expected = svm_run(reference);
+
+    SVM_Context **ctxs =
+        (SVM_Context **)malloc(sizeof(SVM_Context *) * contexts);
+    SVM_Task **tasks = (SVM_Task **)malloc(sizeof(SVM_Task *) * contexts);
+    for (int i = 0; i < contexts; ++i) {
+        ctxs[i] = svm_create_context(program);
+        ctxs[i]->out = out;
+        svm_init(ctxs[i]);
+    }
+
+    SVM_Scheduler *scheduler = svm_create_scheduler(workers, slice);
+    for (int i = 0; i < contexts; ++i) {
+        tasks[i] = svm_scheduler_submit(scheduler, ctxs[i],
+                                        i % SVM_PRIORITY_PLUS_ONE);
+    }
+    svm_scheduler_wait(scheduler);
+
+    SVM_SchedulerMetrics metrics;
+    svm_scheduler_metrics(scheduler, &metrics);
+    int mismatches = 0;
+    for (int i = 0; i < contexts; ++i) {
+        if (svm_task_status(tasks[i]) != expected ||
+            !svm_same_globals(ctxs[i], reference)) {
+            mismatches++;
+        }
+        svm_task_release(scheduler, tasks[i]);
+    }
+
+    double seconds = metrics.elapsed_ns / 1e9;
+    printf("workers      %d\n", workers);
+    printf("contexts     %llu\n", (unsigned long long)metrics.completed);
+    printf("slices       %llu\n", (unsigned long long)metrics.slices);
+    printf("steals       %llu\n", (unsigned long long)metrics.steals);
+    printf("seconds      %.4f\n", seconds);
+    printf("contexts/sec %.0f\n", metrics.completed / seconds);
+    printf("latency mean %.0f ns\n",
+           (double)metrics.total_latency_ns / metrics.completed);
+    printf("latency p50  <= %llu ns\n",
+           (unsigned long long)svm_latency_percentile(&metrics, 50.0));
+    printf("latency p99  <= %llu ns\n",
+           (unsigned long long)svm_latency_percentile(&metrics, 99.0));
+    printf("latency max  %llu ns\n",
+           (unsigned long long)metrics.max_latency_ns);
+    if (mismatches) {
+        fprintf(stderr, "%d contexts differ from svm_run\n", mismatches);
+    }
+
+    svm_delete_scheduler(scheduler);
+    for (int i = 0; i < contexts; ++i) {
+        svm_delete_context(ctxs[i]);
+    }
+    svm_delete_context(reference);
+    free(tasks);
+    free(ctxs);
+    fclose(out);
+    svm_delete_program(program);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,391 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../memory/MEM.h"
+#include "svm.h"
+
+/*
+ * Green-thread scheduler. Every worker thread owns one deque per priority.
+ * The owner takes tasks from the bottom; idle workers steal from the top.
+ * A task runs for one slice of the instruction budget and, if suspended,
+ * goes back on top of its deque, behind everything the owner will run
+ * first. Since svm_run_slice() resumes exactly where it stopped, every
+ * context ends in the same state as it would under svm_run().
+ */
+
+struct SVM_Task_tag {
+    SVM_Context *ctx;
+    SVM_Priority priority;
+    SVM_Status status;
+    uint32_t slices;
+    uint64_t submit_ns;
+    uint64_t finish_ns;
+    bool done;
+    bool released;  // svm_task_release() came first, freed once done
+};
+
+typedef struct {
+    SVM_Task **tasks;  // ring buffer
+    uint32_t capacity;
+    uint32_t head;  // top, where thieves take and preempted tasks go
+    uint32_t count;
+} TaskDeque;
+
+typedef struct {
+    SVM_Scheduler *scheduler;
+    pthread_t thread;
+    pthread_mutex_t lock;  // guards deques and controller
+    MEM_Controller controller;
+    TaskDeque deques[SVM_PRIORITY_PLUS_ONE];
+    uint32_t queued;  // tasks in deques, read without lock as a hint
+    SVM_SchedulerMetrics metrics;
+} Worker;
+
+struct SVM_Scheduler_tag {
+    MEM_Controller controller;  // tasks, guarded by lock
+    pthread_mutex_t lock;
+    pthread_cond_t wake;  // tasks were queued or stopping was set
+    pthread_cond_t idle;  // pending dropped to 0
+    uint32_t worker_count;
+    Worker *workers;
+    uint64_t slice;
+    uint32_t next_worker;
+    uint32_t queued;    // tasks in all deques
+    uint32_t sleepers;  // workers blocked on wake
+    uint64_t pending;   // submitted but not finished
+    bool stopping;
+    uint64_t start_ns;
+};
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void deque_reserve(Worker *worker, TaskDeque *deque) {
+    if (deque->count < deque->capacity) return;
+
+    uint32_t capacity = deque->capacity ? deque->capacity * 2 : 16;
+    SVM_Task **tasks = (SVM_Task **)MEM_controller_malloc(
+        worker->controller, sizeof(SVM_Task *) * capacity);
+    for (uint32_t i = 0; i < deque->count; ++i) {
+        tasks[i] = deque->tasks[(deque->head + i) % deque->capacity];
+    }
+    if (deque->tasks) {
+        MEM_controller_free(worker->controller, deque->tasks);
+    }
+    deque->tasks = tasks;
+    deque->capacity = capacity;
+    deque->head = 0;
+}
+
+static void deque_push_bottom(Worker *worker, TaskDeque *deque,
+                              SVM_Task *task) {
+    deque_reserve(worker, deque);
+    deque->tasks[(deque->head + deque->count) % deque->capacity] = task;
+    deque->count++;
+}
+
+static void deque_push_top(Worker *worker, TaskDeque *deque, SVM_Task *task) {
+    deque_reserve(worker, deque);
+    deque->head = (deque->head + deque->capacity - 1) % deque->capacity;
+    deque->tasks[deque->head] = task;
+    deque->count++;
+}
+
+static SVM_Task *deque_pop_bottom(TaskDeque *deque) {
+    if (deque->count == 0) return NULL;
+    deque->count--;
+    return deque->tasks[(deque->head + deque->count) % deque->capacity];
+}
+
+static SVM_Task *deque_pop_top(TaskDeque *deque) {
+    if (deque->count == 0) return NULL;
+    SVM_Task *task = deque->tasks[deque->head];
+    deque->head = (deque->head + 1) % deque->capacity;
+    deque->count--;
+    return task;
+}
+
+static void wake_sleepers(SVM_Scheduler *scheduler) {
+    if (__atomic_load_n(&scheduler->sleepers, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&scheduler->lock);
+        pthread_cond_signal(&scheduler->wake);
+        pthread_mutex_unlock(&scheduler->lock);
+    }
+}
+
+static void enqueue(SVM_Scheduler *scheduler, Worker *worker, SVM_Task *task,
+                    bool preempted) {
+    pthread_mutex_lock(&worker->lock);
+    if (preempted) {
+        deque_push_top(worker, &worker->deques[task->priority], task);
+    } else {
+        deque_push_bottom(worker, &worker->deques[task->priority], task);
+    }
+    __atomic_add_fetch(&worker->queued, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&worker->lock);
+
+    __atomic_add_fetch(&scheduler->queued, 1, __ATOMIC_SEQ_CST);
+    wake_sleepers(scheduler);
+}
+
+static SVM_Task *take_from(Worker *victim, SVM_Priority priority,
+                           bool steal) {
+    if (__atomic_load_n(&victim->queued, __ATOMIC_RELAXED) == 0) return NULL;
+
+    pthread_mutex_lock(&victim->lock);
+    SVM_Task *task = steal ? deque_pop_top(&victim->deques[priority])
+                           : deque_pop_bottom(&victim->deques[priority]);
+    if (task) {
+        __atomic_sub_fetch(&victim->queued, 1, __ATOMIC_SEQ_CST);
+    }
+    pthread_mutex_unlock(&victim->lock);
+    return task;
+}
+
+/* Highest priority first; own deque before stealing at each priority. */
+static SVM_Task *find_task(SVM_Scheduler *scheduler, Worker *worker) {
+    uint32_t self = worker - scheduler->workers;
+    for (int priority = 0; priority < SVM_PRIORITY_PLUS_ONE; ++priority) {
+        SVM_Task *task = take_from(worker, priority, false);
+        for (uint32_t i = 1; !task && i < scheduler->worker_count; ++i) {
+            Worker *victim =
+                &scheduler->workers[(self + i) % scheduler->worker_count];
+            if ((task = take_from(victim, priority, true))) {
+                __atomic_add_fetch(&worker->metrics.steals, 1,
+                                   __ATOMIC_RELAXED);
+            }
+        }
+        if (task) {
+            __atomic_sub_fetch(&scheduler->queued, 1, __ATOMIC_SEQ_CST);
+            return task;
+        }
+    }
+    return NULL;
+}
+
+static void finish_task(SVM_Scheduler *scheduler, Worker *worker,
+                        SVM_Task *task, SVM_Status status) {
+    SVM_SchedulerMetrics *metrics = &worker->metrics;
+    task->status = status;
+    task->finish_ns = now_ns();
+
+    uint64_t latency = task->finish_ns - task->submit_ns;
+    int bucket = 0;
+    while (bucket < SVM_LATENCY_BUCKETS - 1 && (latency >> (bucket + 1))) {
+        bucket++;
+    }
+    __atomic_add_fetch(&metrics->completed, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&metrics->total_latency_ns, latency, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&metrics->latency_histogram[bucket], 1,
+                       __ATOMIC_RELAXED);
+    if (latency > metrics->max_latency_ns) {
+        __atomic_store_n(&metrics->max_latency_ns, latency, __ATOMIC_RELAXED);
+    }
+
+    pthread_mutex_lock(&scheduler->lock);
+    task->done = true;
+    if (task->released) {
+        MEM_controller_free(scheduler->controller, task);
+    }
+    if (--scheduler->pending == 0) {
+        pthread_cond_broadcast(&scheduler->idle);
+    }
+    pthread_mutex_unlock(&scheduler->lock);
+}
+
+static void *worker_main(void *arg) {
+    Worker *worker = (Worker *)arg;
+    SVM_Scheduler *scheduler = worker->scheduler;
+
+    for (;;) {
+        SVM_Task *task = find_task(scheduler, worker);
+        if (task == NULL) {
+            pthread_mutex_lock(&scheduler->lock);
+            __atomic_add_fetch(&scheduler->sleepers, 1, __ATOMIC_SEQ_CST);
+            while (__atomic_load_n(&scheduler->queued, __ATOMIC_SEQ_CST) ==
+                       0 &&
+                   !scheduler->stopping) {
+                pthread_cond_wait(&scheduler->wake, &scheduler->lock);
+            }
+            __atomic_sub_fetch(&scheduler->sleepers, 1, __ATOMIC_SEQ_CST);
+            bool stop = scheduler->stopping && scheduler->queued == 0;
+            pthread_mutex_unlock(&scheduler->lock);
+            if (stop) break;
+            continue;
+        }
+
+        SVM_Status status = svm_run_slice(task->ctx, scheduler->slice, 0);
+        task->slices++;
+        __atomic_add_fetch(&worker->metrics.slices, 1, __ATOMIC_RELAXED);
+        if (status == SVM_PENDING) {
+            // the event loop parks it instead; here the worker waits
+            status = svm_wait_completion(task->ctx);
+        }
+        if (status == SVM_SUSPENDED) {
+            enqueue(scheduler, worker, task, true);
+        } else {
+            finish_task(scheduler, worker, task, status);
+        }
+    }
+    return NULL;
+}
+
+SVM_Scheduler *svm_create_scheduler(uint32_t worker_count, uint64_t slice) {
+    MEM_Controller controller = MEM_create_controller();
+    SVM_Scheduler *scheduler = (SVM_Scheduler *)MEM_controller_malloc(
+        controller, sizeof(SVM_Scheduler));
+    memset(scheduler, 0, sizeof(SVM_Scheduler));
+    scheduler->controller = controller;
+    pthread_mutex_init(&scheduler->lock, NULL);
+    pthread_cond_init(&scheduler->wake, NULL);
+    pthread_cond_init(&scheduler->idle, NULL);
+    scheduler->worker_count = worker_count ? worker_count : 1;
+    scheduler->slice = slice ? slice : SVM_DEFAULT_SLICE;
+    scheduler->start_ns = now_ns();
+
+    scheduler->workers = (Worker *)MEM_controller_malloc(
+        controller, sizeof(Worker) * scheduler->worker_count);
+    memset(scheduler->workers, 0, sizeof(Worker) * scheduler->worker_count);
+    for (uint32_t i = 0; i < scheduler->worker_count; ++i) {
+        Worker *worker = &scheduler->workers[i];
+        worker->scheduler = scheduler;
+        worker->controller = MEM_create_controller();
+        pthread_mutex_init(&worker->lock, NULL);
+    }
+    for (uint32_t i = 0; i < scheduler->worker_count; ++i) {
+        Worker *worker = &scheduler->workers[i];
+        pthread_create(&worker->thread, NULL, worker_main, worker);
+    }
+    return scheduler;
+}
+
+/* Stop the workers once every submitted task has finished. */
+void svm_delete_scheduler(SVM_Scheduler *scheduler) {
+    if (!scheduler) return;
+    svm_scheduler_wait(scheduler);
+
+    pthread_mutex_lock(&scheduler->lock);
+    scheduler->stopping = true;
+    pthread_cond_broadcast(&scheduler->wake);
+    pthread_mutex_unlock(&scheduler->lock);
+
+    for (uint32_t i = 0; i < scheduler->worker_count; ++i) {
+        Worker *worker = &scheduler->workers[i];
+        pthread_join(worker->thread, NULL);
+        pthread_mutex_destroy(&worker->lock);
+        MEM_dispose_controller(worker->controller);
+    }
+    pthread_cond_destroy(&scheduler->idle);
+    pthread_cond_destroy(&scheduler->wake);
+    pthread_mutex_destroy(&scheduler->lock);
+    // unreleased tasks are freed along with the controller
+    MEM_dispose_controller(scheduler->controller);
+}
+
+/*
+ * Queue ctx to run to completion. The context must have been initialised
+ * or restored, and stays owned by the caller; it must not be touched until
+ * svm_task_done() reports true. The task belongs to the scheduler: hand
+ * it back with svm_task_release() once its results have been read.
+ */
+SVM_Task *svm_scheduler_submit(SVM_Scheduler *scheduler, SVM_Context *ctx,
+                               SVM_Priority priority) {
+    pthread_mutex_lock(&scheduler->lock);
+    SVM_Task *task = (SVM_Task *)MEM_controller_malloc(scheduler->controller,
+                                                       sizeof(SVM_Task));
+    scheduler->pending++;
+    uint32_t target = scheduler->next_worker++ % scheduler->worker_count;
+    pthread_mutex_unlock(&scheduler->lock);
+
+    task->ctx = ctx;
+    task->priority = (priority < SVM_PRIORITY_PLUS_ONE) ? priority
+                                                        : SVM_PRIORITY_LOW;
+    task->status = SVM_SUSPENDED;
+    task->slices = 0;
+    task->submit_ns = now_ns();
+    task->finish_ns = 0;
+    task->done = false;
+    task->released = false;
+
+    Worker *worker = &scheduler->workers[target];
+    __atomic_add_fetch(&worker->metrics.submitted, 1, __ATOMIC_RELAXED);
+    enqueue(scheduler, worker, task, false);
+    return task;
+}
+
+void svm_scheduler_wait(SVM_Scheduler *scheduler) {
+    pthread_mutex_lock(&scheduler->lock);
+    while (scheduler->pending > 0) {
+        pthread_cond_wait(&scheduler->idle, &scheduler->lock);
+    }
+    pthread_mutex_unlock(&scheduler->lock);
+}
+
+bool svm_task_done(SVM_Scheduler *scheduler, SVM_Task *task) {
+    pthread_mutex_lock(&scheduler->lock);
+    bool done = task->done;
+    pthread_mutex_unlock(&scheduler->lock);
+    return done;
+}
+
+/*
+ * Give a task back to the scheduler; the handle must not be used again.
+ * A finished task is freed now, a running one as soon as it finishes.
+ */
+void svm_task_release(SVM_Scheduler *scheduler, SVM_Task *task) {
+    pthread_mutex_lock(&scheduler->lock);
+    if (task->done) {
+        MEM_controller_free(scheduler->controller, task);
+    } else {
+        task->released = true;
+    }
+    pthread_mutex_unlock(&scheduler->lock);
+}
+
+SVM_Status svm_task_status(SVM_Task *task) { return task->status; }
+
+uint64_t svm_task_latency(SVM_Task *task) {
+    return task->finish_ns - task->submit_ns;
+}
+
+void svm_scheduler_metrics(SVM_Scheduler *scheduler,
+                           SVM_SchedulerMetrics *metrics) {
+    memset(metrics, 0, sizeof(SVM_SchedulerMetrics));
+    for (uint32_t i = 0; i < scheduler->worker_count; ++i) {
+        SVM_SchedulerMetrics *m = &scheduler->workers[i].metrics;
+        metrics->submitted += __atomic_load_n(&m->submitted, __ATOMIC_RELAXED);
+        metrics->completed += __atomic_load_n(&m->completed, __ATOMIC_RELAXED);
+        metrics->slices += __atomic_load_n(&m->slices, __ATOMIC_RELAXED);
+        metrics->steals += __atomic_load_n(&m->steals, __ATOMIC_RELAXED);
+        metrics->total_latency_ns +=
+            __atomic_load_n(&m->total_latency_ns, __ATOMIC_RELAXED);
+        uint64_t max = __atomic_load_n(&m->max_latency_ns, __ATOMIC_RELAXED);
+        if (max > metrics->max_latency_ns) metrics->max_latency_ns = max;
+        for (int b = 0; b < SVM_LATENCY_BUCKETS; ++b) {
+            metrics->latency_histogram[b] += __atomic_load_n(
+                &m->latency_histogram[b], __ATOMIC_RELAXED);
+        }
+    }
+    metrics->elapsed_ns = now_ns() - scheduler->start_ns;
+}
+
+/* Upper bound of the histogram bucket holding the given percentile. */
+uint64_t svm_latency_percentile(const SVM_SchedulerMetrics *metrics,
+                                double percentile) {
+    uint64_t rank = (uint64_t)(metrics->completed * percentile / 100.0);
+    uint64_t seen = 0;
+    for (int b = 0; b < SVM_LATENCY_BUCKETS; ++b) {
+        seen += metrics->latency_histogram[b];
+        if (seen > rank) {
+            return (b + 1 < SVM_LATENCY_BUCKETS) ? (1ULL << (b + 1))
+                                                 : UINT64_MAX;
+        }
+    }
+    return metrics->max_latency_ns;
+}
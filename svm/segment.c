@@ -0,0 +1,135 @@
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "svm.h"
+
+/*
+ * Global segment: the globals of a context live in a shared file or POSIX
+ * shared memory object, so another process can fill inputs and read
+ * results in place. The layout is published at the front of the mapping:
+ *
+ *   SegmentHeader
+ *   SegmentEntry entries[global_count]
+ *   SVM_Value    globals[global_count]     at data_offset
+ *
+ * data_offset is a multiple of 64 and every global is an 8-byte
+ * SVM_Value: ival for int and boolean, dval for double. A path of the
+ * form "shm:name" names a shared memory object instead of a file.
+ */
+#define SEGMENT_MAGIC "CSUASEGM"
+#define SEGMENT_VERSION (1)
+#define SEGMENT_NAME_SIZE (56)
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t global_count;
+    uint64_t program_hash;
+    uint64_t data_offset;
+    uint64_t size;  // of the whole segment
+} SegmentHeader;
+
+typedef struct {
+    uint32_t type;    // SVM_INT or SVM_DOUBLE
+    uint32_t offset;  // of the value, from data_offset
+    char name[SEGMENT_NAME_SIZE];  // empty when the image has no names
+} SegmentEntry;
+
+static size_t segment_data_offset(uint32_t count) {
+    size_t offset = sizeof(SegmentHeader) + sizeof(SegmentEntry) * count;
+    return (offset + 63) & ~(size_t)63;
+}
+
+static int open_segment(const char *path) {
+    if (!strncmp(path, "shm:", 4)) {
+        char name[256];
+        snprintf(name, sizeof(name), "/%s", path + 4);
+        return shm_open(name, O_RDWR | O_CREAT, 0644);
+    }
+    return open(path, O_RDWR | O_CREAT, 0644);
+}
+
+static bool segment_matches(const SegmentHeader *header,
+                            const SVM_Program *program, size_t size) {
+    return memcmp(header->magic, SEGMENT_MAGIC, 8) == 0 &&
+           header->version == SEGMENT_VERSION &&
+           header->global_count == program->global_variable_count &&
+           header->program_hash == svm_program_hash(program) &&
+           header->size == size;
+}
+
+static void publish_layout(SegmentHeader *header, const SVM_Program *program,
+                           size_t data_offset, size_t size) {
+    SegmentEntry *entries = (SegmentEntry *)(header + 1);
+    for (uint32_t i = 0; i < program->global_variable_count; ++i) {
+        entries[i].type = program->global_variable_types[i];
+        entries[i].offset = sizeof(SVM_Value) * i;
+        memset(entries[i].name, 0, SEGMENT_NAME_SIZE);
+        if (program->global_variable_names) {
+            strncpy(entries[i].name, program->global_variable_names[i],
+                    SEGMENT_NAME_SIZE - 1);
+        }
+    }
+    memcpy(header->magic, SEGMENT_MAGIC, 8);
+    header->version = SEGMENT_VERSION;
+    header->global_count = program->global_variable_count;
+    header->program_hash = svm_program_hash(program);
+    header->data_offset = data_offset;
+    header->size = size;
+}
+
+/*
+ * Move the globals of ctx into the segment at path. A segment already
+ * published for the same program keeps its values, which is how another
+ * process prefills inputs; anything else is rewritten with the current
+ * globals of ctx. Call after svm_init, since svm_init resets the globals.
+ */
+SVM_Status svm_map_globals(SVM_Context *ctx, const char *path) {
+    const SVM_Program *program = ctx->program;
+    if (ctx->segment) return SVM_ERROR_IO;
+
+    size_t data_offset = segment_data_offset(program->global_variable_count);
+    size_t size =
+        data_offset + sizeof(SVM_Value) * program->global_variable_count;
+    int fd = open_segment(path);
+    if (fd < 0) return SVM_ERROR_IO;
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        ((size_t)st.st_size != size && ftruncate(fd, size) != 0)) {
+        close(fd);
+        return SVM_ERROR_IO;
+    }
+    uint8_t *base = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+                                    MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return SVM_ERROR_IO;
+
+    SegmentHeader *header = (SegmentHeader *)base;
+    SVM_Value *globals = (SVM_Value *)(base + data_offset);
+    if (!segment_matches(header, program, size)) {
+        memcpy(globals, ctx->global_variables,
+               sizeof(SVM_Value) * program->global_variable_count);
+        publish_layout(header, program, data_offset, size);
+    }
+
+    MEM_controller_free(ctx->controller, ctx->global_variables);
+    ctx->global_variables = globals;
+    ctx->segment = base;
+    ctx->segment_size = size;
+    return SVM_FINISHED;
+}
+
+/* Flush the segment of ctx to its file, e.g. after a run finishes. */
+SVM_Status svm_sync_globals(SVM_Context *ctx) {
+    if (!ctx->segment) return SVM_FINISHED;
+    if (msync(ctx->segment, ctx->segment_size, MS_SYNC) != 0) {
+        return SVM_ERROR_IO;
+    }
+    return SVM_FINISHED;
+}
@@ -0,0 +1,402 @@
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "svm.h"
+
+/*
+ * Snapshot file layout. Everything after the header is 8-byte aligned so
+ * a mapped snapshot can be read in place:
+ *
+ *   SnapshotHeader
+ *   SVM_Value globals[global_variable_count]
+ *   SVM_Value stack[sp]
+ *   uint64_t  pt_stack[pt_stack_count]
+ *   SnapshotArray per array, each followed by its data padded to 8 bytes
+ *   uint8_t   string arena[arena_used], padded to 8 bytes
+ *   SnapshotMap per map, each followed by its keys and values padded
+ *   uint8_t   stack_value_type[sp]
+ */
+#define SNAPSHOT_MAGIC "CSUASNAP"
+#define SNAPSHOT_VERSION (5)
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t status;
+    uint64_t program_hash;
+    uint32_t pc;
+    uint32_t sp;
+    uint32_t pt_stack_count;
+    uint32_t global_variable_count;
+    uint32_t array_count;
+    uint64_t array_bytes;  // every SnapshotArray and its padded data
+    uint32_t arena_used;
+    uint32_t map_count;
+    uint64_t map_bytes;  // every SnapshotMap and its padded table
+} SnapshotHeader;
+
+typedef struct {
+    uint32_t type;
+    uint32_t length;
+    uint32_t stride;  // of a record array, 0 otherwise
+    uint32_t padding;
+} SnapshotArray;
+
+typedef struct {
+    uint32_t type;
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t has_empty_key;
+    SVM_Value empty_value;
+} SnapshotMap;
+
+static size_t padded(size_t size) { return (size + 7) & ~(size_t)7; }
+
+static size_t array_data_size(const SVM_Array *a) {
+    return padded(svm_array_size(a));
+}
+
+static size_t map_keys_size(uint32_t capacity) {
+    return padded((size_t)capacity * sizeof(int32_t));
+}
+
+static size_t map_values_size(uint32_t type, uint32_t capacity) {
+    return padded((size_t)capacity *
+                  (type == SVM_DOUBLE ? sizeof(double) : sizeof(int32_t)));
+}
+
+static uint64_t fnv_add(uint64_t hash, const void *data, size_t size) {
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/* Identity of a program: FNV-1a over everything loaded from the image. */
+uint64_t svm_program_hash(const SVM_Program *program) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    hash = fnv_add(hash, &program->constant_pool_count, sizeof(uint32_t));
+    for (int i = 0; i < program->constant_pool_count; ++i) {
+        SVM_Constant *c = &program->constant_pool[i];
+        hash = fnv_add(hash, &c->type, sizeof(c->type));
+        if (c->type == SVM_INT) {
+            hash = fnv_add(hash, &c->u.c_int, sizeof(int));
+        } else {
+            hash = fnv_add(hash, &c->u.c_double, sizeof(double));
+        }
+    }
+    hash = fnv_add(hash, &program->global_variable_count, sizeof(uint32_t));
+    hash = fnv_add(hash, program->global_variable_types,
+                   program->global_variable_count);
+    hash = fnv_add(hash, &program->code_size, sizeof(uint32_t));
+    hash = fnv_add(hash, program->code, program->code_size);
+    hash = fnv_add(hash, &program->stack_size, sizeof(uint32_t));
+    hash = fnv_add(hash, &program->pt_stack_size, sizeof(uint32_t));
+    hash = fnv_add(hash, &program->string_count, sizeof(uint32_t));
+    for (uint32_t i = 0; i < program->string_count; ++i) {
+        hash = fnv_add(hash, program->strings[i].data,
+                       program->strings[i].length + 1);
+    }
+    return hash;
+}
+
+static size_t snapshot_size(const SnapshotHeader *header) {
+    return sizeof(SnapshotHeader) +
+           sizeof(SVM_Value) * (header->global_variable_count + header->sp) +
+           sizeof(uint64_t) * header->pt_stack_count + header->array_bytes +
+           padded(header->arena_used) + header->map_bytes + header->sp;
+}
+
+/*
+ * Save ctx to path. Only valid at a safe point, i.e. before the first
+ * slice or between slices, where pc sits on a segment boundary. The file
+ * is written aside and renamed so a crash never leaves a torn snapshot.
+ */
+SVM_Status svm_save_snapshot(SVM_Context *ctx, const char *path) {
+    if (ctx->status != SVM_FINISHED && ctx->status != SVM_SUSPENDED) {
+        return ctx->status;
+    }
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, 8);
+    header.version = SNAPSHOT_VERSION;
+    header.status = ctx->status;
+    header.program_hash = svm_program_hash(ctx->program);
+    header.pc = ctx->pc;
+    header.sp = ctx->sp;
+    header.pt_stack_count = ctx->pt_stack_count;
+    header.global_variable_count = ctx->program->global_variable_count;
+    header.array_count = ctx->arrays->count;
+    for (uint32_t i = 0; i < header.array_count; ++i) {
+        SVM_Array *a = &ctx->arrays->arrays[i];
+        header.array_bytes +=
+            sizeof(SnapshotArray) + array_data_size(a);
+    }
+    header.arena_used = ctx->strings->used;
+    header.map_count = ctx->maps->count;
+    for (uint32_t i = 0; i < header.map_count; ++i) {
+        SVM_Map *m = &ctx->maps->maps[i];
+        header.map_bytes += sizeof(SnapshotMap) + map_keys_size(m->capacity) +
+                            map_values_size(m->type, m->capacity);
+    }
+
+    size_t len = strlen(path);
+    char *tmp_path = (char *)malloc(len + 5);
+    memcpy(tmp_path, path, len);
+    strcpy(tmp_path + len, ".tmp");
+
+    FILE *fp = fopen(tmp_path, "wb");
+    if (fp == NULL) {
+        free(tmp_path);
+        return SVM_ERROR_IO;
+    }
+    fwrite(&header, sizeof(header), 1, fp);
+    fwrite(ctx->global_variables, sizeof(SVM_Value),
+           header.global_variable_count, fp);
+    fwrite(ctx->stack, sizeof(SVM_Value), header.sp, fp);
+    for (uint32_t i = 0; i < header.pt_stack_count; ++i) {
+        uint64_t pt = ctx->pt_stack[i];
+        fwrite(&pt, sizeof(uint64_t), 1, fp);
+    }
+    static const uint8_t padding[8];
+    for (uint32_t i = 0; i < header.array_count; ++i) {
+        SVM_Array *a = &ctx->arrays->arrays[i];
+        SnapshotArray record = {a->type, a->length, a->stride, 0};
+        size_t size = svm_array_size(a);
+        fwrite(&record, sizeof(record), 1, fp);
+        fwrite(a->data, 1, size, fp);
+        fwrite(padding, 1, array_data_size(a) - size, fp);
+    }
+    fwrite(ctx->strings->bytes, 1, header.arena_used, fp);
+    fwrite(padding, 1, padded(header.arena_used) - header.arena_used, fp);
+    for (uint32_t i = 0; i < header.map_count; ++i) {
+        SVM_Map *m = &ctx->maps->maps[i];
+        SnapshotMap record = {m->type, m->capacity, m->count,
+                              m->has_empty_key, m->empty_value};
+        size_t keys = (size_t)m->capacity * sizeof(int32_t);
+        size_t values = (size_t)m->capacity *
+                        (m->type == SVM_DOUBLE ? sizeof(double) : sizeof(int));
+        fwrite(&record, sizeof(record), 1, fp);
+        fwrite(m->keys, 1, keys, fp);
+        fwrite(padding, 1, map_keys_size(m->capacity) - keys, fp);
+        fwrite(m->values, 1, values, fp);
+        fwrite(padding, 1, map_values_size(m->type, m->capacity) - values,
+               fp);
+    }
+    fwrite(ctx->stack_value_type, sizeof(uint8_t), header.sp, fp);
+
+    bool ok = !ferror(fp) && fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        free(tmp_path);
+        return SVM_ERROR_IO;
+    }
+    free(tmp_path);
+    return SVM_FINISHED;
+}
+
+static bool check_header(const SVM_Context *ctx, const SnapshotHeader *header,
+                         size_t size) {
+    const SVM_Program *program = ctx->program;
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, 8) != 0 ||
+        header->version != SNAPSHOT_VERSION) {
+        return false;
+    }
+    if (header->status != SVM_FINISHED && header->status != SVM_SUSPENDED) {
+        return false;
+    }
+    if (header->global_variable_count != program->global_variable_count ||
+        header->pc > program->code_size || header->sp > program->stack_size ||
+        header->pt_stack_count > program->pt_stack_size) {
+        return false;
+    }
+    if (snapshot_size(header) != size) {
+        return false;
+    }
+    return header->program_hash == svm_program_hash(program);
+}
+
+/* Whether the arrays saved at pos can all be restored. */
+static bool check_arrays(const SnapshotHeader *header, const uint8_t *pos) {
+    const uint8_t *end = pos + header->array_bytes;
+    if (header->array_count >= INT32_MAX) return false;
+    for (uint32_t i = 0; i < header->array_count; ++i) {
+        const SnapshotArray *record = (const SnapshotArray *)pos;
+        if (end - pos < sizeof(SnapshotArray) ||
+            (record->type != SVM_INT && record->type != SVM_DOUBLE) ||
+            record->length > INT32_MAX || record->stride > UINT16_MAX ||
+            (uint64_t)record->length * record->stride > INT32_MAX) {
+            return false;
+        }
+        SVM_Array saved = {record->type, record->length, record->stride};
+        size_t size = array_data_size(&saved);
+        pos += sizeof(SnapshotArray);
+        if (end - pos < size) return false;
+        pos += size;
+    }
+    return pos == end;
+}
+
+/* Replace the arrays of ctx with those saved at pos, once checked. */
+static bool restore_arrays(SVM_Context *ctx, const SnapshotHeader *header,
+                           const uint8_t *pos) {
+    svm_free_arrays(ctx->arrays);
+    for (uint32_t i = 0; i < header->array_count; ++i) {
+        const SnapshotArray *record = (const SnapshotArray *)pos;
+        SVM_Array saved = {record->type, record->length, record->stride};
+        pos += sizeof(SnapshotArray);
+        int handle;
+        if (record->stride) {
+            handle = svm_new_record_array(ctx->arrays, record->stride,
+                                          record->length);
+        } else {
+            handle = svm_new_array(ctx->arrays, record->type, record->length);
+        }
+        if (handle == 0) return false;
+        SVM_Array *a = &ctx->arrays->arrays[handle - 1];
+        memcpy(a->data, pos, svm_array_size(a));
+        pos += array_data_size(&saved);
+    }
+    return true;
+}
+
+/* Replace the string arena of ctx with the one saved at pos. */
+static void restore_strings(SVM_Context *ctx, const SnapshotHeader *header,
+                            const uint8_t *pos) {
+    SVM_StringArena *arena = ctx->strings;
+    if (arena->capacity < header->arena_used) {
+        arena->bytes = (uint8_t *)MEM_controller_realloc(
+            arena->controller, arena->bytes, header->arena_used);
+        arena->capacity = header->arena_used;
+    }
+    if (header->arena_used) memcpy(arena->bytes, pos, header->arena_used);
+    arena->used = header->arena_used;
+}
+
+/* Whether the maps saved at pos can all be restored. */
+static bool check_maps(const SnapshotHeader *header, const uint8_t *pos) {
+    const uint8_t *end = pos + header->map_bytes;
+    if (header->map_count >= INT32_MAX) return false;
+    for (uint32_t i = 0; i < header->map_count; ++i) {
+        const SnapshotMap *record = (const SnapshotMap *)pos;
+        if (end - pos < sizeof(SnapshotMap) ||
+            (record->type != SVM_INT && record->type != SVM_DOUBLE) ||
+            (record->capacity & (record->capacity - 1)) ||
+            record->count > record->capacity + 1) {
+            return false;
+        }
+        size_t keys = map_keys_size(record->capacity);
+        size_t values = map_values_size(record->type, record->capacity);
+        pos += sizeof(SnapshotMap);
+        if (end - pos < keys + values) return false;
+        pos += keys + values;
+    }
+    return pos == end;
+}
+
+/* Replace the maps of ctx with those saved at pos, once checked. */
+static bool restore_maps(SVM_Context *ctx, const SnapshotHeader *header,
+                         const uint8_t *pos) {
+    svm_free_maps(ctx->maps);
+    for (uint32_t i = 0; i < header->map_count; ++i) {
+        const SnapshotMap *record = (const SnapshotMap *)pos;
+        size_t keys = map_keys_size(record->capacity);
+        size_t values = map_values_size(record->type, record->capacity);
+        pos += sizeof(SnapshotMap);
+        int handle = svm_new_map(ctx->maps, record->type);
+        if (handle == 0) return false;
+        SVM_Map *m = &ctx->maps->maps[handle - 1];
+        if (record->capacity) {
+            svm_map_alloc(ctx->maps, m, record->capacity);
+            memcpy(m->keys, pos, (size_t)m->capacity * sizeof(int32_t));
+            memcpy(m->values, pos + keys,
+                   (size_t)m->capacity * (m->type == SVM_DOUBLE
+                                              ? sizeof(double)
+                                              : sizeof(int)));
+        }
+        m->count = record->count;
+        m->has_empty_key = record->has_empty_key != 0;
+        m->empty_value = record->empty_value;
+        pos += keys + values;
+    }
+    return true;
+}
+
+/*
+ * Restore ctx from a snapshot taken of the same program. The file is
+ * mapped rather than read, so only the pages holding live state are
+ * touched.
+ */
+SVM_Status svm_restore_snapshot(SVM_Context *ctx, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return SVM_ERROR_IO;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < sizeof(SnapshotHeader)) {
+        close(fd);
+        return SVM_ERROR_BAD_SNAPSHOT;
+    }
+    uint8_t *base =
+        (uint8_t *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return SVM_ERROR_IO;
+    }
+
+    SnapshotHeader *header = (SnapshotHeader *)base;
+    if (!check_header(ctx, header, st.st_size)) {
+        munmap(base, st.st_size);
+        return SVM_ERROR_BAD_SNAPSHOT;
+    }
+
+    // every section is checked before ctx is touched, so a bad snapshot
+    // leaves the context as it was
+    uint8_t *globals = base + sizeof(SnapshotHeader);
+    uint8_t *stack =
+        globals + sizeof(SVM_Value) * header->global_variable_count;
+    uint64_t *pt_stack = (uint64_t *)(stack + sizeof(SVM_Value) * header->sp);
+    uint8_t *arrays = (uint8_t *)(pt_stack + header->pt_stack_count);
+    uint8_t *strings = arrays + header->array_bytes;
+    uint8_t *maps = strings + padded(header->arena_used);
+    uint8_t *stack_value_type = maps + header->map_bytes;
+    bool ok = check_arrays(header, arrays) && check_maps(header, maps);
+    for (uint32_t i = 0; ok && i < header->pt_stack_count; ++i) {
+        ok = pt_stack[i] < ctx->program->stack_size;
+    }
+    if (!ok) {
+        munmap(base, st.st_size);
+        return SVM_ERROR_BAD_SNAPSHOT;
+    }
+
+    memcpy(ctx->global_variables, globals,
+           sizeof(SVM_Value) * header->global_variable_count);
+    memcpy(ctx->stack, stack, sizeof(SVM_Value) * header->sp);
+    for (uint32_t i = 0; i < header->pt_stack_count; ++i) {
+        ctx->pt_stack[i] = pt_stack[i];
+    }
+    restore_strings(ctx, header, strings);
+    if (!restore_arrays(ctx, header, arrays) ||
+        !restore_maps(ctx, header, maps)) {
+        munmap(base, st.st_size);
+        return SVM_ERROR_BAD_SNAPSHOT;  // not after check_arrays/check_maps
+    }
+    memcpy(ctx->stack_value_type, stack_value_type, header->sp);
+
+    ctx->pc = header->pc;
+    ctx->sp = header->sp;
+    ctx->pt_stack_count = header->pt_stack_count;
+    ctx->status = header->status;
+    munmap(base, st.st_size);
+    return SVM_FINISHED;
+}
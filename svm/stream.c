@@ -0,0 +1,347 @@
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../memory/MEM.h"
+#include "svm.h"
+
+/*
+ * Record-stream mode: the program runs once per fixed-layout binary record.
+ * A layout is a comma separated list of fields, each "global:type" with
+ * type one of i32, i64, f32, f64, or "-:N" for N bytes to skip. Fields are
+ * packed in native byte order.
+ *
+ * Records are processed in batches of STREAM_BATCH_BYTES per worker. With
+ * several workers every round reads one batch per worker, runs the batches
+ * in parallel and writes them back in input order, so memory stays bounded
+ * by the batch buffers.
+ */
+#define STREAM_BATCH_BYTES (1 << 20)
+
+typedef struct {
+    const SVM_Program *program;
+    const SVM_RecordLayout *input;
+    const SVM_RecordLayout *output;
+    SVM_Context *ctx;
+    uint8_t *in_buf;
+    uint8_t *out_buf;
+    uint64_t record_count;  // records in in_buf this round
+    uint64_t first_record;  // stream position of in_buf[0]
+    uint64_t failures;
+    pthread_barrier_t *start;
+    pthread_barrier_t *done;
+    bool *finished;
+} StreamWorker;
+
+static bool parse_field(const SVM_Program *program, char *spec,
+                        SVM_RecordField *field) {
+    char *colon = strchr(spec, ':');
+    if (colon == NULL) return false;
+    *colon = '\0';
+    char *type = colon + 1;
+
+    if (!strcmp(spec, "-")) {
+        field->type = SVM_FIELD_SKIP;
+        field->global = 0;
+        field->size = (uint32_t)strtoul(type, NULL, 10);
+        return field->size > 0;
+    }
+    field->global = (uint32_t)strtoul(spec, NULL, 10);
+    if (field->global >= program->global_variable_count) return false;
+    if (!strcmp(type, "i32")) {
+        field->type = SVM_FIELD_I32;
+        field->size = 4;
+    } else if (!strcmp(type, "i64")) {
+        field->type = SVM_FIELD_I64;
+        field->size = 8;
+    } else if (!strcmp(type, "f32")) {
+        field->type = SVM_FIELD_F32;
+        field->size = 4;
+    } else if (!strcmp(type, "f64")) {
+        field->type = SVM_FIELD_F64;
+        field->size = 8;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+SVM_RecordLayout *svm_parse_record_layout(const SVM_Program *program,
+                                          const char *spec) {
+    char *copy = MEM_strdup((char *)spec);
+    uint32_t count = 1;
+    for (char *p = copy; *p; p++) {
+        if (*p == ',') count++;
+    }
+
+    SVM_RecordLayout *layout =
+        (SVM_RecordLayout *)MEM_malloc(sizeof(SVM_RecordLayout));
+    layout->field_count = count;
+    layout->fields =
+        (SVM_RecordField *)MEM_malloc(sizeof(SVM_RecordField) * count);
+    layout->size = 0;
+
+    char *save = NULL;
+    char *token = strtok_r(copy, ",", &save);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (token == NULL ||
+            !parse_field(program, token, &layout->fields[i])) {
+            MEM_free(copy);
+            svm_delete_record_layout(layout);
+            return NULL;
+        }
+        layout->fields[i].offset = layout->size;
+        layout->size += layout->fields[i].size;
+        token = strtok_r(NULL, ",", &save);
+    }
+    MEM_free(copy);
+    return layout;
+}
+
+void svm_delete_record_layout(SVM_RecordLayout *layout) {
+    if (!layout) return;
+    MEM_free(layout->fields);
+    MEM_free(layout);
+}
+
+/* A double as an integer of [min, max]: NaN is 0, the rest saturates. */
+static int64_t saturate(double v, int64_t min, int64_t max) {
+    if (v != v) return 0;
+    if (v <= (double)min) return min;
+    if (v >= (double)max) return max;
+    return (int64_t)v;
+}
+
+static void bind_record(SVM_Context *ctx, const SVM_RecordLayout *layout,
+                        const uint8_t *record) {
+    const uint8_t *types = ctx->program->global_variable_types;
+    for (uint32_t i = 0; i < layout->field_count; ++i) {
+        const SVM_RecordField *field = &layout->fields[i];
+        const uint8_t *p = record + field->offset;
+        SVM_Value *g = &ctx->global_variables[field->global];
+        bool is_double = types[field->global] == SVM_DOUBLE;
+        switch (field->type) {
+            case SVM_FIELD_I32: {
+                int32_t v;
+                memcpy(&v, p, 4);
+                if (is_double) {
+                    g->dval = v;
+                } else {
+                    g->ival = v;
+                }
+                break;
+            }
+            case SVM_FIELD_I64: {
+                int64_t v;
+                memcpy(&v, p, 8);
+                if (is_double) {
+                    g->dval = (double)v;
+                } else {
+                    g->ival = (int)v;
+                }
+                break;
+            }
+            case SVM_FIELD_F32: {
+                float v;
+                memcpy(&v, p, 4);
+                if (is_double) {
+                    g->dval = v;
+                } else {
+                    g->ival = (int)saturate(v, INT_MIN, INT_MAX);
+                }
+                break;
+            }
+            case SVM_FIELD_F64: {
+                double v;
+                memcpy(&v, p, 8);
+                if (is_double) {
+                    g->dval = v;
+                } else {
+                    g->ival = (int)saturate(v, INT_MIN, INT_MAX);
+                }
+                break;
+            }
+            default: {
+                break;
+            }
+        }
+    }
+}
+
+static void emit_record(SVM_Context *ctx, const SVM_RecordLayout *layout,
+                        uint8_t *record) {
+    const uint8_t *types = ctx->program->global_variable_types;
+    for (uint32_t i = 0; i < layout->field_count; ++i) {
+        const SVM_RecordField *field = &layout->fields[i];
+        uint8_t *p = record + field->offset;
+        SVM_Value value = ctx->global_variables[field->global];
+        bool is_double = types[field->global] == SVM_DOUBLE;
+        switch (field->type) {
+            case SVM_FIELD_I32: {
+                int32_t v = is_double
+                                ? (int32_t)saturate(value.dval, INT32_MIN,
+                                                    INT32_MAX)
+                                : value.ival;
+                memcpy(p, &v, 4);
+                break;
+            }
+            case SVM_FIELD_I64: {
+                int64_t v = is_double
+                                ? saturate(value.dval, INT64_MIN, INT64_MAX)
+                                : value.ival;
+                memcpy(p, &v, 8);
+                break;
+            }
+            case SVM_FIELD_F32: {
+                float v = is_double ? (float)value.dval : value.ival;
+                memcpy(p, &v, 4);
+                break;
+            }
+            case SVM_FIELD_F64: {
+                double v = is_double ? value.dval : value.ival;
+                memcpy(p, &v, 8);
+                break;
+            }
+            default: {
+                memset(p, 0, field->size);
+                break;
+            }
+        }
+    }
+}
+
+static void run_batch(StreamWorker *worker) {
+    for (uint64_t r = 0; r < worker->record_count; ++r) {
+        SVM_Context *ctx = worker->ctx;
+        svm_init(ctx);
+        bind_record(ctx, worker->input,
+                    worker->in_buf + r * worker->input->size);
+        SVM_Status status = svm_run(ctx);
+        if (status != SVM_FINISHED) {
+            fprintf(stderr, "record %llu: %s at pc %u\n",
+                    (unsigned long long)(worker->first_record + r),
+                    svm_status_message(status), ctx->pc);
+            worker->failures++;
+        }
+        emit_record(ctx, worker->output,
+                    worker->out_buf + r * worker->output->size);
+    }
+}
+
+static void *stream_worker(void *arg) {
+    StreamWorker *worker = (StreamWorker *)arg;
+    for (;;) {
+        pthread_barrier_wait(worker->start);
+        if (*worker->finished) break;
+        run_batch(worker);
+        pthread_barrier_wait(worker->done);
+    }
+    return NULL;
+}
+
+/*
+ * Stream records from in_fd to out_fd, running the program once per record
+ * on worker_count threads. Returns the number of records processed; records
+ * that did not finish are counted in *failures and still emitted.
+ */
+uint64_t svm_stream(const SVM_Program *program,
+                    const SVM_RecordLayout *input,
+                    const SVM_RecordLayout *output, int in_fd, int out_fd,
+                    uint32_t worker_count, FILE *out, uint64_t *failures) {
+    if (worker_count == 0) worker_count = 1;
+    uint64_t batch_records = STREAM_BATCH_BYTES / input->size;
+    if (batch_records == 0) batch_records = 1;
+
+    pthread_barrier_t start, done;
+    bool finished = false;
+    pthread_barrier_init(&start, NULL, worker_count + 1);
+    pthread_barrier_init(&done, NULL, worker_count + 1);
+
+    StreamWorker *workers =
+        (StreamWorker *)MEM_malloc(sizeof(StreamWorker) * worker_count);
+    pthread_t *threads =
+        (pthread_t *)MEM_malloc(sizeof(pthread_t) * worker_count);
+    for (uint32_t i = 0; i < worker_count; ++i) {
+        StreamWorker *worker = &workers[i];
+        worker->program = program;
+        worker->input = input;
+        worker->output = output;
+        worker->ctx = svm_create_context(program);
+        worker->ctx->out = out;
+        worker->in_buf = (uint8_t *)MEM_malloc(batch_records * input->size);
+        worker->out_buf = (uint8_t *)MEM_malloc(
+            batch_records * (output->size ? output->size : 1));
+        worker->record_count = 0;
+        worker->failures = 0;
+        worker->start = &start;
+        worker->done = &done;
+        worker->finished = &finished;
+        if (worker_count > 1) {
+            pthread_create(&threads[i], NULL, stream_worker, worker);
+        }
+    }
+
+    uint64_t total = 0;
+    bool eof = false;
+    while (!eof) {
+        uint32_t active = 0;
+        for (; active < worker_count && !eof; ++active) {
+            StreamWorker *worker = &workers[active];
+            ssize_t len = svm_read_full(in_fd, worker->in_buf,
+                                    batch_records * input->size);
+            if (len < 0) {
+                perror("svm_stream");
+                len = 0;
+            }
+            if (len % input->size) {
+                fprintf(stderr, "svm_stream: %zd trailing bytes ignored\n",
+                        len % input->size);
+            }
+            worker->record_count = len / input->size;
+            worker->first_record = total;
+            total += worker->record_count;
+            eof = (size_t)len < batch_records * input->size;
+        }
+        for (uint32_t i = active; i < worker_count; ++i) {
+            workers[i].record_count = 0;
+        }
+
+        if (worker_count > 1) {
+            pthread_barrier_wait(&start);
+            pthread_barrier_wait(&done);
+        } else {
+            run_batch(&workers[0]);
+        }
+        for (uint32_t i = 0; i < active; ++i) {
+            if (!svm_write_full(out_fd, workers[i].out_buf,
+                            workers[i].record_count * output->size)) {
+                perror("svm_stream");
+                eof = true;
+                break;
+            }
+        }
+    }
+
+    if (worker_count > 1) {
+        finished = true;
+        pthread_barrier_wait(&start);
+        for (uint32_t i = 0; i < worker_count; ++i) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+    *failures = 0;
+    for (uint32_t i = 0; i < worker_count; ++i) {
+        *failures += workers[i].failures;
+        svm_delete_context(workers[i].ctx);
+        MEM_free(workers[i].in_buf);
+        MEM_free(workers[i].out_buf);
+    }
+    pthread_barrier_destroy(&start);
+    pthread_barrier_destroy(&done);
+    MEM_free(threads);
+    MEM_free(workers);
+    return total;
+}
@@ -0,0 +1,115 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "svm.h"
+
+static void usage() {
+    fprintf(stderr,
+            "Usage ./svmstream -i layout -o layout [-f input] [-w output] "
+            "[-t threads] [-q] file.csb\n"
+            "  layout: global:type,... type = i32 | i64 | f32 | f64, "
+            "or -:N to skip N bytes\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    char *in_spec = NULL;
+    char *out_spec = NULL;
+    char *in_path = NULL;
+    char *out_path = NULL;
+    int threads = 1;
+    bool quiet = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "i:o:f:w:t:q")) != -1) {
+        switch (opt) {
+            case 'i': {
+                in_spec = optarg;
+                break;
+            }
+            case 'o': {
+                out_spec = optarg;
+                break;
+            }
+            case 'f': {
+                in_path = optarg;
+                break;
+            }
+            case 'w': {
+                out_path = optarg;
+                break;
+            }
+            case 't': {
+                threads = atoi(optarg);
+                break;
+            }
+            case 'q': {
+                quiet = true;
+                break;
+            }
+            default: {
+                usage();
+            }
+        }
+    }
+    if (optind >= argc || !in_spec || !out_spec || threads < 1) usage();
+
+    struct stat st;
+    if (stat(argv[optind], &st) != 0) {
+        fprintf(stderr, "Cannot find file %s\n", argv[optind]);
+        exit(1);
+    }
+    uint8_t *buf = (uint8_t *)malloc(st.st_size);
+    int fd = open(argv[optind], O_RDONLY);
+    ssize_t len = read(fd, buf, st.st_size);
+    close(fd);
+    SVM_Program *program = svm_create_program();
+    SVM_Status status = svm_load(program, buf, len < 0 ? 0 : len);
+    free(buf);
+    if (status != SVM_FINISHED) {
+        fprintf(stderr, "%s: %s\n", argv[optind], svm_status_message(status));
+        exit(1);
+    }
+    add_native_functions(program);
+
+    SVM_RecordLayout *input = svm_parse_record_layout(program, in_spec);
+    SVM_RecordLayout *output = svm_parse_record_layout(program, out_spec);
+    if (input == NULL || output == NULL) {
+        fprintf(stderr, "bad record layout\n");
+        exit(1);
+    }
+
+    int in_fd = in_path ? open(in_path, O_RDONLY) : STDIN_FILENO;
+    int out_fd = out_path ? open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644)
+                          : STDOUT_FILENO;
+    if (in_fd < 0 || out_fd < 0) {
+        fprintf(stderr, "Cannot open %s\n", in_fd < 0 ? in_path : out_path);
+        exit(1);
+    }
+    // native output must not mix with the record stream on stdout
+    FILE *out = quiet ? fopen("/dev/null", "w") : stderr;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint64_t failures;
+    uint64_t records = svm_stream(program, input, output, in_fd, out_fd,
+                                  threads, out, &failures);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds =
+        (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    fprintf(stderr, "%llu records, %llu failed, %.4f s, %.0f records/sec\n",
+            (unsigned long long)records, (unsigned long long)failures,
+            seconds, records / (seconds > 0 ? seconds : 1e-9));
+
+    if (in_path) close(in_fd);
+    if (out_path) close(out_fd);
+    if (quiet) fclose(out);
+    svm_delete_record_layout(input);
+    svm_delete_record_layout(output);
+    svm_delete_program(program);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,90 @@
+#include <string.h>
+
+#include "../memory/MEM.h"
+#include "svm.h"
+
+/*
+ * Strings built at run time. They go to a bump arena that is never freed
+ * piecewise: a script that concatenates in a loop leaves its intermediate
+ * results behind until the context is reset, which is the trade for an
+ * allocation that is a pointer bump and a reset that is one store.
+ */
+#define RECORD_ALIGN (sizeof(uint32_t))
+
+void svm_init_strings(SVM_Context *ctx) {
+    ctx->arena.controller = ctx->controller;
+    ctx->arena.used = 0;
+    ctx->arena.capacity = 0;
+    ctx->arena.bytes = NULL;
+    ctx->strings = &ctx->arena;
+}
+
+void svm_free_strings(SVM_StringArena *arena) {
+    if (arena->bytes) MEM_controller_free(arena->controller, arena->bytes);
+    arena->used = 0;
+    arena->capacity = 0;
+    arena->bytes = NULL;
+}
+
+/* Resolve a handle, false when it names no string. */
+bool svm_string(const SVM_Context *ctx, int handle, SVM_String *s) {
+    if (handle == 0) {
+        s->length = 0;
+        s->data = "";
+        return true;
+    }
+    if (handle > 0) {
+        if ((uint32_t)handle > ctx->program->string_count) return false;
+        *s = ctx->program->strings[handle - 1];
+        return true;
+    }
+    const SVM_StringArena *arena = ctx->strings;
+    uint32_t offset = (uint32_t)-(int64_t)handle - 1;
+    if (offset % RECORD_ALIGN ||
+        (uint64_t)offset + sizeof(uint32_t) > arena->used) {
+        return false;
+    }
+    memcpy(&s->length, arena->bytes + offset, sizeof(uint32_t));
+    s->data = (const char *)arena->bytes + offset + sizeof(uint32_t);
+    return true;
+}
+
+/* Offset of p in the arena, or UINT32_MAX when it lies outside of it. */
+static uint32_t arena_offset(const SVM_StringArena *arena, const char *p) {
+    const uint8_t *u = (const uint8_t *)p;
+    if (arena->bytes && u >= arena->bytes && u < arena->bytes + arena->used) {
+        return (uint32_t)(u - arena->bytes);
+    }
+    return UINT32_MAX;
+}
+
+/*
+ * Append a followed by b as a new string, returns its handle or 0 when the
+ * arena would outgrow a handle. a and b may point into the arena itself.
+ */
+int svm_new_string(SVM_StringArena *arena, const char *a, uint32_t a_len,
+                   const char *b, uint32_t b_len) {
+    uint64_t size = sizeof(uint32_t) + (uint64_t)a_len + b_len + 1;
+    size = (size + RECORD_ALIGN - 1) & ~(uint64_t)(RECORD_ALIGN - 1);
+    if (arena->used + size > INT32_MAX) return 0;
+    if (arena->used + size > arena->capacity) {
+        uint32_t a_off = arena_offset(arena, a);
+        uint32_t b_off = arena_offset(arena, b);
+        uint64_t capacity = arena->capacity ? arena->capacity : 1024;
+        while (capacity < arena->used + size) capacity *= 2;
+        arena->bytes = (uint8_t *)MEM_controller_realloc(
+            arena->controller, arena->bytes, capacity);
+        arena->capacity = (uint32_t)capacity;
+        if (a_off != UINT32_MAX) a = (const char *)arena->bytes + a_off;
+        if (b_off != UINT32_MAX) b = (const char *)arena->bytes + b_off;
+    }
+    uint32_t offset = arena->used;
+    uint8_t *p = arena->bytes + offset;
+    uint32_t length = a_len + b_len;
+    memcpy(p, &length, sizeof(uint32_t));
+    memcpy(p + sizeof(uint32_t), a, a_len);
+    memcpy(p + sizeof(uint32_t) + a_len, b, b_len);
+    p[sizeof(uint32_t) + length] = '\0';
+    arena->used += (uint32_t)size;
+    return -(int)offset - 1;
+}
@@ -1,16 +1,23 @@
 #include "svm.h"
 
+#include <errno.h>
+#include <limits.h>
 #include <math.h>
+#include <poll.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/fcntl.h>
-#include <sys/stat.h>
+#include <sys/mman.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "../memory/MEM.h"
 
+#define svm_malloc(owner, size) \
+    MEM_controller_malloc((owner)->controller, size)
+#define svm_free(owner, ptr) MEM_controller_free((owner)->controller, ptr)
+
 static int read_int(uint8_t **p) {
     uint8_t v1 = **p;
     (*p)++;
@@ -106,18 +113,18 @@ static void add_rowcode(DInfo *info, uint8_t op) {
     info->row_buf[info->r_index] = 0;
 }
 
-static void disasm(SVM_VirtualMachine *svm) {
+void svm_disasm(SVM_Program *program) {
     printf("-- constant pool --\n");
-    printf("constant_count = %d\n", svm->constant_pool_count);
-    for (int i = 0; i < svm->constant_pool_count; ++i) {
+    printf("constant_count = %d\n", program->constant_pool_count);
+    for (int i = 0; i < program->constant_pool_count; ++i) {
         printf("constant[%d] = ", i);
-        switch (svm->constant_pool[i].type) {
+        switch (program->constant_pool[i].type) {
             case SVM_INT: {
-                printf("%d\n", svm->constant_pool[i].u.c_int);
+                printf("%d\n", program->constant_pool[i].u.c_int);
                 break;
             }
             case SVM_DOUBLE: {
-                printf("%f\n", svm->constant_pool[i].u.c_double);
+                printf("%f\n", program->constant_pool[i].u.c_double);
                 break;
             }
             default: {
@@ -127,10 +134,13 @@ static void disasm(SVM_VirtualMachine *svm) {
     }
 
     printf("\n-- variables --\n");
-    printf("variable_count = %d\n", (int)svm->global_variable_count);
-    for (int i = 0; i < svm->global_variable_count; ++i) {
+    printf("variable_count = %d\n", (int)program->global_variable_count);
+    for (int i = 0; i < program->global_variable_count; ++i) {
         printf("v[%d]: ", i);
-        switch (svm->global_variable_types[i]) {
+        if (program->global_variable_names) {
+            printf("%s ", program->global_variable_names[i]);
+        }
+        switch (program->global_variable_types[i]) {
             case SVM_INT: {
                 printf("INT\n");
                 break;
@@ -146,10 +156,10 @@ static void disasm(SVM_VirtualMachine *svm) {
     }
     printf("\n-- code --\n");
 
-    uint8_t *p = svm->code;
+    uint8_t *p = program->code;
     DInfo dinfo = {0};
     int param_len = 0;
-    for (int i = 0; i < svm->code_size; ++i, p++) {
+    for (int i = 0; i < program->code_size; ++i, p++) {
         OpcodeInfo *oinfo = &svm_opcode_info[*p];
         add_rowcode(&dinfo, *p);
         switch (*p) {
@@ -196,7 +206,101 @@ static void disasm(SVM_VirtualMachine *svm) {
             case SVM_DECREMENT:
             case SVM_INVOKE:
             case SVM_GOTO:
-            case SVM_LABEL: {
+            case SVM_LABEL:
+            case SVM_PARALLEL_FOR:
+            case SVM_PARALLEL_END:
+            case SVM_FORK:
+            case SVM_JOIN:
+            case SVM_INVOKE_NATIVE:
+            case SVM_SQRT_DOUBLE:
+            case SVM_ABS_INT:
+            case SVM_ABS_DOUBLE:
+            case SVM_MIN_INT:
+            case SVM_MIN_DOUBLE:
+            case SVM_MAX_INT:
+            case SVM_MAX_DOUBLE:
+            case SVM_FLOOR_DOUBLE:
+            case SVM_FMA_INT:
+            case SVM_FMA_DOUBLE:
+            case SVM_SIN_DOUBLE:
+            case SVM_COS_DOUBLE:
+            case SVM_EXP_DOUBLE:
+            case SVM_LOG_DOUBLE:
+            case SVM_NEW_ARRAY_INT:
+            case SVM_NEW_ARRAY_DOUBLE:
+            case SVM_LOAD_ARRAY_INT:
+            case SVM_LOAD_ARRAY_DOUBLE:
+            case SVM_STORE_ARRAY_INT:
+            case SVM_STORE_ARRAY_DOUBLE:
+            case SVM_LOAD_ARRAY_INT_UNCHECKED:
+            case SVM_LOAD_ARRAY_DOUBLE_UNCHECKED:
+            case SVM_STORE_ARRAY_INT_UNCHECKED:
+            case SVM_STORE_ARRAY_DOUBLE_UNCHECKED:
+            case SVM_ARRAY_LENGTH:
+            case SVM_ARRAY_SUM:
+            case SVM_ARRAY_DOT:
+            case SVM_ARRAY_MIN:
+            case SVM_ARRAY_MAX:
+            case SVM_ARRAY_AXPY:
+            case SVM_ARRAY_FILL:
+            case SVM_ARRAY_COPY:
+            case SVM_PUSH_STRING:
+            case SVM_CONCAT_STRING:
+            case SVM_SUBSTR_STRING:
+            case SVM_STRING_LENGTH:
+            case SVM_EQ_STRING:
+            case SVM_NE_STRING:
+            case SVM_INT_TO_STRING:
+            case SVM_DOUBLE_TO_STRING:
+            case SVM_NEW_MAP_INT:
+            case SVM_NEW_MAP_DOUBLE:
+            case SVM_MAP_GET:
+            case SVM_MAP_PUT:
+            case SVM_MAP_INCREMENT:
+            case SVM_MAP_SIZE:
+            case SVM_NEW_RECORD_ARRAY:
+            case SVM_LOAD_FIELD_INT:
+            case SVM_LOAD_FIELD_DOUBLE:
+            case SVM_STORE_FIELD_INT:
+            case SVM_STORE_FIELD_DOUBLE:
+            case SVM_LOAD_FIELD_INT_UNCHECKED:
+            case SVM_LOAD_FIELD_DOUBLE_UNCHECKED:
+            case SVM_STORE_FIELD_INT_UNCHECKED:
+            case SVM_STORE_FIELD_DOUBLE_UNCHECKED:
+            case SVM_PUSH_STATIC_VECTOR:
+            case SVM_POP_STATIC_VECTOR:
+            case SVM_SPLAT_INT4:
+            case SVM_SPLAT_DOUBLE4:
+            case SVM_ADD_INT4:
+            case SVM_ADD_DOUBLE4:
+            case SVM_SUB_INT4:
+            case SVM_SUB_DOUBLE4:
+            case SVM_MUL_INT4:
+            case SVM_MUL_DOUBLE4:
+            case SVM_DIV_DOUBLE4:
+            case SVM_MINUS_INT4:
+            case SVM_MINUS_DOUBLE4:
+            case SVM_COMPARE_INT4:
+            case SVM_COMPARE_DOUBLE4:
+            case SVM_ALL_INT4:
+            case SVM_ANY_INT4:
+            case SVM_SUM_INT4:
+            case SVM_SUM_DOUBLE4:
+            case SVM_MIN_INT4:
+            case SVM_MIN_DOUBLE4:
+            case SVM_MAX_INT4:
+            case SVM_MAX_DOUBLE4:
+            case SVM_DOT_INT4:
+            case SVM_DOT_DOUBLE4:
+            case SVM_SHUFFLE_VECTOR:
+            case SVM_EXTRACT_VECTOR:
+            case SVM_INT4_TO_DOUBLE4:
+            case SVM_DOUBLE4_TO_INT4:
+            case SVM_JUMP:
+            case SVM_TABLE_SWITCH:
+            case SVM_LOOKUP_SWITCH:
+            case SVM_SELECT_INT:
+            case SVM_SELECT_DOUBLE: {
                 //                printf("%s\n", oinfo->opname);
                 add_opname(&dinfo, oinfo->opname);
                 break;
@@ -231,193 +335,369 @@ static void disasm(SVM_VirtualMachine *svm) {
     }
 }
 
-static void parse(uint8_t *buf, SVM_VirtualMachine *svm) {
+static bool has_bytes(uint8_t *pos, uint8_t *end, size_t n) {
+    return (size_t)(end - pos) >= n;
+}
+
+SVM_Status svm_load(SVM_Program *program, uint8_t *buf, size_t size) {
     uint8_t *pos = buf;
+    uint8_t *end = buf + size;
+    if (!has_bytes(pos, end, 8 + 4) || memcmp(pos, "CAPHESUA", 8) != 0) {
+        return SVM_ERROR_BAD_IMAGE;
+    }
     parse_header(&pos);
-    svm->constant_pool_count = read_int(&pos);
-    //    printf("constant_pool_count = %d\n", svm->constant_pool_count);
-    svm->constant_pool = (SVM_Constant *)MEM_malloc(sizeof(SVM_Constant) *
-                                                    svm->constant_pool_count);
+    program->constant_pool_count = read_int(&pos);
+    //    printf("constant_pool_count = %d\n", program->constant_pool_count);
+    program->constant_pool = (SVM_Constant *)svm_malloc(
+        program, sizeof(SVM_Constant) * program->constant_pool_count);
 
     uint8_t type;
-    for (int i = 0; i < svm->constant_pool_count; ++i) {
+    for (int i = 0; i < program->constant_pool_count; ++i) {
+        if (!has_bytes(pos, end, 1)) return SVM_ERROR_BAD_IMAGE;
         switch (type = read_byte(&pos)) {
             case SVM_INT: {
+                if (!has_bytes(pos, end, 4)) return SVM_ERROR_BAD_IMAGE;
                 int v = read_int(&pos);
                 //                printf("constant[%d] = %d\n", i, v);
-                svm->constant_pool[i].type = SVM_INT;
-                svm->constant_pool[i].u.c_int = v;
+                program->constant_pool[i].type = SVM_INT;
+                program->constant_pool[i].u.c_int = v;
                 break;
             }
             case SVM_DOUBLE: {
+                if (!has_bytes(pos, end, 8)) return SVM_ERROR_BAD_IMAGE;
                 double dv = read_double(&pos);
                 //                printf("constant[%d] = %f\n", i, dv);
-                svm->constant_pool[i].type = SVM_DOUBLE;
-                svm->constant_pool[i].u.c_double = dv;
+                program->constant_pool[i].type = SVM_DOUBLE;
+                program->constant_pool[i].u.c_double = dv;
                 break;
             }
             default: {
-                fprintf(stderr, "undefined constant type\n in parse");
-                exit(1);
+                return SVM_ERROR_BAD_IMAGE;
             }
         }
     }
 
-    svm->global_variable_count = read_int(&pos);
-    svm->global_variables =
-        (SVM_Value *)MEM_malloc(sizeof(SVM_Value) * svm->global_variable_count);
-    svm->global_variable_types =
-        (uint8_t *)MEM_malloc(sizeof(uint8_t) * svm->global_variable_count);
-    //    printf("global_variable_count = %d\n", svm->global_variable_count);
-    for (int i = 0; i < svm->global_variable_count; ++i) {
-        //        uint8_t type = read_byte(&pos);
-        svm->global_variable_types[i] = read_byte(&pos);
-        switch (svm->global_variable_types[i]) {
-            case SVM_INT: {
-                //                printf("INT\n");
-                break;
-            }
+    if (!has_bytes(pos, end, 4)) return SVM_ERROR_BAD_IMAGE;
+    program->global_variable_count = read_int(&pos);
+    if (!has_bytes(pos, end, program->global_variable_count)) {
+        program->global_variable_count = 0;
+        return SVM_ERROR_BAD_IMAGE;
+    }
+    program->global_variable_types = (uint8_t *)svm_malloc(
+        program, sizeof(uint8_t) * program->global_variable_count);
+    //    printf("global_variable_count = %d\n",
+    //           program->global_variable_count);
+    for (int i = 0; i < program->global_variable_count; ++i) {
+        program->global_variable_types[i] = read_byte(&pos);
+        switch (program->global_variable_types[i]) {
+            case SVM_INT:
             case SVM_DOUBLE: {
-                //                printf("DOUBLE\n");
                 break;
             }
+            default: {
+                return SVM_ERROR_BAD_IMAGE;
+            }
         }
     }
 
-    svm->code_size = read_int(&pos);
-    svm->code = (uint8_t *)MEM_malloc(svm->code_size);
-    memcpy(svm->code, pos, svm->code_size);
-    pos += svm->code_size;
-    svm->stack_size = read_int(&pos);
-    svm->pt_stack_size = read_int(&pos);
+    if (!has_bytes(pos, end, 4)) return SVM_ERROR_BAD_IMAGE;
+    program->code_size = read_int(&pos);
+    if (!has_bytes(pos, end, (size_t)program->code_size + 8)) {
+        program->code_size = 0;
+        return SVM_ERROR_BAD_IMAGE;
+    }
+    program->code = (uint8_t *)svm_malloc(program, program->code_size);
+    memcpy(program->code, pos, program->code_size);
+    pos += program->code_size;
+    program->stack_size = read_int(&pos);
+    program->pt_stack_size = read_int(&pos);
+
+    // older images end here; newer ones carry the global names
+    if (pos < end) {
+        program->global_variable_names = (char **)svm_malloc(
+            program, sizeof(char *) * program->global_variable_count);
+        for (int i = 0; i < program->global_variable_count; ++i) {
+            program->global_variable_names[i] = NULL;
+        }
+        for (int i = 0; i < program->global_variable_count; ++i) {
+            if (!has_bytes(pos, end, 4)) return SVM_ERROR_BAD_IMAGE;
+            uint32_t len = read_int(&pos);
+            if (!has_bytes(pos, end, len)) return SVM_ERROR_BAD_IMAGE;
+            char *name = (char *)svm_malloc(program, len + 1);
+            memcpy(name, pos, len);
+            name[len] = '\0';
+            pos += len;
+            program->global_variable_names[i] = name;
+        }
+    }
+
+    // then the interned string literals
+    if (pos < end) {
+        if (!has_bytes(pos, end, 4)) return SVM_ERROR_BAD_IMAGE;
+        uint32_t count = read_int(&pos);
+        if (!has_bytes(pos, end, (size_t)count * 4)) {
+            return SVM_ERROR_BAD_IMAGE;
+        }
+        program->strings =
+            (SVM_String *)svm_malloc(program, sizeof(SVM_String) * count);
+        for (; program->string_count < count; ++program->string_count) {
+            if (!has_bytes(pos, end, 4)) return SVM_ERROR_BAD_IMAGE;
+            uint32_t len = read_int(&pos);
+            if (!has_bytes(pos, end, len)) return SVM_ERROR_BAD_IMAGE;
+            char *data = (char *)svm_malloc(program, len + 1);
+            memcpy(data, pos, len);
+            data[len] = '\0';
+            pos += len;
+            program->strings[program->string_count].length = len;
+            program->strings[program->string_count].data = data;
+        }
+    }
+    return svm_prepare_program(program);
 }
 
-static SVM_VirtualMachine *svm_create() {
-    SVM_VirtualMachine *svm =
-        (SVM_VirtualMachine *)MEM_malloc(sizeof(SVM_VirtualMachine));
-    svm->constant_pool = NULL;
-    svm->global_variables = NULL;
-    svm->global_variable_types = NULL;
-    svm->code = NULL;
-    svm->constant_pool_count = 0;
-    svm->global_variable_count = 0;
-    svm->code_size = 0;
-    svm->function_count = 0;
-    svm->functions = NULL;
-    svm->stack = NULL;
-    svm->stack_size = 0;
-    svm->pt_stack_size = 0;  //
-    svm->stack_value_type = NULL;
-    svm->pt_stack_count = 0;
-    svm->pt_stack = NULL;  //
-    svm->pc = 0;
-    svm->sp = 0;
-    return svm;
+SVM_Program *svm_create_program() {
+    MEM_Controller controller = MEM_create_controller();
+    SVM_Program *program = (SVM_Program *)MEM_controller_malloc(
+        controller, sizeof(SVM_Program));
+    program->controller = controller;
+    program->constant_pool_count = 0;
+    program->constant_pool = NULL;
+    program->global_variable_count = 0;
+    program->global_variable_types = NULL;
+    program->global_variable_names = NULL;
+    program->string_count = 0;
+    program->strings = NULL;
+    program->code_size = 0;
+    program->code = NULL;
+    program->function_count = 0;
+    program->function_capacity = 0;
+    program->functions = NULL;
+    program->stack_size = 0;
+    program->pt_stack_size = 0;  //
+    program->segment_cost = NULL;
+    program->label_count = 0;
+    program->label_pc = NULL;
+    program->global_image = NULL;
+    return program;
 }
 
-static void svm_delete(SVM_VirtualMachine *svm) {
-    if (!svm) return;
-    if (svm->code) {
-        MEM_free(svm->code);
+void svm_delete_program(SVM_Program *program) {
+    if (!program) return;
+    if (program->code) {
+        svm_free(program, program->code);
+    }
+    if (program->constant_pool) {
+        svm_free(program, program->constant_pool);
     }
-    if (svm->constant_pool) {
-        MEM_free(svm->constant_pool);
+    if (program->global_variable_types) {
+        svm_free(program, program->global_variable_types);
     }
-    if (svm->global_variables) {
-        MEM_free(svm->global_variables);
+    if (program->global_variable_names) {
+        for (int i = 0; i < program->global_variable_count; ++i) {
+            if (program->global_variable_names[i]) {
+                svm_free(program, program->global_variable_names[i]);
+            }
+        }
+        svm_free(program, program->global_variable_names);
+    }
+    if (program->strings) {
+        for (uint32_t i = 0; i < program->string_count; ++i) {
+            svm_free(program, (char *)program->strings[i].data);
+        }
+        svm_free(program, program->strings);
     }
-    if (svm->global_variable_types) {
-        MEM_free(svm->global_variable_types);
+    if (program->function_capacity) {
+        svm_free(program, (SVM_Function *)program->functions);
     }
-    if (svm->functions) {
-        MEM_free(svm->functions);
+    if (program->segment_cost) {
+        svm_free(program, program->segment_cost);
     }
-    if (svm->stack) {
-        MEM_free(svm->stack);
+    if (program->label_pc) {
+        svm_free(program, program->label_pc);
     }
-    if (svm->stack_value_type) {
-        MEM_free(svm->stack_value_type);
+    if (program->global_image) {
+        svm_free(program, program->global_image);
     }
-    if (svm->pt_stack) {
-        MEM_free(svm->pt_stack);
+
+    MEM_Controller controller = program->controller;
+    MEM_controller_free(controller, program);
+    MEM_dispose_controller(controller);
+}
+
+void svm_set_native_functions(SVM_Program *program,
+                              const SVM_Function *functions, uint32_t count) {
+    if (program->function_capacity) {
+        svm_free(program, (SVM_Function *)program->functions);
     }
+    program->functions = functions;
+    program->function_count = count;
+    program->function_capacity = 0;
+}
 
-    MEM_free(svm);
+/* A new entry at the end of the function table of program. */
+static SVM_Function *append_function(SVM_Program *program) {
+    if (program->function_count == program->function_capacity ||
+        program->function_capacity == 0) {
+        // copy on first write so the shared table stays untouched
+        uint32_t capacity =
+            program->function_count ? program->function_count * 2 : 4;
+        SVM_Function *functions = (SVM_Function *)svm_malloc(
+            program, sizeof(SVM_Function) * capacity);
+        if (program->function_count) {
+            memcpy(functions, program->functions,
+                   sizeof(SVM_Function) * program->function_count);
+        }
+        if (program->function_capacity) {
+            svm_free(program, (SVM_Function *)program->functions);
+        }
+        program->functions = functions;
+        program->function_capacity = capacity;
+    }
+    return (SVM_Function *)&program->functions[program->function_count++];
 }
 
-void svm_add_native_function(SVM_VirtualMachine *svm,
+void svm_add_native_function(SVM_Program *program,
                              SVM_NativeFunction native_f, char *name,
                              int arg_count) {
-    svm->functions = (SVM_Function *)MEM_realloc(
-        svm->functions, sizeof(SVM_Function) * (svm->function_count + 1));
-    svm->functions[svm->function_count].f_type = NATIVE_FUNCTION;
-    svm->functions[svm->function_count].name = name;
-    svm->functions[svm->function_count].arg_count = arg_count;
-    svm->functions[svm->function_count].u.n_func = native_f;
-    svm->function_count++;
+    SVM_Function *f = append_function(program);
+    f->f_type = NATIVE_FUNCTION;
+    f->name = name;
+    f->arg_count = arg_count;
+    f->pure = false;
+    f->memo = false;
+    f->signature = SVM_SIG_NONE;
+    f->u.n_func = native_f;
 }
 
-static uint8_t fetch(SVM_VirtualMachine *svm) { return svm->code[svm->pc++]; }
+/* A plain C function, memo only taken for a pure one of few arguments. */
+void svm_add_typed_native_function(SVM_Program *program,
+                                   SVM_TypedNative t_func, char *name,
+                                   int arg_count, SVM_Signature signature,
+                                   bool pure, bool memo) {
+    SVM_Function *f = append_function(program);
+    f->f_type = TYPED_NATIVE_FUNCTION;
+    f->name = name;
+    f->arg_count = arg_count;
+    f->pure = pure;
+    f->memo = pure && memo && arg_count <= SVM_MEMO_ARGS;
+    f->signature = signature;
+    f->u.t_func = t_func;
+}
 
-static uint16_t fetch2(SVM_VirtualMachine *svm) {
-    uint8_t v1 = fetch(svm);
-    return (v1 << 8) | fetch(svm);
+SVM_Context *svm_create_context(const SVM_Program *program) {
+    MEM_Controller controller = MEM_create_controller();
+    SVM_Context *ctx = (SVM_Context *)MEM_controller_malloc(
+        controller, sizeof(SVM_Context));
+    ctx->controller = controller;
+    ctx->program = program;
+    ctx->out = stdout;
+    ctx->global_variables = (SVM_Value *)svm_malloc(
+        ctx, sizeof(SVM_Value) * program->global_variable_count);
+    ctx->segment = NULL;
+    ctx->segment_size = 0;
+    ctx->stack =
+        (SVM_Value *)svm_malloc(ctx, sizeof(SVM_Value) * program->stack_size);
+    ctx->stack_value_type =
+        (uint8_t *)svm_malloc(ctx, sizeof(uint8_t) * program->stack_size);
+    ctx->pt_stack =
+        (size_t *)svm_malloc(ctx, sizeof(size_t) * program->pt_stack_size);
+    ctx->pt_stack_count = 0;
+    ctx->pc = 0;
+    ctx->sp = 0;
+    ctx->budget = 0;
+    ctx->deadline = 0;
+    ctx->stop_pc = 0;
+    ctx->status = SVM_FINISHED;
+    svm_init_arrays(ctx);
+    svm_init_strings(ctx);
+    svm_init_maps(ctx);
+    ctx->memo = NULL;
+    return ctx;
 }
 
-static SVM_Constant *read_static(SVM_VirtualMachine *svm, uint16_t idx) {
-    return &svm->constant_pool[idx];
+void svm_delete_context(SVM_Context *ctx) {
+    if (!ctx) return;
+    if (ctx->segment) {
+        munmap(ctx->segment, ctx->segment_size);
+    } else {
+        svm_free(ctx, ctx->global_variables);
+    }
+    svm_free(ctx, ctx->stack);
+    svm_free(ctx, ctx->stack_value_type);
+    svm_free(ctx, ctx->pt_stack);
+    svm_free_arrays(&ctx->heap);
+    svm_free_strings(&ctx->arena);
+    svm_free_maps(&ctx->map_heap);
+
+    MEM_Controller controller = ctx->controller;
+    MEM_controller_free(controller, ctx);
+    MEM_dispose_controller(controller);
 }
 
-static int read_static_int(SVM_VirtualMachine *svm, uint16_t idx) {
-    return read_static(svm, idx)->u.c_int;
+static uint8_t fetch(SVM_Context *ctx) { return ctx->program->code[ctx->pc++]; }
+
+static uint16_t fetch2(SVM_Context *ctx) {
+    uint8_t v1 = fetch(ctx);
+    return (v1 << 8) | fetch(ctx);
 }
 
-static double read_static_double(SVM_VirtualMachine *svm, uint16_t idx) {
-    return read_static(svm, idx)->u.c_double;
+static SVM_Constant *read_static(SVM_Context *ctx, uint16_t idx) {
+    return &ctx->program->constant_pool[idx];
 }
 
-static void push_i(SVM_VirtualMachine *svm, int iv) {
-    svm->stack[svm->sp].ival = iv;
-    svm->stack_value_type[svm->sp] = SVM_INT;
-    svm->sp++;
+static int read_static_int(SVM_Context *ctx, uint16_t idx) {
+    return read_static(ctx, idx)->u.c_int;
 }
 
-static void push_d(SVM_VirtualMachine *svm, double dv) {
-    svm->stack[svm->sp].dval = dv;
-    svm->stack_value_type[svm->sp] = SVM_DOUBLE;
-    svm->sp++;
+static double read_static_double(SVM_Context *ctx, uint16_t idx) {
+    return read_static(ctx, idx)->u.c_double;
 }
 
-static void push_pt(SVM_VirtualMachine *svm) {
-    if (svm->pt_stack_count < svm->stack_size) {
-        svm->pt_stack[svm->pt_stack_count] = svm->sp;
-        svm->pt_stack_count++;
-        svm->sp++;
-    } else {
-        fprintf(stderr,
-                "Error: Segmentation falut happend to push pointer stack.\n");
-        exit(1);
+static void push_i(SVM_Context *ctx, int iv) {
+    ctx->stack[ctx->sp].ival = iv;
+    ctx->stack_value_type[ctx->sp] = SVM_INT;
+    ctx->sp++;
+}
+
+static void push_d(SVM_Context *ctx, double dv) {
+    ctx->stack[ctx->sp].dval = dv;
+    ctx->stack_value_type[ctx->sp] = SVM_DOUBLE;
+    ctx->sp++;
+}
+
+static bool push_pt(SVM_Context *ctx) {
+    if (ctx->pt_stack_count < ctx->program->pt_stack_size) {
+        ctx->pt_stack[ctx->pt_stack_count] = ctx->sp;
+        ctx->pt_stack_count++;
+        ctx->sp++;
+        return true;
     }
+    return false;
 }
 
-static int pop_i(SVM_VirtualMachine *svm) {
-    --svm->sp;
-    return svm->stack[svm->sp].ival;
+static int pop_i(SVM_Context *ctx) {
+    --ctx->sp;
+    return ctx->stack[ctx->sp].ival;
 }
 
-static double pop_d(SVM_VirtualMachine *svm) {
-    --svm->sp;
-    return svm->stack[svm->sp].dval;
+/* Whether int / or % of the top two values would trap the host. */
+static bool division_faults(const SVM_Context *ctx) {
+    int divisor = ctx->stack[ctx->sp - 1].ival;
+    return divisor == 0 ||
+           (divisor == -1 && ctx->stack[ctx->sp - 2].ival == INT_MIN);
 }
 
-static void pop_pt(SVM_VirtualMachine *svm) {
-    if (svm->pt_stack_count > 0) {
-        svm->sp = svm->pt_stack[--svm->pt_stack_count];
-    } else {
-        fprintf(stderr,
-                "Error: Attempting to pop from an empty pointer stack.\n");
-        exit(1);
+static double pop_d(SVM_Context *ctx) {
+    --ctx->sp;
+    return ctx->stack[ctx->sp].dval;
+}
+
+static bool pop_pt(SVM_Context *ctx) {
+    if (ctx->pt_stack_count > 0) {
+        ctx->sp = ctx->pt_stack[--ctx->pt_stack_count];
+        return true;
     }
+    return false;
 }
 
 static void write_i(SVM_Value *head, uint32_t offset, uint32_t idx, int iv) {
@@ -434,444 +714,1509 @@ static double read_d(SVM_Value *head, uint32_t offset, uint32_t idx) {
     return head[offset + idx].dval;
 }
 
-static void write_global_i(SVM_VirtualMachine *svm, uint32_t idx, int iv) {
-    write_i(svm->global_variables, 0, idx, iv);
+static void write_global_i(SVM_Context *ctx, uint32_t idx, int iv) {
+    write_i(ctx->global_variables, 0, idx, iv);
+}
+static int read_global_i(SVM_Context *ctx, uint32_t idx) {
+    return read_i(ctx->global_variables, 0, idx);
 }
-static int read_global_i(SVM_VirtualMachine *svm, uint32_t idx) {
-    return read_i(svm->global_variables, 0, idx);
+
+static void write_global_d(SVM_Context *ctx, uint32_t idx, double dv) {
+    write_d(ctx->global_variables, 0, idx, dv);
 }
 
-static void write_global_d(SVM_VirtualMachine *svm, uint32_t idx, double dv) {
-    write_d(svm->global_variables, 0, idx, dv);
+static double read_global_d(SVM_Context *ctx, uint32_t idx) {
+    return read_d(ctx->global_variables, 0, idx);
 }
 
-static double read_global_d(SVM_VirtualMachine *svm, uint32_t idx) {
-    return read_d(svm->global_variables, 0, idx);
+static bool is_boundary(uint8_t op) {
+    switch (op) {
+        case SVM_GOTO:
+        case SVM_LABEL:
+        case SVM_PUSH_STACK_PT:
+        case SVM_POP_STACK_PT:
+        case SVM_PARALLEL_FOR:
+        case SVM_PARALLEL_END:
+        case SVM_FORK:
+        case SVM_JOIN:
+        case SVM_JUMP:
+        case SVM_TABLE_SWITCH:
+        case SVM_LOOKUP_SWITCH: {
+            return true;
+        }
+        default: {
+            return false;
+        }
+    }
 }
 
-static void init_svm(SVM_VirtualMachine *svm) {
-    svm->stack = (SVM_Value *)MEM_malloc(sizeof(SVM_Value) * svm->stack_size);
-    svm->stack_value_type =
-        (uint8_t *)MEM_malloc(sizeof(uint8_t) * svm->stack_size);
-    svm->pc = 0;
-    svm->sp = 0;
-    svm->pt_stack_count = 0;
-    svm->pt_stack = (size_t *)MEM_malloc(sizeof(size_t) * svm->pt_stack_size);
+static uint16_t label_at(const SVM_Program *program, uint32_t pc) {
+    return (program->code[pc + 1] << 8) | program->code[pc + 2];
+}
 
-    for (int i = 0; i < svm->global_variable_count; ++i) {
-        switch (svm->global_variable_types[i]) {
+/*
+ * Branches go straight to label_pc[label] instead of scanning the code
+ * for the label; a label that appears twice is found where it first does.
+ */
+static void index_labels(SVM_Program *program) {
+    if (program->label_pc) {
+        svm_free(program, program->label_pc);
+    }
+    program->label_count = 0;
+    for (uint32_t pc = 0; pc + 2 < program->code_size;) {
+        uint8_t op = program->code[pc];
+        if (op == SVM_LABEL && label_at(program, pc) >= program->label_count) {
+            program->label_count = label_at(program, pc) + 1;
+        }
+        pc += 1 + strlen(svm_opcode_info[op].parameter) * 2;
+    }
+    program->label_pc = (uint32_t *)svm_malloc(
+        program, sizeof(uint32_t) * (program->label_count + 1));
+    for (uint32_t i = 0; i < program->label_count; ++i) {
+        program->label_pc[i] = SVM_NO_LABEL;
+    }
+    for (uint32_t pc = 0; pc + 2 < program->code_size;) {
+        uint8_t op = program->code[pc];
+        if (op == SVM_LABEL &&
+            program->label_pc[label_at(program, pc)] == SVM_NO_LABEL) {
+            program->label_pc[label_at(program, pc)] = pc;
+        }
+        pc += 1 + strlen(svm_opcode_info[op].parameter) * 2;
+    }
+}
+
+/*
+ * Straight-line code only changes direction at branches and block
+ * boundaries, so the number of instructions run between two boundaries is
+ * known up front. segment_cost[pc] holds that count for the segment that
+ * starts at pc, and the budget is charged once per segment.
+ */
+SVM_Status svm_prepare_program(SVM_Program *program) {
+    if (program->segment_cost) {
+        svm_free(program, program->segment_cost);
+    }
+    program->segment_cost = (uint32_t *)svm_malloc(
+        program, sizeof(uint32_t) * (program->code_size + 1));
+    memset(program->segment_cost, 0,
+           sizeof(uint32_t) * (program->code_size + 1));
+
+    uint32_t head = 0;
+    for (uint32_t pc = 0; pc < program->code_size;) {
+        uint8_t op = program->code[pc];
+        if (op == 0 || op >= SVM_OPCODE_PLUS_ONE) {
+            return SVM_ERROR_UNKNOWN_OPCODE;
+        }
+        if (is_boundary(op) && pc != head) {
+            head = pc;
+        }
+        program->segment_cost[head]++;
+        pc += 1 + strlen(svm_opcode_info[op].parameter) * 2;
+    }
+    index_labels(program);
+
+    if (program->global_image) {
+        svm_free(program, program->global_image);
+    }
+    program->global_image = (SVM_Value *)svm_malloc(
+        program, sizeof(SVM_Value) * program->global_variable_count);
+    // an int leaves the upper bytes alone, so keep them deterministic
+    memset(program->global_image, 0,
+           sizeof(SVM_Value) * program->global_variable_count);
+    for (int i = 0; i < program->global_variable_count; ++i) {
+        switch (program->global_variable_types[i]) {
             case SVM_INT: {
-                svm->global_variables[i].ival = 0;
+                program->global_image[i].ival = 0;
                 break;
             }
             case SVM_DOUBLE: {
-                svm->global_variables[i].dval = 0.0;
+                program->global_image[i].dval = 0.0;
                 break;
             }
             default: {
-                fprintf(stderr, "no such svm type\n");
-                exit(1);
+                return SVM_ERROR_UNKNOWN_TYPE;
             }
         }
     }
+    return SVM_FINISHED;
 }
 
-static void show_status(SVM_VirtualMachine *svm) {
-    printf("\n< show SVM status >\n");
-    printf("-- global variable ---\n");
-    for (int i = 0; i < svm->global_variable_count; ++i) {
-        switch (svm->global_variable_types[i]) {
+/*
+ * Reset the context for a new run. Globals start from the program's
+ * pristine image, so this costs one memcpy whatever their types.
+ */
+SVM_Status svm_init(SVM_Context *ctx) {
+    const SVM_Program *program = ctx->program;
+    ctx->pc = 0;
+    ctx->sp = 0;
+    ctx->pt_stack_count = 0;
+    memcpy(ctx->global_variables, program->global_image,
+           sizeof(SVM_Value) * program->global_variable_count);
+    svm_free_arrays(&ctx->heap);
+    svm_free_maps(&ctx->map_heap);
+    ctx->arena.used = 0;  // keep the buffer for the next run
+    return ctx->status = SVM_FINISHED;
+}
+
+void svm_show_status(SVM_Context *ctx) {
+    flockfile(ctx->out);
+    fprintf(ctx->out, "\n< show SVM status >\n");
+    fprintf(ctx->out, "-- global variable ---\n");
+    for (int i = 0; i < ctx->program->global_variable_count; ++i) {
+        switch (ctx->program->global_variable_types[i]) {
             case SVM_INT: {
-                printf("[%d:svm_int] = %d\n", i, svm->global_variables[i].ival);
+                fprintf(ctx->out, "[%d:svm_int] = %d\n", i,
+                        ctx->global_variables[i].ival);
                 break;
             }
             case SVM_DOUBLE: {
-                printf("[%d:svm_dbl] = %f\n", i, svm->global_variables[i].dval);
+                fprintf(ctx->out, "[%d:svm_dbl] = %f\n", i,
+                        ctx->global_variables[i].dval);
                 break;
             }
             default: {
-                fprintf(stderr, "no such svm type\n");
-                exit(1);
+                fprintf(ctx->out, "[%d:unknown]\n", i);
+                break;
             }
         }
     }
-    printf("\n--- stack ---\n");
-    for (int i = (svm->sp - 1); i >= 0; --i) {
-        switch (svm->stack_value_type[i]) {
+    fprintf(ctx->out, "\n--- stack ---\n");
+    for (int i = (ctx->sp - 1); i >= 0; --i) {
+        switch (ctx->stack_value_type[i]) {
             case SVM_INT: {
-                printf("[%d:svm_int] = %d\n", i, svm->stack[i].ival);
+                fprintf(ctx->out, "[%d:svm_int] = %d\n", i, ctx->stack[i].ival);
                 break;
             }
             case SVM_DOUBLE: {
-                printf("[%d:svm_dbl] = %f\n", i, svm->stack[i].dval);
+                fprintf(ctx->out, "[%d:svm_dbl] = %f\n", i, ctx->stack[i].dval);
                 break;
             }
             default: {
-                fprintf(stderr, "no such svm type\n");
-                exit(1);
+                fprintf(ctx->out, "[%d:unknown]\n", i);
+                break;
             }
         }
     }
+    funlockfile(ctx->out);
+}
+
+/*
+ * Whether two contexts of one program hold the same globals. Each slot is
+ * compared by its type: an int leaves the rest of the SVM_Value unwritten.
+ */
+bool svm_same_globals(const SVM_Context *a, const SVM_Context *b) {
+    const SVM_Program *program = a->program;
+    for (int i = 0; i < program->global_variable_count; ++i) {
+        const SVM_Value *va = &a->global_variables[i];
+        const SVM_Value *vb = &b->global_variables[i];
+        if (program->global_variable_types[i] == SVM_DOUBLE
+                ? memcmp(&va->dval, &vb->dval, sizeof(double)) != 0
+                : va->ival != vb->ival) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
 }
 
-static void svm_run(SVM_VirtualMachine *svm) {
-    bool running = true;
+#define SVM_SIG_TYPE(sig, ret, member, type, args, params, call) type,
+const uint8_t svm_signature_type[SVM_SIG_PLUS_ONE] = {
+    SVM_INT, SVM_SIGNATURES(SVM_SIG_TYPE)};
+#undef SVM_SIG_TYPE
+
+#define SVM_SIG_ARGS(sig, ret, member, type, args, params, call) args,
+const char *svm_signature_args[SVM_SIG_PLUS_ONE] = {
+    "", SVM_SIGNATURES(SVM_SIG_ARGS)};
+#undef SVM_SIG_ARGS
+
+/* Call a typed native with its arguments in a[0..arg_count). */
+SVM_Value svm_call_typed(const SVM_Function *func, const SVM_Value *a) {
+    SVM_Value v;
+    switch (func->signature) {
+#define SVM_SIG_CALL(sig, ret, member, type, args, params, call) \
+    case sig: {                                                  \
+        v.member = ((ret(*) params)func->u.t_func) call;         \
+        break;                                                   \
+    }
+        SVM_SIGNATURES(SVM_SIG_CALL)
+#undef SVM_SIG_CALL
+        default: {
+            v.ival = 0;
+            break;
+        }
+    }
+    return v;
+}
+
+/* func, a memo native, on the arguments at the top of the stack. */
+static SVM_Value call_memo(SVM_Context *ctx, uint16_t f_idx,
+                           const SVM_Function *func, const SVM_Value *args) {
+    const uint64_t mix = 0x9e3779b97f4a7c15ULL;
+    uint64_t key[SVM_MEMO_ARGS] = {0};
+    uint64_t hash = (f_idx + 1) * mix;
+    for (int i = 0; i < func->arg_count; ++i) {
+        if (ctx->stack_value_type[ctx->sp - func->arg_count + i] ==
+            SVM_DOUBLE) {
+            memcpy(&key[i], &args[i].dval, sizeof(double));
+        } else {
+            key[i] = (uint32_t)args[i].ival;
+        }
+        hash = (hash ^ key[i]) * mix;
+    }
+    if (ctx->memo == NULL) {
+        ctx->memo = (SVM_MemoEntry *)svm_malloc(
+            ctx, sizeof(SVM_MemoEntry) * SVM_MEMO_ENTRIES);
+        memset(ctx->memo, 0, sizeof(SVM_MemoEntry) * SVM_MEMO_ENTRIES);
+    }
+    SVM_MemoEntry *entry = &ctx->memo[(hash >> 32) % SVM_MEMO_ENTRIES];
+    if (entry->function != f_idx + 1u ||
+        memcmp(entry->key, key, sizeof(key)) != 0) {
+        entry->function = f_idx + 1u;
+        memcpy(entry->key, key, sizeof(key));
+        entry->value = svm_call_typed(func, args);
+    }
+    return entry->value;
+}
+
+/*
+ * Call function f_idx on the arguments at the top of the stack and leave
+ * its value there. SVM_PENDING leaves the arguments popped and no value.
+ */
+static SVM_Status invoke(SVM_Context *ctx, uint16_t f_idx) {
+    if (f_idx >= ctx->program->function_count) {
+        return SVM_ERROR_BAD_FUNCTION;
+    }
+    const SVM_Function *func = &ctx->program->functions[f_idx];
+    SVM_Value *args = &ctx->stack[ctx->sp - func->arg_count];
+    switch (func->f_type) {
+        case TYPED_NATIVE_FUNCTION: {
+            SVM_Value val = func->memo ? call_memo(ctx, f_idx, func, args)
+                                       : svm_call_typed(func, args);
+            ctx->sp -= func->arg_count;
+            ctx->stack_value_type[ctx->sp] =
+                svm_signature_type[func->signature];
+            ctx->stack[ctx->sp++] = val;
+            return SVM_FINISHED;
+        }
+        case NATIVE_FUNCTION: {
+            SVM_Value val = func->u.n_func(ctx, args, func->arg_count);
+            ctx->sp -= func->arg_count;
+            ctx->stack_value_type[ctx->sp] = SVM_INT;
+            ctx->stack[ctx->sp++] = val;
+            return SVM_FINISHED;
+        }
+        case ASYNC_NATIVE_FUNCTION: {
+            SVM_Value val;
+            SVM_Status status =
+                func->u.a_func(ctx, args, func->arg_count, &val);
+            ctx->sp -= func->arg_count;
+            if (status == SVM_FINISHED) {
+                ctx->stack_value_type[ctx->sp] = SVM_INT;
+                ctx->stack[ctx->sp++] = val;
+            }
+            return status;
+        }
+        default: {
+            return SVM_ERROR_BAD_FUNCTION;
+        }
+    }
+}
+
+/* The array behind handle, NULL when there is none. */
+static SVM_Array *get_array(SVM_Context *ctx, int handle) {
+    SVM_ArrayHeap *heap = ctx->arrays;
+    if ((uint32_t)(handle - 1) >= heap->count) return NULL;
+    return &heap->arrays[handle - 1];
+}
+
+static SVM_Map *get_map(SVM_Context *ctx, int handle) {
+    SVM_MapHeap *heap = ctx->maps;
+    if ((uint32_t)(handle - 1) >= heap->count) return NULL;
+    return &heap->maps[handle - 1];
+}
+
+/* Pop an index and a handle; NULL when either is bad. */
+static SVM_Array *pop_element(SVM_Context *ctx, int *index) {
+    *index = pop_i(ctx);
+    SVM_Array *a = get_array(ctx, pop_i(ctx));
+    if (a && (uint32_t)*index >= a->length) {
+        ctx->status = SVM_ERROR_INDEX_OUT_OF_RANGE;
+        return NULL;
+    }
+    if (a == NULL) ctx->status = SVM_ERROR_BAD_ARRAY;
+    return a;
+}
+
+/* Pop a handle the compiler proved valid along with the index. */
+static SVM_Array *pop_element_unchecked(SVM_Context *ctx, int *index) {
+    *index = pop_i(ctx);
+    SVM_Array *a = get_array(ctx, pop_i(ctx));
+    if (a == NULL) ctx->status = SVM_ERROR_BAD_ARRAY;
+    return a;
+}
+
+/*
+ * Pop an index and the handle of a record array, and return the value at
+ * slot field of that record; NULL when either is bad. checked is false when
+ * the compiler proved the index in range.
+ */
+static SVM_Value *pop_field(SVM_Context *ctx, uint16_t field, bool checked) {
+    uint32_t index = pop_i(ctx);
+    SVM_Array *a = get_array(ctx, pop_i(ctx));
+    if (a == NULL || field >= a->stride) {
+        ctx->status = SVM_ERROR_BAD_ARRAY;
+        return NULL;
+    }
+    if (checked && index >= a->length) {
+        ctx->status = SVM_ERROR_INDEX_OUT_OF_RANGE;
+        return NULL;
+    }
+    return (SVM_Value *)a->data + (size_t)index * a->stride + field;
+}
+
+/* Pop two handles of arrays of one type and length, second one first. */
+static bool pop_array_pair(SVM_Context *ctx, SVM_Array **a, SVM_Array **b) {
+    *b = get_array(ctx, pop_i(ctx));
+    *a = get_array(ctx, pop_i(ctx));
+    return *a && *b && (*a)->type == (*b)->type &&
+           (*a)->length == (*b)->length;
+}
+
+static bool pop_string_pair(SVM_Context *ctx, SVM_String *a, SVM_String *b) {
+    bool ok = svm_string(ctx, pop_i(ctx), b);
+    return svm_string(ctx, pop_i(ctx), a) && ok;
+}
+
+static void push_value(SVM_Context *ctx, uint8_t type, SVM_Value v) {
+    ctx->stack[ctx->sp] = v;
+    ctx->stack_value_type[ctx->sp] = type;
+    ctx->sp++;
+}
+
+/* The int4 or double4 on top of the stack. */
+static SVM_Value *vector_top(SVM_Context *ctx) {
+    return &ctx->stack[ctx->sp - SVM_VECTOR_LANES];
+}
+
+static void tag_vector(SVM_Context *ctx, uint8_t type) {
+    memset(&ctx->stack_value_type[ctx->sp - SVM_VECTOR_LANES], type,
+           SVM_VECTOR_LANES);
+}
+
+/* Continue at the SVM_LABEL with id label, false if there is none. */
+static bool jump_to_label(SVM_Context *ctx, uint16_t label) {
+    const SVM_Program *program = ctx->program;
+    if (label >= program->label_count ||
+        program->label_pc[label] == SVM_NO_LABEL) {
+        return false;
+    }
+    ctx->pc = program->label_pc[label];
+    return true;
+}
+
+/* Label of key in a SVM_TABLE_SWITCH table, see svm.h. */
+static uint16_t table_switch_label(const SVM_Constant *table, int key) {
+    int64_t index = (int64_t)key - table[0].u.c_int;
+    if (index < 0 || index >= table[1].u.c_int) {
+        return table[2].u.c_int;
+    }
+    return table[3 + index].u.c_int;
+}
+
+/* Label of key in a SVM_LOOKUP_SWITCH table, found by binary search. */
+static uint16_t lookup_switch_label(const SVM_Constant *table, int key) {
+    const SVM_Constant *pairs = table + 2;
+    int low = 0, high = table[0].u.c_int;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (pairs[2 * mid].u.c_int < key) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low < table[0].u.c_int && pairs[2 * low].u.c_int == key) {
+        return pairs[2 * low + 1].u.c_int;
+    }
+    return table[1].u.c_int;
+}
+
+/*
+ * Charge the segment starting at pc against the budget. Called only from
+ * branch and block-boundary opcodes, so straight-line code pays nothing.
+ * A slice always runs at least one segment to guarantee progress.
+ */
+static bool enter_segment(SVM_Context *ctx, uint32_t pc,
+                          bool *progressed) {
+    uint32_t cost = ctx->program->segment_cost[pc];
+    if (*progressed) {
+        if (ctx->budget < cost) return false;
+        if (ctx->deadline && now_ns() >= ctx->deadline) return false;
+    }
+    ctx->budget = (ctx->budget < cost) ? 0 : ctx->budget - cost;
+    *progressed = true;
+    return true;
+}
+
+/*
+ * Stop on a fault in the instruction at pc, which is left as it was
+ * before: pc at its opcode, its operands still on the stack.
+ */
+static SVM_Status fault(SVM_Context *ctx, uint32_t pc, uint32_t sp,
+                        SVM_Status status) {
+    ctx->pc = pc;
+    ctx->sp = sp;
+    return ctx->status = status;
+}
+
+SVM_Status svm_run_slice(SVM_Context *ctx, uint64_t max_instructions,
+                         uint64_t deadline_ns) {
+    bool running = ctx->pc < ctx->program->code_size;
+    bool progressed = false;
     uint8_t op = 0;
+
+    if (ctx->status != SVM_FINISHED && ctx->status != SVM_SUSPENDED) {
+        return ctx->status;
+    }
+    ctx->budget = max_instructions;
+    ctx->deadline = deadline_ns;
+    if (running && !is_boundary(ctx->program->code[ctx->pc])) {
+        enter_segment(ctx, ctx->pc, &progressed);
+    }
+
     while (running) {
-        switch (op = fetch(svm)) {
+        uint32_t op_pc = ctx->pc, op_sp = ctx->sp;  // where a fault rewinds to
+        switch (op = fetch(ctx)) {
             case SVM_PUSH_INT: {  // push from constant pool
-                uint16_t s_idx = fetch2(svm);
-                int v = read_static_int(svm, s_idx);
-                push_i(svm, v);
+                uint16_t s_idx = fetch2(ctx);
+                int v = read_static_int(ctx, s_idx);
+                push_i(ctx, v);
                 break;
             }
             case SVM_PUSH_DOUBLE: {
-                uint16_t s_idx = fetch2(svm);
-                double dv = read_static_double(svm, s_idx);
-                push_d(svm, dv);
+                uint16_t s_idx = fetch2(ctx);
+                double dv = read_static_double(ctx, s_idx);
+                push_d(ctx, dv);
                 break;
             }
             case SVM_POP_STATIC_INT: {  // save i_val to global variable
-                uint16_t s_idx = fetch2(svm);
-                int iv = pop_i(svm);
-                write_global_i(svm, s_idx, iv);
-                //                show_status(svm);
+                uint16_t s_idx = fetch2(ctx);
+                int iv = pop_i(ctx);
+                write_global_i(ctx, s_idx, iv);
+                //                svm_show_status(ctx);
                 //                exit(1);
                 break;
             }
             case SVM_POP_STATIC_DOUBLE: {  // save d_val to global variable
-                uint16_t s_idx = fetch2(svm);
-                double dv = pop_d(svm);
-                write_global_d(svm, s_idx, dv);
+                uint16_t s_idx = fetch2(ctx);
+                double dv = pop_d(ctx);
+                write_global_d(ctx, s_idx, dv);
                 //                exit(1);
                 break;
             }
             case SVM_POP_STACK_PT:  //
             {
-                pop_pt(svm);
+                if (!enter_segment(ctx, ctx->pc - 1, &progressed)) {
+                    ctx->pc--;
+                    return ctx->status = SVM_SUSPENDED;
+                }
+                if (!pop_pt(ctx)) {
+                    return fault(ctx, op_pc, op_sp,
+                                 SVM_ERROR_PT_STACK_UNDERFLOW);
+                }
                 break;
             }
             case SVM_PUSH_STACK_PT: {  //
-                push_pt(svm);
+                if (!enter_segment(ctx, ctx->pc - 1, &progressed)) {
+                    ctx->pc--;
+                    return ctx->status = SVM_SUSPENDED;
+                }
+                if (!push_pt(ctx)) {
+                    return fault(ctx, op_pc, op_sp,
+                                 SVM_ERROR_PT_STACK_OVERFLOW);
+                }
                 break;
             }
             case SVM_PUSH_STATIC_INT: {
-                uint16_t s_idx = fetch2(svm);
-                int iv = read_global_i(svm, s_idx);
+                uint16_t s_idx = fetch2(ctx);
+                int iv = read_global_i(ctx, s_idx);
                 //                printf("iv = %d\n", iv);
-                push_i(svm, iv);
+                push_i(ctx, iv);
                 break;
             }
             case SVM_PUSH_STATIC_DOUBLE: {
-                uint16_t s_idx = fetch2(svm);
-                double dv = read_global_d(svm, s_idx);
-                push_d(svm, dv);
+                uint16_t s_idx = fetch2(ctx);
+                double dv = read_global_d(ctx, s_idx);
+                push_d(ctx, dv);
                 break;
             }
             case SVM_ADD_INT: {
-                int iv1 = pop_i(svm);
-                int iv2 = pop_i(svm);
-                push_i(svm, (iv2 + iv1));
+                int iv1 = pop_i(ctx);
+                int iv2 = pop_i(ctx);
+                push_i(ctx, (iv2 + iv1));
                 break;
             }
             case SVM_ADD_DOUBLE: {
-                double dv1 = pop_d(svm);
-                double dv2 = pop_d(svm);
-                push_d(svm, (dv2 + dv1));
+                double dv1 = pop_d(ctx);
+                double dv2 = pop_d(ctx);
+                push_d(ctx, (dv2 + dv1));
                 break;
             }
             case SVM_SUB_INT: {
-                int iv1 = pop_i(svm);
-                int iv2 = pop_i(svm);
-                push_i(svm, (iv2 - iv1));
+                int iv1 = pop_i(ctx);
+                int iv2 = pop_i(ctx);
+                push_i(ctx, (iv2 - iv1));
                 break;
             }
             case SVM_SUB_DOUBLE: {
-                double dv1 = pop_d(svm);
-                double dv2 = pop_d(svm);
-                push_d(svm, (dv2 - dv1));
+                double dv1 = pop_d(ctx);
+                double dv2 = pop_d(ctx);
+                push_d(ctx, (dv2 - dv1));
                 break;
             }
             case SVM_MUL_INT: {
-                int iv1 = pop_i(svm);
-                int iv2 = pop_i(svm);
-                push_i(svm, (iv2 * iv1));
+                int iv1 = pop_i(ctx);
+                int iv2 = pop_i(ctx);
+                push_i(ctx, (iv2 * iv1));
                 break;
             }
             case SVM_MUL_DOUBLE: {
-                double dv1 = pop_d(svm);
-                double dv2 = pop_d(svm);
-                push_d(svm, (dv2 * dv1));
+                double dv1 = pop_d(ctx);
+                double dv2 = pop_d(ctx);
+                push_d(ctx, (dv2 * dv1));
                 break;
             }
             case SVM_DIV_INT: {
-                int iv1 = pop_i(svm);
-                int iv2 = pop_i(svm);
-                push_i(svm, (iv2 / iv1));
+                if (division_faults(ctx)) {
+                    return fault(ctx, op_pc, op_sp, SVM_ERROR_DIVISION_BY_ZERO);
+                }
+                int iv1 = pop_i(ctx);
+                int iv2 = pop_i(ctx);
+                push_i(ctx, (iv2 / iv1));
                 break;
             }
             case SVM_DIV_DOUBLE: {
-                double dv1 = pop_d(svm);
-                double dv2 = pop_d(svm);
-                push_d(svm, (dv2 / dv1));
+                double dv1 = pop_d(ctx);
+                double dv2 = pop_d(ctx);
+                push_d(ctx, (dv2 / dv1));
                 break;
             }
             case SVM_MOD_INT: {
-                int iv1 = pop_i(svm);
-                int iv2 = pop_i(svm);
-                push_i(svm, (iv2 % iv1));
+                if (division_faults(ctx)) {
+                    return fault(ctx, op_pc, op_sp, SVM_ERROR_DIVISION_BY_ZERO);
+                }
+                int iv1 = pop_i(ctx);
+                int iv2 = pop_i(ctx);
+                push_i(ctx, (iv2 % iv1));
                 break;
             }
             case SVM_MOD_DOUBLE: {
-                double dv1 = pop_d(svm);
-                double dv2 = pop_d(svm);
-                push_d(svm, fmod(dv2, dv1));
+                double dv1 = pop_d(ctx);
+                double dv2 = pop_d(ctx);
+                push_d(ctx, fmod(dv2, dv1));
                 break;
             }
             case SVM_LT_INT: {
-                int iv1 = pop_i(svm);
-                int iv2 = pop_i(svm);
-                push_i(svm, (iv2 < iv1) ? 1 : 0);
+                int iv1 = pop_i(ctx);
+                int iv2 = pop_i(ctx);
+                push_i(ctx, (iv2 < iv1) ? 1 : 0);
                 break;
             }
             case SVM_LT_DOUBLE: {
-                double dv1 = pop_d(svm);
-                double dv2 = pop_d(svm);
-                push_i(svm, (dv2 < dv1) ? 1 : 0);
+                double dv1 = pop_d(ctx);
+                double dv2 = pop_d(ctx);
+                push_i(ctx, (dv2 < dv1) ? 1 : 0);
                 break;
             }
             case SVM_LE_INT: {
-                int iv1 = pop_i(svm);
-                int iv2 = pop_i(svm);
-                push_i(svm, (iv2 <= iv1) ? 1 : 0);
+                int iv1 = pop_i(ctx);
+                int iv2 = pop_i(ctx);
+                push_i(ctx, (iv2 <= iv1) ? 1 : 0);
                 break;
             }
             case SVM_LE_DOUBLE: {
-                double dv1 = pop_d(svm);
-                double dv2 = pop_d(svm);
-                push_i(svm, (dv2 <= dv1) ? 1 : 0);
+                double dv1 = pop_d(ctx);
+                double dv2 = pop_d(ctx);
+                push_i(ctx, (dv2 <= dv1) ? 1 : 0);
                 break;
             }
             case SVM_GT_INT: {
-                int iv1 = pop_i(svm);
-                int iv2 = pop_i(svm);
-                push_i(svm, (iv2 > iv1) ? 1 : 0);
+                int iv1 = pop_i(ctx);
+                int iv2 = pop_i(ctx);
+                push_i(ctx, (iv2 > iv1) ? 1 : 0);
                 break;
                 break;
             }
             case SVM_GT_DOUBLE: {
-                double dv1 = pop_d(svm);
-                double dv2 = pop_d(svm);
-                push_i(svm, (dv2 > dv1) ? 1 : 0);
+                double dv1 = pop_d(ctx);
+                double dv2 = pop_d(ctx);
+                push_i(ctx, (dv2 > dv1) ? 1 : 0);
                 break;
             }
             case SVM_GE_INT: {
-                int iv1 = pop_i(svm);
-                int iv2 = pop_i(svm);
-                push_i(svm, (iv2 >= iv1) ? 1 : 0);
+                int iv1 = pop_i(ctx);
+                int iv2 = pop_i(ctx);
+                push_i(ctx, (iv2 >= iv1) ? 1 : 0);
                 break;
             }
             case SVM_GE_DOUBLE: {
-                double dv1 = pop_d(svm);
-                double dv2 = pop_d(svm);
-                push_i(svm, (dv2 >= dv1) ? 1 : 0);
+                double dv1 = pop_d(ctx);
+                double dv2 = pop_d(ctx);
+                push_i(ctx, (dv2 >= dv1) ? 1 : 0);
                 break;
             }
             case SVM_EQ_INT: {
-                int iv1 = pop_i(svm);
-                int iv2 = pop_i(svm);
-                push_i(svm, (iv2 == iv1) ? 1 : 0);
+                int iv1 = pop_i(ctx);
+                int iv2 = pop_i(ctx);
+                push_i(ctx, (iv2 == iv1) ? 1 : 0);
                 break;
             }
             case SVM_EQ_DOUBLE: {
-                double dv1 = pop_d(svm);
-                double dv2 = pop_d(svm);
-                push_i(svm, (dv2 == dv1) ? 1 : 0);
+                double dv1 = pop_d(ctx);
+                double dv2 = pop_d(ctx);
+                push_i(ctx, (dv2 == dv1) ? 1 : 0);
                 break;
             }
             case SVM_NE_INT: {
-                int iv1 = pop_i(svm);
-                int iv2 = pop_i(svm);
-                push_i(svm, (iv2 != iv1) ? 1 : 0);
+                int iv1 = pop_i(ctx);
+                int iv2 = pop_i(ctx);
+                push_i(ctx, (iv2 != iv1) ? 1 : 0);
                 break;
             }
             case SVM_NE_DOUBLE: {
-                double dv1 = pop_d(svm);
-                double dv2 = pop_d(svm);
-                push_i(svm, (dv2 != dv1) ? 1 : 0);
+                double dv1 = pop_d(ctx);
+                double dv2 = pop_d(ctx);
+                push_i(ctx, (dv2 != dv1) ? 1 : 0);
                 break;
             }
             case SVM_CAST_DOUBLE_TO_INT: {
-                double dv = pop_d(svm);
-                push_i(svm, (int)dv);
+                double dv = pop_d(ctx);
+                push_i(ctx, (int)dv);
                 break;
             }
             case SVM_INCREMENT: {
-                int iv = pop_i(svm);
-                push_i(svm, ++iv);
+                int iv = pop_i(ctx);
+                push_i(ctx, ++iv);
                 break;
             }
             case SVM_DECREMENT: {
-                int iv = pop_i(svm);
-                push_i(svm, --iv);
+                int iv = pop_i(ctx);
+                push_i(ctx, --iv);
                 break;
             }
             case SVM_LOGICAL_AND: {
-                int iv1 = pop_i(svm);
-                int iv2 = pop_i(svm);
-                push_i(svm, (iv1 == 1 && iv2 == 1) ? 1 : 0);
+                int iv1 = pop_i(ctx);
+                int iv2 = pop_i(ctx);
+                push_i(ctx, (iv1 == 1 && iv2 == 1) ? 1 : 0);
                 break;
             }
             case SVM_LOGICAL_OR: {
-                int iv1 = pop_i(svm);
-                int iv2 = pop_i(svm);
-                push_i(svm, (iv1 == 1 || iv2 == 1) ? 1 : 0);
+                int iv1 = pop_i(ctx);
+                int iv2 = pop_i(ctx);
+                push_i(ctx, (iv1 == 1 || iv2 == 1) ? 1 : 0);
                 break;
             }
             case SVM_LOGICAL_NOT: {
-                int iv = pop_i(svm);
-                push_i(svm, (iv == 1) ? 0 : 1);
+                int iv = pop_i(ctx);
+                push_i(ctx, (iv == 1) ? 0 : 1);
                 break;
             }
             case SVM_MINUS_INT: {
-                int iv = pop_i(svm);
-                push_i(svm, -iv);
+                int iv = pop_i(ctx);
+                push_i(ctx, -iv);
                 break;
             }
             case SVM_MINUS_DOUBLE: {
-                double dv = pop_d(svm);
-                push_d(svm, -dv);
+                double dv = pop_d(ctx);
+                push_d(ctx, -dv);
                 break;
             }
             case SVM_CAST_INT_TO_DOUBLE: {
-                int i = pop_i(svm);
-                push_d(svm, (double)i);
+                int i = pop_i(ctx);
+                push_d(ctx, (double)i);
                 break;
             }
-            case SVM_PUSH_FUNCTION: {
-                uint16_t idx = fetch2(svm);
-                push_i(svm, idx);
+            case SVM_SQRT_DOUBLE: {
+                push_d(ctx, sqrt(pop_d(ctx)));
                 break;
             }
-            case SVM_INVOKE: {
-                uint16_t f_idx = pop_i(svm);
-                switch (svm->functions[f_idx].f_type) {
-                    case NATIVE_FUNCTION: {
-                        SVM_Value val = svm->functions[f_idx].u.n_func(
-                            svm,
-                            &svm->stack[svm->sp -
-                                        svm->functions[f_idx].arg_count],
-                            svm->functions[f_idx].arg_count);
-                        svm->sp -= svm->functions[f_idx].arg_count;
-                        svm->stack[svm->sp++] = val;
-                        break;
+            case SVM_ABS_INT: {
+                int iv = pop_i(ctx);
+                push_i(ctx, iv < 0 ? -iv : iv);
+                break;
+            }
+            case SVM_ABS_DOUBLE: {
+                push_d(ctx, fabs(pop_d(ctx)));
+                break;
+            }
+            case SVM_MIN_INT: {
+                int iv1 = pop_i(ctx);
+                int iv2 = pop_i(ctx);
+                push_i(ctx, iv2 < iv1 ? iv2 : iv1);
+                break;
+            }
+            case SVM_MIN_DOUBLE: {
+                double dv1 = pop_d(ctx);
+                double dv2 = pop_d(ctx);
+                push_d(ctx, dv2 < dv1 ? dv2 : dv1);
+                break;
+            }
+            case SVM_MAX_INT: {
+                int iv1 = pop_i(ctx);
+                int iv2 = pop_i(ctx);
+                push_i(ctx, iv2 > iv1 ? iv2 : iv1);
+                break;
+            }
+            case SVM_MAX_DOUBLE: {
+                double dv1 = pop_d(ctx);
+                double dv2 = pop_d(ctx);
+                push_d(ctx, dv2 > dv1 ? dv2 : dv1);
+                break;
+            }
+            case SVM_SELECT_INT: {
+                int iv2 = pop_i(ctx);
+                int iv1 = pop_i(ctx);
+                push_i(ctx, pop_i(ctx) ? iv1 : iv2);
+                break;
+            }
+            case SVM_SELECT_DOUBLE: {
+                double dv2 = pop_d(ctx);
+                double dv1 = pop_d(ctx);
+                push_d(ctx, pop_i(ctx) ? dv1 : dv2);
+                break;
+            }
+            case SVM_FLOOR_DOUBLE: {
+                push_d(ctx, floor(pop_d(ctx)));
+                break;
+            }
+            case SVM_FMA_INT: {  // a * b + c
+                int c = pop_i(ctx);
+                int b = pop_i(ctx);
+                int a = pop_i(ctx);
+                push_i(ctx, a * b + c);
+                break;
+            }
+            case SVM_FMA_DOUBLE: {
+                double c = pop_d(ctx);
+                double b = pop_d(ctx);
+                double a = pop_d(ctx);
+                push_d(ctx, fma(a, b, c));
+                break;
+            }
+            case SVM_SIN_DOUBLE: {
+                push_d(ctx, sin(pop_d(ctx)));
+                break;
+            }
+            case SVM_COS_DOUBLE: {
+                push_d(ctx, cos(pop_d(ctx)));
+                break;
+            }
+            case SVM_EXP_DOUBLE: {
+                push_d(ctx, exp(pop_d(ctx)));
+                break;
+            }
+            case SVM_LOG_DOUBLE: {
+                push_d(ctx, log(pop_d(ctx)));
+                break;
+            }
+            case SVM_NEW_ARRAY_INT:
+            case SVM_NEW_ARRAY_DOUBLE: {
+                uint8_t type = op == SVM_NEW_ARRAY_INT ? SVM_INT : SVM_DOUBLE;
+                int handle = svm_new_array(ctx->arrays, type, pop_i(ctx));
+                if (handle == 0) {
+                    return fault(ctx, op_pc, op_sp, SVM_ERROR_BAD_ARRAY);
+                }
+                push_i(ctx, handle);
+                break;
+            }
+            case SVM_LOAD_ARRAY_INT: {
+                int i;
+                SVM_Array *a = pop_element(ctx, &i);
+                if (a == NULL) {
+                    return fault(ctx, op_pc, op_sp, ctx->status);
+                }
+                push_i(ctx, ((int *)a->data)[i]);
+                break;
+            }
+            case SVM_LOAD_ARRAY_DOUBLE: {
+                int i;
+                SVM_Array *a = pop_element(ctx, &i);
+                if (a == NULL) {
+                    return fault(ctx, op_pc, op_sp, ctx->status);
+                }
+                push_d(ctx, ((double *)a->data)[i]);
+                break;
+            }
+            case SVM_STORE_ARRAY_INT: {
+                int i;
+                SVM_Array *a = pop_element(ctx, &i);
+                if (a == NULL) {
+                    return fault(ctx, op_pc, op_sp, ctx->status);
+                }
+                ((int *)a->data)[i] = pop_i(ctx);
+                break;
+            }
+            case SVM_STORE_ARRAY_DOUBLE: {
+                int i;
+                SVM_Array *a = pop_element(ctx, &i);
+                if (a == NULL) {
+                    return fault(ctx, op_pc, op_sp, ctx->status);
+                }
+                ((double *)a->data)[i] = pop_d(ctx);
+                break;
+            }
+            case SVM_LOAD_ARRAY_INT_UNCHECKED: {
+                int i;
+                SVM_Array *a = pop_element_unchecked(ctx, &i);
+                if (a == NULL) {
+                    return fault(ctx, op_pc, op_sp, ctx->status);
+                }
+                push_i(ctx, ((int *)a->data)[i]);
+                break;
+            }
+            case SVM_LOAD_ARRAY_DOUBLE_UNCHECKED: {
+                int i;
+                SVM_Array *a = pop_element_unchecked(ctx, &i);
+                if (a == NULL) {
+                    return fault(ctx, op_pc, op_sp, ctx->status);
+                }
+                push_d(ctx, ((double *)a->data)[i]);
+                break;
+            }
+            case SVM_STORE_ARRAY_INT_UNCHECKED: {
+                int i;
+                SVM_Array *a = pop_element_unchecked(ctx, &i);
+                if (a == NULL) {
+                    return fault(ctx, op_pc, op_sp, ctx->status);
+                }
+                ((int *)a->data)[i] = pop_i(ctx);
+                break;
+            }
+            case SVM_STORE_ARRAY_DOUBLE_UNCHECKED: {
+                int i;
+                SVM_Array *a = pop_element_unchecked(ctx, &i);
+                if (a == NULL) {
+                    return fault(ctx, op_pc, op_sp, ctx->status);
+                }
+                ((double *)a->data)[i] = pop_d(ctx);
+                break;
+            }
+            case SVM_ARRAY_LENGTH:
+            case SVM_ARRAY_SUM:
+            case SVM_ARRAY_MIN:
+            case SVM_ARRAY_MAX: {
+                SVM_Array *a = get_array(ctx, pop_i(ctx));
+                if (a == NULL) {
+                    return fault(ctx, op_pc, op_sp, SVM_ERROR_BAD_ARRAY);
+                }
+                if (op == SVM_ARRAY_LENGTH) {
+                    push_i(ctx, a->length);
+                } else {
+                    push_value(ctx, a->type,
+                               op == SVM_ARRAY_SUM   ? svm_array_sum(a)
+                               : op == SVM_ARRAY_MIN ? svm_array_min(a)
+                                                     : svm_array_max(a));
+                }
+                break;
+            }
+            case SVM_ARRAY_DOT: {
+                SVM_Array *a, *b;
+                if (!pop_array_pair(ctx, &a, &b)) {
+                    return fault(ctx, op_pc, op_sp, SVM_ERROR_BAD_ARRAY);
+                }
+                push_value(ctx, a->type, svm_array_dot(a, b));
+                break;
+            }
+            case SVM_ARRAY_AXPY: {  // alpha, x, y -> y
+                int y_handle = ctx->stack[ctx->sp - 1].ival;
+                SVM_Array *x, *y;
+                if (!pop_array_pair(ctx, &x, &y)) {
+                    return fault(ctx, op_pc, op_sp, SVM_ERROR_BAD_ARRAY);
+                }
+                svm_array_axpy(ctx->stack[--ctx->sp], x, y);
+                push_i(ctx, y_handle);
+                break;
+            }
+            case SVM_ARRAY_FILL: {  // a, value -> a
+                SVM_Value v = ctx->stack[--ctx->sp];
+                int handle = pop_i(ctx);
+                SVM_Array *a = get_array(ctx, handle);
+                if (a == NULL) {
+                    return fault(ctx, op_pc, op_sp, SVM_ERROR_BAD_ARRAY);
+                }
+                svm_array_fill(a, v);
+                push_i(ctx, handle);
+                break;
+            }
+            case SVM_ARRAY_COPY: {  // dst, src -> dst
+                int dst_handle = ctx->stack[ctx->sp - 2].ival;
+                SVM_Array *dst, *src;
+                if (!pop_array_pair(ctx, &dst, &src)) {
+                    return fault(ctx, op_pc, op_sp, SVM_ERROR_BAD_ARRAY);
+                }
+                svm_array_copy(dst, src);
+                push_i(ctx, dst_handle);
+                break;
+            }
+            case SVM_PUSH_STRING: {
+                uint16_t s_idx = fetch2(ctx);
+                push_i(ctx, s_idx + 1);
+                break;
+            }
+            case SVM_CONCAT_STRING: {
+                int rh = ctx->stack[ctx->sp - 1].ival;
+                int lh = ctx->stack[ctx->sp - 2].ival;
+                SVM_String a, b;
+                if (!pop_string_pair(ctx, &a, &b)) {
+                    return fault(ctx, op_pc, op_sp, SVM_ERROR_BAD_STRING);
+                }
+                if (a.length == 0 || b.length == 0) {  // no copy needed
+                    push_i(ctx, a.length ? lh : rh);
+                    break;
+                }
+                int handle =
+                    svm_new_string(ctx->strings, a.data, a.length, b.data,
+                                   b.length);
+                if (handle == 0) {
+                    return fault(ctx, op_pc, op_sp, SVM_ERROR_BAD_STRING);
+                }
+                push_i(ctx, handle);
+                break;
+            }
+            case SVM_SUBSTR_STRING: {  // s, start, length -> s[start..]
+                int length = pop_i(ctx);
+                int start = pop_i(ctx);
+                SVM_String str;
+                if (!svm_string(ctx, pop_i(ctx), &str)) {
+                    return fault(ctx, op_pc, op_sp, SVM_ERROR_BAD_STRING);
+                }
+                if (start < 0 || length < 0 ||
+                    (uint32_t)start > str.length ||
+                    (uint32_t)length > str.length - start) {
+                    return fault(ctx, op_pc, op_sp,
+                                 SVM_ERROR_INDEX_OUT_OF_RANGE);
+                }
+                int handle = 0;
+                if (length > 0) {
+                    handle = svm_new_string(ctx->strings, str.data + start,
+                                            length, "", 0);
+                    if (handle == 0) {
+                        return fault(ctx, op_pc, op_sp, SVM_ERROR_BAD_STRING);
                     }
-                    default: {
-                        fprintf(stderr, "no such function type in invoke\n");
-                        exit(1);
+                }
+                push_i(ctx, handle);
+                break;
+            }
+            case SVM_STRING_LENGTH: {
+                SVM_String str;
+                if (!svm_string(ctx, pop_i(ctx), &str)) {
+                    return fault(ctx, op_pc, op_sp, SVM_ERROR_BAD_STRING);
+                }
+                push_i(ctx, str.length);
+                break;
+            }
+            case SVM_EQ_STRING:
+            case SVM_NE_STRING: {
+                int rh = ctx->stack[ctx->sp - 1].ival;
+                int lh = ctx->stack[ctx->sp - 2].ival;
+                bool equal;
+                if (lh >= 0 && rh >= 0) {  // both interned
+                    equal = lh == rh;
+                    ctx->sp -= 2;
+                } else {
+                    SVM_String a, b;
+                    if (!pop_string_pair(ctx, &a, &b)) {
+                        return fault(ctx, op_pc, op_sp, SVM_ERROR_BAD_STRING);
+                    }
+                    equal = a.length == b.length &&
+                            memcmp(a.data, b.data, a.length) == 0;
+                }
+                push_i(ctx, op == SVM_EQ_STRING ? equal : !equal);
+                break;
+            }
+            case SVM_NEW_MAP_INT:
+            case SVM_NEW_MAP_DOUBLE: {
+                uint8_t type = op == SVM_NEW_MAP_INT ? SVM_INT : SVM_DOUBLE;
+                int handle = svm_new_map(ctx->maps, type);
+                if (handle == 0) {
+                    return fault(ctx, op_pc, op_sp, SVM_ERROR_BAD_MAP);
+                }
+                push_i(ctx, handle);
+                break;
+            }
+            case SVM_MAP_GET: {  // m, key -> value
+                int key = pop_i(ctx);
+                SVM_Map *m = get_map(ctx, pop_i(ctx));
+                if (m == NULL) {
+                    return fault(ctx, op_pc, op_sp, SVM_ERROR_BAD_MAP);
+                }
+                push_value(ctx, m->type, svm_map_get(m, key));
+                break;
+            }
+            case SVM_MAP_PUT:
+            case SVM_MAP_INCREMENT: {  // m, key, value -> value now held
+                SVM_Value v = ctx->stack[--ctx->sp];
+                int key = pop_i(ctx);
+                SVM_Map *m = get_map(ctx, pop_i(ctx));
+                if (m == NULL) {
+                    return fault(ctx, op_pc, op_sp, SVM_ERROR_BAD_MAP);
+                }
+                if (op == SVM_MAP_PUT) {
+                    v = svm_map_put(ctx->maps, m, key, v);
+                } else {
+                    v = svm_map_increment(ctx->maps, m, key, v);
+                }
+                push_value(ctx, m->type, v);
+                break;
+            }
+            case SVM_MAP_SIZE: {
+                SVM_Map *m = get_map(ctx, pop_i(ctx));
+                if (m == NULL) {
+                    return fault(ctx, op_pc, op_sp, SVM_ERROR_BAD_MAP);
+                }
+                push_i(ctx, m->count);
+                break;
+            }
+            case SVM_NEW_RECORD_ARRAY: {  // length -> handle
+                uint16_t stride = fetch2(ctx);
+                int handle =
+                    svm_new_record_array(ctx->arrays, stride, pop_i(ctx));
+                if (handle == 0) {
+                    return fault(ctx, op_pc, op_sp, SVM_ERROR_BAD_ARRAY);
+                }
+                push_i(ctx, handle);
+                break;
+            }
+            case SVM_LOAD_FIELD_INT:
+            case SVM_LOAD_FIELD_DOUBLE:
+            case SVM_LOAD_FIELD_INT_UNCHECKED:
+            case SVM_LOAD_FIELD_DOUBLE_UNCHECKED: {  // a, i -> a[i].field
+                uint16_t field = fetch2(ctx);
+                SVM_Value *v = pop_field(ctx, field,
+                                         op == SVM_LOAD_FIELD_INT ||
+                                             op == SVM_LOAD_FIELD_DOUBLE);
+                if (v == NULL) {
+                    return fault(ctx, op_pc, op_sp, ctx->status);
+                }
+                if (op == SVM_LOAD_FIELD_DOUBLE ||
+                    op == SVM_LOAD_FIELD_DOUBLE_UNCHECKED) {
+                    push_d(ctx, v->dval);
+                } else {
+                    push_i(ctx, v->ival);
+                }
+                break;
+            }
+            case SVM_STORE_FIELD_INT:
+            case SVM_STORE_FIELD_DOUBLE:
+            case SVM_STORE_FIELD_INT_UNCHECKED:
+            case SVM_STORE_FIELD_DOUBLE_UNCHECKED: {  // value, a, i
+                uint16_t field = fetch2(ctx);
+                SVM_Value *v = pop_field(ctx, field,
+                                         op == SVM_STORE_FIELD_INT ||
+                                             op == SVM_STORE_FIELD_DOUBLE);
+                if (v == NULL) {
+                    return fault(ctx, op_pc, op_sp, ctx->status);
+                }
+                if (op == SVM_STORE_FIELD_DOUBLE ||
+                    op == SVM_STORE_FIELD_DOUBLE_UNCHECKED) {
+                    v->dval = pop_d(ctx);
+                } else {
+                    v->ival = pop_i(ctx);
+                }
+                break;
+            }
+            case SVM_PUSH_STATIC_VECTOR: {
+                uint16_t s_idx = fetch2(ctx);
+                memcpy(&ctx->stack[ctx->sp], &ctx->global_variables[s_idx],
+                       sizeof(SVM_Value) * SVM_VECTOR_LANES);
+                memcpy(&ctx->stack_value_type[ctx->sp],
+                       &ctx->program->global_variable_types[s_idx],
+                       SVM_VECTOR_LANES);
+                ctx->sp += SVM_VECTOR_LANES;
+                break;
+            }
+            case SVM_POP_STATIC_VECTOR: {
+                uint16_t s_idx = fetch2(ctx);
+                ctx->sp -= SVM_VECTOR_LANES;
+                for (int i = 0; i < SVM_VECTOR_LANES; ++i) {
+                    SVM_Value *g = &ctx->global_variables[s_idx + i];
+                    if (ctx->stack_value_type[ctx->sp + i] == SVM_DOUBLE) {
+                        g->dval = ctx->stack[ctx->sp + i].dval;
+                    } else {
+                        g->ival = ctx->stack[ctx->sp + i].ival;
                     }
                 }
                 break;
             }
+            case SVM_SPLAT_INT4:
+            case SVM_SPLAT_DOUBLE4: {
+                uint8_t type = ctx->stack_value_type[ctx->sp - 1];
+                for (int i = 1; i < SVM_VECTOR_LANES; ++i) {
+                    if (type == SVM_DOUBLE) {
+                        push_d(ctx, ctx->stack[ctx->sp - 1].dval);
+                    } else {
+                        push_i(ctx, ctx->stack[ctx->sp - 1].ival);
+                    }
+                }
+                break;
+            }
+            case SVM_ADD_INT4:
+            case SVM_ADD_DOUBLE4:
+            case SVM_SUB_INT4:
+            case SVM_SUB_DOUBLE4:
+            case SVM_MUL_INT4:
+            case SVM_MUL_DOUBLE4:
+            case SVM_DIV_DOUBLE4: {  // a, b
+                ctx->sp -= SVM_VECTOR_LANES;
+                svm_vector_arith(op, vector_top(ctx), &ctx->stack[ctx->sp]);
+                break;
+            }
+            case SVM_MINUS_INT4:
+            case SVM_MINUS_DOUBLE4: {
+                svm_vector_unary(op, vector_top(ctx));
+                break;
+            }
+            case SVM_INT4_TO_DOUBLE4:
+            case SVM_DOUBLE4_TO_INT4: {
+                svm_vector_unary(op, vector_top(ctx));
+                tag_vector(ctx, op == SVM_INT4_TO_DOUBLE4 ? SVM_DOUBLE
+                                                          : SVM_INT);
+                break;
+            }
+            case SVM_COMPARE_INT4:
+            case SVM_COMPARE_DOUBLE4: {  // a, b
+                uint16_t comparison = fetch2(ctx);
+                ctx->sp -= SVM_VECTOR_LANES;
+                if (!svm_vector_compare(op, comparison, vector_top(ctx),
+                                        &ctx->stack[ctx->sp])) {
+                    ctx->sp += SVM_VECTOR_LANES;
+                    return fault(ctx, op_pc, op_sp, SVM_ERROR_UNKNOWN_OPCODE);
+                }
+                tag_vector(ctx, SVM_INT);
+                break;
+            }
+            case SVM_ALL_INT4:
+            case SVM_ANY_INT4:
+            case SVM_SUM_INT4:
+            case SVM_SUM_DOUBLE4:
+            case SVM_MIN_INT4:
+            case SVM_MIN_DOUBLE4:
+            case SVM_MAX_INT4:
+            case SVM_MAX_DOUBLE4: {
+                SVM_Value v = svm_vector_reduce(op, vector_top(ctx));
+                ctx->sp -= SVM_VECTOR_LANES;
+                push_value(ctx,
+                           op == SVM_SUM_DOUBLE4 || op == SVM_MIN_DOUBLE4 ||
+                                   op == SVM_MAX_DOUBLE4
+                               ? SVM_DOUBLE
+                               : SVM_INT,
+                           v);
+                break;
+            }
+            case SVM_DOT_INT4:
+            case SVM_DOT_DOUBLE4: {  // a, b
+                ctx->sp -= SVM_VECTOR_LANES;
+                SVM_Value v =
+                    svm_vector_dot(op, vector_top(ctx), &ctx->stack[ctx->sp]);
+                ctx->sp -= SVM_VECTOR_LANES;
+                push_value(ctx, op == SVM_DOT_DOUBLE4 ? SVM_DOUBLE : SVM_INT,
+                           v);
+                break;
+            }
+            case SVM_SHUFFLE_VECTOR: {
+                svm_vector_shuffle(vector_top(ctx), fetch2(ctx));
+                break;
+            }
+            case SVM_EXTRACT_VECTOR: {
+                uint16_t lane = fetch2(ctx);
+                if (lane >= SVM_VECTOR_LANES) {
+                    return fault(ctx, op_pc, op_sp, SVM_ERROR_UNKNOWN_OPCODE);
+                }
+                SVM_Value v = vector_top(ctx)[lane];
+                uint8_t type = ctx->stack_value_type[ctx->sp - 1];
+                ctx->sp -= SVM_VECTOR_LANES;
+                push_value(ctx, type, v);
+                break;
+            }
+            case SVM_INT_TO_STRING:
+            case SVM_DOUBLE_TO_STRING: {
+                char buf[512];  // room for any %f of a double
+                int len;
+                if (op == SVM_INT_TO_STRING) {
+                    len = snprintf(buf, sizeof(buf), "%d", pop_i(ctx));
+                } else {
+                    len = snprintf(buf, sizeof(buf), "%f", pop_d(ctx));
+                }
+                int handle = svm_new_string(ctx->strings, buf, len, "", 0);
+                if (handle == 0) {
+                    return fault(ctx, op_pc, op_sp, SVM_ERROR_BAD_STRING);
+                }
+                push_i(ctx, handle);
+                break;
+            }
+            case SVM_PUSH_FUNCTION: {
+                uint16_t idx = fetch2(ctx);
+                push_i(ctx, idx);
+                break;
+            }
+            case SVM_INVOKE: {
+                uint16_t f_idx = pop_i(ctx);
+                SVM_Status status = invoke(ctx, f_idx);
+                if (status == SVM_PENDING) return ctx->status = status;
+                if (status != SVM_FINISHED) {
+                    return fault(ctx, op_pc, op_sp, status);
+                }
+                break;
+            }
+            case SVM_INVOKE_NATIVE: {
+                uint16_t f_idx = fetch2(ctx);
+                SVM_Status status = invoke(ctx, f_idx);
+                if (status == SVM_PENDING) return ctx->status = status;
+                if (status != SVM_FINISHED) {
+                    return fault(ctx, op_pc, op_sp, status);
+                }
+                break;
+            }
             case SVM_POP: {
-                pop_i(svm);
+                pop_i(ctx);
                 break;
             }
             case SVM_GOTO: {
-                uint16_t s_idx = pop_i(svm);
+                if (!enter_segment(ctx, ctx->pc - 1, &progressed)) {
+                    ctx->pc--;
+                    return ctx->status = SVM_SUSPENDED;
+                }
+                uint16_t s_idx = pop_i(ctx);
                 if (s_idx) {
                     // True->Run code in Block
-                    fetch2(svm);  // skip label
+                    fetch2(ctx);  // skip label
                     break;
                 }
                 // False->GOTO
-                uint16_t s_idx_goto = fetch2(svm);
-
-                // skip until LABEL
-                while (running) {
-                    switch (op = fetch(svm)) {
-                        case SVM_LABEL: {
-                            uint16_t s_idx_label = fetch2(svm);
-                            if (s_idx_goto == s_idx_label) {
-                                goto END_WHILE;
-                            }
-                            break;
-                        }
-                        default: {
-                            OpcodeInfo *_oinfo = &svm_opcode_info[op];
-                            if (_oinfo->s_size >= 1) {
-                                int fetch_size = _oinfo->s_size;
-                                for (; fetch_size > 0; fetch_size--) {
-                                    fetch2(svm);  // trash
-                                }
-                            }
-                            break;
-                        }
-                    }
-                    running = svm->pc < svm->code_size;
+                uint16_t s_idx_goto = fetch2(ctx);
+                if (!jump_to_label(ctx, s_idx_goto)) {
+                    return fault(ctx, op_pc, op_sp,
+                                 SVM_ERROR_LABEL_NOT_FOUND);
                 }
-                fprintf(stderr, "cannot exit from if in svm_run\n");
-                show_status(svm);
-                exit(1);
-            END_WHILE:
                 break;
             }
             case SVM_LABEL: {
+                if (!enter_segment(ctx, ctx->pc - 1, &progressed)) {
+                    ctx->pc--;
+                    return ctx->status = SVM_SUSPENDED;
+                }
                 // skip label
-                fetch2(svm);
+                fetch2(ctx);
+                break;
+            }
+            case SVM_JUMP:
+            case SVM_TABLE_SWITCH:
+            case SVM_LOOKUP_SWITCH: {
+                if (!enter_segment(ctx, ctx->pc - 1, &progressed)) {
+                    ctx->pc--;
+                    return ctx->status = SVM_SUSPENDED;
+                }
+                uint16_t s_idx = fetch2(ctx);
+                uint16_t label = s_idx;
+                if (op == SVM_TABLE_SWITCH) {
+                    label = table_switch_label(read_static(ctx, s_idx),
+                                               pop_i(ctx));
+                } else if (op == SVM_LOOKUP_SWITCH) {
+                    label = lookup_switch_label(read_static(ctx, s_idx),
+                                                pop_i(ctx));
+                }
+                if (!jump_to_label(ctx, label)) {
+                    return fault(ctx, op_pc, op_sp, SVM_ERROR_LABEL_NOT_FOUND);
+                }
+                break;
+            }
+            case SVM_PARALLEL_FOR: {
+                // the whole loop runs as part of this segment
+                if (!enter_segment(ctx, ctx->pc - 1, &progressed)) {
+                    ctx->pc--;
+                    return ctx->status = SVM_SUSPENDED;
+                }
+                uint16_t desc = fetch2(ctx);
+                int upper = pop_i(ctx);
+                int lower = pop_i(ctx);
+                SVM_Status status = svm_parallel_for(ctx, desc, lower, upper);
+                if (status != SVM_FINISHED) {
+                    return fault(ctx, op_pc, op_sp, status);
+                }
+                break;
+            }
+            case SVM_PARALLEL_END: {
+                if (ctx->pc - 1 == ctx->stop_pc) {
+                    // one iteration of a parallel for worker is done
+                    ctx->pc--;
+                    return ctx->status = SVM_FINISHED;
+                }
+                if (!enter_segment(ctx, ctx->pc - 1, &progressed)) {
+                    ctx->pc--;
+                    return ctx->status = SVM_SUSPENDED;
+                }
+                break;
+            }
+            case SVM_FORK: {
+                // every segment runs as part of this one
+                if (!enter_segment(ctx, ctx->pc - 1, &progressed)) {
+                    ctx->pc--;
+                    return ctx->status = SVM_SUSPENDED;
+                }
+                uint16_t segment_count = fetch2(ctx);
+                SVM_Status status = svm_fork(ctx, segment_count);
+                if (status != SVM_FINISHED) {
+                    return fault(ctx, op_pc, op_sp, status);
+                }
+                break;
+            }
+            case SVM_JOIN: {
+                if (ctx->pc - 1 == ctx->stop_pc) {
+                    // this worker's segment is done
+                    ctx->pc--;
+                    return ctx->status = SVM_FINISHED;
+                }
+                if (!enter_segment(ctx, ctx->pc - 1, &progressed)) {
+                    ctx->pc--;
+                    return ctx->status = SVM_SUSPENDED;
+                }
                 break;
             }
             default: {
-                fprintf(stderr, "unknown opcode: %02x in svm_run\n", op);
-                show_status(svm);
-                exit(1);
+                return fault(ctx, op_pc, op_sp, SVM_ERROR_UNKNOWN_OPCODE);
             }
         }
 
-        running = svm->pc < svm->code_size;
+        running = ctx->pc < ctx->program->code_size;
     }
-    show_status(svm);
+    return ctx->status = SVM_FINISHED;
 }
 
-int main(int argc, char *argv[]) {
-    // for test
-    bool disasm_mode = false;
-    int file_idx = 1;
-    if (argc < 2) {
-        fprintf(stderr, "Usage ./svm [optino] file\n");
-        exit(1);
+/* Run to the end, waiting in place for every async native. */
+SVM_Status svm_run(SVM_Context *ctx) {
+    SVM_Status status;
+    while ((status = svm_run_slice(ctx, SVM_UNLIMITED, 0)) == SVM_PENDING) {
+        if (svm_wait_completion(ctx) != SVM_SUSPENDED) break;
     }
+    return ctx->status;
+}
 
-    if (argc == 3) {
-        if (!strcmp("-d", argv[1])) {
-            printf("disasm\n");
-            file_idx++;
-            disasm_mode = true;
-        } else {
-            fprintf(stderr, "No such option)\n");
+/* Hand a parked context the value of its async native. */
+void svm_complete(SVM_Context *ctx, SVM_Value result) {
+    ctx->stack_value_type[ctx->sp] = SVM_INT;  // as from an untyped native
+    ctx->stack[ctx->sp++] = result;
+    ctx->status = SVM_SUSPENDED;
+}
+
+/*
+ * Block the calling thread until the parked context's completion is done.
+ * Returns SVM_SUSPENDED when it can run again.
+ */
+SVM_Status svm_wait_completion(SVM_Context *ctx) {
+    if (ctx->status != SVM_PENDING) return ctx->status;
+    SVM_Completion *completion = &ctx->completion;
+    SVM_Value result;
+    for (;;) {
+        struct pollfd fds;
+        fds.fd = completion->fd;
+        fds.events = completion->events;
+        fds.revents = 0;
+        if (poll(&fds, 1, -1) < 0) {
+            if (errno == EINTR) continue;
+            return ctx->status = SVM_ERROR_IO;
         }
+        if (completion->ready(ctx, completion, &result)) break;
     }
+    svm_complete(ctx, result);
+    return ctx->status;
+}
 
-    SVM_VirtualMachine *svm = svm_create();
-    struct stat st;
-    stat(argv[file_idx], &st);
-    uint8_t *buf = (uint8_t *)malloc(st.st_size);
-    int fp = open(argv[file_idx], O_RDONLY);
-    read(fp, buf, st.st_size);
-    parse(buf, svm);
-    close(fp);
-    free(buf);
-
-    if (disasm_mode) {
-        disasm(svm);
-    } else {
-        add_native_functions(svm);
-        init_svm(svm);
-        svm_run(svm);
+/* Read up to size bytes from fd, stopping early only at end of input. */
+ssize_t svm_read_full(int fd, void *buf, size_t size) {
+    uint8_t *p = (uint8_t *)buf;
+    size_t total = 0;
+    while (total < size) {
+        ssize_t n = read(fd, p + total, size - total);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        if (n == 0) break;
+        total += n;
     }
+    return total;
+}
 
-    svm_delete(svm);
-    MEM_dump_memory();
+/* Write all size bytes to fd. */
+bool svm_write_full(int fd, const void *buf, size_t size) {
+    const uint8_t *p = (const uint8_t *)buf;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
 
-    return 0;
+const char *svm_status_message(SVM_Status status) {
+    switch (status) {
+        case SVM_FINISHED: {
+            return "finished";
+        }
+        case SVM_SUSPENDED: {
+            return "suspended";
+        }
+        case SVM_ERROR_BAD_IMAGE: {
+            return "broken executable image";
+        }
+        case SVM_ERROR_UNKNOWN_OPCODE: {
+            return "unknown opcode";
+        }
+        case SVM_ERROR_UNKNOWN_TYPE: {
+            return "unknown value type";
+        }
+        case SVM_ERROR_PT_STACK_OVERFLOW: {
+            return "pointer stack overflow";
+        }
+        case SVM_ERROR_PT_STACK_UNDERFLOW: {
+            return "pointer stack underflow";
+        }
+        case SVM_ERROR_LABEL_NOT_FOUND: {
+            return "branch target label not found";
+        }
+        case SVM_ERROR_BAD_FUNCTION: {
+            return "invalid function";
+        }
+        case SVM_ERROR_BAD_SNAPSHOT: {
+            return "snapshot does not match the program";
+        }
+        case SVM_ERROR_IO: {
+            return "file or descriptor I/O failed";
+        }
+        case SVM_PENDING: {
+            return "waiting for an async native";
+        }
+        case SVM_ERROR_BAD_ARRAY: {
+            return "no such array, or arrays of different length";
+        }
+        case SVM_ERROR_INDEX_OUT_OF_RANGE: {
+            return "index out of range";
+        }
+        case SVM_ERROR_BAD_STRING: {
+            return "no such string, or the string arena is full";
+        }
+        case SVM_ERROR_BAD_MAP: {
+            return "no such map";
+        }
+        case SVM_ERROR_DIVISION_BY_ZERO: {
+            return "integer division by zero";
+        }
+        default: {
+            return "unknown status";
+        }
+    }
 }
@@ -1,10 +1,17 @@
 
 #ifndef _SVM_H_
 #define _SVM_H_
+#include <pthread.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
 
-typedef struct SVM_VirtualMachine_tag SVM_VirtualMachine;
+#include "../memory/MEM.h"
+
+typedef struct SVM_Program_tag SVM_Program;
+typedef struct SVM_Context_tag SVM_Context;
 
 typedef enum {
     SVM_PUSH_INT = 1,
@@ -55,9 +62,135 @@ typedef enum {
     SVM_INVOKE,
     SVM_RETURN,
     SVM_GOTO,
-    SVM_LABEL
+    SVM_LABEL,
+    SVM_PARALLEL_FOR,
+    SVM_PARALLEL_END,
+    SVM_FORK,
+    SVM_JOIN,
+    SVM_INVOKE_NATIVE,
+    SVM_SQRT_DOUBLE,
+    SVM_ABS_INT,
+    SVM_ABS_DOUBLE,
+    SVM_MIN_INT,
+    SVM_MIN_DOUBLE,
+    SVM_MAX_INT,
+    SVM_MAX_DOUBLE,
+    SVM_FLOOR_DOUBLE,
+    SVM_FMA_INT,
+    SVM_FMA_DOUBLE,
+    SVM_SIN_DOUBLE,
+    SVM_COS_DOUBLE,
+    SVM_EXP_DOUBLE,
+    SVM_LOG_DOUBLE,
+    SVM_NEW_ARRAY_INT,
+    SVM_NEW_ARRAY_DOUBLE,
+    SVM_LOAD_ARRAY_INT,
+    SVM_LOAD_ARRAY_DOUBLE,
+    SVM_STORE_ARRAY_INT,
+    SVM_STORE_ARRAY_DOUBLE,
+    SVM_LOAD_ARRAY_INT_UNCHECKED,  // index proven in range by the compiler
+    SVM_LOAD_ARRAY_DOUBLE_UNCHECKED,
+    SVM_STORE_ARRAY_INT_UNCHECKED,
+    SVM_STORE_ARRAY_DOUBLE_UNCHECKED,
+    SVM_ARRAY_LENGTH,
+    SVM_ARRAY_SUM,
+    SVM_ARRAY_DOT,
+    SVM_ARRAY_MIN,
+    SVM_ARRAY_MAX,
+    SVM_ARRAY_AXPY,
+    SVM_ARRAY_FILL,
+    SVM_ARRAY_COPY,
+    SVM_PUSH_STRING,
+    SVM_CONCAT_STRING,
+    SVM_SUBSTR_STRING,
+    SVM_STRING_LENGTH,
+    SVM_EQ_STRING,
+    SVM_NE_STRING,
+    SVM_INT_TO_STRING,
+    SVM_DOUBLE_TO_STRING,
+    SVM_NEW_MAP_INT,
+    SVM_NEW_MAP_DOUBLE,
+    SVM_MAP_GET,
+    SVM_MAP_PUT,
+    SVM_MAP_INCREMENT,
+    SVM_MAP_SIZE,
+    SVM_NEW_RECORD_ARRAY,  // operand: values per record
+    SVM_LOAD_FIELD_INT,    // operand: slot of the field in a record
+    SVM_LOAD_FIELD_DOUBLE,
+    SVM_STORE_FIELD_INT,
+    SVM_STORE_FIELD_DOUBLE,
+    SVM_LOAD_FIELD_INT_UNCHECKED,
+    SVM_LOAD_FIELD_DOUBLE_UNCHECKED,
+    SVM_STORE_FIELD_INT_UNCHECKED,
+    SVM_STORE_FIELD_DOUBLE_UNCHECKED,
+    SVM_PUSH_STATIC_VECTOR,  // operand: first of the SVM_VECTOR_LANES globals
+    SVM_POP_STATIC_VECTOR,
+    SVM_SPLAT_INT4,
+    SVM_SPLAT_DOUBLE4,
+    SVM_ADD_INT4,
+    SVM_ADD_DOUBLE4,
+    SVM_SUB_INT4,
+    SVM_SUB_DOUBLE4,
+    SVM_MUL_INT4,
+    SVM_MUL_DOUBLE4,
+    SVM_DIV_DOUBLE4,
+    SVM_MINUS_INT4,
+    SVM_MINUS_DOUBLE4,
+    SVM_COMPARE_INT4,  // operand: SVM_Comparison, gives an int4 of 1 and 0
+    SVM_COMPARE_DOUBLE4,
+    SVM_ALL_INT4,
+    SVM_ANY_INT4,
+    SVM_SUM_INT4,
+    SVM_SUM_DOUBLE4,
+    SVM_MIN_INT4,
+    SVM_MIN_DOUBLE4,
+    SVM_MAX_INT4,
+    SVM_MAX_DOUBLE4,
+    SVM_DOT_INT4,
+    SVM_DOT_DOUBLE4,
+    SVM_SHUFFLE_VECTOR,  // operand: source lane of each lane, 2 bits apiece
+    SVM_EXTRACT_VECTOR,  // operand: lane
+    SVM_INT4_TO_DOUBLE4,
+    SVM_DOUBLE4_TO_INT4,
+    SVM_JUMP,           // operand: label
+    SVM_TABLE_SWITCH,   // operand: first constant of the table
+    SVM_LOOKUP_SWITCH,
+    SVM_SELECT_INT,     // condition, if true, if false -> one of them
+    SVM_SELECT_DOUBLE,
+    SVM_OPCODE_PLUS_ONE
 } SVM_Opcode;
 
+typedef enum {
+    SVM_FINISHED = 0,
+    SVM_SUSPENDED,
+    SVM_ERROR_BAD_IMAGE,
+    SVM_ERROR_UNKNOWN_OPCODE,
+    SVM_ERROR_UNKNOWN_TYPE,
+    SVM_ERROR_PT_STACK_OVERFLOW,
+    SVM_ERROR_PT_STACK_UNDERFLOW,
+    SVM_ERROR_LABEL_NOT_FOUND,
+    SVM_ERROR_BAD_FUNCTION,
+    SVM_ERROR_BAD_SNAPSHOT,
+    SVM_ERROR_IO,
+    SVM_PENDING,  // parked in an async native, see SVM_Completion
+    SVM_ERROR_BAD_ARRAY,
+    SVM_ERROR_INDEX_OUT_OF_RANGE,
+    SVM_ERROR_BAD_STRING,
+    SVM_ERROR_BAD_MAP,
+    SVM_ERROR_DIVISION_BY_ZERO,  // also INT_MIN / -1, which traps the same
+} SVM_Status;
+
+/* How a parallel for merges a reduction variable. */
+typedef enum {
+    SVM_REDUCE_SUM = 1,
+    SVM_REDUCE_MIN,
+    SVM_REDUCE_MAX,
+    SVM_REDUCE_PLUS_ONE
+} SVM_Reduction;
+
+#define SVM_UNLIMITED (UINT64_MAX)
+#define SVM_LANES (8)
+
 typedef enum {
     SVM_INT = 1,
     SVM_DOUBLE,
@@ -82,47 +215,500 @@ typedef struct {
     char s_size;
 } OpcodeInfo;
 
-typedef enum { NATIVE_FUNCTION, CSUA_FUNCTION } FunctionType;
+typedef enum {
+    NATIVE_FUNCTION,
+    CSUA_FUNCTION,
+    ASYNC_NATIVE_FUNCTION,
+    TYPED_NATIVE_FUNCTION
+} FunctionType;
+
+/*
+ * Signatures a typed native may have, as
+ *   X(name, C return type, SVM_Value member, SVM type, parameter types,
+ *     (parameters), (call))
+ * where the parameter types spell one 'i' or 'd' per argument, for the
+ * compiler to check a prototype against. The VM calls a typed native
+ * straight through a pointer of that C type, so plain C functions such
+ * as sqrt() register without a wrapper.
+ */
+#define SVM_SIGNATURES(X)                                                    \
+    X(SVM_SIG_I_V, int, ival, SVM_INT, "", (void), ())                       \
+    X(SVM_SIG_I_I, int, ival, SVM_INT, "i", (int), (a[0].ival))              \
+    X(SVM_SIG_I_II, int, ival, SVM_INT, "ii", (int, int),                    \
+      (a[0].ival, a[1].ival))                                                \
+    X(SVM_SIG_I_D, int, ival, SVM_INT, "d", (double), (a[0].dval))           \
+    X(SVM_SIG_I_DD, int, ival, SVM_INT, "dd", (double, double),              \
+      (a[0].dval, a[1].dval))                                                \
+    X(SVM_SIG_D_V, double, dval, SVM_DOUBLE, "", (void), ())                 \
+    X(SVM_SIG_D_I, double, dval, SVM_DOUBLE, "i", (int), (a[0].ival))        \
+    X(SVM_SIG_D_D, double, dval, SVM_DOUBLE, "d", (double), (a[0].dval))     \
+    X(SVM_SIG_D_DD, double, dval, SVM_DOUBLE, "dd", (double, double),        \
+      (a[0].dval, a[1].dval))                                                \
+    X(SVM_SIG_D_DI, double, dval, SVM_DOUBLE, "di", (double, int),           \
+      (a[0].dval, a[1].ival))
+
+#define SVM_SIG_ENUM(sig, ret, member, type, args, params, call) sig,
+typedef enum {
+    SVM_SIG_NONE = 0,  // takes an SVM_Value window instead
+    SVM_SIGNATURES(SVM_SIG_ENUM) SVM_SIG_PLUS_ONE
+} SVM_Signature;
+#undef SVM_SIG_ENUM
 
-typedef SVM_Value (*SVM_NativeFunction)(SVM_VirtualMachine *svm,
-                                        SVM_Value *values, int arg_count);
+typedef void (*SVM_TypedNative)(void);  // cast to its signature to call
+
+typedef SVM_Value (*SVM_NativeFunction)(SVM_Context *ctx, SVM_Value *values,
+                                        int arg_count);
+
+/*
+ * An async native either stores its value in *result and returns
+ * SVM_FINISHED, or fills ctx->completion and returns SVM_PENDING. The
+ * context is then parked just after the SVM_INVOKE with the arguments
+ * popped, and svm_complete() pushes the value once it is there.
+ */
+typedef SVM_Status (*SVM_AsyncNativeFunction)(SVM_Context *ctx,
+                                              SVM_Value *values,
+                                              int arg_count,
+                                              SVM_Value *result);
+
+typedef struct SVM_Completion_tag SVM_Completion;
+
+/* Called once completion->fd is ready; returns false to keep waiting. */
+typedef bool (*SVM_CompletionHandler)(SVM_Context *ctx,
+                                      SVM_Completion *completion,
+                                      SVM_Value *result);
+
+/* What a parked context waits for. The fd belongs to the native. */
+struct SVM_Completion_tag {
+    int fd;
+    uint32_t events;  // POLLIN / POLLOUT
+    SVM_CompletionHandler ready;
+    void *data;  // for the native
+};
 
 typedef struct {
     FunctionType f_type;
     char *name;
     int arg_count;
+    bool pure;  // result depends on the arguments only, no side effect
+    bool memo;  // pure and slow enough to keep its results, see SVM_MemoEntry
+    SVM_Signature signature;  // TYPED_NATIVE_FUNCTION only
     union {
         SVM_NativeFunction n_func;
+        SVM_AsyncNativeFunction a_func;
+        SVM_TypedNative t_func;
     } u;
 } SVM_Function;
 
-struct SVM_VirtualMachine_tag {
+/*
+ * A recent result of a memo native. Each context keeps SVM_MEMO_ENTRIES,
+ * direct mapped on the function and the argument bits; an int argument
+ * counts by its value alone.
+ */
+#define SVM_MEMO_ENTRIES (64)
+#define SVM_MEMO_ARGS (2)  // the most a typed native takes
+typedef struct {
+    uint32_t function;  // index + 1, 0 when empty
+    uint64_t key[SVM_MEMO_ARGS];
+    SVM_Value value;
+} SVM_MemoEntry;
+
+#define SVM_ARRAY_ALIGN (64)  // one cache line, one AVX-512 vector
+
+/*
+ * int4 and double4 values take SVM_VECTOR_LANES consecutive slots, lane 0
+ * lowest, on the stack and among the globals. The lanes of a double4 are
+ * then one 32-byte vector; an int4 lane keeps its int in the low half of
+ * the slot.
+ */
+#define SVM_VECTOR_LANES (4)
+
+typedef enum {
+    SVM_COMPARE_EQ = 0,
+    SVM_COMPARE_NE,
+    SVM_COMPARE_LT,
+    SVM_COMPARE_LE,
+    SVM_COMPARE_GT,
+    SVM_COMPARE_GE,
+    SVM_COMPARISON_PLUS_ONE
+} SVM_Comparison;
+
+/*
+ * Switch tables are consecutive int constants from the operand on:
+ *
+ *   SVM_TABLE_SWITCH   low, count, default, label[count]
+ *   SVM_LOOKUP_SWITCH  count, default, {key, label}[count] sorted by key
+ *
+ * Both pop an int and jump to the label of its case, or to default.
+ */
+#define SVM_NO_LABEL (UINT32_MAX)
+
+/*
+ * Elements of an array, zero filled and SVM_ARRAY_ALIGN aligned. A record
+ * array holds length records of stride values each, one after another.
+ */
+typedef struct {
+    uint8_t type;  // SVM_INT or SVM_DOUBLE, SVM_INT for a record array
+    uint32_t length;
+    uint32_t stride;  // values per record, 0 unless a record array
+    void *data;       // int[length], double[length] or SVM_Value[]
+} SVM_Array;
+
+/*
+ * Arrays a context allocated. A global holds an array as its index + 1,
+ * so 0 is no array. Arrays live until the context is reset or deleted.
+ */
+typedef struct {
+    MEM_Controller controller;
+    uint32_t count;
+    uint32_t capacity;
+    SVM_Array *arrays;
+} SVM_ArrayHeap;
+
+#define SVM_MAP_EMPTY INT32_MIN  // key of a free slot
+
+/*
+ * Open addressing table from int keys to int or double values, probed
+ * linearly and kept at most half full. Keys and values are separate
+ * SVM_ARRAY_ALIGN aligned arrays, so a probe sequence walks one run of
+ * keys and a hit costs one more line for its value. The key SVM_MAP_EMPTY
+ * itself is held beside the table.
+ */
+typedef struct {
+    uint8_t type;  // SVM_INT or SVM_DOUBLE, of the values
+    uint8_t shift;  // 32 - log2(capacity)
+    bool has_empty_key;
+    uint32_t count;
+    uint32_t capacity;  // a power of two, 0 before the first insert
+    int32_t *keys;
+    void *values;  // int[capacity] or double[capacity]
+    SVM_Value empty_value;
+} SVM_Map;
+
+/* Maps a context allocated, held by index + 1 like SVM_ArrayHeap. */
+typedef struct {
+    MEM_Controller controller;
+    uint32_t count;
+    uint32_t capacity;
+    SVM_Map *maps;
+} SVM_MapHeap;
+
+/*
+ * A string value is an int handle: i + 1 for string i of the program,
+ * -(offset + 1) for a string built at run time in the arena, and 0 for "".
+ * Program strings are interned, so two of them are equal exactly when
+ * their handles are.
+ */
+typedef struct {
+    uint32_t length;
+    const char *data;  // NUL terminated
+} SVM_String;
+
+/*
+ * Bump allocator for strings built by SVM_CONCAT_STRING and friends. Each
+ * record is a uint32_t length, the bytes and a NUL, 4-byte aligned. The
+ * whole arena is dropped at once when the context is reset.
+ */
+typedef struct {
+    MEM_Controller controller;
+    uint32_t used;
+    uint32_t capacity;
+    uint8_t *bytes;
+} SVM_StringArena;
+
+/*
+ * Everything loaded from an executable. A program is never written once
+ * loaded and prepared, so any number of contexts may run it at the same
+ * time from different threads, or share its pages across fork().
+ */
+struct SVM_Program_tag {
+    MEM_Controller controller;
     uint32_t constant_pool_count;
     SVM_Constant *constant_pool;
     uint32_t global_variable_count;
-    SVM_Value *global_variables;
     uint8_t *global_variable_types;
+    char **global_variable_names;  // NULL when the image has no names
     uint32_t code_size;
     uint8_t *code;
+    uint32_t string_count;
+    SVM_String *strings;  // deduplicated literals
     uint32_t function_count;
-    SVM_Function *functions;
+    uint32_t function_capacity;  // 0 while functions is a shared table
+    const SVM_Function *functions;
     uint32_t stack_size;
+    uint32_t pt_stack_size;   //
+    uint32_t *segment_cost;   // instructions per straight-line segment
+    uint32_t label_count;
+    uint32_t *label_pc;       // where each label is, SVM_NO_LABEL if nowhere
+    SVM_Value *global_image;  // initial value of every global
+};
+
+/* State of one execution of a program. */
+struct SVM_Context_tag {
+    MEM_Controller controller;  // private allocator of this context
+    const SVM_Program *program;
+    FILE *out;  // where natives and status write
+    SVM_Value *global_variables;
+    void *segment;  // mapping that holds global_variables, or NULL
+    size_t segment_size;
     uint8_t *stack_value_type;
     SVM_Value *stack;
-    uint32_t pt_stack_size;  //
-    size_t *pt_stack;        //
-    size_t pt_stack_count;   //
+    size_t *pt_stack;       //
+    size_t pt_stack_count;  //
     uint32_t pc;
     uint32_t sp;
+    uint64_t budget;    // instructions left in the current slice
+    uint64_t deadline;  // CLOCK_MONOTONIC ns, 0 = none
+    uint32_t stop_pc;   // PARALLEL_END or JOIN ending a worker, 0 = none
+    SVM_Status status;
+    SVM_Completion completion;  // valid while status is SVM_PENDING
+    SVM_ArrayHeap heap;
+    SVM_ArrayHeap *arrays;  // &heap, or the parent's in a parallel worker
+    SVM_StringArena arena;
+    SVM_StringArena *strings;  // &arena, or the parent's in a worker
+    SVM_MapHeap map_heap;
+    SVM_MapHeap *maps;  // &map_heap, or the parent's in a worker
+    SVM_MemoEntry *memo;  // NULL until a memo native is called
 };
 
 extern OpcodeInfo svm_opcode_info[];
+extern const uint8_t svm_signature_type[];  // SVM type of each return
+extern const char *svm_signature_args[];     // its parameter types
+
+/*
+ * Contexts of one program kept initialised between runs, for callers that
+ * execute the same short script once per request.
+ */
+typedef struct {
+    MEM_Controller controller;  // guarded by lock
+    const SVM_Program *program;
+    pthread_mutex_t lock;
+    uint32_t count;  // idle contexts in free_list
+    uint32_t capacity;
+    SVM_Context **free_list;
+} SVM_ContextPool;
+
+typedef enum {
+    SVM_PRIORITY_HIGH = 0,
+    SVM_PRIORITY_NORMAL,
+    SVM_PRIORITY_LOW,
+    SVM_PRIORITY_PLUS_ONE
+} SVM_Priority;
+
+#define SVM_DEFAULT_SLICE (10000)
+#define SVM_LATENCY_BUCKETS (64)
+
+typedef struct SVM_Scheduler_tag SVM_Scheduler;
+typedef struct SVM_Task_tag SVM_Task;
+typedef struct SVM_EventLoop_tag SVM_EventLoop;
+
+typedef struct {
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t slices;
+    uint64_t steals;
+    uint64_t total_latency_ns;  // submit to finish, summed
+    uint64_t max_latency_ns;
+    uint64_t elapsed_ns;  // since the scheduler was created
+    // completed tasks by floor(log2(latency in ns))
+    uint64_t latency_histogram[SVM_LATENCY_BUCKETS];
+} SVM_SchedulerMetrics;
+
+/* Initial globals for a sweep, one row per run. */
+typedef struct {
+    uint32_t column_count;
+    uint32_t *globals;  // global index bound by each column
+    uint32_t row_count;
+    SVM_Value *rows;  // row_count * column_count, row by row
+} SVM_SweepTable;
+
+/* Selected globals after each run, stored column by column. */
+typedef struct {
+    uint32_t column_count;
+    uint32_t *globals;
+    uint32_t row_count;
+    SVM_Value **columns;  // columns[column][row]
+    uint8_t *status;      // SVM_Status of each row
+} SVM_SweepResult;
+
+typedef struct {
+    uint32_t process_count;
+    uint32_t batch_rows;    // rows per request sent to a worker
+    uint32_t max_attempts;  // workers a batch may take down before failing
+    int64_t kill_batch;     // test hook: kill the first runner, -1 = off
+} SVM_ClusterOptions;
+
+typedef enum {
+    SVM_FIELD_I32 = 1,
+    SVM_FIELD_I64,
+    SVM_FIELD_F32,
+    SVM_FIELD_F64,
+    SVM_FIELD_SKIP,
+} SVM_FieldType;
+
+typedef struct {
+    SVM_FieldType type;
+    uint32_t global;
+    uint32_t size;
+    uint32_t offset;  // from the start of the record
+} SVM_RecordField;
+
+/* Fixed binary record, fields packed in native byte order. */
+typedef struct {
+    uint32_t field_count;
+    SVM_RecordField *fields;
+    uint32_t size;
+} SVM_RecordLayout;
 
 /* svm.c */
-void svm_add_native_function(SVM_VirtualMachine *svm,
+SVM_Program *svm_create_program();
+void svm_delete_program(SVM_Program *program);
+SVM_Status svm_load(SVM_Program *program, uint8_t *buf, size_t size);
+SVM_Status svm_prepare_program(SVM_Program *program);
+void svm_disasm(SVM_Program *program);
+void svm_set_native_functions(SVM_Program *program,
+                              const SVM_Function *functions, uint32_t count);
+void svm_add_native_function(SVM_Program *program,
                              SVM_NativeFunction native_f, char *name,
                              int arg_count);
+void svm_add_typed_native_function(SVM_Program *program,
+                                   SVM_TypedNative t_func, char *name,
+                                   int arg_count, SVM_Signature signature,
+                                   bool pure, bool memo);
+SVM_Context *svm_create_context(const SVM_Program *program);
+void svm_delete_context(SVM_Context *ctx);
+SVM_Status svm_init(SVM_Context *ctx);
+SVM_Status svm_run(SVM_Context *ctx);
+SVM_Status svm_run_slice(SVM_Context *ctx, uint64_t max_instructions,
+                         uint64_t deadline_ns);
+const char *svm_status_message(SVM_Status status);
+void svm_show_status(SVM_Context *ctx);
+bool svm_same_globals(const SVM_Context *a, const SVM_Context *b);
+SVM_Value svm_call_typed(const SVM_Function *func, const SVM_Value *a);
+void svm_complete(SVM_Context *ctx, SVM_Value result);
+SVM_Status svm_wait_completion(SVM_Context *ctx);
+ssize_t svm_read_full(int fd, void *buf, size_t size);
+bool svm_write_full(int fd, const void *buf, size_t size);
+
+/* array.c */
+void svm_init_arrays(SVM_Context *ctx);
+void svm_free_arrays(SVM_ArrayHeap *heap);
+int svm_new_array(SVM_ArrayHeap *heap, uint8_t type, int length);
+int svm_new_record_array(SVM_ArrayHeap *heap, int stride, int length);
+size_t svm_array_size(const SVM_Array *a);
+SVM_Value svm_array_sum(const SVM_Array *a);
+SVM_Value svm_array_dot(const SVM_Array *a, const SVM_Array *b);
+SVM_Value svm_array_min(const SVM_Array *a);
+SVM_Value svm_array_max(const SVM_Array *a);
+void svm_array_axpy(SVM_Value alpha, const SVM_Array *x, SVM_Array *y);
+void svm_array_fill(SVM_Array *a, SVM_Value v);
+void svm_array_copy(SVM_Array *dst, const SVM_Array *src);
+
+/* vector.c */
+void svm_vector_arith(uint8_t op, SVM_Value *a, const SVM_Value *b);
+void svm_vector_unary(uint8_t op, SVM_Value *a);
+bool svm_vector_compare(uint8_t op, int comparison, SVM_Value *a,
+                        const SVM_Value *b);
+SVM_Value svm_vector_reduce(uint8_t op, const SVM_Value *a);
+SVM_Value svm_vector_dot(uint8_t op, const SVM_Value *a, const SVM_Value *b);
+void svm_vector_shuffle(SVM_Value *a, int lanes);
+
+/* map.c */
+void svm_init_maps(SVM_Context *ctx);
+void svm_free_maps(SVM_MapHeap *heap);
+int svm_new_map(SVM_MapHeap *heap, uint8_t type);
+void svm_map_alloc(SVM_MapHeap *heap, SVM_Map *map, uint32_t capacity);
+SVM_Value svm_map_get(const SVM_Map *map, int key);
+SVM_Value svm_map_put(SVM_MapHeap *heap, SVM_Map *map, int key, SVM_Value v);
+SVM_Value svm_map_increment(SVM_MapHeap *heap, SVM_Map *map, int key,
+                            SVM_Value delta);
+
+/* string.c */
+void svm_init_strings(SVM_Context *ctx);
+void svm_free_strings(SVM_StringArena *arena);
+bool svm_string(const SVM_Context *ctx, int handle, SVM_String *s);
+int svm_new_string(SVM_StringArena *arena, const char *a, uint32_t a_len,
+                   const char *b, uint32_t b_len);
+
+/* pool.c */
+SVM_ContextPool *svm_create_context_pool(const SVM_Program *program,
+                                         uint32_t size);
+void svm_delete_context_pool(SVM_ContextPool *pool);
+SVM_Context *svm_acquire_context(SVM_ContextPool *pool);
+void svm_release_context(SVM_ContextPool *pool, SVM_Context *ctx);
+
+/* snapshot.c */
+uint64_t svm_program_hash(const SVM_Program *program);
+SVM_Status svm_save_snapshot(SVM_Context *ctx, const char *path);
+SVM_Status svm_restore_snapshot(SVM_Context *ctx, const char *path);
+
+/* segment.c */
+SVM_Status svm_map_globals(SVM_Context *ctx, const char *path);
+SVM_Status svm_sync_globals(SVM_Context *ctx);
+
+/* scheduler.c */
+SVM_Scheduler *svm_create_scheduler(uint32_t worker_count, uint64_t slice);
+void svm_delete_scheduler(SVM_Scheduler *scheduler);
+SVM_Task *svm_scheduler_submit(SVM_Scheduler *scheduler, SVM_Context *ctx,
+                               SVM_Priority priority);
+void svm_scheduler_wait(SVM_Scheduler *scheduler);
+bool svm_task_done(SVM_Scheduler *scheduler, SVM_Task *task);
+void svm_task_release(SVM_Scheduler *scheduler, SVM_Task *task);
+SVM_Status svm_task_status(SVM_Task *task);
+uint64_t svm_task_latency(SVM_Task *task);
+void svm_scheduler_metrics(SVM_Scheduler *scheduler,
+                           SVM_SchedulerMetrics *metrics);
+uint64_t svm_latency_percentile(const SVM_SchedulerMetrics *metrics,
+                                double percentile);
+
+/* parallel.c */
+void svm_set_parallel_workers(uint32_t worker_count);
+SVM_Status svm_parallel_for(SVM_Context *ctx, uint16_t desc, int lower,
+                            int upper);
+SVM_Status svm_fork(SVM_Context *ctx, uint16_t segment_count);
+
+/* lanes.c */
+uint32_t svm_run_lanes(SVM_Context **ctxs, uint32_t lane_count);
+
+/* eventloop.c */
+SVM_EventLoop *svm_create_event_loop(uint64_t slice);
+void svm_delete_event_loop(SVM_EventLoop *loop);
+void svm_event_loop_submit(SVM_EventLoop *loop, SVM_Context *ctx);
+uint32_t svm_event_loop_run(SVM_EventLoop *loop);
+
+/* sweep.c */
+SVM_SweepTable *svm_read_sweep_binary(const SVM_Program *program, FILE *fp);
+SVM_SweepTable *svm_read_sweep_csv(const SVM_Program *program, FILE *fp);
+void svm_delete_sweep_table(SVM_SweepTable *table);
+SVM_SweepResult *svm_create_sweep_result(const SVM_Program *program,
+                                         uint32_t column_count,
+                                         const uint32_t *globals,
+                                         uint32_t row_count);
+void svm_delete_sweep_result(SVM_SweepResult *result);
+uint32_t svm_sweep(const SVM_Program *program, const SVM_SweepTable *input,
+                   SVM_SweepResult *result, uint32_t worker_count,
+                   bool use_lanes, FILE *out);
+bool svm_write_sweep_columns(const SVM_Program *program,
+                             const SVM_SweepResult *result, FILE *fp);
+bool svm_write_sweep_csv(const SVM_Program *program,
+                         const SVM_SweepResult *result, FILE *fp);
+
+/* cluster.c */
+uint32_t svm_sweep_processes(const SVM_Program *program,
+                             const SVM_SweepTable *input,
+                             SVM_SweepResult *result,
+                             const SVM_ClusterOptions *options, FILE *out);
+
+/* stream.c */
+SVM_RecordLayout *svm_parse_record_layout(const SVM_Program *program,
+                                          const char *spec);
+void svm_delete_record_layout(SVM_RecordLayout *layout);
+uint64_t svm_stream(const SVM_Program *program,
+                    const SVM_RecordLayout *input,
+                    const SVM_RecordLayout *output, int in_fd, int out_fd,
+                    uint32_t worker_count, FILE *out, uint64_t *failures);
 
 /* native.c */
-void add_native_functions(SVM_VirtualMachine *svm);
+void add_native_functions(SVM_Program *program);
+const SVM_Function *find_native_function(const char *name);
+int find_native_index(const char *name);
 #endif
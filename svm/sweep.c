@@ -0,0 +1,362 @@
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../memory/MEM.h"
+#include "svm.h"
+
+/*
+ * Parameter sweep: one program, many initial global vectors. Each row of
+ * the input table is bound to its globals after svm_init(), so only
+ * globals the program does not initialise itself act as inputs.
+ *
+ * Binary input table, native byte order:
+ *   "CSUAROWS" u32 column_count u32 row_count u32 globals[column_count]
+ *   then row_count * column_count 8-byte cells (int64 or double)
+ *
+ * CSV input table: a header line of global indices, then one row of values
+ * per line.
+ *
+ * Columnar output, native byte order:
+ *   "CSUACOLS" u32 column_count u32 row_count
+ *   column_count * (u32 global, u32 type)
+ *   column_count * row_count 8-byte cells, one column after another
+ *   row_count status bytes
+ */
+#define SWEEP_CHUNK (16)
+
+typedef struct {
+    const SVM_Program *program;
+    const SVM_SweepTable *input;
+    SVM_SweepResult *result;
+    FILE *out;
+    bool use_lanes;
+    uint32_t next_row;
+} SweepJob;
+
+/* False when iv does not fit the int global the cell is for. */
+static bool set_cell(SVM_Value *cell, uint8_t type, int64_t iv, double dv) {
+    memset(cell, 0, sizeof(SVM_Value));
+    if (type == SVM_DOUBLE) {
+        cell->dval = dv;
+    } else if (iv < INT_MIN || iv > INT_MAX) {
+        return false;
+    } else {
+        cell->ival = (int)iv;
+    }
+    return true;
+}
+
+/* False when fgets() stopped before the end of a line. */
+static bool whole_line(const char *line, FILE *fp) {
+    size_t len = strlen(line);
+    return (len > 0 && line[len - 1] == '\n') || feof(fp);
+}
+
+static bool check_globals(const SVM_Program *program, uint32_t count,
+                          const uint32_t *globals) {
+    for (uint32_t i = 0; i < count; ++i) {
+        if (globals[i] >= program->global_variable_count) return false;
+    }
+    return true;
+}
+
+static SVM_SweepTable *create_table(uint32_t column_count) {
+    SVM_SweepTable *table =
+        (SVM_SweepTable *)MEM_malloc(sizeof(SVM_SweepTable));
+    table->column_count = column_count;
+    table->globals = (uint32_t *)MEM_malloc(sizeof(uint32_t) * column_count);
+    table->row_count = 0;
+    table->rows = NULL;
+    return table;
+}
+
+void svm_delete_sweep_table(SVM_SweepTable *table) {
+    if (!table) return;
+    MEM_free(table->globals);
+    if (table->rows) MEM_free(table->rows);
+    MEM_free(table);
+}
+
+SVM_SweepTable *svm_read_sweep_binary(const SVM_Program *program, FILE *fp) {
+    char magic[8];
+    uint32_t column_count, row_count;
+    if (fread(magic, 1, 8, fp) != 8 || memcmp(magic, "CSUAROWS", 8) != 0 ||
+        fread(&column_count, sizeof(uint32_t), 1, fp) != 1 ||
+        fread(&row_count, sizeof(uint32_t), 1, fp) != 1 || column_count == 0) {
+        return NULL;
+    }
+    SVM_SweepTable *table = create_table(column_count);
+    if (fread(table->globals, sizeof(uint32_t), column_count, fp) !=
+            column_count ||
+        !check_globals(program, column_count, table->globals)) {
+        svm_delete_sweep_table(table);
+        return NULL;
+    }
+    table->row_count = row_count;
+    table->rows = (SVM_Value *)MEM_malloc(sizeof(SVM_Value) * column_count *
+                                          (row_count ? row_count : 1));
+    for (size_t i = 0; i < (size_t)row_count * column_count; ++i) {
+        union {
+            int64_t iv;
+            double dv;
+        } cell;
+        if (fread(&cell, 8, 1, fp) != 1) {
+            svm_delete_sweep_table(table);
+            return NULL;
+        }
+        uint8_t type =
+            program->global_variable_types[table->globals[i % column_count]];
+        if (!set_cell(&table->rows[i], type, cell.iv, cell.dv)) {
+            fprintf(stderr, "value out of range in row %zu column %zu\n",
+                    i / column_count + 1, i % column_count);
+            svm_delete_sweep_table(table);
+            return NULL;
+        }
+    }
+    return table;
+}
+
+static uint32_t count_fields(const char *line) {
+    uint32_t count = 1;
+    for (; *line; line++) {
+        if (*line == ',') count++;
+    }
+    return count;
+}
+
+SVM_SweepTable *svm_read_sweep_csv(const SVM_Program *program, FILE *fp) {
+    char line[4096];
+    if (fgets(line, sizeof(line), fp) == NULL) return NULL;
+    if (!whole_line(line, fp)) {
+        fprintf(stderr, "header longer than %zu bytes\n", sizeof(line) - 1);
+        return NULL;
+    }
+
+    SVM_SweepTable *table = create_table(count_fields(line));
+    char *pos = line;
+    for (uint32_t i = 0; i < table->column_count; ++i) {
+        table->globals[i] = (uint32_t)strtoul(pos, &pos, 10);
+        if (*pos == ',') pos++;
+    }
+    if (!check_globals(program, table->column_count, table->globals)) {
+        svm_delete_sweep_table(table);
+        return NULL;
+    }
+
+    uint32_t capacity = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        if (!whole_line(line, fp)) {
+            fprintf(stderr, "row %u longer than %zu bytes\n",
+                    table->row_count + 1, sizeof(line) - 1);
+            svm_delete_sweep_table(table);
+            return NULL;
+        }
+        if (line[0] == '\n' || line[0] == '\0') continue;
+        if (table->row_count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            table->rows = (SVM_Value *)MEM_realloc(
+                table->rows,
+                sizeof(SVM_Value) * table->column_count * capacity);
+        }
+        SVM_Value *row = &table->rows[table->row_count * table->column_count];
+        pos = line;
+        for (uint32_t i = 0; i < table->column_count; ++i) {
+            uint8_t type = program->global_variable_types[table->globals[i]];
+            char *end;
+            bool fits;
+            errno = 0;
+            if (type == SVM_DOUBLE) {
+                fits = set_cell(&row[i], type, 0, strtod(pos, &end));
+            } else {
+                fits = set_cell(&row[i], type, strtoll(pos, &end, 10), 0.0) &&
+                       errno != ERANGE;
+            }
+            if (end == pos || !fits) {
+                fprintf(stderr, "%s value in row %u column %u\n",
+                        end == pos ? "bad" : "out of range",
+                        table->row_count + 1, i);
+                svm_delete_sweep_table(table);
+                return NULL;
+            }
+            pos = (*end == ',') ? end + 1 : end;
+        }
+        table->row_count++;
+    }
+    return table;
+}
+
+SVM_SweepResult *svm_create_sweep_result(const SVM_Program *program,
+                                         uint32_t column_count,
+                                         const uint32_t *globals,
+                                         uint32_t row_count) {
+    if (!check_globals(program, column_count, globals)) return NULL;
+
+    SVM_SweepResult *result =
+        (SVM_SweepResult *)MEM_malloc(sizeof(SVM_SweepResult));
+    result->column_count = column_count;
+    result->row_count = row_count;
+    result->globals = (uint32_t *)MEM_malloc(sizeof(uint32_t) * column_count);
+    memcpy(result->globals, globals, sizeof(uint32_t) * column_count);
+    result->columns =
+        (SVM_Value **)MEM_malloc(sizeof(SVM_Value *) * column_count);
+    for (uint32_t i = 0; i < column_count; ++i) {
+        result->columns[i] = (SVM_Value *)MEM_malloc(
+            sizeof(SVM_Value) * (row_count ? row_count : 1));
+    }
+    result->status = (uint8_t *)MEM_malloc(row_count ? row_count : 1);
+    return result;
+}
+
+void svm_delete_sweep_result(SVM_SweepResult *result) {
+    if (!result) return;
+    for (uint32_t i = 0; i < result->column_count; ++i) {
+        MEM_free(result->columns[i]);
+    }
+    MEM_free(result->columns);
+    MEM_free(result->globals);
+    MEM_free(result->status);
+    MEM_free(result);
+}
+
+static void bind_row(SweepJob *job, SVM_Context *ctx, uint32_t row) {
+    const SVM_SweepTable *input = job->input;
+    svm_init(ctx);
+    const SVM_Value *values = &input->rows[(size_t)row * input->column_count];
+    for (uint32_t i = 0; i < input->column_count; ++i) {
+        ctx->global_variables[input->globals[i]] = values[i];
+    }
+}
+
+static void collect_row(SweepJob *job, SVM_Context *ctx, uint32_t row) {
+    SVM_SweepResult *result = job->result;
+    result->status[row] = ctx->status;
+    for (uint32_t i = 0; i < result->column_count; ++i) {
+        result->columns[i][row] = ctx->global_variables[result->globals[i]];
+    }
+}
+
+static void *sweep_worker(void *arg) {
+    SweepJob *job = (SweepJob *)arg;
+    uint32_t width = job->use_lanes ? SVM_LANES : 1;
+    SVM_Context *ctxs[SVM_LANES];
+    for (uint32_t l = 0; l < width; ++l) {
+        ctxs[l] = svm_create_context(job->program);
+        ctxs[l]->out = job->out;
+    }
+
+    for (;;) {
+        uint32_t row =
+            __atomic_fetch_add(&job->next_row, SWEEP_CHUNK, __ATOMIC_RELAXED);
+        if (row >= job->input->row_count) break;
+        uint32_t end = row + SWEEP_CHUNK;
+        if (end > job->input->row_count) end = job->input->row_count;
+        for (; row < end; row += width) {
+            uint32_t count = (end - row < width) ? end - row : width;
+            for (uint32_t l = 0; l < count; ++l) {
+                bind_row(job, ctxs[l], row + l);
+            }
+            if (job->use_lanes) {
+                svm_run_lanes(ctxs, count);
+            } else {
+                svm_run(ctxs[0]);
+            }
+            for (uint32_t l = 0; l < count; ++l) {
+                collect_row(job, ctxs[l], row + l);
+            }
+        }
+    }
+    for (uint32_t l = 0; l < width; ++l) {
+        svm_delete_context(ctxs[l]);
+    }
+    return NULL;
+}
+
+/*
+ * Run every input row on worker_count threads, one context per thread (or
+ * SVM_LANES with use_lanes, running rows lane-parallel), filling result in
+ * place. Returns the number of rows that did not finish.
+ */
+uint32_t svm_sweep(const SVM_Program *program, const SVM_SweepTable *input,
+                   SVM_SweepResult *result, uint32_t worker_count,
+                   bool use_lanes, FILE *out) {
+    SweepJob job;
+    job.program = program;
+    job.input = input;
+    job.result = result;
+    job.out = out;
+    job.use_lanes = use_lanes;
+    job.next_row = 0;
+
+    if (worker_count <= 1) {
+        sweep_worker(&job);
+    } else {
+        pthread_t *threads =
+            (pthread_t *)MEM_malloc(sizeof(pthread_t) * worker_count);
+        for (uint32_t i = 0; i < worker_count; ++i) {
+            pthread_create(&threads[i], NULL, sweep_worker, &job);
+        }
+        for (uint32_t i = 0; i < worker_count; ++i) {
+            pthread_join(threads[i], NULL);
+        }
+        MEM_free(threads);
+    }
+
+    uint32_t failures = 0;
+    for (uint32_t row = 0; row < input->row_count; ++row) {
+        if (result->status[row] != SVM_FINISHED) failures++;
+    }
+    return failures;
+}
+
+bool svm_write_sweep_columns(const SVM_Program *program,
+                             const SVM_SweepResult *result, FILE *fp) {
+    fwrite("CSUACOLS", 1, 8, fp);
+    fwrite(&result->column_count, sizeof(uint32_t), 1, fp);
+    fwrite(&result->row_count, sizeof(uint32_t), 1, fp);
+    for (uint32_t i = 0; i < result->column_count; ++i) {
+        uint32_t type = program->global_variable_types[result->globals[i]];
+        fwrite(&result->globals[i], sizeof(uint32_t), 1, fp);
+        fwrite(&type, sizeof(uint32_t), 1, fp);
+    }
+    for (uint32_t i = 0; i < result->column_count; ++i) {
+        uint8_t type = program->global_variable_types[result->globals[i]];
+        for (uint32_t row = 0; row < result->row_count; ++row) {
+            union {
+                int64_t iv;
+                double dv;
+            } cell;
+            if (type == SVM_DOUBLE) {
+                cell.dv = result->columns[i][row].dval;
+            } else {
+                cell.iv = result->columns[i][row].ival;
+            }
+            fwrite(&cell, 8, 1, fp);
+        }
+    }
+    fwrite(result->status, 1, result->row_count, fp);
+    return !ferror(fp);
+}
+
+bool svm_write_sweep_csv(const SVM_Program *program,
+                         const SVM_SweepResult *result, FILE *fp) {
+    for (uint32_t i = 0; i < result->column_count; ++i) {
+        fprintf(fp, "%u,", result->globals[i]);
+    }
+    fprintf(fp, "status\n");
+    for (uint32_t row = 0; row < result->row_count; ++row) {
+        for (uint32_t i = 0; i < result->column_count; ++i) {
+            if (program->global_variable_types[result->globals[i]] ==
+                SVM_DOUBLE) {
+                fprintf(fp, "%.17g,", result->columns[i][row].dval);
+            } else {
+                fprintf(fp, "%d,", result->columns[i][row].ival);
+            }
+        }
+        fprintf(fp, "%d\n", result->status[row]);
+    }
+    return !ferror(fp);
+}
@@ -0,0 +1,170 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../memory/MEM.h"
+#include "svm.h"
+
+static bool has_suffix(const char *str, const char *suffix) {
+    size_t len = strlen(str);
+    size_t slen = strlen(suffix);
+    return len >= slen && !strcmp(str + len - slen, suffix);
+}
+
+static uint32_t parse_globals(char *list, uint32_t **globals) {
+    uint32_t count = 1;
+    for (char *p = list; *p; p++) {
+        if (*p == ',') count++;
+    }
+    *globals = (uint32_t *)MEM_malloc(sizeof(uint32_t) * count);
+    for (uint32_t i = 0; i < count; ++i) {
+        (*globals)[i] = (uint32_t)strtoul(list, &list, 10);
+        if (*list == ',') list++;
+    }
+    return count;
+}
+
+static void usage() {
+    fprintf(stderr,
+            "Usage ./svmsweep -i input(.csv|.rows) -o output(.csv|.cols) "
+            "-g globals [-t threads] [-q] [-l] "
+            "[-p processes [-b batch] [-k batch]] file.csb\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    char *input_path = NULL;
+    char *output_path = NULL;
+    char *global_list = NULL;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    bool quiet = false;
+    bool use_lanes = false;
+    SVM_ClusterOptions cluster;
+    cluster.process_count = 0;
+    cluster.batch_rows = 1024;
+    cluster.max_attempts = 3;
+    cluster.kill_batch = -1;
+    int opt;
+    while ((opt = getopt(argc, argv, "i:o:g:t:qlp:b:k:")) != -1) {
+        switch (opt) {
+            case 'i': {
+                input_path = optarg;
+                break;
+            }
+            case 'o': {
+                output_path = optarg;
+                break;
+            }
+            case 'g': {
+                global_list = optarg;
+                break;
+            }
+            case 't': {
+                threads = atoi(optarg);
+                break;
+            }
+            case 'q': {
+                quiet = true;
+                break;
+            }
+            case 'l': {
+                use_lanes = true;
+                break;
+            }
+            case 'p': {
+                cluster.process_count = atoi(optarg);
+                break;
+            }
+            case 'b': {
+                cluster.batch_rows = atoi(optarg);
+                break;
+            }
+            case 'k': {
+                cluster.kill_batch = atoll(optarg);
+                break;
+            }
+            default: {
+                usage();
+            }
+        }
+    }
+    if (optind >= argc || !input_path || !output_path || !global_list ||
+        threads < 1) {
+        usage();
+    }
+
+    struct stat st;
+    if (stat(argv[optind], &st) != 0) {
+        fprintf(stderr, "Cannot find file %s\n", argv[optind]);
+        exit(1);
+    }
+    uint8_t *buf = (uint8_t *)malloc(st.st_size);
+    int fd = open(argv[optind], O_RDONLY);
+    ssize_t len = read(fd, buf, st.st_size);
+    close(fd);
+    SVM_Program *program = svm_create_program();
+    SVM_Status status = svm_load(program, buf, len < 0 ? 0 : len);
+    free(buf);
+    if (status != SVM_FINISHED) {
+        fprintf(stderr, "%s: %s\n", argv[optind], svm_status_message(status));
+        exit(1);
+    }
+    add_native_functions(program);
+
+    FILE *fp = fopen(input_path, "rb");
+    if (fp == NULL) {
+        fprintf(stderr, "Cannot find file %s\n", input_path);
+        exit(1);
+    }
+    SVM_SweepTable *input = has_suffix(input_path, ".csv")
+                                ? svm_read_sweep_csv(program, fp)
+                                : svm_read_sweep_binary(program, fp);
+    fclose(fp);
+    if (input == NULL) {
+        fprintf(stderr, "%s: broken input table\n", input_path);
+        exit(1);
+    }
+
+    uint32_t *globals;
+    uint32_t global_count = parse_globals(global_list, &globals);
+    SVM_SweepResult *result = svm_create_sweep_result(
+        program, global_count, globals, input->row_count);
+    if (result == NULL) {
+        fprintf(stderr, "no such global in %s\n", global_list);
+        exit(1);
+    }
+
+    FILE *out = quiet ? fopen("/dev/null", "w") : stdout;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint32_t failures =
+        cluster.process_count
+            ? svm_sweep_processes(program, input, result, &cluster, out)
+            : svm_sweep(program, input, result, threads, use_lanes, out);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds =
+        (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    fprintf(stderr, "%u rows, %u failed, %.4f s, %.0f rows/sec\n",
+            input->row_count, failures, seconds,
+            input->row_count / (seconds > 0 ? seconds : 1e-9));
+
+    fp = fopen(output_path, "wb");
+    bool written = fp && (has_suffix(output_path, ".csv")
+                              ? svm_write_sweep_csv(program, result, fp)
+                              : svm_write_sweep_columns(program, result, fp));
+    if (fp) fclose(fp);
+    if (!written) {
+        fprintf(stderr, "Cannot write file %s\n", output_path);
+    }
+
+    if (quiet) fclose(out);
+    svm_delete_sweep_result(result);
+    svm_delete_sweep_table(input);
+    MEM_free(globals);
+    svm_delete_program(program);
+    return (written && failures == 0) ? 0 : 1;
+}
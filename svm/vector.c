@@ -0,0 +1,231 @@
+#include <string.h>
+
+#include "svm.h"
+
+/*
+ * Lane-wise kernels of the int4 and double4 opcodes. A vector is
+ * SVM_VECTOR_LANES stack slots, so a double4 loads straight into one
+ * 256-bit register (two SSE registers without AVX). The slots of an int4
+ * hold an int in their low half each; the lanes are widened to 64 bits,
+ * which wraps add, sub and mul exactly as int does, and sign extended
+ * where the upper half matters. Slots are only 8-byte aligned, so every
+ * load and store goes through memcpy and compiles to unaligned moves.
+ */
+typedef double Double4 __attribute__((vector_size(32)));
+typedef int64_t Long4 __attribute__((vector_size(32)));
+
+#define LOAD(v, a) memcpy(&(v), (a), sizeof(v))
+#define STORE(a, v) memcpy((a), &(v), sizeof(v))
+#define SIGN_EXTEND(v) ((v) = ((v) << 32) >> 32)
+
+// lanes 2, 3, 0, 1: folds the upper half onto the lower one
+static const Long4 swap_halves = {2, 3, 0, 1};
+
+/* a = a op b for the ADD, SUB, MUL and DIV vector opcodes. */
+void svm_vector_arith(uint8_t op, SVM_Value *a, const SVM_Value *b) {
+    Long4 la, lb;
+    Double4 da, db;
+    switch (op) {
+        case SVM_ADD_INT4:
+        case SVM_SUB_INT4:
+        case SVM_MUL_INT4: {
+            LOAD(la, a);
+            LOAD(lb, b);
+            la = op == SVM_ADD_INT4   ? la + lb
+                 : op == SVM_SUB_INT4 ? la - lb
+                                      : la * lb;
+            STORE(a, la);
+            break;
+        }
+        default: {
+            LOAD(da, a);
+            LOAD(db, b);
+            da = op == SVM_ADD_DOUBLE4   ? da + db
+                 : op == SVM_SUB_DOUBLE4 ? da - db
+                 : op == SVM_MUL_DOUBLE4 ? da * db
+                                         : da / db;
+            STORE(a, da);
+            break;
+        }
+    }
+}
+
+/* Negation and the int4 / double4 conversions, in place. */
+void svm_vector_unary(uint8_t op, SVM_Value *a) {
+    Long4 l;
+    Double4 d;
+    switch (op) {
+        case SVM_MINUS_INT4: {
+            LOAD(l, a);
+            l = -l;
+            STORE(a, l);
+            break;
+        }
+        case SVM_MINUS_DOUBLE4: {
+            LOAD(d, a);
+            d = -d;
+            STORE(a, d);
+            break;
+        }
+        case SVM_INT4_TO_DOUBLE4: {
+            LOAD(l, a);
+            SIGN_EXTEND(l);
+            d = __builtin_convertvector(l, Double4);
+            STORE(a, d);
+            break;
+        }
+        default: {  // SVM_DOUBLE4_TO_INT4, truncating like a cast
+            LOAD(d, a);
+            l = __builtin_convertvector(d, Long4);
+            STORE(a, l);
+            break;
+        }
+    }
+}
+
+// false from the enclosing function on an unknown comparison
+#define COMPARE(mask, x, y, comparison) \
+    switch (comparison) {               \
+        case SVM_COMPARE_EQ: {          \
+            mask = x == y;              \
+            break;                      \
+        }                               \
+        case SVM_COMPARE_NE: {          \
+            mask = x != y;              \
+            break;                      \
+        }                               \
+        case SVM_COMPARE_LT: {          \
+            mask = x < y;               \
+            break;                      \
+        }                               \
+        case SVM_COMPARE_LE: {          \
+            mask = x <= y;              \
+            break;                      \
+        }                               \
+        case SVM_COMPARE_GT: {          \
+            mask = x > y;               \
+            break;                      \
+        }                               \
+        case SVM_COMPARE_GE: {          \
+            mask = x >= y;              \
+            break;                      \
+        }                               \
+        default: {                      \
+            return false;               \
+        }                               \
+    }
+
+/*
+ * a = the int4 of 1 where a comparison b holds and 0 elsewhere. false on a
+ * comparison that is not an SVM_Comparison.
+ */
+bool svm_vector_compare(uint8_t op, int comparison, SVM_Value *a,
+                        const SVM_Value *b) {
+    Long4 mask;
+    if (op == SVM_COMPARE_INT4) {
+        Long4 x, y;
+        LOAD(x, a);
+        LOAD(y, b);
+        SIGN_EXTEND(x);
+        SIGN_EXTEND(y);
+        COMPARE(mask, x, y, comparison);
+    } else {
+        Double4 x, y;
+        LOAD(x, a);
+        LOAD(y, b);
+        COMPARE(mask, x, y, comparison);
+    }
+    mask &= 1;
+    STORE(a, mask);
+    return true;
+}
+
+/*
+ * The lanes of a folded by the SUM, MIN, MAX, ALL or ANY opcode op, in
+ * two pairwise steps.
+ */
+SVM_Value svm_vector_reduce(uint8_t op, const SVM_Value *a) {
+    SVM_Value v;
+    switch (op) {
+        case SVM_SUM_DOUBLE4:
+        case SVM_MIN_DOUBLE4:
+        case SVM_MAX_DOUBLE4: {
+            Double4 d, h;
+            LOAD(d, a);
+            h = __builtin_shuffle(d, swap_halves);
+            if (op == SVM_SUM_DOUBLE4) {
+                d += h;
+                v.dval = d[0] + d[1];
+            } else {
+                Long4 take = op == SVM_MIN_DOUBLE4 ? h < d : h > d;
+                d = (Double4)(((Long4)h & take) | ((Long4)d & ~take));
+                v.dval = op == SVM_MIN_DOUBLE4 ? (d[1] < d[0] ? d[1] : d[0])
+                                               : (d[1] > d[0] ? d[1] : d[0]);
+            }
+            break;
+        }
+        default: {
+            Long4 l, h;
+            LOAD(l, a);
+            SIGN_EXTEND(l);
+            h = __builtin_shuffle(l, swap_halves);
+            switch (op) {
+                case SVM_SUM_INT4: {
+                    l += h;
+                    v.ival = (int)(l[0] + l[1]);
+                    break;
+                }
+                case SVM_MIN_INT4:
+                case SVM_MAX_INT4: {
+                    Long4 take = op == SVM_MIN_INT4 ? h < l : h > l;
+                    l = (h & take) | (l & ~take);
+                    v.ival = (int)(op == SVM_MIN_INT4
+                                       ? (l[1] < l[0] ? l[1] : l[0])
+                                       : (l[1] > l[0] ? l[1] : l[0]));
+                    break;
+                }
+                case SVM_ALL_INT4: {
+                    l = (l != 0) & (h != 0);
+                    v.ival = (l[0] & l[1]) != 0;
+                    break;
+                }
+                default: {  // SVM_ANY_INT4
+                    l |= h;
+                    v.ival = (l[0] | l[1]) != 0;
+                    break;
+                }
+            }
+            break;
+        }
+    }
+    return v;
+}
+
+/* The sum of the lane-wise products of a and b. */
+SVM_Value svm_vector_dot(uint8_t op, const SVM_Value *a, const SVM_Value *b) {
+    SVM_Value v;
+    if (op == SVM_DOT_DOUBLE4) {
+        Double4 x, y;
+        SVM_Value p[SVM_VECTOR_LANES];
+        LOAD(x, a);
+        LOAD(y, b);
+        x *= y;
+        STORE(p, x);
+        return svm_vector_reduce(SVM_SUM_DOUBLE4, p);
+    }
+    Long4 x, y;
+    LOAD(x, a);
+    LOAD(y, b);
+    x *= y;
+    v.ival = (int)(x[0] + x[1] + x[2] + x[3]);
+    return v;
+}
+
+/* Lane i of a becomes lane (lanes >> 2 * i) & 3 of the old a. */
+void svm_vector_shuffle(SVM_Value *a, int lanes) {
+    Long4 l, select = {lanes & 3, (lanes >> 2) & 3, (lanes >> 4) & 3,
+                       (lanes >> 6) & 3};
+    LOAD(l, a);
+    l = __builtin_shuffle(l, select);
+    STORE(a, l);
+}